@@ -0,0 +1,140 @@
+/*--------------------------------------------------------------------*/
+/* benchsymtableborrow.c                                            */
+/* Author: Kevin Chen                                               */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "symtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/* Note: This program measures what SYMTABLE_BORROW_KEYS saves. It puts
+   the same keys, which all live in one buffer made beforehand, into a
+   SymTable that copies them and into one that borrows them, and
+   writes the time the puts took and how much the peak memory of the
+   process grew. Each SymTable is built in a child process of its own,
+   so that neither reuses the memory the other freed. */
+
+/*--------------------------------------------------------------------*/
+
+enum {MAX_KEY_LENGTH = 24};
+
+/* Return the wall clock time in seconds. */
+
+static double now(void)
+{
+   struct timespec sTime;
+   clock_gettime(CLOCK_MONOTONIC, &sTime);
+   return (double)sTime.tv_sec + (double)sTime.tv_nsec / 1e9;
+}
+
+/* Return the peak memory of the process in KiB. */
+
+static long peakKiB(void)
+{
+   struct rusage sUsage;
+   getrusage(RUSAGE_SELF, &sUsage);
+   return sUsage.ru_maxrss;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put the iKeyCount keys of paacKeys into a SymTable made with
+   uFlags, and write the time it took and the growth of peak memory
+   with the label pcMode. */
+
+static void run(const char *pcMode, unsigned int uFlags,
+   char (*paacKeys)[MAX_KEY_LENGTH], int iKeyCount)
+{
+   SymTable_T oSymTable;
+   long lBefore;
+   double dStart;
+   double dSeconds;
+   int k;
+
+   lBefore = peakKiB();
+   dStart = now();
+   oSymTable = SymTable_newWithFlags(uFlags);
+   if (oSymTable == NULL)
+   {
+      fprintf(stderr, "out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   for (k = 0; k < iKeyCount; k++)
+      if (! SymTable_put(oSymTable, paacKeys[k], paacKeys[k]))
+      {
+         fprintf(stderr, "out of memory\n");
+         exit(EXIT_FAILURE);
+      }
+   dSeconds = now() - dStart;
+   printf("%-8s %10.3f %14ld\n", pcMode, dSeconds, peakKiB() - lBefore);
+   fflush(stdout);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put iKeyCount keys, argv[1] or 1000000, of argv[2] or 16
+   characters, copying them and borrowing them, and write the times
+   and memory to stdout. */
+
+int main(int argc, char *argv[])
+{
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   int iKeyCount = 1000000;
+   int iKeyLength = 16;
+   int iMode;
+   pid_t iChild;
+   int k;
+
+   if (argc > 1)
+      iKeyCount = atoi(argv[1]);
+   if (argc > 2)
+      iKeyLength = atoi(argv[2]);
+   if (iKeyCount < 1 || iKeyLength < 8 || iKeyLength >= MAX_KEY_LENGTH)
+   {
+      fprintf(stderr, "Usage: %s [keycount [keylength 8 to %d]]\n",
+         argv[0], MAX_KEY_LENGTH - 1);
+      exit(EXIT_FAILURE);
+   }
+
+   paacKeys = malloc(sizeof(*paacKeys) * (size_t)iKeyCount);
+   if (paacKeys == NULL)
+   {
+      fprintf(stderr, "out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   for (k = 0; k < iKeyCount; k++)
+      sprintf(paacKeys[k], "%0*d", iKeyLength, k);
+
+   printf("%d keys of %d characters\n", iKeyCount, iKeyLength);
+   printf("mode     puts (s)   peak growth (KiB)\n");
+   fflush(stdout);
+   for (iMode = 0; iMode < 2; iMode++)
+   {
+      iChild = fork();
+      if (iChild < 0)
+      {
+         fprintf(stderr, "cannot fork\n");
+         exit(EXIT_FAILURE);
+      }
+      if (iChild == 0)
+      {
+         if (iMode == 0)
+            run("copy", 0, paacKeys, iKeyCount);
+         else
+            run("borrow", SYMTABLE_BORROW_KEYS, paacKeys, iKeyCount);
+         exit(EXIT_SUCCESS);
+      }
+      waitpid(iChild, NULL, 0);
+   }
+
+   free(paacKeys);
+   return 0;
+}
@@ -0,0 +1,193 @@
+/*--------------------------------------------------------------------*/
+/* benchsymtablefrozen.c                                            */
+/* Author: Kevin Chen                                               */
+/*--------------------------------------------------------------------*/
+
+#define _DEFAULT_SOURCE
+
+#include "symtablefrozen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+/* Note: This program measures what a FrozenTable saves. It makes
+   keys like the mangled names of a large program, which share long
+   prefixes, puts them into a SymTable and makes a FrozenTable of it,
+   then writes the bytes per key each takes and the time lookups in a
+   random order take in each. The bytes of the SymTable are what the
+   heap grew by while it was built, which the C library reports where
+   it is glibc, and are written as n/a otherwise. The bytes of the
+   FrozenTable are those of its keys and its array of values. */
+
+/*--------------------------------------------------------------------*/
+
+enum {MAX_KEY_LENGTH = 64};
+
+/* Return the wall clock time in seconds. */
+
+static double now(void)
+{
+   struct timespec sTime;
+   clock_gettime(CLOCK_MONOTONIC, &sTime);
+   return (double)sTime.tv_sec + (double)sTime.tv_nsec / 1e9;
+}
+
+/* Return how many bytes of the heap are in use, or 0 if that is not
+   known. */
+
+static size_t heapBytes(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+   struct mallinfo2 sInfo = mallinfo2();
+   return sInfo.uordblks + sInfo.hblkhd;
+#else
+   return 0;
+#endif
+}
+
+/* Write the key of symbol k into pcKey, as a name in one of a few
+   namespaces and classes. */
+
+static void makeKey(char *pcKey, int k)
+{
+   static const char *apcSpaces[] = {"llvm", "clang", "mlir", "lld"};
+   sprintf(pcKey, "_ZN%s%d%s%dClass%d%dmethod%dEv",
+      apcSpaces[k % 4], 10 + k % 3, "detail", k % 11, k % 251,
+      k / 251 % 10, k);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Look up the iLookupCount keys of paacKeys in the order of aiOrder
+   with pfGet on pvTable, and return the seconds it took. */
+
+static double timeLookups(void *(*pfGet)(void *pvTable, const char *pcKey),
+   void *pvTable, char (*paacKeys)[MAX_KEY_LENGTH], const int *aiOrder,
+   int iLookupCount)
+{
+   double dStart;
+   int iFound = 0;
+   int k;
+
+   dStart = now();
+   for (k = 0; k < iLookupCount; k++)
+      if ((*pfGet)(pvTable, paacKeys[aiOrder[k]]) != NULL)
+         iFound++;
+   if (iFound != iLookupCount)
+   {
+      fprintf(stderr, "lookup failed\n");
+      exit(EXIT_FAILURE);
+   }
+   return now() - dStart;
+}
+
+/* Call SymTable_get on the SymTable pvTable. */
+
+static void *getSymTable(void *pvTable, const char *pcKey)
+{
+   return SymTable_get((SymTable_T)pvTable, pcKey);
+}
+
+/* Call FrozenTable_get on the FrozenTable pvTable. */
+
+static void *getFrozenTable(void *pvTable, const char *pcKey)
+{
+   return FrozenTable_get((FrozenTable_T)pvTable, pcKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put iKeyCount keys, argv[1] or 1000000, into a SymTable and make a
+   FrozenTable of it, look up iLookupCount of them, argv[2] or
+   10000000, in a random order in each, and write the bytes per key
+   and the times to stdout. */
+
+int main(int argc, char *argv[])
+{
+   SymTable_T oSymTable;
+   FrozenTable_T oFrozenTable;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   int *aiOrder;
+   int iKeyCount = 1000000;
+   int iLookupCount = 10000000;
+   size_t uRawBytes = 0;
+   size_t uHeapBefore;
+   size_t uHeapAfter;
+   double dSeconds;
+   int k;
+
+   if (argc > 1)
+      iKeyCount = atoi(argv[1]);
+   if (argc > 2)
+      iLookupCount = atoi(argv[2]);
+   if (iKeyCount < 1 || iLookupCount < 1)
+   {
+      fprintf(stderr, "Usage: %s [keycount [lookupcount]]\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   paacKeys = malloc(sizeof(*paacKeys) * (size_t)iKeyCount);
+   aiOrder = malloc(sizeof(*aiOrder) * (size_t)iLookupCount);
+   if (paacKeys == NULL || aiOrder == NULL)
+   {
+      fprintf(stderr, "out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   for (k = 0; k < iKeyCount; k++)
+   {
+      makeKey(paacKeys[k], k);
+      uRawBytes += strlen(paacKeys[k]) + 1;
+   }
+   srand(1);
+   for (k = 0; k < iLookupCount; k++)
+      aiOrder[k] = (int)(((double)rand() / ((double)RAND_MAX + 1.0)) *
+         iKeyCount);
+
+   uHeapBefore = heapBytes();
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL)
+   {
+      fprintf(stderr, "out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   for (k = 0; k < iKeyCount; k++)
+      if (! SymTable_put(oSymTable, paacKeys[k], paacKeys[k]))
+      {
+         fprintf(stderr, "out of memory\n");
+         exit(EXIT_FAILURE);
+      }
+   uHeapAfter = heapBytes();
+   oFrozenTable = FrozenTable_fromSymTable(oSymTable);
+   if (oFrozenTable == NULL)
+   {
+      fprintf(stderr, "out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+
+   printf("%d keys of %.1f bytes, %d lookups\n", iKeyCount,
+      (double)uRawBytes / iKeyCount, iLookupCount);
+   printf("table    bytes/key   lookups (s)\n");
+   dSeconds = timeLookups(getSymTable, oSymTable, paacKeys, aiOrder,
+      iLookupCount);
+   if (uHeapAfter == 0)
+      printf("%-8s %9s %13.3f\n", "symtable", "n/a", dSeconds);
+   else
+      printf("%-8s %9.1f %13.3f\n", "symtable",
+         (double)(uHeapAfter - uHeapBefore) / iKeyCount, dSeconds);
+   dSeconds = timeLookups(getFrozenTable, oFrozenTable, paacKeys,
+      aiOrder, iLookupCount);
+   printf("%-8s %9.1f %13.3f\n", "frozen",
+      (double)(FrozenTable_getKeyBytes(oFrozenTable) +
+      (size_t)iKeyCount * sizeof(void*)) / iKeyCount,
+      dSeconds);
+
+   FrozenTable_free(oFrozenTable);
+   SymTable_free(oSymTable);
+   free(paacKeys);
+   free(aiOrder);
+   return 0;
+}
@@ -0,0 +1,226 @@
+/*--------------------------------------------------------------------*/
+/* benchsymtablehuge.c                                              */
+/* Author: Kevin Chen                                               */
+/*--------------------------------------------------------------------*/
+
+#define _DEFAULT_SOURCE
+
+#include "symtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+/* Note: This program measures what SYMTABLE_HUGE_PAGES and
+   SymTable_newOnNode save. It puts the same keys into a SymTable with
+   an ordinary bucket array, one in huge pages and, if a NUMA node is
+   given, one in huge pages on that node, then looks keys up in a
+   random order and writes the time the lookups took and the data TLB
+   misses they caused. The misses come from the perf counters where
+   the system has them, and are written as n/a otherwise. Each
+   SymTable is built in a child process of its own, so that none
+   reuses the memory another freed. */
+
+/*--------------------------------------------------------------------*/
+
+enum {MAX_KEY_LENGTH = 24};
+
+/* Return the wall clock time in seconds. */
+
+static double now(void)
+{
+   struct timespec sTime;
+   clock_gettime(CLOCK_MONOTONIC, &sTime);
+   return (double)sTime.tv_sec + (double)sTime.tv_nsec / 1e9;
+}
+
+/* Return a disabled counter of the data TLB misses of the calling
+   process, or -1 if there is none. */
+
+static int openTlbCounter(void)
+{
+#if defined(__linux__) && defined(SYS_perf_event_open)
+   struct perf_event_attr sAttr;
+   memset(&sAttr, 0, sizeof(sAttr));
+   sAttr.type = PERF_TYPE_HW_CACHE;
+   sAttr.size = sizeof(sAttr);
+   sAttr.config = PERF_COUNT_HW_CACHE_DTLB |
+      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+   sAttr.disabled = 1;
+   sAttr.exclude_kernel = 1;
+   sAttr.exclude_hv = 1;
+   return (int)syscall(SYS_perf_event_open, &sAttr, 0, -1, -1, 0);
+#else
+   return -1;
+#endif
+}
+
+/* Start the counter iCounter from 0, or stop it and return its count
+   if iStart is 0. Return -1 if there is no counter. */
+
+static long long tlbCounter(int iCounter, int iStart)
+{
+#if defined(__linux__) && defined(SYS_perf_event_open)
+   long long llCount;
+   if (iCounter < 0)
+      return -1;
+   if (iStart)
+   {
+      ioctl(iCounter, PERF_EVENT_IOC_RESET, 0);
+      ioctl(iCounter, PERF_EVENT_IOC_ENABLE, 0);
+      return 0;
+   }
+   ioctl(iCounter, PERF_EVENT_IOC_DISABLE, 0);
+   if (read(iCounter, &llCount, sizeof(llCount)) != sizeof(llCount))
+      return -1;
+   return llCount;
+#else
+   (void)iCounter;
+   (void)iStart;
+   return -1;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put the iKeyCount keys of paacKeys into a SymTable made with
+   uFlags on NUMA node iNode, or on none if it is -1, then look up
+   iLookupCount keys in the order of aiOrder, and write the time the
+   lookups took and their TLB misses with the label pcMode. */
+
+static void run(const char *pcMode, unsigned int uFlags, int iNode,
+   char (*paacKeys)[MAX_KEY_LENGTH], int iKeyCount,
+   const int *aiOrder, int iLookupCount)
+{
+   SymTable_T oSymTable;
+   double dStart;
+   double dSeconds;
+   long long llMisses;
+   int iCounter;
+   int iFound = 0;
+   int k;
+
+   oSymTable = SymTable_newOnNode(uFlags, iNode);
+   if (oSymTable == NULL)
+   {
+      fprintf(stderr, "out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   for (k = 0; k < iKeyCount; k++)
+      if (! SymTable_put(oSymTable, paacKeys[k], paacKeys[k]))
+      {
+         fprintf(stderr, "out of memory\n");
+         exit(EXIT_FAILURE);
+      }
+   iCounter = openTlbCounter();
+   dStart = now();
+   tlbCounter(iCounter, 1);
+   for (k = 0; k < iLookupCount; k++)
+      if (SymTable_get(oSymTable, paacKeys[aiOrder[k]]) != NULL)
+         iFound++;
+   llMisses = tlbCounter(iCounter, 0);
+   dSeconds = now() - dStart;
+   if (iFound != iLookupCount)
+   {
+      fprintf(stderr, "lookup failed\n");
+      exit(EXIT_FAILURE);
+   }
+   if (llMisses < 0)
+      printf("%-8s %12.3f %16s\n", pcMode, dSeconds, "n/a");
+   else
+      printf("%-8s %12.3f %16lld\n", pcMode, dSeconds, llMisses);
+   fflush(stdout);
+   if (iCounter >= 0)
+      close(iCounter);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put iKeyCount keys, argv[1] or 60000, look up iLookupCount of them,
+   argv[2] or 10000000, in a random order, in a SymTable of each mode,
+   the last of them on NUMA node argv[3] if it is given, and write the
+   times and TLB misses to stdout. */
+
+int main(int argc, char *argv[])
+{
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   int *aiOrder;
+   int iKeyCount = 60000;
+   int iLookupCount = 10000000;
+   int iNode = -1;
+   int iModeCount = 2;
+   int iMode;
+   pid_t iChild;
+   int k;
+
+   if (argc > 1)
+      iKeyCount = atoi(argv[1]);
+   if (argc > 2)
+      iLookupCount = atoi(argv[2]);
+   if (argc > 3)
+   {
+      iNode = atoi(argv[3]);
+      iModeCount = 3;
+   }
+   if (iKeyCount < 1 || iLookupCount < 1 || (argc > 3 && iNode < 0))
+   {
+      fprintf(stderr, "Usage: %s [keycount [lookupcount [node]]]\n",
+         argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   paacKeys = malloc(sizeof(*paacKeys) * (size_t)iKeyCount);
+   aiOrder = malloc(sizeof(*aiOrder) * (size_t)iLookupCount);
+   if (paacKeys == NULL || aiOrder == NULL)
+   {
+      fprintf(stderr, "out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   for (k = 0; k < iKeyCount; k++)
+      sprintf(paacKeys[k], "%016d", k);
+   srand(1);
+   for (k = 0; k < iLookupCount; k++)
+      aiOrder[k] = (int)(((double)rand() / ((double)RAND_MAX + 1.0)) *
+         iKeyCount);
+
+   printf("%d keys, %d lookups\n", iKeyCount, iLookupCount);
+   printf("mode     lookups (s)   dTLB misses\n");
+   fflush(stdout);
+   for (iMode = 0; iMode < iModeCount; iMode++)
+   {
+      iChild = fork();
+      if (iChild < 0)
+      {
+         fprintf(stderr, "cannot fork\n");
+         exit(EXIT_FAILURE);
+      }
+      if (iChild == 0)
+      {
+         if (iMode == 0)
+            run("plain", 0, -1, paacKeys, iKeyCount, aiOrder,
+               iLookupCount);
+         else if (iMode == 1)
+            run("huge", SYMTABLE_HUGE_PAGES, -1, paacKeys, iKeyCount,
+               aiOrder, iLookupCount);
+         else
+            run("node", SYMTABLE_HUGE_PAGES, iNode, paacKeys, iKeyCount,
+               aiOrder, iLookupCount);
+         exit(EXIT_SUCCESS);
+      }
+      waitpid(iChild, NULL, 0);
+   }
+
+   free(paacKeys);
+   free(aiOrder);
+   return 0;
+}
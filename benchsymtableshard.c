@@ -0,0 +1,154 @@
+/*--------------------------------------------------------------------*/
+/* benchsymtableshard.c                                             */
+/* Author: Kevin Chen                                               */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "symtableshard.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+/* Note: This program measures how puts and gets scale with the number
+   of threads, for a ShardTable of one shard, which is one SymTable
+   behind one lock, and for one of many shards. Every thread puts and
+   then gets keys of its own, so the only contention is over the
+   locks and whatever the threads share in memory. */
+
+/*--------------------------------------------------------------------*/
+
+enum {MAX_KEY_LENGTH = 12, SHARD_COUNT = 64};
+
+/* Worker is what one thread does: put and then get the keys
+   paacKeys[0] up to but not including paacKeys[iCount]. */
+struct Worker
+{
+   ShardTable_T oShardTable;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   int iCount;
+   pthread_t sThread;
+};
+
+static void *runWorker(void *pvWorker)
+{
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   int k;
+   for (k = 0; k < psWorker->iCount; k++)
+      ShardTable_put(psWorker->oShardTable, psWorker->paacKeys[k],
+         psWorker->paacKeys[k]);
+   for (k = 0; k < psWorker->iCount; k++)
+      if (ShardTable_get(psWorker->oShardTable, psWorker->paacKeys[k]) !=
+         psWorker->paacKeys[k])
+         fprintf(stderr, "lost key %s\n", psWorker->paacKeys[k]);
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the wall clock time in seconds. */
+
+static double now(void)
+{
+   struct timespec sTime;
+   clock_gettime(CLOCK_MONOTONIC, &sTime);
+   return (double)sTime.tv_sec + (double)sTime.tv_nsec / 1e9;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put and get the iKeyCount keys of paacKeys with iThreads threads in
+   a new ShardTable of uShards shards. Return the seconds taken. */
+
+static double run(char (*paacKeys)[MAX_KEY_LENGTH], int iKeyCount,
+   int iThreads, size_t uShards)
+{
+   ShardTable_T oShardTable;
+   struct Worker *psWorkers;
+   double dStart;
+   double dSeconds;
+   int t;
+
+   oShardTable = ShardTable_new(uShards, 0);
+   psWorkers = malloc(sizeof(*psWorkers) * (size_t)iThreads);
+   if (oShardTable == NULL || psWorkers == NULL)
+   {
+      fprintf(stderr, "out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   dStart = now();
+   for (t = 0; t < iThreads; t++)
+   {
+      psWorkers[t].oShardTable = oShardTable;
+      psWorkers[t].paacKeys = &paacKeys[t * (iKeyCount / iThreads)];
+      psWorkers[t].iCount = iKeyCount / iThreads;
+      if (pthread_create(&psWorkers[t].sThread, NULL, runWorker,
+         &psWorkers[t]) != 0)
+      {
+         fprintf(stderr, "cannot start thread\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+   for (t = 0; t < iThreads; t++)
+      pthread_join(psWorkers[t].sThread, NULL);
+   dSeconds = now() - dStart;
+   ShardTable_free(oShardTable);
+   free(psWorkers);
+   return dSeconds;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Time iKeyCount puts and gets, argv[1] or 1000000, for 1, 2, 4 and
+   so on up to iMaxThreads threads, argv[2] or 64, with one shard and
+   with SHARD_COUNT shards, and write the times to stdout. */
+
+int main(int argc, char *argv[])
+{
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   int iKeyCount = 1000000;
+   int iMaxThreads = 64;
+   double dOne;
+   double dMany;
+   double dBase = 0.0;
+   int iThreads;
+   int k;
+
+   if (argc > 1)
+      iKeyCount = atoi(argv[1]);
+   if (argc > 2)
+      iMaxThreads = atoi(argv[2]);
+   if (iKeyCount < 1 || iMaxThreads < 1)
+   {
+      fprintf(stderr, "Usage: %s [keycount [maxthreads]]\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   paacKeys = malloc(sizeof(*paacKeys) * (size_t)iKeyCount);
+   if (paacKeys == NULL)
+   {
+      fprintf(stderr, "out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   for (k = 0; k < iKeyCount; k++)
+      sprintf(paacKeys[k], "%d", k);
+
+   printf("%d keys put and got, %d shards against 1\n", iKeyCount,
+      SHARD_COUNT);
+   printf("threads  1 shard (s)  %d shards (s)  speedup over 1 thread\n",
+      SHARD_COUNT);
+   for (iThreads = 1; iThreads <= iMaxThreads; iThreads *= 2)
+   {
+      dOne = run(paacKeys, iKeyCount, iThreads, 1);
+      dMany = run(paacKeys, iKeyCount, iThreads, SHARD_COUNT);
+      if (iThreads == 1)
+         dBase = dMany;
+      printf("%7d  %11.3f  %13.3f  %21.2f\n", iThreads, dOne, dMany,
+         dBase / dMany);
+      fflush(stdout);
+   }
+
+   free(paacKeys);
+   return 0;
+}
@@ -7,6 +7,11 @@
 #define symtableH
 
 #include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /* SymTable_T is a pointer to a SymTable */
 typedef struct SymTable *SymTable_T;
@@ -15,14 +20,176 @@ typedef struct SymTable *SymTable_T;
     stores key value binding pairs. Returns the SymTable_T*/
 SymTable_T SymTable_new(void);
 
+/* SYMTABLE_HARDENED asks for a SymTable whose hash function is keyed
+    with a random seed, so that keys from an untrusted source cannot
+    be chosen to collide. Implementations that do not hash ignore it.
+    A hash table made without it still switches to such a keyed hash
+    by itself once one bucket holds far more keys than the average,
+    which changes the order SymTable_map visits bindings in and makes
+    each hash a little slower from then on. */
+#define SYMTABLE_HARDENED 0x1u
+
+/* SYMTABLE_MOVE_TO_FRONT asks for a SymTable that moves each binding
+    found by SymTable_contains, SymTable_get or SymTable_replace to the
+    front of the list it is kept in, and SYMTABLE_TRANSPOSE for one
+    that moves it one place forward. Either way, frequently used keys
+    are found in fewer steps. If both are given, SYMTABLE_MOVE_TO_FRONT
+    is used. */
+#define SYMTABLE_MOVE_TO_FRONT 0x2u
+#define SYMTABLE_TRANSPOSE 0x4u
+
+/* SYMTABLE_DEFER_FREE asks for a SymTable whose SymTable_remove takes
+    the binding out at once but leaves freeing its memory for later: a
+    few bindings at a time in later calls to SymTable_put, or in
+    batches through SymTable_reclaim. Removing then costs the same
+    whatever free would have cost. Implementations whose removal does
+    more work than the freeing ignore it. */
+#define SYMTABLE_DEFER_FREE 0x8u
+
+/* SYMTABLE_FILTER asks for a SymTable that keeps a counting filter of
+    its keys up to date on every SymTable_put and SymTable_remove, so
+    that SymTable_contains and SymTable_get answer most lookups of keys
+    it does not have from one cache line of the filter, without
+    touching the table. Snapshots do without it. Implementations that
+    do not hash ignore it. */
+#define SYMTABLE_FILTER 0x10u
+
+/* SYMTABLE_BORROW_KEYS asks for a SymTable that keeps the pcKey passed
+    to SymTable_put itself instead of a copy of it, so that putting a
+    binding copies no key and allocates no memory for one. The caller
+    must then leave every key unchanged and in place for as long as
+    the SymTable, or any snapshot of it, may use it: until its binding
+    is removed or evicted and every snapshot taken while it was bound
+    is freed, or until the SymTable is freed. The SymTable never frees
+    such a key. SymTable_putN borrows its key too, so the uLength
+    characters at pcKey must be followed by a '\0'. */
+#define SYMTABLE_BORROW_KEYS 0x20u
+
+/* SYMTABLE_BACKGROUND_RESIZE asks for a SymTable that grows on a
+    thread of its own instead of in the SymTable_put that fills it.
+    While the thread copies the bindings into the larger table, calls
+    go on against the old one, with changes kept aside in a small
+    table that lookups check first, and the first call after the copy
+    is done switches over and applies them. Operations that walk or
+    combine whole SymTables, and SymTable_free, first wait for the
+    copy, except SymTable_map, which walks the old table and the
+    changes kept aside as they are, so that its order may then differ
+    from that of SymTable_next. Implementations that do not resize or
+    have no threads ignore it, as do bounded SymTables and those that
+    borrow their keys, which resize as they fill. */
+#define SYMTABLE_BACKGROUND_RESIZE 0x40u
+
+/* SYMTABLE_HUGE_PAGES asks for a SymTable that keeps a large bucket
+    array in 2 MB pages, so that lookups spread over all of it miss
+    the TLB less. The pages come from those the system keeps aside if
+    there are any, and are asked for from transparent huge pages
+    otherwise. A system with neither gives ordinary pages, and smaller
+    arrays are allocated as usual. Implementations without a bucket
+    array ignore it. */
+#define SYMTABLE_HUGE_PAGES 0x80u
+
+/* SYMTABLE_THREAD_CACHE asks for a SymTable that gives the memory of
+    the bindings it frees to a small cache of the calling thread, and
+    takes the memory of new bindings from that cache before malloc, so
+    that threads that remove and put many bindings, in one SymTable or
+    in several, recycle it without going through the locks of malloc.
+    Each thread's cache holds a bounded amount and is freed when the
+    thread exits. Implementations without threads, or that allocate
+    bindings in other ways, ignore it. */
+#define SYMTABLE_THREAD_CACHE 0x100u
+
+/* SymTable_newWithFlags takes in uFlags, a bitwise or of SYMTABLE_
+    flags, and creates a new SymTable_T like SymTable_new with those
+    options. Returns the SymTable_T, or NULL if there is no memory. */
+SymTable_T SymTable_newWithFlags(unsigned int uFlags);
+
+/* SymTable_newOnNode takes in uFlags as for SymTable_newWithFlags and
+    a NUMA node iNode, and creates a new SymTable_T like
+    SymTable_newWithFlags whose bucket array is placed in the memory
+    of node iNode while that has room, on systems that support it.
+    An iNode of -1 places it nowhere in particular. Implementations
+    without a bucket array ignore iNode. Returns the SymTable_T, or
+    NULL if there is no memory. */
+SymTable_T SymTable_newOnNode(unsigned int uFlags, int iNode);
+
+/* SymTable_fromArrays takes in an array ppcKeys of uCount strings and
+    an array ppvValues of uCount generic values, and creates a new
+    SymTable_T that binds each ppcKeys[i] to ppvValues[i]. If a key
+    appears more than once, its first binding is kept, as if each
+    binding had been put in order. It is faster than uCount calls to
+    SymTable_put. Returns the SymTable_T, or NULL if there is no
+    memory. */
+SymTable_T SymTable_fromArrays(const char *const *ppcKeys,
+    const void *const *ppvValues, size_t uCount);
+
+/* SymTable_buildParallel takes in ppcKeys, ppvValues and uCount as for
+    SymTable_fromArrays and a number of threads uThreads, and creates
+    the same SymTable_T SymTable_fromArrays would, with the work split
+    among up to uThreads threads. An implementation that cannot split
+    it, or a system without threads, builds it on the calling thread.
+    Returns the SymTable_T, or NULL if there is no memory. */
+SymTable_T SymTable_buildParallel(const char *const *ppcKeys,
+    const void *const *ppvValues, size_t uCount, size_t uThreads);
+
+/* SymTable_newSized takes in a value size uValueSize and creates a new
+    SymTable_T that keeps a copy of every value in the binding itself,
+    instead of a pointer to it. SymTable_put copies uValueSize bytes
+    from pvValue, and SymTable_replace copies them over the old value
+    and returns a pointer to the copy. SymTable_get and SymTable_map
+    also give pointers to the copy, which stays valid until its binding
+    is removed. SymTable_remove returns NULL, as the copy goes with the
+    binding; get the value first if it is still needed. Returns the
+    SymTable_T, or NULL if there is no memory. */
+SymTable_T SymTable_newSized(size_t uValueSize);
+
+/* SymTable_newBounded takes in a capacity uCapacity of at least 1,
+    uFlags as for SymTable_newWithFlags, a function pfEvict and
+    pvExtra, and creates a new SymTable_T that never holds more than
+    uCapacity bindings, for use as a cache. When SymTable_put takes it
+    past uCapacity, a binding that has not been put or found lately is
+    evicted: pfEvict, unless it is NULL, is called with its key, value
+    and pvExtra so that the value can be freed, and then the binding
+    is removed. pfEvict must not use the SymTable. Which binding goes
+    depends on the implementation. If there is no memory to evict
+    one, SymTable_put returns 0 and the SymTable stays within
+    uCapacity. Returns the SymTable_T, or NULL if there is no
+    memory. */
+SymTable_T SymTable_newBounded(size_t uCapacity, unsigned int uFlags,
+    void (*pfEvict)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra);
+
+/* SymTable_snapshot takes in a oSymTable and returns a read-only
+    SymTable_T that keeps the bindings oSymTable has now, or NULL if
+    there is no memory. It takes constant time: the snapshot shares
+    the storage of oSymTable, and whichever later changes a shared
+    part copies only that part. A snapshot may be read and freed by
+    another thread while oSymTable keeps changing, but must not be
+    passed to SymTable_put, SymTable_replace or SymTable_remove. It
+    is freed with SymTable_free. Once a SymTable has been
+    snapshotted, SymTable_replace and SymTable_remove may also fail
+    for lack of memory to copy what they change, in which case they
+    return NULL and leave the binding as it was. */
+SymTable_T SymTable_snapshot(SymTable_T oSymTable);
+
 /* SymTable_free takes in a oSymTable and free it and all of it's 
     contents */
 void SymTable_free(SymTable_T oSymTable);
 
+/* SymTable_reclaim takes in a oSymTable and a budget uBudget, and
+    frees the memory of up to uBudget of the bindings that were removed
+    from the oSymTable but not freed yet. Returns how many such
+    bindings are left. */
+size_t SymTable_reclaim(SymTable_T oSymTable, size_t uBudget);
+
 /* SymTable_getLength takes in a oSymTable and return how many
     key value bindings are in the oSymTable as an size_t */
 size_t SymTable_getLength(SymTable_T oSymTable);
 
+/* SymTable_getFlags takes in a oSymTable and returns the SYMTABLE_
+    flags it acts on, those it was made with. A snapshot keeps only
+    the SYMTABLE_BORROW_KEYS flag of the SymTable it was taken of. */
+unsigned int SymTable_getFlags(SymTable_T oSymTable);
+
 /* SymTable_put takes in a oSymTable, a string pcKey and a
     generic value pvValue and stores it in the oSymTable. It
     returns 1 if successful and 0 if not. If there is no
@@ -58,4 +225,170 @@ void SymTable_map(SymTable_T oSymTable,
     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
     const void *pvExtra);
 
+/* SymTable_retain takes in a oSymTable, functions pfKeep and pfFree,
+    and pvExtra. It calls pfKeep on every binding, in the order
+    SymTable_map visits them, and removes the bindings for which
+    pfKeep returns 0 in the same pass, without looking any key up
+    again. Unless pfFree is NULL, it is called on each removed binding
+    before its key is freed, so that it may free the value. Neither
+    may change the oSymTable. Returns 1 if successful, or 0 if there
+    is not enough memory, in which case some of the bindings pfKeep
+    rejected may stay, and pfFree is only called on those removed. */
+int SymTable_retain(SymTable_T oSymTable,
+    int (*pfKeep)(const char *pcKey, void *pvValue, void *pvExtra),
+    void (*pfFree)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra);
+
+/* SYMTABLE_MERGE_KEEP and SYMTABLE_MERGE_REPLACE are the policies of
+    SymTable_merge for a key both SymTables have: the value in oDst
+    stays, or is replaced by the value in oSrc. */
+#define SYMTABLE_MERGE_KEEP 0u
+#define SYMTABLE_MERGE_REPLACE 1u
+
+/* SymTable_merge takes in two SymTables oDst and oSrc and a policy
+    uPolicy, and moves every binding of oSrc whose key oDst lacks
+    into oDst. A binding whose key both have stays in oSrc, but with
+    SYMTABLE_MERGE_REPLACE its value first trades places with the
+    value in oDst, so that afterwards oSrc holds the values that lost,
+    for the caller to free. SymTables made by SymTable_newSized copy
+    the value instead. oDst grows at most once, before any binding
+    moves, and keys move without being copied where the two
+    SymTables allow it. Both must keep values of the same size, and
+    both or neither must borrow their keys. Returns 1 if successful,
+    or 0 if there is not enough memory, in which case the bindings
+    not merged yet stay in oSrc. */
+int SymTable_merge(SymTable_T oDst, SymTable_T oSrc, unsigned int uPolicy);
+
+/* SymTable_difference takes in two SymTables oSymTable and oOther,
+    function pfFree and pvExtra, and removes from oSymTable every
+    binding whose key oOther has, calling pfFree on each unless it is
+    NULL, as SymTable_retain does. oOther does not change. Returns 1
+    if successful, or 0 if there is not enough memory, as
+    SymTable_retain does. */
+int SymTable_difference(SymTable_T oSymTable, SymTable_T oOther,
+    void (*pfFree)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra);
+
+/* SymTable_putN, SymTable_lookupN and SymTable_removeN work like
+    SymTable_put, SymTable_get and SymTable_remove, but take the key as
+    its first uLength characters at pcKey, which need not be followed
+    by a '\0', so that a key cut from a longer string is used where it
+    is. The uLength characters must not include a '\0'. */
+int SymTable_putN(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue);
+void *SymTable_removeN(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength);
+
+/* SymTableCursor is a place in a walk over the bindings of a
+    SymTable. A SymTableCursor set to all zeroes, such as
+    SYMTABLE_CURSOR_INIT, is before the first binding. Once it is at a
+    binding, pcKey and pvValue are its key and value. The other fields
+    belong to the implementation. */
+struct SymTableCursor {
+    const char *pcKey;
+    void *pvValue;
+    const void *pvPlace;
+    size_t uIndex;
+};
+#define SYMTABLE_CURSOR_INIT {NULL, NULL, NULL, 0}
+
+/* SymTable_lookupN takes in a oSymTable, a key of uLength characters
+    at pcKey as for SymTable_putN, and a psCursor. If the key is in the
+    oSymTable, it puts psCursor at its binding and returns 1, so that a
+    walk with SymTable_next may go on from there. Otherwise it returns
+    0 and leaves psCursor as it was. */
+int SymTable_lookupN(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, struct SymTableCursor *psCursor);
+
+/* SymTable_next takes in a oSymTable and a psCursor, and moves
+    psCursor to the next binding in the order SymTable_map visits them.
+    Returns 1, or 0 if there are no more bindings. The walk is only
+    good while the oSymTable does not change, and while no lookup
+    moves its bindings about, as SYMTABLE_MOVE_TO_FRONT and
+    SYMTABLE_TRANSPOSE do. */
+int SymTable_next(SymTable_T oSymTable, struct SymTableCursor *psCursor);
+
+/* SymTable_loadStream takes in a oSymTable, a psFile of lines of the
+    form key, a tab and value, functions pfParse and pfFree and
+    pvExtra, and binds each key to the value pfParse makes of the rest
+    of its line. The value is the uLength characters at pcValue,
+    without the tab or the line end, and need not be followed by a
+    '\0'; pfParse stores what to bind in *ppvValue and returns 1, or
+    returns 0 to stop the load. A line without a tab is all key, with
+    an empty value. Empty lines are skipped, and a '\r' before the
+    '\n' is not part of the line. If pfParse is NULL, every key is
+    bound to NULL, which a SymTable made by SymTable_newSized cannot
+    hold. If a key appears more than once, its first binding is kept.
+    A value pfParse made that is not bound, because its key was bound
+    already or there was no memory, is passed to pfFree with pvExtra,
+    unless pfFree is NULL, so that pfParse may allocate the values it
+    makes. A regular file is mapped into memory where the system
+    allows it, and other streams are read in large blocks; either way
+    each key is copied only into the oSymTable. The oSymTable must
+    not borrow its keys: the lines are read into memory that is freed
+    once the load is done, so a SymTable made with
+    SYMTABLE_BORROW_KEYS is refused, and 0 returned, before anything
+    is read. Returns 1 once psFile is at its end, or 0 if it cannot
+    be read, a key has a '\0' in it, pfParse fails or there is no
+    memory, in which case the bindings of the lines before stay. */
+int SymTable_loadStream(SymTable_T oSymTable, FILE *psFile,
+    int (*pfParse)(const char *pcValue, size_t uLength, void **ppvValue,
+        void *pvExtra),
+    void (*pfFree)(void *pvValue, void *pvExtra),
+    const void *pvExtra);
+
+/* SymTable_mapRange takes in a oSymTable, bounds pcLo and pcHi,
+    function pfApply and pvExtra. It applys pfApply in increasing
+    strcmp order to the bindings whose keys are at least pcLo and less
+    than pcHi, where a NULL bound is no limit. Returns 1 if successful,
+    or 0 if there is not enough memory to order the bindings, in which
+    case none are visited.*/
+int SymTable_mapRange(SymTable_T oSymTable, const char *pcLo,
+    const char *pcHi,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra);
+
+/* SymTable_mapPrefix takes in a oSymTable, a string pcPrefix,
+    function pfApply and pvExtra. It applys pfApply in increasing
+    strcmp order to the bindings whose keys start with pcPrefix.
+    Returns 1 if successful, or 0 if there is not enough memory to
+    order the bindings, in which case none are visited.*/
+int SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra);
+
+/* SymTableStats holds the operation counters of a SymTable. They
+    are only kept when the implementation is compiled with
+    SYMTABLE_STATS defined, and stay 0 otherwise. Counters that do not
+    apply to an implementation, such as uResizes for a linked list,
+    also stay 0. The average probes per lookup is uProbes divided by
+    uHits + uMisses. */
+struct SymTableStats {
+    /* uHashes is the number of keys hashed */
+    size_t uHashes;
+    /* uProbes is the number of nodes visited by lookups */
+    size_t uProbes;
+    /* uCompares is the number of strcmp calls made by lookups */
+    size_t uCompares;
+    /* uHits and uMisses are the number of lookups that found and
+      did not find their key */
+    size_t uHits;
+    size_t uMisses;
+    /* uResizes is the number of times the table grew, and
+      dResizeSeconds is the CPU time spent growing it */
+    size_t uResizes;
+    double dResizeSeconds;
+    /* uAllocations is the number of successful calls to malloc
+      and calloc */
+    size_t uAllocations;
+};
+
+/* SymTable_getStats takes in a oSymTable and returns a copy of its
+    operation counters. */
+struct SymTableStats SymTable_getStats(SymTable_T oSymTable);
+
+#ifdef __cplusplus
+}
+#endif
+
     #endif
\ No newline at end of file
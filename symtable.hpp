@@ -0,0 +1,249 @@
+/*--------------------------------------------------------------------*/
+/* symtable.hpp                                                     */
+/* Author: Kevin Chen                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef symtableHPP
+#define symtableHPP
+
+#include "symtable.h"
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+/* Note: This header wraps a SymTable_T in a C++17 class that owns it
+   and frees it when it goes out of scope. Keys are looked up as
+   std::string_view through SymTable_lookupN and friends, so that no
+   NUL-terminated copy of them is made, and iterators walk the
+   SymTable with SymTable_next, so that nothing is allocated beyond
+   what the SymTable itself allocates. */
+
+namespace symtable {
+
+/* SymTable owns one SymTable_T. It can be moved but not copied; for
+   a copy that shares the bindings, use SymTable_snapshot on handle(). */
+class SymTable
+{
+public:
+   using key_type = std::string_view;
+   using mapped_type = void *;
+   using value_type = std::pair<std::string_view, void *>;
+   using size_type = std::size_t;
+
+   /* iterator is a forward iterator over the bindings, in the order
+      SymTable_map visits them. Dereferencing it gives the key and
+      value of a binding by value. It is only good while the SymTable
+      does not change, as for SymTable_next. */
+   class iterator
+   {
+   public:
+      /* ArrowProxy holds a binding so that it->first works */
+      struct ArrowProxy
+      {
+         value_type sBinding;
+         const value_type *operator->() const { return &sBinding; }
+      };
+
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = SymTable::value_type;
+      using difference_type = std::ptrdiff_t;
+      using pointer = ArrowProxy;
+      using reference = value_type;
+
+      iterator() = default;
+
+      value_type operator*() const
+      {
+         return value_type(sCursor.pcKey, sCursor.pvValue);
+      }
+
+      ArrowProxy operator->() const { return ArrowProxy{**this}; }
+
+      iterator &operator++()
+      {
+         if (! SymTable_next(oSymTable, &sCursor))
+            oSymTable = nullptr;
+         return *this;
+      }
+
+      iterator operator++(int)
+      {
+         iterator oOld = *this;
+         ++*this;
+         return oOld;
+      }
+
+      /* Two iterators are equal if both are at the end, or both are at
+         the same place of the same SymTable. */
+      friend bool operator==(const iterator &oFirst,
+         const iterator &oSecond)
+      {
+         return oFirst.oSymTable == oSecond.oSymTable &&
+            (oFirst.oSymTable == nullptr ||
+             (oFirst.sCursor.uIndex == oSecond.sCursor.uIndex &&
+              oFirst.sCursor.pvPlace == oSecond.sCursor.pvPlace));
+      }
+
+      friend bool operator!=(const iterator &oFirst,
+         const iterator &oSecond)
+      {
+         return ! (oFirst == oSecond);
+      }
+
+   private:
+      friend class SymTable;
+
+      /* oSymTable is the SymTable walked, or nullptr at the end */
+      SymTable_T oSymTable = nullptr;
+      struct SymTableCursor sCursor = SYMTABLE_CURSOR_INIT;
+   };
+
+   using const_iterator = iterator;
+
+   /* SymTable() makes an empty SymTable, and SymTable(uFlags) one with
+      SYMTABLE_ flags. Both throw std::bad_alloc if there is no
+      memory. */
+   SymTable() : SymTable(SymTable_new()) {}
+   explicit SymTable(unsigned int uFlags)
+      : SymTable(SymTable_newWithFlags(uFlags)) {}
+
+   /* SymTable(oSymTable) takes ownership of oSymTable, as made by any
+      of the SymTable_new functions or SymTable_snapshot. Throws
+      std::bad_alloc if oSymTable is NULL, so that the result of one of
+      them can be passed straight in. */
+   explicit SymTable(SymTable_T oSymTable) : m_oSymTable(oSymTable)
+   {
+      if (m_oSymTable == nullptr)
+         throw std::bad_alloc();
+   }
+
+   SymTable(const SymTable &) = delete;
+   SymTable &operator=(const SymTable &) = delete;
+
+   /* A moved-from SymTable owns nothing and may only be destroyed or
+      assigned to. */
+   SymTable(SymTable &&oOther) noexcept
+      : m_oSymTable(std::exchange(oOther.m_oSymTable, nullptr)) {}
+
+   SymTable &operator=(SymTable &&oOther) noexcept
+   {
+      if (this != &oOther)
+      {
+         if (m_oSymTable != nullptr)
+            SymTable_free(m_oSymTable);
+         m_oSymTable = std::exchange(oOther.m_oSymTable, nullptr);
+      }
+      return *this;
+   }
+
+   ~SymTable()
+   {
+      if (m_oSymTable != nullptr)
+         SymTable_free(m_oSymTable);
+   }
+
+   /* handle returns the SymTable_T, which stays owned by the SymTable,
+      and release gives up ownership of it. */
+   SymTable_T handle() const noexcept { return m_oSymTable; }
+   SymTable_T release() noexcept
+   {
+      return std::exchange(m_oSymTable, nullptr);
+   }
+
+   void swap(SymTable &oOther) noexcept
+   {
+      std::swap(m_oSymTable, oOther.m_oSymTable);
+   }
+
+   size_type size() const { return SymTable_getLength(m_oSymTable); }
+   bool empty() const { return size() == 0; }
+
+   iterator begin() const
+   {
+      iterator oIterator;
+      oIterator.oSymTable = m_oSymTable;
+      return ++oIterator;
+   }
+
+   iterator end() const { return iterator(); }
+
+   /* find returns an iterator at the binding of sKey, or end() if
+      there is none. A key with a '\0' in it is never bound. */
+   iterator find(std::string_view sKey) const
+   {
+      iterator oIterator;
+      if (isKey(sKey) && SymTable_lookupN(m_oSymTable, sKey.data(),
+         sKey.size(), &oIterator.sCursor))
+         oIterator.oSymTable = m_oSymTable;
+      return oIterator;
+   }
+
+   bool contains(std::string_view sKey) const
+   {
+      return find(sKey) != end();
+   }
+
+   /* try_emplace binds sKey to pvValue unless sKey is bound already.
+      Returns an iterator at the binding of sKey and true if it was
+      made, or false if it was there. Throws std::invalid_argument if
+      sKey has a '\0' in it, and std::bad_alloc if there is no
+      memory. */
+   std::pair<iterator, bool> try_emplace(std::string_view sKey,
+      const void *pvValue)
+   {
+      iterator oIterator;
+      if (! isKey(sKey))
+         throw std::invalid_argument("SymTable key with a '\\0'");
+      oIterator.oSymTable = m_oSymTable;
+      if (SymTable_lookupN(m_oSymTable, sKey.data(), sKey.size(),
+         &oIterator.sCursor))
+         return std::make_pair(oIterator, false);
+      if (! SymTable_putN(m_oSymTable, sKey.data(), sKey.size(), pvValue))
+         throw std::bad_alloc();
+      SymTable_lookupN(m_oSymTable, sKey.data(), sKey.size(),
+         &oIterator.sCursor);
+      return std::make_pair(oIterator, true);
+   }
+
+   /* erase removes the binding of sKey. Returns 1 if there was one,
+      otherwise 0. Throws std::bad_alloc if there is no memory to copy
+      what a snapshot shares. */
+   size_type erase(std::string_view sKey)
+   {
+      struct SymTableCursor sCursor = SYMTABLE_CURSOR_INIT;
+      size_type uLength;
+      if (! isKey(sKey) || ! SymTable_lookupN(m_oSymTable, sKey.data(),
+         sKey.size(), &sCursor))
+         return 0;
+      /* a value may be NULL, so only the length tells whether the
+         binding went */
+      uLength = size();
+      SymTable_removeN(m_oSymTable, sKey.data(), sKey.size());
+      if (size() == uLength)
+         throw std::bad_alloc();
+      return 1;
+   }
+
+private:
+   /* isKey returns true if sKey can be a key, which is when it has no
+      '\0' in it */
+   static bool isKey(std::string_view sKey)
+   {
+      return sKey.find('\0') == std::string_view::npos;
+   }
+
+   /* m_oSymTable is the owned SymTable_T, or nullptr once moved from */
+   SymTable_T m_oSymTable;
+};
+
+inline void swap(SymTable &oFirst, SymTable &oSecond) noexcept
+{
+   oFirst.swap(oSecond);
+}
+
+}
+
+#endif
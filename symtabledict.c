@@ -0,0 +1,1266 @@
+/*--------------------------------------------------------------------*/
+/* symtabledict.c                                                     */
+/* Author: Kevin Chen                                                 */
+/*--------------------------------------------------------------------*/
+
+#include "symtable.h"
+#include "symtablegen.h"
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#ifdef SYMTABLE_STATS
+#include <time.h>
+#endif
+
+/* Note: This file keeps the bindings in a dense array of Entries in
+   the order they were put, and finds them through a sparse index of
+   uint32_t slots that each hold the position of one Entry, as the
+   dictionaries of CPython do. SymTable_map, SymTable_next and
+   SymTable_retain scan the Entries from the front, so they visit the
+   bindings in the order they were put, however often the SymTable
+   has grown, and an index slot costs 4 bytes where a hash table
+   chain costs a Node. Removing a binding leaves a hole in the
+   Entries, and the holes are squeezed out whenever the Entries fill
+   up. A snapshot shares the Store of its SymTable, and the first
+   change after it copies the Store but not the keys, which count
+   their references. */
+
+#ifdef SYMTABLE_STATS
+/* When SYMTABLE_STATS is defined, STAT_ADD adds uCount to one of the
+   counters of a SymTable. Otherwise it expands to nothing, so the
+   normal build does no counting at all. */
+#define STAT_ADD(oSymTable, field, uCount) \
+   ((oSymTable)->sStats.field += (uCount))
+#else
+#define STAT_ADD(oSymTable, field, uCount) ((void)0)
+#endif
+
+/* REF_INC and REF_DEC add one to or take one from a reference count
+   and give the new count, and REF_GET reads one. They are atomic
+   where the compiler allows it, so that a snapshot may be used and
+   freed on another thread than the SymTable it was taken from. */
+#if defined(__GNUC__)
+#define REF_INC(puRefs) __atomic_add_fetch((puRefs), 1, __ATOMIC_RELAXED)
+#define REF_DEC(puRefs) __atomic_sub_fetch((puRefs), 1, __ATOMIC_ACQ_REL)
+#define REF_GET(puRefs) __atomic_load_n((puRefs), __ATOMIC_ACQUIRE)
+#else
+#define REF_INC(puRefs) (++*(puRefs))
+#define REF_DEC(puRefs) (--*(puRefs))
+#define REF_GET(puRefs) (*(puRefs))
+#endif
+
+/* MIN_SLOTS is the fewest index slots a Store has, and RECLAIM_STEP
+   is how many removed keys of a SYMTABLE_DEFER_FREE SymTable each
+   SymTable_put frees */
+enum {MIN_SLOTS = 8, RECLAIM_STEP = 2};
+
+/* uSlotEmpty marks an index slot that no Entry has taken, and
+   uSlotRemoved one whose Entry was removed, which lookups must probe
+   past. Every other slot holds the position of an Entry. */
+static const uint32_t uSlotEmpty = UINT32_MAX;
+static const uint32_t uSlotRemoved = UINT32_MAX - 1;
+
+/* uNoSlot is the slot SymTable_find gives for a key that is not
+   there */
+static const size_t uNoSlot = (size_t)-1;
+
+/* Align is a union of the types that need the most alignment, so that
+   a value of any type may start at a multiple of its size */
+union Align
+{
+   long double ld;
+   long long ll;
+   void *pv;
+   void (*pf)(void);
+};
+
+/* The Entry struct holds one binding of a Store */
+struct Entry
+{
+   /* uHash is the hash code of pcKey, kept so that neither lookups
+      nor growing have to hash the key again */
+   size_t uHash;
+   /* pcKey is the key, or NULL if the binding was removed and the
+      Entry is a hole */
+   char *pcKey;
+   /* pvItem is the value of the binding */
+   const void *pvItem;
+};
+
+/* The Store struct holds the Entries and the index of a SymTable,
+   both in the same block of memory, after the Store */
+struct Store
+{
+   /* uRefs is how many SymTables share the Store. A Store with more
+      than one is copied before it changes */
+   size_t uRefs;
+   /* uSlots is the number of index slots, a power of two, and uRoom
+      the number of Entries there is room for */
+   size_t uSlots;
+   size_t uRoom;
+   /* uUsed is how many Entries have been used, holes included, and
+      no Entry before uFirst holds a binding */
+   size_t uUsed;
+   size_t uFirst;
+   /* asEntries are the Entries in the order they were put */
+   struct Entry *asEntries;
+   /* auIndex are the index slots */
+   uint32_t *auIndex;
+};
+
+/* The SymTable struct contains the Store of the bindings and
+   contains it's length as a size_t */
+struct SymTable
+{
+   /* psStore is a pointer that points to the Store. It is never
+      NULL */
+   struct Store *psStore;
+   /* length is a size_t that stores how many bindings are in
+      the table */
+   size_t length;
+   /* uFlags stores the SYMTABLE_ flags the SymTable was made with */
+   unsigned int uFlags;
+   /* iReadOnly is 1 if the SymTable is a snapshot, otherwise 0 */
+   int iReadOnly;
+   /* uValueSize is the size of the values a SymTable made by
+      SymTable_newSized keeps with its keys, or 0 if it keeps
+      pointers */
+   size_t uValueSize;
+   /* ppcDead holds the keys removed but not freed yet, uDead is how
+      many there are and uDeadRoom how many it has room for */
+   char **ppcDead;
+   size_t uDead;
+   size_t uDeadRoom;
+   /* uCapacity is the most bindings a bounded SymTable may hold, or 0
+      if it has no capacity */
+   size_t uCapacity;
+   /* pfEvict is called with every evicted binding and pvExtra, unless
+      it is NULL */
+   void (*pfEvict)(const char *pcKey, void *pvValue, void *pvExtra);
+   const void *pvExtra;
+#ifdef SYMTABLE_STATS
+   /* sStats stores the operation counters of the SymTable */
+   struct SymTableStats sStats;
+#endif
+};
+
+/* Key_refs takes in a pcKey made by Key_new and returns its
+   reference count, which is kept just before the string. */
+static size_t *Key_refs(char *pcKey) {
+   return (size_t *)(void *)pcKey - 1;
+}
+
+/* Key_valueOffset takes in the length uLen of a key including its
+   '\0' and returns where a value stored with the key starts, from the
+   start of the key's memory. */
+static size_t Key_valueOffset(size_t uLen) {
+   return (sizeof(size_t) + uLen + sizeof(union Align) - 1) /
+      sizeof(union Align) * sizeof(union Align);
+}
+
+/* Key_new takes in a oSymTable, a pcKey of uLength characters and a
+   pointer ppvValue to its value, and returns a copy of pcKey with a
+   reference count of 1 for an Entry, or NULL if there is no memory.
+   If the oSymTable was made by SymTable_newSized, the value is
+   copied in after the key, and *ppvValue is set to point to the
+   copy. If the oSymTable borrows its keys, pcKey itself is
+   returned. */
+static char *Key_new(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength, const void **ppvValue) {
+   size_t uLen = uLength + 1;
+   size_t uSize = sizeof(size_t) + uLen;
+   char *pcBlock;
+   char *pcCopy;
+   if (oSymTable->uFlags & SYMTABLE_BORROW_KEYS) {
+      assert(pcKey[uLength] == '\0');
+      return (char *)pcKey;
+   }
+   if (oSymTable->uValueSize != 0) {
+      uSize = Key_valueOffset(uLen) + oSymTable->uValueSize;
+   }
+   pcBlock = (char *) malloc(uSize);
+   if (pcBlock == NULL) {
+      return NULL;
+   }
+   STAT_ADD(oSymTable, uAllocations, 1);
+   pcCopy = pcBlock + sizeof(size_t);
+   *Key_refs(pcCopy) = 1;
+   memcpy(pcCopy, pcKey, uLength);
+   pcCopy[uLength] = '\0';
+   if (oSymTable->uValueSize != 0) {
+      memcpy(pcBlock + Key_valueOffset(uLen), *ppvValue,
+         oSymTable->uValueSize);
+      *ppvValue = pcBlock + Key_valueOffset(uLen);
+   }
+   return pcCopy;
+}
+
+/* Key_equals takes in a key pcStored and a pcKey of uLength
+   characters with no '\0' among them, and returns 1 if they are the
+   same key, otherwise 0. */
+static int Key_equals(const char *pcStored, const char *pcKey,
+   size_t uLength) {
+   return strncmp(pcStored, pcKey, uLength) == 0 &&
+      pcStored[uLength] == '\0';
+}
+
+/* Key_retain takes in a oSymTable and one of its keys pcKey, and
+   adds one reference to pcKey, unless it is borrowed. */
+static void Key_retain(SymTable_T oSymTable, char *pcKey) {
+   if (! (oSymTable->uFlags & SYMTABLE_BORROW_KEYS)) {
+      REF_INC(Key_refs(pcKey));
+   }
+}
+
+/* Key_release takes in a oSymTable and one of its keys pcKey, and
+   drops one reference to pcKey, freeing it on the last unless it is
+   borrowed. */
+static void Key_release(SymTable_T oSymTable, char *pcKey) {
+   if (! (oSymTable->uFlags & SYMTABLE_BORROW_KEYS) &&
+      REF_DEC(Key_refs(pcKey)) == 0) {
+      free(Key_refs(pcKey));
+   }
+}
+
+/* Store_roomFor takes in a number of index slots uSlots and returns
+   how many Entries a Store with that many slots has room for: two
+   thirds of them, so that every probe sequence meets an empty
+   slot. */
+static size_t Store_roomFor(size_t uSlots) {
+   return uSlots / 3 * 2;
+}
+
+/* Store_new takes in a number of index slots uSlots, a power of two,
+   and returns a new empty Store with that many slots, or NULL if
+   there is no memory or the positions of the Entries would not fit
+   in a slot. */
+static struct Store *Store_new(size_t uSlots) {
+   size_t uRoom = Store_roomFor(uSlots);
+   size_t uHeader = (sizeof(struct Store) + sizeof(union Align) - 1) /
+      sizeof(union Align) * sizeof(union Align);
+   struct Store *psStore;
+   assert(uSlots >= MIN_SLOTS);
+   if (uSlots > (size_t)uSlotRemoved) {
+      return NULL;
+   }
+   psStore = (struct Store *) malloc(uHeader +
+      uRoom * sizeof(struct Entry) + uSlots * sizeof(uint32_t));
+   if (psStore == NULL) {
+      return NULL;
+   }
+   psStore->uRefs = 1;
+   psStore->uSlots = uSlots;
+   psStore->uRoom = uRoom;
+   psStore->uUsed = 0;
+   psStore->uFirst = 0;
+   psStore->asEntries = (struct Entry *)(void *)((char *)psStore +
+      uHeader);
+   psStore->auIndex = (uint32_t *)(void *)(psStore->asEntries + uRoom);
+   /* uSlotEmpty has every bit set */
+   memset(psStore->auIndex, 0xff, uSlots * sizeof(uint32_t));
+   return psStore;
+}
+
+/* Store_probe takes in a psStore, the slot uSlot just probed and a
+   pointer puPerturb to the bits of the hash code not used yet, and
+   returns the slot to probe next. As in CPython, the high bits of the
+   hash code are shifted in a few at a time, so that keys whose low
+   bits agree soon part ways, and once they are used up the sequence
+   goes through every slot. */
+static size_t Store_probe(const struct Store *psStore, size_t uSlot,
+   size_t *puPerturb) {
+   *puPerturb >>= 5;
+   return (uSlot * 5 + *puPerturb + 1) & (psStore->uSlots - 1);
+}
+
+/* Store_place takes in a psStore, the hash code uHash of the key of
+   its Entry at position uPos, and makes the first free slot on the
+   probe sequence of uHash point to it. */
+static void Store_place(struct Store *psStore, size_t uHash,
+   size_t uPos) {
+   size_t uPerturb = uHash;
+   size_t uSlot = uHash & (psStore->uSlots - 1);
+   while (psStore->auIndex[uSlot] < uSlotRemoved) {
+      uSlot = Store_probe(psStore, uSlot, &uPerturb);
+   }
+   psStore->auIndex[uSlot] = (uint32_t)uPos;
+}
+
+/* Store_slotOf takes in a psStore, one of its keys pcKey and the hash
+   code uHash of pcKey, and returns the slot that points to the Entry
+   of pcKey, comparing only addresses. */
+static size_t Store_slotOf(const struct Store *psStore, size_t uHash,
+   const char *pcKey) {
+   size_t uPerturb = uHash;
+   size_t uSlot = uHash & (psStore->uSlots - 1);
+   uint32_t uPos;
+   for (;;) {
+      uPos = psStore->auIndex[uSlot];
+      assert(uPos != uSlotEmpty);
+      if (uPos != uSlotRemoved && psStore->asEntries[uPos].pcKey == pcKey) {
+         return uSlot;
+      }
+      uSlot = Store_probe(psStore, uSlot, &uPerturb);
+   }
+}
+
+/* Store_compact takes in a psStore that one SymTable owns, moves its
+   bindings to the front of its Entries in the same order, squeezing
+   out the holes, and builds its index again. */
+static void Store_compact(struct Store *psStore) {
+   size_t uKept = 0;
+   size_t i;
+   for (i = psStore->uFirst; i < psStore->uUsed; i++) {
+      if (psStore->asEntries[i].pcKey != NULL) {
+         psStore->asEntries[uKept++] = psStore->asEntries[i];
+      }
+   }
+   psStore->uUsed = uKept;
+   psStore->uFirst = 0;
+   memset(psStore->auIndex, 0xff, psStore->uSlots * sizeof(uint32_t));
+   for (i = 0; i < uKept; i++) {
+      Store_place(psStore, psStore->asEntries[i].uHash, i);
+   }
+}
+
+/* Store_release takes in a oSymTable and its psStore, and drops one
+   reference to psStore. If that was the last, it frees psStore and
+   drops its keys. */
+static void Store_release(SymTable_T oSymTable, struct Store *psStore) {
+   size_t i;
+   if (REF_DEC(&psStore->uRefs) != 0) {
+      return;
+   }
+   for (i = psStore->uFirst; i < psStore->uUsed; i++) {
+      if (psStore->asEntries[i].pcKey != NULL) {
+         Key_release(oSymTable, psStore->asEntries[i].pcKey);
+      }
+   }
+   free(psStore);
+}
+
+/* SymTable_hash takes in a pcKey of uLength characters and returns
+   the hash code from the assignment specification, with its bits
+   mixed so that the low ones, which pick the first slot, depend on
+   every character. */
+static size_t SymTable_hash(const char *pcKey, size_t uLength) {
+   uint64_t uHash = (uint64_t)SymTable_hashBytes(pcKey, uLength) *
+      UINT64_C(0x9e3779b97f4a7c15);
+   return (size_t)(uHash ^ (uHash >> 29));
+}
+
+/* SymTable_find takes in a oSymTable, a pcKey of uLength characters
+   and its hash code uHash, and returns the index slot that points to
+   the Entry of pcKey, or uNoSlot if there is none. */
+static size_t SymTable_find(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength, size_t uHash) {
+   const struct Store *psStore = oSymTable->psStore;
+   const struct Entry *psEntry;
+   size_t uPerturb = uHash;
+   size_t uSlot = uHash & (psStore->uSlots - 1);
+   uint32_t uPos;
+   for (;;) {
+      STAT_ADD(oSymTable, uProbes, 1);
+      uPos = psStore->auIndex[uSlot];
+      if (uPos == uSlotEmpty) {
+         STAT_ADD(oSymTable, uMisses, 1);
+         return uNoSlot;
+      }
+      if (uPos != uSlotRemoved) {
+         psEntry = &psStore->asEntries[uPos];
+         if (psEntry->uHash == uHash) {
+            STAT_ADD(oSymTable, uCompares, 1);
+            if (Key_equals(psEntry->pcKey, pcKey, uLength)) {
+               STAT_ADD(oSymTable, uHits, 1);
+               return uSlot;
+            }
+         }
+      }
+      uSlot = Store_probe(psStore, uSlot, &uPerturb);
+   }
+}
+
+/* SymTable_lookup takes in a oSymTable and a pcKey of uLength
+   characters, stores the hash code of pcKey in *puHash, and returns
+   the index slot of pcKey as SymTable_find does. */
+static size_t SymTable_lookup(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength, size_t *puHash) {
+   *puHash = SymTable_hash(pcKey, uLength);
+   STAT_ADD(oSymTable, uHashes, 1);
+   return SymTable_find(oSymTable, pcKey, uLength, *puHash);
+}
+
+/* SymTable_slotsFor takes in a number of bindings uLength and returns
+   the fewest index slots of a Store with room for them. */
+static size_t SymTable_slotsFor(size_t uLength) {
+   size_t uSlots = MIN_SLOTS;
+   while (Store_roomFor(uSlots) < uLength) {
+      uSlots *= 2;
+   }
+   return uSlots;
+}
+
+/* SymTable_resize takes in a oSymTable and a number of index slots
+   uSlots with room for all of its bindings, and moves them into a
+   new Store of that many slots, in the same order and without the
+   holes. If the old Store is shared with a snapshot, the keys are
+   shared too. Returns 1 if successful, or 0 if there is no memory, in
+   which case the oSymTable keeps its Store. */
+static int SymTable_resize(SymTable_T oSymTable, size_t uSlots) {
+   struct Store *psOld = oSymTable->psStore;
+   struct Store *psNew;
+   int iShared = REF_GET(&psOld->uRefs) > 1;
+   size_t i;
+   psNew = Store_new(uSlots);
+   if (psNew == NULL) {
+      return 0;
+   }
+   STAT_ADD(oSymTable, uAllocations, 1);
+   assert(psNew->uRoom >= oSymTable->length);
+   for (i = psOld->uFirst; i < psOld->uUsed; i++) {
+      if (psOld->asEntries[i].pcKey == NULL) {
+         continue;
+      }
+      if (iShared) {
+         Key_retain(oSymTable, psOld->asEntries[i].pcKey);
+      }
+      psNew->asEntries[psNew->uUsed] = psOld->asEntries[i];
+      Store_place(psNew, psNew->asEntries[psNew->uUsed].uHash,
+         psNew->uUsed);
+      psNew->uUsed += 1;
+   }
+   oSymTable->psStore = psNew;
+   if (iShared) {
+      Store_release(oSymTable, psOld);
+   }
+   else {
+      free(psOld);
+   }
+   return 1;
+}
+
+/* SymTable_grow takes in a oSymTable and a number of bindings
+   uLength, and moves the bindings into a Store with room for uLength
+   of them as SymTable_resize does. Returns 1 if successful, or 0 if
+   there is no memory. */
+static int SymTable_grow(SymTable_T oSymTable, size_t uLength) {
+   size_t uSlots = SymTable_slotsFor(uLength);
+   int iSuccessful;
+#ifdef SYMTABLE_STATS
+   clock_t iInitialClock = clock();
+   if (uSlots > oSymTable->psStore->uSlots) {
+      STAT_ADD(oSymTable, uResizes, 1);
+   }
+#endif
+   iSuccessful = SymTable_resize(oSymTable, uSlots);
+#ifdef SYMTABLE_STATS
+   oSymTable->sStats.dResizeSeconds +=
+      ((double)(clock() - iInitialClock)) / CLOCKS_PER_SEC;
+#endif
+   return iSuccessful;
+}
+
+/* SymTable_own takes in a oSymTable and makes sure no snapshot shares
+   its Store, copying it if one does. Returns 1 if successful, or 0 if
+   there is no memory. */
+static int SymTable_own(SymTable_T oSymTable) {
+   if (REF_GET(&oSymTable->psStore->uRefs) == 1) {
+      return 1;
+   }
+   return SymTable_resize(oSymTable, oSymTable->psStore->uSlots);
+}
+
+/* SymTable_ownSlot takes in a oSymTable, a pointer puSlot to the
+   index slot of one of its bindings and the hash code uHash of its
+   key, and makes sure no snapshot shares the Store of the oSymTable
+   as SymTable_own does, setting *puSlot to the slot of the binding in
+   the copy if there is one. Returns 1 if successful, or 0 if there is
+   no memory. */
+static int SymTable_ownSlot(SymTable_T oSymTable, size_t *puSlot,
+   size_t uHash) {
+   const struct Store *psStore = oSymTable->psStore;
+   const char *pcKey;
+   if (REF_GET(&psStore->uRefs) == 1) {
+      return 1;
+   }
+   pcKey = psStore->asEntries[psStore->auIndex[*puSlot]].pcKey;
+   if (! SymTable_own(oSymTable)) {
+      return 0;
+   }
+   *puSlot = Store_slotOf(oSymTable->psStore, uHash, pcKey);
+   return 1;
+}
+
+/* SymTable_ownValue takes in a oSymTable made by SymTable_newSized
+   that owns its Store and one of its Entries psEntry, and makes sure
+   no snapshot shares the key the value of psEntry is kept with,
+   copying it if one does. Returns 1 if successful, or 0 if there is
+   no memory. */
+static int SymTable_ownValue(SymTable_T oSymTable, struct Entry *psEntry) {
+   char *pcCopy;
+   const void *pvItem = psEntry->pvItem;
+   assert(oSymTable->uValueSize != 0);
+   if (REF_GET(Key_refs(psEntry->pcKey)) == 1) {
+      return 1;
+   }
+   pcCopy = Key_new(oSymTable, psEntry->pcKey, strlen(psEntry->pcKey),
+      &pvItem);
+   if (pcCopy == NULL) {
+      return 0;
+   }
+   Key_release(oSymTable, psEntry->pcKey);
+   psEntry->pcKey = pcCopy;
+   psEntry->pvItem = pvItem;
+   return 1;
+}
+
+/* SymTable_discardKey takes in a oSymTable and the pcKey of a binding
+   taken out of it, and drops pcKey, or with SYMTABLE_DEFER_FREE keeps
+   it for SymTable_reclaim if it is the last reference. If there is no
+   memory to keep it, it is freed at once. */
+static void SymTable_discardKey(SymTable_T oSymTable, char *pcKey) {
+   char **ppcDead;
+   size_t uRoom;
+   if ((oSymTable->uFlags & SYMTABLE_DEFER_FREE) &&
+      ! (oSymTable->uFlags & SYMTABLE_BORROW_KEYS) &&
+      REF_GET(Key_refs(pcKey)) == 1) {
+      if (oSymTable->uDead == oSymTable->uDeadRoom) {
+         uRoom = oSymTable->uDeadRoom == 0 ? MIN_SLOTS :
+            2 * oSymTable->uDeadRoom;
+         ppcDead = (char **) realloc(oSymTable->ppcDead,
+            uRoom * sizeof(char *));
+         if (ppcDead != NULL) {
+            STAT_ADD(oSymTable, uAllocations, 1);
+            oSymTable->ppcDead = ppcDead;
+            oSymTable->uDeadRoom = uRoom;
+         }
+      }
+      if (oSymTable->uDead < oSymTable->uDeadRoom) {
+         oSymTable->ppcDead[oSymTable->uDead++] = pcKey;
+         return;
+      }
+   }
+   Key_release(oSymTable, pcKey);
+}
+
+/* SymTable_removeSlot takes in a oSymTable that owns its Store and
+   the index slot uSlot of one of its bindings, removes the binding,
+   leaving a hole in the Entries, and returns its value. */
+static const void *SymTable_removeSlot(SymTable_T oSymTable,
+   size_t uSlot) {
+   struct Store *psStore = oSymTable->psStore;
+   struct Entry *psEntry = &psStore->asEntries[psStore->auIndex[uSlot]];
+   const void *pvItem = psEntry->pvItem;
+   psStore->auIndex[uSlot] = uSlotRemoved;
+   SymTable_discardKey(oSymTable, psEntry->pcKey);
+   psEntry->pcKey = NULL;
+   oSymTable->length -= 1;
+   return pvItem;
+}
+
+/* SymTable_evict takes in a bounded oSymTable that owns its Store and
+   has at least one binding, and evicts its first binding, which has
+   gone the longest without being put or found. */
+static void SymTable_evict(SymTable_T oSymTable) {
+   struct Store *psStore = oSymTable->psStore;
+   struct Entry *psEntry;
+   while (psStore->asEntries[psStore->uFirst].pcKey == NULL) {
+      psStore->uFirst++;
+   }
+   psEntry = &psStore->asEntries[psStore->uFirst];
+   if (oSymTable->pfEvict != NULL) {
+      (*oSymTable->pfEvict)(psEntry->pcKey, (void *)psEntry->pvItem,
+         (void *)oSymTable->pvExtra);
+   }
+   SymTable_removeSlot(oSymTable, Store_slotOf(psStore, psEntry->uHash,
+      psEntry->pcKey));
+}
+
+/* SymTable_touch takes in a oSymTable and the index slot uSlot of a
+   binding it found, and returns the Entry of the binding. If the
+   oSymTable is bounded, the binding first moves to the end of the
+   Entries, so that the first binding is always the one that has gone
+   the longest without being put or found, unless the Store is shared
+   with a snapshot or there is no memory to squeeze out the holes. */
+static struct Entry *SymTable_touch(SymTable_T oSymTable, size_t uSlot) {
+   struct Store *psStore = oSymTable->psStore;
+   size_t uPos = psStore->auIndex[uSlot];
+   struct Entry sEntry;
+   if (oSymTable->uCapacity == 0 || uPos + 1 == psStore->uUsed ||
+      REF_GET(&psStore->uRefs) > 1) {
+      return &psStore->asEntries[uPos];
+   }
+   if (psStore->uUsed == psStore->uRoom) {
+      sEntry = psStore->asEntries[uPos];
+      if (! SymTable_grow(oSymTable, 2 * oSymTable->length + 1)) {
+         return &psStore->asEntries[uPos];
+      }
+      psStore = oSymTable->psStore;
+      uSlot = Store_slotOf(psStore, sEntry.uHash, sEntry.pcKey);
+      uPos = psStore->auIndex[uSlot];
+   }
+   psStore->asEntries[psStore->uUsed] = psStore->asEntries[uPos];
+   psStore->asEntries[uPos].pcKey = NULL;
+   psStore->auIndex[uSlot] = (uint32_t)psStore->uUsed;
+   psStore->uUsed += 1;
+   return &psStore->asEntries[psStore->uUsed - 1];
+}
+
+/* SymTable_inRange takes in a string pcKey, bounds pcLo and pcHi and
+   a prefix pcPrefix of length uPrefixLength, and returns 1 if pcKey
+   is at least pcLo, less than pcHi and starts with pcPrefix, where a
+   NULL pcLo, pcHi or pcPrefix is no limit. Otherwise returns 0. */
+static int SymTable_inRange(const char *pcKey, const char *pcLo,
+   const char *pcHi, const char *pcPrefix, size_t uPrefixLength) {
+   if (pcLo != NULL && strcmp(pcKey, pcLo) < 0) {
+      return 0;
+   }
+   if (pcHi != NULL && strcmp(pcKey, pcHi) >= 0) {
+      return 0;
+   }
+   if (pcPrefix != NULL && strncmp(pcKey, pcPrefix, uPrefixLength) != 0) {
+      return 0;
+   }
+   return 1;
+}
+
+/* SymTable_compareEntries takes in pointers pvFirst and pvSecond to
+   two Entry pointers and compares their keys with strcmp, for
+   qsort. */
+static int SymTable_compareEntries(const void *pvFirst,
+   const void *pvSecond) {
+   const struct Entry *psFirst = *(const struct Entry *const *)pvFirst;
+   const struct Entry *psSecond = *(const struct Entry *const *)pvSecond;
+   return strcmp(psFirst->pcKey, psSecond->pcKey);
+}
+
+/* SymTable_mapSorted takes in a oSymTable, bounds pcLo and pcHi, a
+   prefix pcPrefix, function pfApply and pvExtra. It collects the
+   Entries whose keys are in range as for SymTable_inRange, sorts them
+   by key and applies pfApply to each in that order. Returns 1 if
+   successful, or 0 if there is no memory for the sorting, in which
+   case pfApply is never called. */
+static int SymTable_mapSorted(SymTable_T oSymTable, const char *pcLo,
+    const char *pcHi, const char *pcPrefix,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   const struct Store *psStore;
+   const struct Entry **ppsMatches;
+   size_t uPrefixLength = 0;
+   size_t uCount = 0;
+   size_t i;
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+   psStore = oSymTable->psStore;
+   if (pcPrefix != NULL) {
+      uPrefixLength = strlen(pcPrefix);
+   }
+   for (i = psStore->uFirst; i < psStore->uUsed; i++) {
+      if (psStore->asEntries[i].pcKey != NULL &&
+         SymTable_inRange(psStore->asEntries[i].pcKey, pcLo, pcHi,
+         pcPrefix, uPrefixLength)) {
+         uCount++;
+      }
+   }
+   if (uCount == 0) {
+      return 1;
+   }
+   ppsMatches = (const struct Entry **) malloc(uCount *
+      sizeof(struct Entry *));
+   if (ppsMatches == NULL) {
+      return 0;
+   }
+   uCount = 0;
+   for (i = psStore->uFirst; i < psStore->uUsed; i++) {
+      if (psStore->asEntries[i].pcKey != NULL &&
+         SymTable_inRange(psStore->asEntries[i].pcKey, pcLo, pcHi,
+         pcPrefix, uPrefixLength)) {
+         ppsMatches[uCount++] = &psStore->asEntries[i];
+      }
+   }
+   qsort(ppsMatches, uCount, sizeof(struct Entry *),
+      SymTable_compareEntries);
+   for (i = 0; i < uCount; i++) {
+      (*pfApply)(ppsMatches[i]->pcKey, (void *)ppsMatches[i]->pvItem,
+         (void *)pvExtra);
+   }
+   free(ppsMatches);
+   return 1;
+}
+
+SymTable_T SymTable_new(void) {
+   return SymTable_newWithFlags(0);
+}
+
+/* A dict finds its bindings through its index and keeps them in the
+   order they were put, so it ignores SYMTABLE_MOVE_TO_FRONT and
+   SYMTABLE_TRANSPOSE. It only hashes with the hash function from the
+   assignment specification, keeps no filter and grows on the calling
+   thread, so it also ignores SYMTABLE_HARDENED, SYMTABLE_FILTER and
+   SYMTABLE_BACKGROUND_RESIZE. */
+SymTable_T SymTable_newWithFlags(unsigned int uFlags) {
+   SymTable_T oSymTable;
+   oSymTable = (SymTable_T) malloc(sizeof(struct SymTable));
+   if (oSymTable == NULL) {
+      return NULL;
+   }
+   oSymTable->length = 0;
+   oSymTable->uFlags = uFlags;
+   oSymTable->iReadOnly = 0;
+   oSymTable->uValueSize = 0;
+   oSymTable->ppcDead = NULL;
+   oSymTable->uDead = 0;
+   oSymTable->uDeadRoom = 0;
+   oSymTable->uCapacity = 0;
+   oSymTable->pfEvict = NULL;
+   oSymTable->pvExtra = NULL;
+#ifdef SYMTABLE_STATS
+   memset(&oSymTable->sStats, 0, sizeof(oSymTable->sStats));
+   oSymTable->sStats.uAllocations = 1;
+#endif
+   oSymTable->psStore = Store_new(MIN_SLOTS);
+   if (oSymTable->psStore == NULL) {
+      free(oSymTable);
+      return NULL;
+   }
+   STAT_ADD(oSymTable, uAllocations, 1);
+   return oSymTable;
+}
+
+/* A dict has no bucket array, only a Store that grows as often as a
+   bucket array would, so it ignores SYMTABLE_HUGE_PAGES and
+   iNode. */
+SymTable_T SymTable_newOnNode(unsigned int uFlags, int iNode) {
+   (void)iNode;
+   return SymTable_newWithFlags(uFlags);
+}
+
+SymTable_T SymTable_newSized(size_t uValueSize) {
+   SymTable_T oSymTable;
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL) {
+      return NULL;
+   }
+   oSymTable->uValueSize = uValueSize;
+   return oSymTable;
+}
+
+/* A bounded dict moves every binding it finds to the end of its
+   Entries, so that the first binding is always the least recently
+   used one, and evicts that. */
+SymTable_T SymTable_newBounded(size_t uCapacity, unsigned int uFlags,
+   void (*pfEvict)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+   SymTable_T oSymTable;
+   assert(uCapacity >= 1);
+   oSymTable = SymTable_newWithFlags(uFlags);
+   if (oSymTable == NULL) {
+      return NULL;
+   }
+   oSymTable->uCapacity = uCapacity;
+   oSymTable->pfEvict = pfEvict;
+   oSymTable->pvExtra = pvExtra;
+   return oSymTable;
+}
+
+/* A dict grows once to hold every binding, then puts them one at a
+   time, so that they keep the order of the arrays. */
+SymTable_T SymTable_fromArrays(const char *const *ppcKeys,
+   const void *const *ppvValues, size_t uCount) {
+   SymTable_T oSymTable;
+   size_t i;
+   assert(uCount == 0 || ppcKeys != NULL);
+   assert(uCount == 0 || ppvValues != NULL);
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL) {
+      return NULL;
+   }
+   if (! SymTable_grow(oSymTable, uCount)) {
+      SymTable_free(oSymTable);
+      return NULL;
+   }
+   for (i = 0; i < uCount; i++) {
+      if (! SymTable_put(oSymTable, ppcKeys[i], ppvValues[i]) &&
+         ! SymTable_contains(oSymTable, ppcKeys[i])) {
+         SymTable_free(oSymTable);
+         return NULL;
+      }
+   }
+   return oSymTable;
+}
+
+/* The order of the Entries is the order of the arrays, so a dict
+   cannot split the work among threads, and builds it on the calling
+   thread, as SymTable_fromArrays does. */
+SymTable_T SymTable_buildParallel(const char *const *ppcKeys,
+   const void *const *ppvValues, size_t uCount, size_t uThreads) {
+   (void)uThreads;
+   return SymTable_fromArrays(ppcKeys, ppvValues, uCount);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+   return oSymTable->length;
+}
+
+unsigned int SymTable_getFlags(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+   return oSymTable->uFlags;
+}
+
+/* SymTable_putKey takes in a oSymTable, a pcKey of uLength characters
+   and a pvValue, and puts the binding in a new Entry at the end as
+   SymTable_put does. */
+static int SymTable_putKey(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength, const void *pvValue) {
+   struct Store *psStore;
+   struct Entry *psEntry;
+   size_t uHash;
+   char *pcCopy;
+   if (oSymTable->uDead != 0) {
+      SymTable_reclaim(oSymTable, RECLAIM_STEP);
+   }
+   if (SymTable_lookup(oSymTable, pcKey, uLength, &uHash) != uNoSlot) {
+      return 0;
+   }
+   if (! SymTable_own(oSymTable)) {
+      return 0;
+   }
+   if (oSymTable->psStore->uUsed == oSymTable->psStore->uRoom &&
+      ! SymTable_grow(oSymTable, 2 * oSymTable->length + 1)) {
+      return 0;
+   }
+   pcCopy = Key_new(oSymTable, pcKey, uLength, &pvValue);
+   if (pcCopy == NULL) {
+      return 0;
+   }
+   psStore = oSymTable->psStore;
+   psEntry = &psStore->asEntries[psStore->uUsed];
+   psEntry->uHash = uHash;
+   psEntry->pcKey = pcCopy;
+   psEntry->pvItem = pvValue;
+   Store_place(psStore, uHash, psStore->uUsed);
+   psStore->uUsed += 1;
+   oSymTable->length += 1;
+   if (oSymTable->uCapacity != 0 &&
+      oSymTable->length > oSymTable->uCapacity) {
+      SymTable_evict(oSymTable);
+   }
+   return 1;
+}
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(! oSymTable->iReadOnly);
+   return SymTable_putKey(oSymTable, pcKey, strlen(pcKey), pvValue);
+}
+
+int SymTable_putN(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength, const void *pvValue) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL || uLength == 0);
+   assert(uLength == 0 || memchr(pcKey, '\0', uLength) == NULL);
+   assert(! oSymTable->iReadOnly);
+   return SymTable_putKey(oSymTable, pcKey == NULL ? "" : pcKey, uLength,
+      pvValue);
+}
+
+/* SymTable_findEntry takes in a oSymTable and a string pcKey, and
+   returns the Entry of pcKey after SymTable_touch, or NULL if there
+   is none. */
+static const struct Entry *SymTable_findEntry(SymTable_T oSymTable,
+   const char *pcKey) {
+   size_t uHash;
+   size_t uSlot;
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   uSlot = SymTable_lookup(oSymTable, pcKey, strlen(pcKey), &uHash);
+   if (uSlot == uNoSlot) {
+      return NULL;
+   }
+   return SymTable_touch(oSymTable, uSlot);
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+   return SymTable_findEntry(oSymTable, pcKey) != NULL;
+}
+
+void* SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+   const struct Entry *psEntry;
+   psEntry = SymTable_findEntry(oSymTable, pcKey);
+   if (psEntry == NULL) {
+      return NULL;
+   }
+   return (void*) psEntry->pvItem;
+}
+
+/* A cursor at a binding has the position of its Entry plus 1 as
+   uIndex, so that SymTable_next goes on from the Entry after it. */
+int SymTable_lookupN(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength, struct SymTableCursor *psCursor) {
+   const struct Store *psStore;
+   size_t uHash;
+   size_t uSlot;
+   size_t uPos;
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL || uLength == 0);
+   assert(uLength == 0 || memchr(pcKey, '\0', uLength) == NULL);
+   assert(psCursor != NULL);
+   uSlot = SymTable_lookup(oSymTable, pcKey == NULL ? "" : pcKey,
+      uLength, &uHash);
+   if (uSlot == uNoSlot) {
+      return 0;
+   }
+   psStore = oSymTable->psStore;
+   uPos = psStore->auIndex[uSlot];
+   psCursor->uIndex = uPos + 1;
+   psCursor->pvPlace = NULL;
+   psCursor->pcKey = psStore->asEntries[uPos].pcKey;
+   psCursor->pvValue = (void*) psStore->asEntries[uPos].pvItem;
+   return 1;
+}
+
+int SymTable_next(SymTable_T oSymTable, struct SymTableCursor *psCursor) {
+   const struct Store *psStore;
+   size_t uPos;
+   assert(oSymTable != NULL);
+   assert(psCursor != NULL);
+   psStore = oSymTable->psStore;
+   uPos = psCursor->uIndex;
+   if (uPos < psStore->uFirst) {
+      uPos = psStore->uFirst;
+   }
+   while (uPos < psStore->uUsed && psStore->asEntries[uPos].pcKey == NULL) {
+      uPos++;
+   }
+   if (uPos >= psStore->uUsed) {
+      psCursor->uIndex = psStore->uUsed;
+      psCursor->pvPlace = NULL;
+      return 0;
+   }
+   psCursor->uIndex = uPos + 1;
+   psCursor->pvPlace = NULL;
+   psCursor->pcKey = psStore->asEntries[uPos].pcKey;
+   psCursor->pvValue = (void*) psStore->asEntries[uPos].pvItem;
+   return 1;
+}
+
+void* SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue) {
+   struct Entry *psEntry;
+   const void *pvOld;
+   size_t uHash;
+   size_t uSlot;
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(! oSymTable->iReadOnly);
+   uSlot = SymTable_lookup(oSymTable, pcKey, strlen(pcKey), &uHash);
+   if (uSlot == uNoSlot) {
+      return NULL;
+   }
+   if (! SymTable_ownSlot(oSymTable, &uSlot, uHash)) {
+      return NULL;
+   }
+   psEntry = SymTable_touch(oSymTable, uSlot);
+   if (oSymTable->uValueSize != 0) {
+      if (! SymTable_ownValue(oSymTable, psEntry)) {
+         return NULL;
+      }
+      memcpy((void*)psEntry->pvItem, pvValue, oSymTable->uValueSize);
+      return (void*) psEntry->pvItem;
+   }
+   pvOld = psEntry->pvItem;
+   psEntry->pvItem = pvValue;
+   return (void*) pvOld;
+}
+
+/* SymTable_removeKey takes in a oSymTable and a pcKey of uLength
+   characters, and removes the binding of pcKey as SymTable_remove
+   does. */
+static void *SymTable_removeKey(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength) {
+   const void *pvItem;
+   size_t uHash;
+   size_t uSlot;
+   uSlot = SymTable_lookup(oSymTable, pcKey, uLength, &uHash);
+   if (uSlot == uNoSlot) {
+      return NULL;
+   }
+   if (! SymTable_ownSlot(oSymTable, &uSlot, uHash)) {
+      return NULL;
+   }
+   pvItem = SymTable_removeSlot(oSymTable, uSlot);
+   if (oSymTable->uValueSize != 0) {
+      return NULL;
+   }
+   return (void *) pvItem;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(! oSymTable->iReadOnly);
+   return SymTable_removeKey(oSymTable, pcKey, strlen(pcKey));
+}
+
+void *SymTable_removeN(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL || uLength == 0);
+   assert(uLength == 0 || memchr(pcKey, '\0', uLength) == NULL);
+   assert(! oSymTable->iReadOnly);
+   return SymTable_removeKey(oSymTable, pcKey == NULL ? "" : pcKey,
+      uLength);
+}
+
+size_t SymTable_reclaim(SymTable_T oSymTable, size_t uBudget) {
+   assert(oSymTable != NULL);
+   for (; uBudget > 0 && oSymTable->uDead > 0; uBudget--) {
+      oSymTable->uDead -= 1;
+      free(Key_refs(oSymTable->ppcDead[oSymTable->uDead]));
+   }
+   return oSymTable->uDead;
+}
+
+void SymTable_free(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+   SymTable_reclaim(oSymTable, oSymTable->uDead);
+   free(oSymTable->ppcDead);
+   Store_release(oSymTable, oSymTable->psStore);
+   free(oSymTable);
+}
+
+SymTable_T SymTable_snapshot(SymTable_T oSymTable) {
+   SymTable_T oSnapshot;
+   assert(oSymTable != NULL);
+   oSnapshot = (SymTable_T) malloc(sizeof(struct SymTable));
+   if (oSnapshot == NULL) {
+      return NULL;
+   }
+   REF_INC(&oSymTable->psStore->uRefs);
+   oSnapshot->psStore = oSymTable->psStore;
+   oSnapshot->length = oSymTable->length;
+   /* a snapshot frees only the keys it owns */
+   oSnapshot->uFlags = oSymTable->uFlags & SYMTABLE_BORROW_KEYS;
+   oSnapshot->iReadOnly = 1;
+   oSnapshot->uValueSize = oSymTable->uValueSize;
+   oSnapshot->ppcDead = NULL;
+   oSnapshot->uDead = 0;
+   oSnapshot->uDeadRoom = 0;
+   oSnapshot->uCapacity = 0;
+   oSnapshot->pfEvict = NULL;
+   oSnapshot->pvExtra = NULL;
+#ifdef SYMTABLE_STATS
+   memset(&oSnapshot->sStats, 0, sizeof(oSnapshot->sStats));
+   oSnapshot->sStats.uAllocations = 1;
+#endif
+   return oSnapshot;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   const struct Store *psStore;
+   size_t i;
+
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+
+   psStore = oSymTable->psStore;
+   for (i = psStore->uFirst; i < psStore->uUsed; i++)
+      if (psStore->asEntries[i].pcKey != NULL)
+         (*pfApply)(psStore->asEntries[i].pcKey,
+            (void *)psStore->asEntries[i].pvItem, (void *)pvExtra);
+}
+
+/* SymTable_retain squeezes the kept bindings to the front of the
+   Entries as it goes and builds the index again at the end, so it
+   needs no memory unless a snapshot shares the Store. */
+int SymTable_retain(SymTable_T oSymTable,
+    int (*pfKeep)(const char *pcKey, void *pvValue, void *pvExtra),
+    void (*pfFree)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   struct Store *psStore;
+   struct Entry *psEntry;
+   size_t i;
+   assert(oSymTable != NULL);
+   assert(pfKeep != NULL);
+   assert(! oSymTable->iReadOnly);
+   if (! SymTable_own(oSymTable)) {
+      return 0;
+   }
+   psStore = oSymTable->psStore;
+   for (i = psStore->uFirst; i < psStore->uUsed; i++) {
+      psEntry = &psStore->asEntries[i];
+      if (psEntry->pcKey == NULL ||
+         (*pfKeep)(psEntry->pcKey, (void *)psEntry->pvItem,
+         (void *)pvExtra)) {
+         continue;
+      }
+      if (pfFree != NULL) {
+         (*pfFree)(psEntry->pcKey, (void *)psEntry->pvItem,
+            (void *)pvExtra);
+      }
+      SymTable_discardKey(oSymTable, psEntry->pcKey);
+      psEntry->pcKey = NULL;
+      oSymTable->length -= 1;
+   }
+   Store_compact(psStore);
+   return 1;
+}
+
+/* Difference is the pvExtra SymTable_difference passes to
+   SymTable_retain, with the SymTable oOther whose keys are removed
+   and the pfFree and pvExtra of the caller */
+struct Difference
+{
+   SymTable_T oOther;
+   void (*pfFree)(const char *pcKey, void *pvValue, void *pvExtra);
+   const void *pvExtra;
+};
+
+/* SymTable_lacks takes in a binding pcKey and pvValue and a
+   Difference pvExtra, and returns 1 if oOther of the Difference does
+   not have pcKey, otherwise 0. */
+static int SymTable_lacks(const char *pcKey, void *pvValue,
+   void *pvExtra) {
+   struct Difference *psDifference = (struct Difference *)pvExtra;
+   size_t uHash;
+   (void)pvValue;
+   return SymTable_lookup(psDifference->oOther, pcKey, strlen(pcKey),
+      &uHash) == uNoSlot;
+}
+
+/* SymTable_freeDifference takes in a binding pcKey and pvValue and a
+   Difference pvExtra, and calls pfFree of the Difference on the
+   binding with the pvExtra of the caller. */
+static void SymTable_freeDifference(const char *pcKey, void *pvValue,
+   void *pvExtra) {
+   struct Difference *psDifference = (struct Difference *)pvExtra;
+   (*psDifference->pfFree)(pcKey, pvValue,
+      (void *)psDifference->pvExtra);
+}
+
+int SymTable_difference(SymTable_T oSymTable, SymTable_T oOther,
+    void (*pfFree)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   struct Difference sDifference;
+   assert(oSymTable != NULL);
+   assert(oOther != NULL);
+   assert(oSymTable != oOther);
+   sDifference.oOther = oOther;
+   sDifference.pfFree = pfFree;
+   sDifference.pvExtra = pvExtra;
+   return SymTable_retain(oSymTable, SymTable_lacks,
+      pfFree == NULL ? NULL : SymTable_freeDifference, &sDifference);
+}
+
+/* SymTable_merge makes room in oDst for every binding of oSrc first,
+   then appends the Entries it moves to those of oDst in the order of
+   oSrc, key, hash code and all, so no key is copied or hashed again,
+   and squeezes the holes they leave out of oSrc at the end. */
+int SymTable_merge(SymTable_T oDst, SymTable_T oSrc, unsigned int uPolicy) {
+   struct Store *psSrc;
+   struct Store *psDst;
+   struct Entry *psEntry;
+   struct Entry *psFound;
+   const void *pvOld;
+   size_t uMoved = 0;
+   size_t uSlot;
+   size_t i;
+   int iSuccessful = 1;
+   assert(oDst != NULL);
+   assert(oSrc != NULL);
+   assert(oDst != oSrc);
+   assert(! oDst->iReadOnly && ! oSrc->iReadOnly);
+   assert(oDst->uValueSize == oSrc->uValueSize);
+   assert((oDst->uFlags & SYMTABLE_BORROW_KEYS) ==
+      (oSrc->uFlags & SYMTABLE_BORROW_KEYS));
+   assert(uPolicy == SYMTABLE_MERGE_KEEP ||
+      uPolicy == SYMTABLE_MERGE_REPLACE);
+   if (! SymTable_own(oSrc)) {
+      return 0;
+   }
+   if (oDst->psStore->uUsed + oSrc->length > oDst->psStore->uRoom) {
+      if (! SymTable_grow(oDst, 2 * (oDst->length + oSrc->length))) {
+         return 0;
+      }
+   }
+   else if (! SymTable_own(oDst)) {
+      return 0;
+   }
+   psSrc = oSrc->psStore;
+   psDst = oDst->psStore;
+   for (i = psSrc->uFirst; i < psSrc->uUsed; i++) {
+      psEntry = &psSrc->asEntries[i];
+      if (psEntry->pcKey == NULL) {
+         continue;
+      }
+      uSlot = SymTable_find(oDst, psEntry->pcKey, strlen(psEntry->pcKey),
+         psEntry->uHash);
+      if (uSlot == uNoSlot) {
+         psDst->asEntries[psDst->uUsed] = *psEntry;
+         Store_place(psDst, psEntry->uHash, psDst->uUsed);
+         psDst->uUsed += 1;
+         psEntry->pcKey = NULL;
+         oSrc->length -= 1;
+         oDst->length += 1;
+         uMoved++;
+         continue;
+      }
+      if (uPolicy == SYMTABLE_MERGE_KEEP) {
+         continue;
+      }
+      psFound = &psDst->asEntries[psDst->auIndex[uSlot]];
+      if (oDst->uValueSize != 0) {
+         if (! SymTable_ownValue(oDst, psFound)) {
+            iSuccessful = 0;
+            break;
+         }
+         memcpy((void*)psFound->pvItem, psEntry->pvItem, oDst->uValueSize);
+      }
+      else {
+         pvOld = psFound->pvItem;
+         psFound->pvItem = psEntry->pvItem;
+         psEntry->pvItem = pvOld;
+      }
+   }
+   if (uMoved != 0) {
+      Store_compact(psSrc);
+   }
+   while (oDst->uCapacity != 0 && oDst->length > oDst->uCapacity) {
+      SymTable_evict(oDst);
+   }
+   return iSuccessful;
+}
+
+int SymTable_mapRange(SymTable_T oSymTable, const char *pcLo,
+    const char *pcHi,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   return SymTable_mapSorted(oSymTable, pcLo, pcHi, NULL, pfApply,
+      pvExtra);
+}
+
+int SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   assert(pcPrefix != NULL);
+   return SymTable_mapSorted(oSymTable, pcPrefix, NULL, pcPrefix,
+      pfApply, pvExtra);
+}
+
+struct SymTableStats SymTable_getStats(SymTable_T oSymTable) {
+   struct SymTableStats sStats;
+   assert(oSymTable != NULL);
+#ifdef SYMTABLE_STATS
+   sStats = oSymTable->sStats;
+#else
+   memset(&sStats, 0, sizeof(sStats));
+#endif
+   return sStats;
+}
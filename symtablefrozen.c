@@ -0,0 +1,409 @@
+/*--------------------------------------------------------------------*/
+/* symtablefrozen.c                                                 */
+/* Author: Kevin Chen                                               */
+/*--------------------------------------------------------------------*/
+
+#include "symtablefrozen.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* BLOCK_KEYS is how many keys a block holds. The first key of every
+   block is kept whole, so that a lookup can binary search the blocks
+   by it. Larger blocks save more memory, as fewer keys are kept
+   whole, but a lookup scans more keys of its block */
+enum {BLOCK_KEYS = 16};
+
+/* uNotFound is the position FrozenTable_find gives for a key that is
+   not there */
+static const size_t uNotFound = (size_t)-1;
+
+/* FrozenTable is the front-coded keys of uLength bindings in
+   increasing order, in blocks of BLOCK_KEYS keys, and their values.
+   The first key of a block is its length and its characters, and
+   every other key is the length of the prefix it shares with the key
+   before it, the length of the rest and the characters of the rest.
+   Lengths are written 7 bits to a byte, low bits first, with the top
+   bit set on every byte but the last, so that most take one byte */
+struct FrozenTable
+{
+   /* pucKeys holds the blocks of keys, one after another, in
+      uKeyBytes bytes */
+   unsigned char *pucKeys;
+   size_t uKeyBytes;
+   /* puBlocks holds where each of the uBlocks blocks starts in
+      pucKeys */
+   size_t *puBlocks;
+   size_t uBlocks;
+   /* ppvValues holds the values of the bindings, in the order of
+      their keys */
+   const void **ppvValues;
+   size_t uLength;
+   /* uMaxKey is the length of the longest key */
+   size_t uMaxKey;
+};
+
+/* Freeze is what FrozenTable_fromSymTable collects from a SymTable:
+   the uCount bindings so far, in increasing order of key */
+struct Freeze
+{
+   const char **ppcKeys;
+   const void **ppvValues;
+   size_t uCount;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Length_size takes in a length uLength and returns how many bytes
+   it takes written. */
+static size_t Length_size(size_t uLength) {
+   size_t uSize = 1;
+   while (uLength >= 0x80) {
+      uLength >>= 7;
+      uSize++;
+   }
+   return uSize;
+}
+
+/* Length_write takes in a place pucAt with room for it and a length
+   uLength, writes uLength there and returns the place after it. */
+static unsigned char *Length_write(unsigned char *pucAt, size_t uLength) {
+   while (uLength >= 0x80) {
+      *pucAt++ = (unsigned char)(uLength | 0x80);
+      uLength >>= 7;
+   }
+   *pucAt++ = (unsigned char)uLength;
+   return pucAt;
+}
+
+/* Length_read takes in a pointer ppucAt to a place where a length is
+   written, and returns the length, moving *ppucAt past it. */
+static size_t Length_read(const unsigned char **ppucAt) {
+   const unsigned char *pucAt = *ppucAt;
+   size_t uLength = 0;
+   unsigned int uShift = 0;
+   while (*pucAt & 0x80) {
+      uLength |= (size_t)(*pucAt++ & 0x7f) << uShift;
+      uShift += 7;
+   }
+   uLength |= (size_t)*pucAt++ << uShift;
+   *ppucAt = pucAt;
+   return uLength;
+}
+
+/* FrozenTable_common takes in uFirst characters at pcFirst and
+   uSecond characters at pcSecond, and returns how many characters
+   they start with in common. */
+static size_t FrozenTable_common(const char *pcFirst, size_t uFirst,
+   const char *pcSecond, size_t uSecond) {
+   size_t uCommon = 0;
+   while (uCommon < uFirst && uCommon < uSecond &&
+      pcFirst[uCommon] == pcSecond[uCommon]) {
+      uCommon++;
+   }
+   return uCommon;
+}
+
+/* FrozenTable_collect takes in a binding pcKey and pvValue and a
+   Freeze pvExtra, and adds the binding to the Freeze. */
+static void FrozenTable_collect(const char *pcKey, void *pvValue,
+   void *pvExtra) {
+   struct Freeze *psFreeze = (struct Freeze *)pvExtra;
+   psFreeze->ppcKeys[psFreeze->uCount] = pcKey;
+   psFreeze->ppvValues[psFreeze->uCount] = pvValue;
+   psFreeze->uCount++;
+}
+
+/* FrozenTable_encode takes in a oFrozenTable, its keys ppcKeys in
+   increasing order and a place pucAt with room for them, or NULL, and
+   writes the keys there in blocks, setting where each block starts.
+   Returns how many bytes they take, and with a NULL pucAt only
+   counts them. */
+static size_t FrozenTable_encode(FrozenTable_T oFrozenTable,
+   const char **ppcKeys, unsigned char *pucAt) {
+   size_t uBytes = 0;
+   size_t uPrevious = 0;
+   size_t uShared;
+   size_t uKey;
+   size_t i;
+   for (i = 0; i < oFrozenTable->uLength; i++) {
+      uKey = strlen(ppcKeys[i]);
+      if (i % BLOCK_KEYS == 0) {
+         uShared = 0;
+         if (pucAt != NULL) {
+            oFrozenTable->puBlocks[i / BLOCK_KEYS] = uBytes;
+         }
+         uBytes += Length_size(uKey);
+      }
+      else {
+         uShared = FrozenTable_common(ppcKeys[i - 1], uPrevious,
+            ppcKeys[i], uKey);
+         uBytes += Length_size(uShared) + Length_size(uKey - uShared);
+      }
+      uBytes += uKey - uShared;
+      if (pucAt != NULL) {
+         if (i % BLOCK_KEYS != 0) {
+            pucAt = Length_write(pucAt, uShared);
+         }
+         pucAt = Length_write(pucAt, uKey - uShared);
+         memcpy(pucAt, ppcKeys[i] + uShared, uKey - uShared);
+         pucAt += uKey - uShared;
+      }
+      if (uKey > oFrozenTable->uMaxKey) {
+         oFrozenTable->uMaxKey = uKey;
+      }
+      uPrevious = uKey;
+   }
+   return uBytes;
+}
+
+FrozenTable_T FrozenTable_fromSymTable(SymTable_T oSymTable) {
+   FrozenTable_T oFrozenTable;
+   struct Freeze sFreeze;
+   size_t uLength;
+   assert(oSymTable != NULL);
+   oFrozenTable = (FrozenTable_T) malloc(sizeof(struct FrozenTable));
+   if (oFrozenTable == NULL) {
+      return NULL;
+   }
+   uLength = SymTable_getLength(oSymTable);
+   oFrozenTable->uLength = uLength;
+   oFrozenTable->uBlocks = (uLength + BLOCK_KEYS - 1) / BLOCK_KEYS;
+   oFrozenTable->uMaxKey = 0;
+   oFrozenTable->pucKeys = NULL;
+   /* one more of each, so that an empty SymTable asks for some */
+   oFrozenTable->puBlocks = (size_t *) malloc((oFrozenTable->uBlocks + 1) *
+      sizeof(size_t));
+   oFrozenTable->ppvValues = (const void **) malloc((uLength + 1) *
+      sizeof(void *));
+   sFreeze.ppcKeys = (const char **) malloc((uLength + 1) *
+      sizeof(char *));
+   sFreeze.ppvValues = oFrozenTable->ppvValues;
+   sFreeze.uCount = 0;
+   if (oFrozenTable->puBlocks == NULL || oFrozenTable->ppvValues == NULL ||
+      sFreeze.ppcKeys == NULL ||
+      ! SymTable_mapRange(oSymTable, NULL, NULL, FrozenTable_collect,
+      &sFreeze)) {
+      free(sFreeze.ppcKeys);
+      FrozenTable_free(oFrozenTable);
+      return NULL;
+   }
+   assert(sFreeze.uCount == uLength);
+   oFrozenTable->uKeyBytes = FrozenTable_encode(oFrozenTable,
+      sFreeze.ppcKeys, NULL);
+   oFrozenTable->pucKeys = (unsigned char *) malloc(
+      oFrozenTable->uKeyBytes + 1);
+   if (oFrozenTable->pucKeys == NULL) {
+      free(sFreeze.ppcKeys);
+      FrozenTable_free(oFrozenTable);
+      return NULL;
+   }
+   FrozenTable_encode(oFrozenTable, sFreeze.ppcKeys,
+      oFrozenTable->pucKeys);
+   free(sFreeze.ppcKeys);
+   return oFrozenTable;
+}
+
+void FrozenTable_free(FrozenTable_T oFrozenTable) {
+   assert(oFrozenTable != NULL);
+   free(oFrozenTable->pucKeys);
+   free(oFrozenTable->puBlocks);
+   free(oFrozenTable->ppvValues);
+   free(oFrozenTable);
+}
+
+size_t FrozenTable_getLength(FrozenTable_T oFrozenTable) {
+   assert(oFrozenTable != NULL);
+   return oFrozenTable->uLength;
+}
+
+size_t FrozenTable_getKeyBytes(FrozenTable_T oFrozenTable) {
+   assert(oFrozenTable != NULL);
+   return oFrozenTable->uKeyBytes +
+      oFrozenTable->uBlocks * sizeof(size_t);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* FrozenTable_blocksUpTo takes in a oFrozenTable and a pcKey of
+   uLength characters, and returns how many blocks start with a key
+   that is at most pcKey, by binary search. */
+static size_t FrozenTable_blocksUpTo(FrozenTable_T oFrozenTable,
+   const char *pcKey, size_t uLength) {
+   const unsigned char *pucAt;
+   size_t uLo = 0;
+   size_t uHi = oFrozenTable->uBlocks;
+   size_t uMid;
+   size_t uFirst;
+   size_t uCommon;
+   int iAtMost;
+   while (uLo < uHi) {
+      uMid = uLo + (uHi - uLo) / 2;
+      pucAt = oFrozenTable->pucKeys + oFrozenTable->puBlocks[uMid];
+      uFirst = Length_read(&pucAt);
+      uCommon = FrozenTable_common((const char *)pucAt, uFirst, pcKey,
+         uLength);
+      iAtMost = uCommon == uFirst || (uCommon < uLength &&
+         pucAt[uCommon] < (unsigned char)pcKey[uCommon]);
+      if (iAtMost) {
+         uLo = uMid + 1;
+      }
+      else {
+         uHi = uMid;
+      }
+   }
+   return uLo;
+}
+
+/* FrozenTable_find takes in a oFrozenTable and a pcKey, and returns
+   the position of the binding of pcKey, or uNotFound if there is
+   none. The keys of a block are never put back together: each is
+   compared from where the key before it parted from pcKey, since a
+   key that shares more with the one before it than that one shared
+   with pcKey still sorts before pcKey, and one that shares less
+   sorts after it. */
+static size_t FrozenTable_find(FrozenTable_T oFrozenTable,
+   const char *pcKey) {
+   const unsigned char *pucAt;
+   size_t uLength;
+   size_t uBlocks;
+   size_t uPos;
+   size_t uEnd;
+   size_t uCommon;
+   size_t uShared;
+   size_t uRest;
+   size_t uMore;
+   assert(oFrozenTable != NULL);
+   assert(pcKey != NULL);
+   uLength = strlen(pcKey);
+   uBlocks = FrozenTable_blocksUpTo(oFrozenTable, pcKey, uLength);
+   if (uBlocks == 0) {
+      return uNotFound;
+   }
+   uPos = (uBlocks - 1) * BLOCK_KEYS;
+   uEnd = uPos + BLOCK_KEYS;
+   if (uEnd > oFrozenTable->uLength) {
+      uEnd = oFrozenTable->uLength;
+   }
+   pucAt = oFrozenTable->pucKeys + oFrozenTable->puBlocks[uBlocks - 1];
+   uRest = Length_read(&pucAt);
+   uCommon = FrozenTable_common((const char *)pucAt, uRest, pcKey,
+      uLength);
+   if (uCommon == uRest && uCommon == uLength) {
+      return uPos;
+   }
+   pucAt += uRest;
+   for (uPos++; uPos < uEnd; uPos++) {
+      uShared = Length_read(&pucAt);
+      uRest = Length_read(&pucAt);
+      if (uShared < uCommon) {
+         return uNotFound;
+      }
+      if (uShared == uCommon) {
+         uMore = FrozenTable_common((const char *)pucAt, uRest,
+            pcKey + uCommon, uLength - uCommon);
+         uCommon += uMore;
+         if (uMore == uRest && uCommon == uLength) {
+            return uPos;
+         }
+         if (uMore < uRest && (uCommon == uLength ||
+            pucAt[uMore] > (unsigned char)pcKey[uCommon])) {
+            return uNotFound;
+         }
+      }
+      pucAt += uRest;
+   }
+   return uNotFound;
+}
+
+int FrozenTable_contains(FrozenTable_T oFrozenTable, const char *pcKey) {
+   return FrozenTable_find(oFrozenTable, pcKey) != uNotFound;
+}
+
+void *FrozenTable_get(FrozenTable_T oFrozenTable, const char *pcKey) {
+   size_t uPos = FrozenTable_find(oFrozenTable, pcKey);
+   if (uPos == uNotFound) {
+      return NULL;
+   }
+   return (void *)oFrozenTable->ppvValues[uPos];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* FrozenTable_mapFrom takes in a oFrozenTable, a block uBlock, a
+   prefix pcPrefix of length uPrefixLength or NULL, function pfApply
+   and pvExtra. It puts the keys back together from the start of
+   uBlock on, and applies pfApply to each binding whose key starts
+   with pcPrefix, stopping at the first key past them. Returns 1 if
+   successful, or 0 if there is no memory for the keys. */
+static int FrozenTable_mapFrom(FrozenTable_T oFrozenTable, size_t uBlock,
+   const char *pcPrefix, size_t uPrefixLength,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+   const unsigned char *pucAt;
+   char *pcKey;
+   size_t uShared = 0;
+   size_t uRest;
+   size_t uPos;
+   int iCompare;
+   if (uBlock >= oFrozenTable->uBlocks) {
+      return 1;
+   }
+   pcKey = (char *) malloc(oFrozenTable->uMaxKey + 1);
+   if (pcKey == NULL) {
+      return 0;
+   }
+   pucAt = oFrozenTable->pucKeys + oFrozenTable->puBlocks[uBlock];
+   for (uPos = uBlock * BLOCK_KEYS; uPos < oFrozenTable->uLength; uPos++) {
+      if (uPos % BLOCK_KEYS != 0) {
+         uShared = Length_read(&pucAt);
+      }
+      else {
+         uShared = 0;
+      }
+      uRest = Length_read(&pucAt);
+      memcpy(pcKey + uShared, pucAt, uRest);
+      pcKey[uShared + uRest] = '\0';
+      pucAt += uRest;
+      if (pcPrefix != NULL) {
+         iCompare = strncmp(pcKey, pcPrefix, uPrefixLength);
+         if (iCompare < 0) {
+            continue;
+         }
+         if (iCompare > 0) {
+            break;
+         }
+      }
+      (*pfApply)(pcKey, (void *)oFrozenTable->ppvValues[uPos],
+         (void *)pvExtra);
+   }
+   free(pcKey);
+   return 1;
+}
+
+int FrozenTable_map(FrozenTable_T oFrozenTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+   assert(oFrozenTable != NULL);
+   assert(pfApply != NULL);
+   return FrozenTable_mapFrom(oFrozenTable, 0, NULL, 0, pfApply,
+      pvExtra);
+}
+
+int FrozenTable_mapPrefix(FrozenTable_T oFrozenTable,
+   const char *pcPrefix,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+   size_t uPrefixLength;
+   size_t uBlocks;
+   assert(oFrozenTable != NULL);
+   assert(pcPrefix != NULL);
+   assert(pfApply != NULL);
+   uPrefixLength = strlen(pcPrefix);
+   /* the first key with pcPrefix is in the last block that starts at
+      most at pcPrefix, or in the first block if none does */
+   uBlocks = FrozenTable_blocksUpTo(oFrozenTable, pcPrefix,
+      uPrefixLength);
+   return FrozenTable_mapFrom(oFrozenTable, uBlocks == 0 ? 0 :
+      uBlocks - 1, pcPrefix, uPrefixLength, pfApply, pvExtra);
+}
@@ -0,0 +1,72 @@
+/*--------------------------------------------------------------------*/
+/* symtablefrozen.h                                                 */
+/* Author: Kevin Chen                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef symtablefrozenH
+#define symtablefrozenH
+
+#include "symtable.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Note: A FrozenTable is a read-only copy of the bindings of a
+   SymTable, made once the SymTable is done changing. Its keys are
+   kept in strcmp order and front-coded: in each block of a few keys,
+   the first is kept whole and every other key only as the length of
+   the prefix it shares with the key before it and the rest of it,
+   all in one block of memory. Keys that share long prefixes, such as
+   names in namespaces or mangled names, so take a fraction of the
+   memory a SymTable gives them, for a lookup that is a binary search
+   over the blocks and a scan of one. Many threads may read a
+   FrozenTable at once. */
+
+/* FrozenTable_T is a pointer to a FrozenTable */
+typedef struct FrozenTable *FrozenTable_T;
+
+/* FrozenTable_fromSymTable takes in a oSymTable and creates a new
+   FrozenTable_T with the same bindings. The keys are copied, so the
+   oSymTable may change or be freed afterwards, but the values are the
+   pointers the oSymTable holds, which for a SymTable made by
+   SymTable_newSized point into it. Returns the FrozenTable_T, or NULL
+   if there is no memory. */
+FrozenTable_T FrozenTable_fromSymTable(SymTable_T oSymTable);
+
+/* FrozenTable_free takes in a oFrozenTable and frees it. */
+void FrozenTable_free(FrozenTable_T oFrozenTable);
+
+/* FrozenTable_getLength takes in a oFrozenTable and returns how many
+   bindings it has. */
+size_t FrozenTable_getLength(FrozenTable_T oFrozenTable);
+
+/* FrozenTable_getKeyBytes takes in a oFrozenTable and returns how many
+   bytes its keys take, with what it needs to find them. */
+size_t FrozenTable_getKeyBytes(FrozenTable_T oFrozenTable);
+
+/* FrozenTable_contains and FrozenTable_get work like SymTable_contains
+   and SymTable_get. */
+int FrozenTable_contains(FrozenTable_T oFrozenTable, const char *pcKey);
+void *FrozenTable_get(FrozenTable_T oFrozenTable, const char *pcKey);
+
+/* FrozenTable_map and FrozenTable_mapPrefix work like SymTable_map and
+   SymTable_mapPrefix, always in increasing strcmp order. The keys are
+   put back together in a buffer one at a time, so the pcKey passed to
+   pfApply is only good until pfApply returns. Returns 1 if
+   successful, or 0 if there is no memory for the buffer, in which
+   case pfApply is never called. */
+int FrozenTable_map(FrozenTable_T oFrozenTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra);
+int FrozenTable_mapPrefix(FrozenTable_T oFrozenTable,
+   const char *pcPrefix,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,299 @@
+/*--------------------------------------------------------------------*/
+/* symtablegen.h                                                    */
+/* Author: Kevin Chen                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef symtablegenH
+#define symtablegenH
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/* Note: This header generates hash tables specialized for one key
+   type, one value type, one hash and one equality, with no void* in
+   the way. Everything is static inline and the hash and equality are
+   pasted in as written, so a SymTable_map style callback or a macro
+   hash is inlined where the compiler sees fit. The sizes the table
+   grows through, when it grows and the hash of a string are defined
+   here once and also used by symtablehash.c, so both tables behave
+   the same way. */
+
+/* SYMTABLE_BUCKET_COUNTS lists the bucket counts a hash table grows
+   through, in increasing order */
+#define SYMTABLE_BUCKET_COUNTS 509, 1021, 2039, 4093, 8191, 16381, \
+   32749, 65521
+
+/* SYMTABLE_SHOULD_EXPAND is 1 if a hash table of uLength bindings in
+   uBuckets buckets, the uBucketnum th of uSizes bucket counts, should
+   move to the next bucket count, otherwise 0. A table still full
+   after a rebuild that ran out of memory is tried again on the next
+   put. */
+#define SYMTABLE_SHOULD_EXPAND(uLength, uBuckets, uBucketnum, uSizes) \
+   ((uLength) >= (uBuckets) && (uBucketnum) < (uSizes) - 1)
+
+/* SymTable_hashString takes in a string pcKey and returns its hash
+   code, using the hash function from the assignment specification. */
+static inline size_t SymTable_hashString(const char *pcKey) {
+   const size_t HASH_MULTIPLIER = 65599;
+   size_t u;
+   size_t uHash = 0;
+   assert(pcKey != NULL);
+   for (u = 0; pcKey[u] != '\0'; u++)
+      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+   return uHash;
+}
+
+/* SymTable_hashBytes takes in the first uLength characters at pcKey
+   and returns the same hash code SymTable_hashString gives for them as
+   a string. */
+static inline size_t SymTable_hashBytes(const char *pcKey,
+   size_t uLength) {
+   const size_t HASH_MULTIPLIER = 65599;
+   size_t u;
+   size_t uHash = 0;
+   assert(pcKey != NULL);
+   for (u = 0; u < uLength; u++)
+      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+   return uHash;
+}
+
+/* SymTable_equalString takes in strings pcFirst and pcSecond and
+   returns 1 if they are equal, otherwise 0. */
+static inline int SymTable_equalString(const char *pcFirst,
+   const char *pcSecond) {
+   return strcmp(pcFirst, pcSecond) == 0;
+}
+
+/* SYMTABLE_HASH_INT and SYMTABLE_EQUAL_INT hash and compare integer
+   keys. The bucket counts are prime, so an integer is its own hash. */
+#define SYMTABLE_HASH_INT(key) ((size_t)(key))
+#define SYMTABLE_EQUAL_INT(first, second) ((first) == (second))
+
+/* SYMTABLE_DEFINE(Name, KeyT, ValueT, HASH, EQUAL) defines Name_T, a
+   pointer to a hash table that binds keys of type KeyT to values of
+   type ValueT, and its functions:
+
+   Name_new(void) returns a new empty Name_T, or NULL if there is no
+   memory. Name_free(oTable) frees it.
+
+   Name_getLength(oTable) returns how many bindings it has.
+
+   Name_put(oTable, key, value) binds key to value and returns 1, or
+   returns 0 if key is already bound or there is no memory.
+
+   Name_contains(oTable, key) returns 1 if key is bound, otherwise 0.
+
+   Name_get(oTable, key) returns a pointer to the value of key, which
+   stays valid until key is removed, or NULL if key is not bound.
+
+   Name_replace(oTable, key, value, pOldValue) binds key to value,
+   stores the old value in *pOldValue unless pOldValue is NULL, and
+   returns 1, or returns 0 if key is not bound.
+
+   Name_remove(oTable, key, pOldValue) removes the binding of key,
+   stores its value in *pOldValue unless pOldValue is NULL, and
+   returns 1, or returns 0 if key is not bound.
+
+   Name_map(oTable, pfApply, pvExtra) calls pfApply with every key, a
+   pointer to its value and pvExtra.
+
+   HASH(key) must return a size_t, and EQUAL(first, second) nonzero if
+   two keys are the same. Both may be functions or macros. Keys and
+   values are copied as they are; a table of string keys keeps the
+   pointers, so the strings must outlive their bindings. */
+#define SYMTABLE_DEFINE(Name, KeyT, ValueT, HASH, EQUAL) \
+\
+typedef struct Name *Name##_T; \
+\
+struct Name##Node \
+{ \
+   size_t uHash; \
+   KeyT key; \
+   ValueT value; \
+   struct Name##Node *psNext; \
+}; \
+\
+struct Name \
+{ \
+   size_t length; \
+   size_t bucketnum; \
+   size_t maxbucket; \
+   struct Name##Node **ppsBuckets; \
+}; \
+\
+static inline Name##_T Name##_new(void) { \
+   static const size_t auCounts[] = {SYMTABLE_BUCKET_COUNTS}; \
+   Name##_T oTable = (Name##_T) malloc(sizeof(struct Name)); \
+   if (oTable == NULL) { \
+      return NULL; \
+   } \
+   oTable->ppsBuckets = (struct Name##Node **) \
+      calloc(auCounts[0], sizeof(struct Name##Node *)); \
+   if (oTable->ppsBuckets == NULL) { \
+      free(oTable); \
+      return NULL; \
+   } \
+   oTable->length = 0; \
+   oTable->bucketnum = 0; \
+   oTable->maxbucket = auCounts[0]; \
+   return oTable; \
+} \
+\
+static inline void Name##_free(Name##_T oTable) { \
+   struct Name##Node *psNode; \
+   struct Name##Node *psNext; \
+   size_t i; \
+   assert(oTable != NULL); \
+   for (i = 0; i < oTable->maxbucket; i++) { \
+      for (psNode = oTable->ppsBuckets[i]; psNode != NULL; \
+         psNode = psNext) { \
+         psNext = psNode->psNext; \
+         free(psNode); \
+      } \
+   } \
+   free(oTable->ppsBuckets); \
+   free(oTable); \
+} \
+\
+static inline size_t Name##_getLength(Name##_T oTable) { \
+   assert(oTable != NULL); \
+   return oTable->length; \
+} \
+\
+/* Name_find returns the link to the node of key, whose hash is \
+   uHash, or the link at the end of its bucket if it is not bound */ \
+static inline struct Name##Node **Name##_find(Name##_T oTable, \
+   KeyT key, size_t uHash) { \
+   struct Name##Node **ppsLink; \
+   ppsLink = &oTable->ppsBuckets[uHash % oTable->maxbucket]; \
+   while (*ppsLink != NULL && ((*ppsLink)->uHash != uHash || \
+      ! EQUAL((*ppsLink)->key, key))) { \
+      ppsLink = &(*ppsLink)->psNext; \
+   } \
+   return ppsLink; \
+} \
+\
+/* Name_expand moves every node into the next bucket count, or \
+   leaves the table as it is if there is no memory */ \
+static inline void Name##_expand(Name##_T oTable) { \
+   static const size_t auCounts[] = {SYMTABLE_BUCKET_COUNTS}; \
+   struct Name##Node **ppsNew; \
+   struct Name##Node *psNode; \
+   struct Name##Node *psNext; \
+   size_t uNewLen = auCounts[oTable->bucketnum + 1]; \
+   size_t i; \
+   ppsNew = (struct Name##Node **) \
+      calloc(uNewLen, sizeof(struct Name##Node *)); \
+   if (ppsNew == NULL) { \
+      return; \
+   } \
+   for (i = 0; i < oTable->maxbucket; i++) { \
+      for (psNode = oTable->ppsBuckets[i]; psNode != NULL; \
+         psNode = psNext) { \
+         psNext = psNode->psNext; \
+         psNode->psNext = ppsNew[psNode->uHash % uNewLen]; \
+         ppsNew[psNode->uHash % uNewLen] = psNode; \
+      } \
+   } \
+   free(oTable->ppsBuckets); \
+   oTable->ppsBuckets = ppsNew; \
+   oTable->bucketnum += 1; \
+   oTable->maxbucket = uNewLen; \
+} \
+\
+static inline int Name##_put(Name##_T oTable, KeyT key, \
+   ValueT value) { \
+   static const size_t auCounts[] = {SYMTABLE_BUCKET_COUNTS}; \
+   struct Name##Node **ppsLink; \
+   struct Name##Node *psNode; \
+   size_t uHash; \
+   assert(oTable != NULL); \
+   uHash = (size_t)HASH(key); \
+   ppsLink = Name##_find(oTable, key, uHash); \
+   if (*ppsLink != NULL) { \
+      return 0; \
+   } \
+   psNode = (struct Name##Node *) malloc(sizeof(struct Name##Node)); \
+   if (psNode == NULL) { \
+      return 0; \
+   } \
+   psNode->uHash = uHash; \
+   psNode->key = key; \
+   psNode->value = value; \
+   psNode->psNext = NULL; \
+   *ppsLink = psNode; \
+   oTable->length += 1; \
+   if (SYMTABLE_SHOULD_EXPAND(oTable->length, oTable->maxbucket, \
+      oTable->bucketnum, sizeof(auCounts)/sizeof(auCounts[0]))) { \
+      Name##_expand(oTable); \
+   } \
+   return 1; \
+} \
+\
+static inline int Name##_contains(Name##_T oTable, KeyT key) { \
+   assert(oTable != NULL); \
+   return *Name##_find(oTable, key, (size_t)HASH(key)) != NULL; \
+} \
+\
+static inline ValueT *Name##_get(Name##_T oTable, KeyT key) { \
+   struct Name##Node *psNode; \
+   assert(oTable != NULL); \
+   psNode = *Name##_find(oTable, key, (size_t)HASH(key)); \
+   if (psNode == NULL) { \
+      return NULL; \
+   } \
+   return &psNode->value; \
+} \
+\
+static inline int Name##_replace(Name##_T oTable, KeyT key, \
+   ValueT value, ValueT *pOldValue) { \
+   struct Name##Node *psNode; \
+   assert(oTable != NULL); \
+   psNode = *Name##_find(oTable, key, (size_t)HASH(key)); \
+   if (psNode == NULL) { \
+      return 0; \
+   } \
+   if (pOldValue != NULL) { \
+      *pOldValue = psNode->value; \
+   } \
+   psNode->value = value; \
+   return 1; \
+} \
+\
+static inline int Name##_remove(Name##_T oTable, KeyT key, \
+   ValueT *pOldValue) { \
+   struct Name##Node **ppsLink; \
+   struct Name##Node *psNode; \
+   assert(oTable != NULL); \
+   ppsLink = Name##_find(oTable, key, (size_t)HASH(key)); \
+   psNode = *ppsLink; \
+   if (psNode == NULL) { \
+      return 0; \
+   } \
+   if (pOldValue != NULL) { \
+      *pOldValue = psNode->value; \
+   } \
+   *ppsLink = psNode->psNext; \
+   free(psNode); \
+   oTable->length -= 1; \
+   return 1; \
+} \
+\
+static inline void Name##_map(Name##_T oTable, \
+   void (*pfApply)(KeyT key, ValueT *pValue, void *pvExtra), \
+   const void *pvExtra) { \
+   struct Name##Node *psNode; \
+   size_t i; \
+   assert(oTable != NULL); \
+   assert(pfApply != NULL); \
+   for (i = 0; i < oTable->maxbucket; i++) { \
+      for (psNode = oTable->ppsBuckets[i]; psNode != NULL; \
+         psNode = psNode->psNext) { \
+         (*pfApply)(psNode->key, &psNode->value, (void *)pvExtra); \
+      } \
+   } \
+}
+
+#endif
@@ -3,51 +3,284 @@
 /* Author: Kevin Chen                                                 */
 /*--------------------------------------------------------------------*/
 
+/* mmap's MAP_ANONYMOUS and MAP_HUGETLB, madvise and syscall, which
+   SYMTABLE_HUGE_PAGES and SymTable_newOnNode use, are not part of
+   ISO C or of POSIX alone */
+#if defined(__linux__) && ! defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include "symtable.h"
+#include "symtablegen.h"
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <limits.h>
+
+/* SymTable_buildParallel runs its parts on POSIX threads where there
+   are any. Elsewhere SYMTABLE_THREADS is left undefined and the parts
+   run one after another on the calling thread. */
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#if defined(_POSIX_THREADS) && _POSIX_THREADS > 0
+#include <pthread.h>
+#define SYMTABLE_THREADS
+#endif
+#endif
+
+/* On Linux, large bucket arrays and those placed on a NUMA node are
+   mapped with mmap instead of malloc'd, see Array_map. Elsewhere
+   SYMTABLE_MMAP is left undefined and every psArray is malloc'd. */
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define SYMTABLE_MMAP
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#ifdef SYMTABLE_STATS
+/* When SYMTABLE_STATS is defined, STATS_PARAM, STATS_PASS and
+   STATS_ARG pass the SymTableStats of the SymTable down to the
+   LinkedList functions and STAT_ADD adds uCount to one of its
+   counters. Otherwise they expand to nothing, so the normal build
+   does no counting at all. */
+#define STATS_PARAM , struct SymTableStats *psStats
+#define STATS_PASS , psStats
+#define STATS_ARG(oSymTable) , &(oSymTable)->sStats
+#define STAT_ADD(psStats, field, uCount) ((psStats)->field += (uCount))
+#else
+#define STATS_PARAM
+#define STATS_PASS
+#define STATS_ARG(oSymTable)
+#define STAT_ADD(psStats, field, uCount) ((void)0)
+#endif
+
+/* REF_INC and REF_DEC add one to or take one from a reference count
+   and give the new count, and REF_GET reads one. They are atomic
+   where the compiler allows it, so that a snapshot may be used and
+   freed on another thread than the SymTable it was taken from. */
+#if defined(__GNUC__)
+#define REF_INC(puRefs) __atomic_add_fetch((puRefs), 1, __ATOMIC_RELAXED)
+#define REF_DEC(puRefs) __atomic_sub_fetch((puRefs), 1, __ATOMIC_ACQ_REL)
+#define REF_GET(puRefs) __atomic_load_n((puRefs), __ATOMIC_ACQUIRE)
+#else
+#define REF_INC(puRefs) (++*(puRefs))
+#define REF_DEC(puRefs) (--*(puRefs))
+#define REF_GET(puRefs) (*(puRefs))
+#endif
 
 /* Note: For the sake of modularity This file uses all the functions 
    from symtablelist.c to implement all the linkedlist in the symtable. 
-   Skip to SymTable_hash for all the Symtable function. 
-   Go to line ~250*/
+   Skip to SymTable_hash for all the Symtable function. */
 
 /* auBucketCounts contains the different dimensions in size_t that
-   the hash table could have */
-static const size_t auBucketCounts[] = {509, 1021, 2039, 4093, 8191, 
-        16381, 32749, 65521};
+   the hash table could have, shared with the tables symtablegen.h
+   generates */
+static const size_t auBucketCounts[] = {SYMTABLE_BUCKET_COUNTS};
+
+/* FLOOD_LENGTH is the LinkedList length past which a bucket is taken
+   to be flooded with colliding keys, as long as it is also more than
+   FLOOD_FACTOR times the average LinkedList length */
+enum {FLOOD_LENGTH = 32, FLOOD_FACTOR = 8};
+
+/* GROUP_WIDTH is the number of tags in the control group of a
+   LinkedList, which is the width of one 16-byte vector register.
+   TAG_EMPTY marks a lane with no node behind it; real tags only use
+   the low 7 bits, so it never matches one. */
+enum {GROUP_WIDTH = 16, TAG_EMPTY = 0x80};
+
+/* CACHE_LINE is the size in bytes of a cache line, which psArray is
+   aligned to so that no Bucket straddles two lines */
+enum {CACHE_LINE = 64};
+
+/* HUGE_PAGE is the size in bytes of the huge pages of
+   SYMTABLE_HUGE_PAGES. A psArray of a quarter of one or more goes in
+   huge pages, and a smaller one is not worth one. MBIND_PREFERRED is the
+   mbind mode that places memory on a NUMA node while there is room
+   on it, and MBIND_NODES the most nodes SymTable_newOnNode can name */
+enum {HUGE_PAGE = 2 * 1024 * 1024, MBIND_PREFERRED = 1,
+   MBIND_NODES = 1024};
+
+/* NO_SLOT is the index of no slot of a Clock */
+#define NO_SLOT ((size_t)-1)
+
+/* KEY_ARENA is added to the reference count of a key that lives in an
+   Arena, so that the count never drops to 0 and the key is never
+   freed on its own */
+#define KEY_ARENA ((size_t)1 << (sizeof(size_t) * CHAR_BIT - 1))
+
+/* RECLAIM_STEP is how many removed bindings of a SYMTABLE_DEFER_FREE
+   SymTable each SymTable_put frees */
+enum {RECLAIM_STEP = 2};
+
+/* CACHE_NODES is the most Nodes the Cache of a thread keeps, and
+   CACHE_KEYS the most keys of each of its KEY_CLASSES sizes, which go
+   up a size_t at a time from that of the empty key */
+enum {CACHE_NODES = 256, CACHE_KEYS = 64, KEY_CLASSES = 8};
+
+/* BUILD_PART_KEYS is the fewest keys SymTable_buildParallel gives a
+   thread, below which starting one costs more than it saves, and
+   BUILD_MAX_PARTS the most threads it starts */
+enum {BUILD_PART_KEYS = 1024, BUILD_MAX_PARTS = 64};
+
+/* RESIZE_BUILDING, RESIZE_BUILT, RESIZE_INSTALLED and
+   RESIZE_DISCARDED are the states of a Resize, see iState */
+enum {RESIZE_BUILDING, RESIZE_BUILT, RESIZE_INSTALLED, RESIZE_DISCARDED};
+
+/* FILTER_HASHES is how many counters of its block each key counts in,
+   and FILTER_LOAD is how many bindings each block of the Filter is
+   sized for */
+enum {FILTER_HASHES = 4, FILTER_LOAD = 8};
 
 /* LinkedList_T is a pointer a LinkedList */
 typedef struct LinkedList *LinkedList_T;
 
 /* The Node Struct is used in the LinkedList in 
    SymTable and contains
-   a void* pvItem, string psKey, and next node psNext */
+   a void* pvItem, string psKey, the hash code uHash and next
+   node psNext */
 struct Node
 {
    /* pvItem is the value stored in the Node */
    const void *pvItem;
-   /* psKey is the string that stores the identity of the Node */
+   /* psKey is the string that stores the identity of the Node. It
+      is made by Key_new, so it may be shared with a snapshot */
    char* pvKey;
+   /* uHash is the full hash code of pvKey. It is kept so that the
+      LinkedList can filter by tag and the SymTable can resize
+      without hashing the key again */
+   size_t uHash;
    /* psNext is a pointer that points to the next Node in the 
       linked List */
    struct Node *psNext;
+   /* uSlot is the index of the slot of the binding in the Clock of a
+      bounded SymTable, and means nothing in any other */
+   size_t uSlot;
 };
 
 /* LinkedList is the same as SymbolTable in symtablelist.c file.
    It is all the same functions as symboltablelist.c with the
-   name changed to LinkedList */
+   name changed to LinkedList, plus a control group of tags that
+   lets lookups skip nodes that cannot match */
 struct LinkedList
 {
+   /* aucTags is the control group. Lane i holds the 7-bit tag of
+      the i-th node of the linkedlist, or TAG_EMPTY if the linkedlist
+      is shorter than i + 1 */
+   unsigned char aucTags[GROUP_WIDTH];
    /* psFirst is a pointer that points to the first node in the 
       linkedlist */
    struct Node *psFirst;
    /* length is a size_t that stores how many bindings are in 
       the table */
    size_t length;
+   /* uRefs is how many psArrays hold the LinkedList. One held by more
+      than one is shared with a snapshot and is copied before it
+      changes */
+   size_t uRefs;
+};
+
+/* Bucket is one slot of psArray. The first binding of the bucket is
+   kept in the slot itself, so that finding a key in a bucket with
+   one binding reads nothing but the slot and the key. Any further
+   bindings go in the LinkedList oOverflow. A Bucket with no inline
+   binding has no other bindings either */
+struct Bucket
+{
+   /* uHash is the full hash code of pcKey */
+   size_t uHash;
+   /* pcKey is the key of the inline binding, made by Key_new, or NULL
+      if the Bucket is empty */
+   char *pcKey;
+   /* pvItem is the value of the inline binding */
+   const void *pvItem;
+   /* oOverflow holds the bindings after the first, or is NULL */
+   LinkedList_T oOverflow;
+};
+
+/* ArrayHeader is kept just before the first Bucket of every psArray */
+struct ArrayHeader
+{
+   /* pvBlock is the memory malloc'd for the psArray, which starts
+      somewhere inside it on a cache line */
+   void *pvBlock;
+   /* uRefs is how many SymTables share the psArray. One shared by
+      more than one is copied before it changes */
+   size_t uRefs;
+   /* uMapped is how many bytes were mapped for pvBlock by Array_map,
+      or 0 if it was malloc'd */
+   size_t uMapped;
+};
+
+/* Filter is a counting Bloom filter of the keys of a SymTable. Each
+   key counts in FILTER_HASHES counters, all in one block of CACHE_LINE
+   counters, so that checking a key reads one cache line. A key whose
+   counters are not all above 0 is not in the SymTable. A counter that
+   reaches UCHAR_MAX stays there, since it no longer knows how many
+   keys count in it */
+struct Filter
+{
+   /* uBlocks is how many blocks of counters there are */
+   size_t uBlocks;
+   /* pucCounts points to the first block, which starts on a cache
+      line */
+   unsigned char *pucCounts;
+};
+
+/* Clock holds the capacity of a bounded SymTable and what it needs to
+   choose a binding to evict in constant time. It approximates least
+   recently used with the CLOCK algorithm: every binding has a slot
+   with a flag, set whenever the binding is put or found, and a hand
+   sweeps the slots, clearing every flag it passes, and evicts the
+   binding of the first slot whose flag was already clear. A slot
+   keeps the hash code of its binding, which leads to its Bucket, and
+   the binding keeps the index of its slot, in puSlots if it is inline
+   and in its Node otherwise */
+struct Clock
+{
+   /* uCapacity is the most bindings the SymTable may hold */
+   size_t uCapacity;
+   /* uSlots is how many slots there are, which grows up to uCapacity
+      as bindings are put */
+   size_t uSlots;
+   /* puHashes has the hash code of the binding of each slot. A slot
+      with no binding holds the index of the next such slot instead,
+      the first being uFree and the last followed by NO_SLOT */
+   size_t *puHashes;
+   size_t uFree;
+   /* pucUsed has the flag of each slot */
+   unsigned char *pucUsed;
+   /* puSlots has the index of the slot of the inline binding of each
+      Bucket of psArray */
+   size_t *puSlots;
+   /* uHand is the index of the slot the hand is at */
+   size_t uHand;
+   /* pfEvict is called with every evicted binding and pvExtra, unless
+      it is NULL */
+   void (*pfEvict)(const char *pcKey, void *pvValue, void *pvExtra);
+   const void *pvExtra;
+};
+
+/* Arena is a block of memory that holds many Nodes or keys at once.
+   They are never freed one at a time, only with the whole Arena when
+   the SymTable is freed. A key in an Arena tells so by its reference
+   count, see KEY_ARENA, and the Nodes in Arenas are the one block
+   psNodes of the SymTable */
+struct Arena
+{
+   /* pcStart points to the memory of the Arena */
+   char *pcStart;
+   /* psNext points to the next Arena of the SymTable */
+   struct Arena *psNext;
 };
 
 /* SymTable is a hashtable with dimension maxbucket (size of the
@@ -64,11 +297,668 @@ struct SymTable {
       auBucketCounts that stores what is the maxbucket size and
       the next maxbucket sizes */
     size_t bucketnum;
-    /* psArray stores an array of LinkedList_T that represent the
-      hashtable */
-    LinkedList_T* psArray;
+    /* psArray stores the array of maxbucket Buckets that represent
+      the hashtable */
+    struct Bucket* psArray;
+    /* iKeyed is 1 if the SymTable hashes with SymTable_sipHash and
+      the random seed auSeed, and 0 if it uses the hash function from
+      the assignment specification */
+    int iKeyed;
+    uint64_t auSeed[2];
+    /* uFlags stores the SYMTABLE_ flags the SymTable was made with */
+    unsigned int uFlags;
+    /* iNode is the NUMA node psArray is placed on, or -1 */
+    int iNode;
+    /* psArenas stores the Arenas that hold Nodes or keys of the
+      SymTable, or is NULL if every Node and key was malloc'd alone */
+    struct Arena *psArenas;
+    /* psNodes points to the uNodes Nodes SymTable_build made in one
+      of the Arenas, or is NULL */
+    struct Node *psNodes;
+    size_t uNodes;
+    /* puArenaRefs points to how many SymTables share psArenas once a
+      snapshot has been taken, and is NULL before that */
+    size_t *puArenaRefs;
+    /* iReadOnly is 1 if the SymTable is a snapshot, otherwise 0 */
+    int iReadOnly;
+    /* uValueSize is the size of the values a SymTable made by
+      SymTable_newSized keeps with its keys, or 0 if it keeps
+      pointers */
+    size_t uValueSize;
+    /* psFilter is the Filter of the keys of the SymTable, or NULL if
+      it has none */
+    struct Filter *psFilter;
+    /* psClock is the eviction state of a bounded SymTable, or NULL if
+      it has no capacity */
+    struct Clock *psClock;
+    /* psDead points to the Nodes removed but not freed yet, linked
+      through psNext, and pcDeadKeys to the keys removed from Buckets
+      but not freed yet, linked through their reference counts. uDead
+      is how many there are of both */
+    struct Node *psDead;
+    char *pcDeadKeys;
+    size_t uDead;
+    /* oYoung holds the changes made while a Resize copies psArray,
+      which stays as it was until then, or is NULL. A key removed from
+      psArray meanwhile is bound to &cTombstone in oYoung, and
+      uBaseLength is the number of bindings in psArray itself */
+    SymTable_T oYoung;
+    size_t uBaseLength;
+    /* psResize is the Resize copying psArray, or the last one if its
+      thread may still be freeing the old psArray, or NULL */
+    struct Resize *psResize;
+#ifdef SYMTABLE_STATS
+    /* sStats stores the operation counters of the SymTable */
+    struct SymTableStats sStats;
+#endif
+};
+
+
+/* SymTable_holdsNode takes in a oSymTable and a psNode of it, and
+   returns 1 if psNode is one of the block psNodes, which is only
+   freed with the Arenas, otherwise 0. */
+static int SymTable_holdsNode(SymTable_T oSymTable,
+   const struct Node *psNode) {
+   return oSymTable->psNodes != NULL && psNode >= oSymTable->psNodes &&
+      psNode < oSymTable->psNodes + oSymTable->uNodes;
+}
+
+/* Align is a union of the types that need the most alignment, so that
+   a value of any type may start at a multiple of its size */
+union Align
+{
+   long double ld;
+   long long ll;
+   void *pv;
+   void (*pf)(void);
+};
+
+/* Key_refs takes in a pcKey made by Key_new or Key_init and returns
+   its reference count, which is kept just before the string. */
+static size_t *Key_refs(char *pcKey) {
+   return (size_t *)(void *)pcKey - 1;
+}
+
+/* Key_size takes in the length uLen of a key including its '\0' and
+   returns the bytes it takes with its reference count, rounded up so
+   that keys laid out one after another stay aligned. */
+static size_t Key_size(size_t uLen) {
+   return sizeof(size_t) +
+      (uLen + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t);
+}
+
+/* Key_init takes in Key_size(uLen) bytes of memory pcBlock, aligned
+   for a size_t, and a pcKey of length uLen including its '\0', which
+   need not be there, and copies pcKey into pcBlock with a reference
+   count of 1. Returns the copy. */
+static char *Key_init(char *pcBlock, const char *pcKey, size_t uLen) {
+   char *pcCopy = pcBlock + sizeof(size_t);
+   *Key_refs(pcCopy) = 1;
+   memcpy(pcCopy, pcKey, uLen - 1);
+   pcCopy[uLen - 1] = '\0';
+   return pcCopy;
+}
+
+/* Key_valueOffset takes in the length uLen of a key including its
+   '\0' and returns where a value stored with the key starts, from the
+   start of the key's memory. */
+static size_t Key_valueOffset(size_t uLen) {
+   return (sizeof(size_t) + uLen + sizeof(union Align) - 1) /
+      sizeof(union Align) * sizeof(union Align);
+}
+
+/* Cache is the memory a thread freed from SYMTABLE_THREAD_CACHE
+   SymTables, kept for it to use again. Nodes are linked through
+   psNext, and the memory of keys through its first bytes, by the
+   size of the key it can hold. Anything in a Cache was malloc'd and
+   may still be freed as usual */
+struct Cache
+{
+   struct Node *psNodes;
+   size_t uNodes;
+   void *apvKeys[KEY_CLASSES];
+   size_t auKeys[KEY_CLASSES];
 };
 
+#ifdef SYMTABLE_THREADS
+/* sCacheKey holds the Cache of each thread, once sCacheOnce has made
+   it, if iCacheKey is 1 */
+static pthread_key_t sCacheKey;
+static pthread_once_t sCacheOnce = PTHREAD_ONCE_INIT;
+static int iCacheKey = 0;
+
+/* Cache_free takes in the Cache pvCache of a thread that is exiting
+   and frees it with everything in it. */
+static void Cache_free(void *pvCache) {
+   struct Cache *psCache = (struct Cache *)pvCache;
+   struct Node *psNode;
+   void *pvKey;
+   size_t c;
+   while (psCache->psNodes != NULL) {
+      psNode = psCache->psNodes;
+      psCache->psNodes = psNode->psNext;
+      free(psNode);
+   }
+   for (c = 0; c < KEY_CLASSES; c++) {
+      while (psCache->apvKeys[c] != NULL) {
+         pvKey = psCache->apvKeys[c];
+         psCache->apvKeys[c] = *(void **)pvKey;
+         free(pvKey);
+      }
+   }
+   free(psCache);
+}
+
+/* Cache_makeKey makes sCacheKey, once for the whole program. */
+static void Cache_makeKey(void) {
+   iCacheKey = pthread_key_create(&sCacheKey, Cache_free) == 0;
+}
+#endif
+
+/* Cache_get takes in the flags uFlags of a SymTable, and returns the
+   Cache of the calling thread, made the first time it is asked for,
+   if uFlags has SYMTABLE_THREAD_CACHE. Returns NULL if it does not,
+   or if there is no Cache to be had. */
+static struct Cache *Cache_get(unsigned int uFlags) {
+#ifdef SYMTABLE_THREADS
+   struct Cache *psCache;
+   if (! (uFlags & SYMTABLE_THREAD_CACHE) ||
+      pthread_once(&sCacheOnce, Cache_makeKey) != 0 || ! iCacheKey) {
+      return NULL;
+   }
+   psCache = (struct Cache *) pthread_getspecific(sCacheKey);
+   if (psCache == NULL) {
+      psCache = (struct Cache *) calloc(1, sizeof(struct Cache));
+      if (psCache != NULL && pthread_setspecific(sCacheKey, psCache) != 0) {
+         free(psCache);
+         psCache = NULL;
+      }
+   }
+   return psCache;
+#else
+   (void)uFlags;
+   return NULL;
+#endif
+}
+
+/* Node_new takes in the flags uFlags of a SymTable and returns the
+   memory for a new Node, from the Cache of the calling thread if it
+   has one, or NULL if there is no memory. */
+static struct Node *Node_new(unsigned int uFlags) {
+   struct Cache *psCache = Cache_get(uFlags);
+   struct Node *psNode;
+   if (psCache == NULL || psCache->psNodes == NULL) {
+      return (struct Node *) malloc(sizeof(struct Node));
+   }
+   psNode = psCache->psNodes;
+   psCache->psNodes = psNode->psNext;
+   psCache->uNodes -= 1;
+   return psNode;
+}
+
+/* Node_free takes in the flags uFlags of a SymTable and a malloc'd
+   psNode, and gives psNode to the Cache of the calling thread if it
+   has one with room, or frees it. */
+static void Node_free(unsigned int uFlags, struct Node *psNode) {
+   struct Cache *psCache = Cache_get(uFlags);
+   if (psCache == NULL || psCache->uNodes == CACHE_NODES) {
+      free(psNode);
+      return;
+   }
+   psNode->psNext = psCache->psNodes;
+   psCache->psNodes = psNode;
+   psCache->uNodes += 1;
+}
+
+/* Key_alloc takes in the flags uFlags of a SymTable and the length
+   uLen of a key including its '\0', and returns Key_size(uLen) bytes
+   of memory for it, from the Cache of the calling thread if it has
+   some, or NULL if there is no memory. */
+static char *Key_alloc(unsigned int uFlags, size_t uLen) {
+   size_t uClass = (Key_size(uLen) - Key_size(1)) / sizeof(size_t);
+   struct Cache *psCache;
+   void *pvKey;
+   if (uClass < KEY_CLASSES) {
+      psCache = Cache_get(uFlags);
+      if (psCache != NULL && psCache->apvKeys[uClass] != NULL) {
+         pvKey = psCache->apvKeys[uClass];
+         psCache->apvKeys[uClass] = *(void **)pvKey;
+         psCache->auKeys[uClass] -= 1;
+         return (char *)pvKey;
+      }
+   }
+   return (char *) malloc(Key_size(uLen));
+}
+
+/* Key_free takes in the flags uFlags of a SymTable and a malloc'd
+   pcKey whose count of references is used up, and gives its memory
+   to the Cache of the calling thread if it has one with room, or
+   frees it. Memory that held a value after the key is kept with that
+   of keys of the same Key_size, which it is larger than. */
+static void Key_free(unsigned int uFlags, char *pcKey) {
+   size_t uClass = (Key_size(strlen(pcKey) + 1) - Key_size(1)) /
+      sizeof(size_t);
+   struct Cache *psCache;
+   void *pvKey = Key_refs(pcKey);
+   if (uClass < KEY_CLASSES) {
+      psCache = Cache_get(uFlags);
+      if (psCache != NULL && psCache->auKeys[uClass] < CACHE_KEYS) {
+         *(void **)pvKey = psCache->apvKeys[uClass];
+         psCache->apvKeys[uClass] = pvKey;
+         psCache->auKeys[uClass] += 1;
+         return;
+      }
+   }
+   free(pvKey);
+}
+
+/* Key_new takes in the flags uFlags of a SymTable, a pcKey of
+   uLength characters, a pointer ppvValue to its value and the value
+   size uValueSize of the SymTable, and returns a copy of pcKey
+   that a Bucket or Node can own, or NULL if there is no memory. If
+   uValueSize is not 0, uValueSize bytes of *ppvValue are copied in
+   with the key, and *ppvValue is set to point to the copy. If uFlags
+   has SYMTABLE_BORROW_KEYS, pcKey itself is returned. */
+static char *Key_new(unsigned int uFlags, const char *pcKey,
+   size_t uLength, const void **ppvValue, size_t uValueSize) {
+   size_t uLen = uLength + 1;
+   char *pcBlock;
+   char *pcCopy;
+   if (uFlags & SYMTABLE_BORROW_KEYS) {
+      assert(pcKey[uLength] == '\0');
+      return (char *)pcKey;
+   }
+   if (uValueSize == 0) {
+      pcBlock = Key_alloc(uFlags, uLen);
+   }
+   else {
+      pcBlock = (char *) malloc(Key_valueOffset(uLen) + uValueSize);
+   }
+   if (pcBlock == NULL) {
+      return NULL;
+   }
+   pcCopy = Key_init(pcBlock, pcKey, uLen);
+   if (uValueSize != 0) {
+      memcpy(pcBlock + Key_valueOffset(uLen), *ppvValue, uValueSize);
+      *ppvValue = pcBlock + Key_valueOffset(uLen);
+   }
+   return pcCopy;
+}
+
+/* Key_equals takes in a key pcStored and a pcKey of uLength
+   characters with no '\0' among them, and returns 1 if they are the
+   same key, otherwise 0. */
+static int Key_equals(const char *pcStored, const char *pcKey,
+   size_t uLength) {
+   return strncmp(pcStored, pcKey, uLength) == 0 &&
+      pcStored[uLength] == '\0';
+}
+
+/* Key_retain takes in the flags uFlags of a SymTable and a pcKey,
+   and adds one reference to pcKey, unless uFlags has
+   SYMTABLE_BORROW_KEYS. */
+static void Key_retain(unsigned int uFlags, char *pcKey) {
+   if (! (uFlags & SYMTABLE_BORROW_KEYS)) {
+      REF_INC(Key_refs(pcKey));
+   }
+}
+
+/* Key_release takes in the flags uFlags of a SymTable and a pcKey,
+   and drops one reference to pcKey, freeing it on the last, unless
+   uFlags has SYMTABLE_BORROW_KEYS. A key in an Arena never runs out
+   of references. */
+static void Key_release(unsigned int uFlags, char *pcKey) {
+   if (uFlags & SYMTABLE_BORROW_KEYS) {
+      return;
+   }
+   if (REF_DEC(Key_refs(pcKey)) == 0) {
+      Key_free(uFlags, pcKey);
+   }
+}
+
+/* SymTable_freeNode takes in a oSymTable and a psNode of it, and frees
+   psNode and drops its key, skipping whichever of them lives in one
+   of the Arenas. */
+static void SymTable_freeNode(SymTable_T oSymTable,
+   struct Node *psNode) {
+   Key_release(oSymTable->uFlags, psNode->pvKey);
+   if (! SymTable_holdsNode(oSymTable, psNode)) {
+      Node_free(oSymTable->uFlags, psNode);
+   }
+}
+
+/* Arena_new takes in a list of Arenas *ppsArenas and a size uSize,
+   and adds a new Arena of uSize bytes to the front of the list.
+   Returns the memory of the Arena, or NULL if there is no memory. */
+static void *Arena_new(struct Arena **ppsArenas, size_t uSize) {
+   struct Arena *psArena;
+   psArena = (struct Arena *) malloc(sizeof(struct Arena));
+   if (psArena == NULL) {
+      return NULL;
+   }
+   psArena->pcStart = (char *) malloc(uSize == 0 ? 1 : uSize);
+   if (psArena->pcStart == NULL) {
+      free(psArena);
+      return NULL;
+   }
+   psArena->psNext = *ppsArenas;
+   *ppsArenas = psArena;
+   return psArena->pcStart;
+}
+
+/* Arena_freeAll takes in a list of Arenas psArenas and frees all of
+   them along with their memory. */
+static void Arena_freeAll(struct Arena *psArenas) {
+   struct Arena *psNext;
+   for (; psArenas != NULL; psArenas = psNext) {
+      psNext = psArenas->psNext;
+      free(psArenas->pcStart);
+      free(psArenas);
+   }
+}
+
+/* Array_header takes in a psArray made by Array_new and returns the
+   ArrayHeader just before it. */
+static struct ArrayHeader *Array_header(struct Bucket *psArray) {
+   return (struct ArrayHeader *)(void *)psArray - 1;
+}
+
+#ifdef SYMTABLE_MMAP
+/* Array_bind takes in uBytes of mapped memory at pcBlock that nothing
+   has touched yet and a NUMA node iNode, and asks for its pages to be
+   placed on iNode while there is room there. A system or node that
+   cannot do so leaves them where they would have gone. */
+static void Array_bind(char *pcBlock, size_t uBytes, int iNode) {
+#ifdef SYS_mbind
+   unsigned long aulMask[MBIND_NODES / (sizeof(unsigned long) * CHAR_BIT)];
+   size_t uBits = sizeof(unsigned long) * CHAR_BIT;
+   if (iNode >= MBIND_NODES) {
+      return;
+   }
+   memset(aulMask, 0, sizeof(aulMask));
+   aulMask[(size_t)iNode / uBits] = 1ul << ((size_t)iNode % uBits);
+   /* the kernel reads one bit fewer than it is told, so it is told
+     one more */
+   (void)syscall(SYS_mbind, pcBlock, (unsigned long) uBytes,
+      MBIND_PREFERRED, aulMask, (unsigned long) MBIND_NODES + 1, 0ul);
+#else
+   (void)pcBlock;
+   (void)uBytes;
+   (void)iNode;
+#endif
+}
+
+/* Array_map takes in a size uBytes and uFlags and iNode as for
+   Array_new, and maps at least uBytes of zeroed memory: in huge pages
+   if uFlags has SYMTABLE_HUGE_PAGES, from those the system keeps
+   aside if it has some and otherwise from transparent huge pages,
+   and on NUMA node iNode unless it is -1. It stores how many bytes
+   it mapped in *puMapped. Returns the memory, or NULL if it could
+   not be mapped. */
+static char *Array_map(size_t uBytes, unsigned int uFlags, int iNode,
+   size_t *puMapped) {
+   void *pvBlock = MAP_FAILED;
+   char *pcBlock;
+   size_t uPage = (size_t) sysconf(_SC_PAGESIZE);
+   size_t uSkip;
+   if (uFlags & SYMTABLE_HUGE_PAGES) {
+      uBytes = (uBytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+#ifdef MAP_HUGETLB
+      pvBlock = mmap(NULL, uBytes, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+      if (pvBlock == MAP_FAILED) {
+         /* transparent huge pages need the memory aligned to one, so
+           map one more and unmap what sticks out on either side */
+         pvBlock = mmap(NULL, uBytes + HUGE_PAGE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+         if (pvBlock == MAP_FAILED) {
+            return NULL;
+         }
+         pcBlock = (char *) pvBlock;
+         uSkip = (HUGE_PAGE - (uintptr_t)pcBlock % HUGE_PAGE) % HUGE_PAGE;
+         if (uSkip != 0) {
+            munmap(pcBlock, uSkip);
+         }
+         munmap(pcBlock + uSkip + uBytes, HUGE_PAGE - uSkip);
+         pvBlock = pcBlock + uSkip;
+#ifdef MADV_HUGEPAGE
+         (void)madvise(pvBlock, uBytes, MADV_HUGEPAGE);
+#endif
+      }
+   }
+   else {
+      uBytes = (uBytes + uPage - 1) / uPage * uPage;
+      pvBlock = mmap(NULL, uBytes, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (pvBlock == MAP_FAILED) {
+         return NULL;
+      }
+   }
+   if (iNode >= 0) {
+      Array_bind((char *) pvBlock, uBytes, iNode);
+   }
+   *puMapped = uBytes;
+   return (char *) pvBlock;
+}
+#endif
+
+/* Array_new takes in a length uLen, the uFlags of a SymTable and the
+   NUMA node iNode it is placed on, or -1, and returns a new psArray
+   of uLen empty Buckets starting on a cache line, shared by one
+   SymTable, or NULL if there is no memory. The psArray is mapped by
+   Array_map if it is to go on iNode, or if it is large enough for
+   SYMTABLE_HUGE_PAGES, and malloc'd otherwise or if that fails. */
+static struct Bucket *Array_new(size_t uLen, unsigned int uFlags,
+   int iNode) {
+   char *pcBlock = NULL;
+   char *pcArray;
+   struct Bucket *psArray;
+   size_t uBytes = sizeof(struct ArrayHeader) + CACHE_LINE +
+      uLen * sizeof(struct Bucket);
+   size_t uMapped = 0;
+#ifdef SYMTABLE_MMAP
+   if (iNode >= 0 ||
+      ((uFlags & SYMTABLE_HUGE_PAGES) && uBytes >= HUGE_PAGE / 4)) {
+      pcBlock = Array_map(uBytes, uFlags, iNode, &uMapped);
+   }
+#else
+   (void)uFlags;
+   (void)iNode;
+#endif
+   if (pcBlock == NULL) {
+      uMapped = 0;
+      pcBlock = (char *) malloc(uBytes);
+   }
+   if (pcBlock == NULL) {
+      return NULL;
+   }
+   pcArray = pcBlock + sizeof(struct ArrayHeader);
+   pcArray += (CACHE_LINE - (uintptr_t)pcArray % CACHE_LINE) % CACHE_LINE;
+   psArray = (struct Bucket *)(void *)pcArray;
+   /* this also faults in the pages of a mapped psArray, which places
+     them */
+   memset(psArray, 0, uLen * sizeof(struct Bucket));
+   Array_header(psArray)->pvBlock = pcBlock;
+   Array_header(psArray)->uRefs = 1;
+   Array_header(psArray)->uMapped = uMapped;
+   return psArray;
+}
+
+/* Array_free takes in a psArray made by Array_new and frees it. */
+static void Array_free(struct Bucket *psArray) {
+   struct ArrayHeader *psHeader = Array_header(psArray);
+#ifdef SYMTABLE_MMAP
+   if (psHeader->uMapped != 0) {
+      munmap(psHeader->pvBlock, psHeader->uMapped);
+      return;
+   }
+#endif
+   free(psHeader->pvBlock);
+}
+
+/* Filter_new takes in a number of bindings uBindings and returns a new
+   empty Filter sized for them, or NULL if there is no memory. */
+static struct Filter *Filter_new(size_t uBindings) {
+   struct Filter *psFilter;
+   char *pcCounts;
+   size_t uBlocks = uBindings / FILTER_LOAD + 1;
+   psFilter = (struct Filter *) malloc(sizeof(struct Filter) + CACHE_LINE +
+      uBlocks * CACHE_LINE);
+   if (psFilter == NULL) {
+      return NULL;
+   }
+   pcCounts = (char *)(psFilter + 1);
+   pcCounts += (CACHE_LINE - (uintptr_t)pcCounts % CACHE_LINE) % CACHE_LINE;
+   psFilter->uBlocks = uBlocks;
+   psFilter->pucCounts = (unsigned char *)pcCounts;
+   memset(psFilter->pucCounts, 0, uBlocks * CACHE_LINE);
+   return psFilter;
+}
+
+/* Filter_block takes in a psFilter and a hash code uHash, and returns
+   the block of counters of uHash. *puBits is set to the bits that
+   choose the counters in the block. The bits are mixed from uHash
+   first, as the bucket of uHash has already used its low bits. */
+static unsigned char *Filter_block(const struct Filter *psFilter,
+   size_t uHash, uint64_t *puBits) {
+   uint64_t uMix = (uint64_t)uHash;
+   uMix ^= uMix >> 30;
+   uMix *= UINT64_C(0xbf58476d1ce4e5b9);
+   uMix ^= uMix >> 27;
+   uMix *= UINT64_C(0x94d049bb133111eb);
+   uMix ^= uMix >> 31;
+   *puBits = uMix;
+   return psFilter->pucCounts +
+      (size_t)((uMix >> 32) % psFilter->uBlocks) * CACHE_LINE;
+}
+
+/* Filter_add takes in a psFilter and a hash code uHash, and counts
+   one more key with uHash. */
+static void Filter_add(struct Filter *psFilter, size_t uHash) {
+   uint64_t uBits;
+   unsigned char *pucBlock = Filter_block(psFilter, uHash, &uBits);
+   int i;
+   for (i = 0; i < FILTER_HASHES; i++, uBits /= CACHE_LINE) {
+      if (pucBlock[uBits % CACHE_LINE] != UCHAR_MAX) {
+         pucBlock[uBits % CACHE_LINE]++;
+      }
+   }
+}
+
+/* Filter_drop takes in a psFilter and a hash code uHash, and counts
+   one less key with uHash. */
+static void Filter_drop(struct Filter *psFilter, size_t uHash) {
+   uint64_t uBits;
+   unsigned char *pucBlock = Filter_block(psFilter, uHash, &uBits);
+   int i;
+   for (i = 0; i < FILTER_HASHES; i++, uBits /= CACHE_LINE) {
+      if (pucBlock[uBits % CACHE_LINE] != UCHAR_MAX) {
+         pucBlock[uBits % CACHE_LINE]--;
+      }
+   }
+}
+
+/* Filter_mayContain takes in a psFilter and a hash code uHash, and
+   returns 0 if no key with uHash is counted in psFilter, otherwise
+   1. */
+static int Filter_mayContain(const struct Filter *psFilter, size_t uHash) {
+   uint64_t uBits;
+   const unsigned char *pucBlock = Filter_block(psFilter, uHash, &uBits);
+   int i;
+   for (i = 0; i < FILTER_HASHES; i++, uBits /= CACHE_LINE) {
+      if (pucBlock[uBits % CACHE_LINE] == 0) {
+         return 0;
+      }
+   }
+   return 1;
+}
+
+/* Clock_new takes in a capacity uCapacity and a number of Buckets
+   uBuckets, and returns a new Clock with no slots yet, or NULL if
+   there is no memory. */
+static struct Clock *Clock_new(size_t uCapacity, size_t uBuckets) {
+   struct Clock *psClock;
+   psClock = (struct Clock*) malloc(sizeof(struct Clock));
+   if (psClock == NULL) {
+      return NULL;
+   }
+   psClock->puSlots = (size_t*) malloc(uBuckets * sizeof(size_t));
+   if (psClock->puSlots == NULL) {
+      free(psClock);
+      return NULL;
+   }
+   psClock->uCapacity = uCapacity;
+   psClock->uSlots = 0;
+   psClock->puHashes = NULL;
+   psClock->uFree = NO_SLOT;
+   psClock->pucUsed = NULL;
+   psClock->uHand = 0;
+   return psClock;
+}
+
+/* Clock_free takes in a psClock and frees it */
+static void Clock_free(struct Clock *psClock) {
+   free(psClock->puHashes);
+   free(psClock->pucUsed);
+   free(psClock->puSlots);
+   free(psClock);
+}
+
+/* Clock_reserve takes in a psClock with fewer bindings than its
+   capacity and makes sure it has a free slot, adding slots if need
+   be. Returns 1 if successful, or 0 if there is no memory. */
+static int Clock_reserve(struct Clock *psClock) {
+   size_t *puHashes;
+   unsigned char *pucUsed;
+   size_t uSlots;
+   size_t i;
+   if (psClock->uFree != NO_SLOT) {
+      return 1;
+   }
+   assert(psClock->uSlots < psClock->uCapacity);
+   uSlots = psClock->uCapacity;
+   if (psClock->uSlots < (uSlots - 1) / 2) {
+      uSlots = 2 * psClock->uSlots + 1;
+   }
+   puHashes = (size_t*) realloc(psClock->puHashes,
+      uSlots * sizeof(size_t));
+   if (puHashes == NULL) {
+      return 0;
+   }
+   psClock->puHashes = puHashes;
+   pucUsed = (unsigned char*) realloc(psClock->pucUsed, uSlots);
+   if (pucUsed == NULL) {
+      return 0;
+   }
+   psClock->pucUsed = pucUsed;
+   for (i = psClock->uSlots; i < uSlots - 1; i++) {
+      puHashes[i] = i + 1;
+   }
+   puHashes[uSlots - 1] = NO_SLOT;
+   psClock->uFree = psClock->uSlots;
+   psClock->uSlots = uSlots;
+   return 1;
+}
+
+/* Clock_take takes in a psClock with a free slot and the hash code
+   uHash of a new binding, and returns the index of the slot the
+   binding gets, marked as used. */
+static size_t Clock_take(struct Clock *psClock, size_t uHash) {
+   size_t uSlot = psClock->uFree;
+   assert(uSlot != NO_SLOT);
+   psClock->uFree = psClock->puHashes[uSlot];
+   psClock->puHashes[uSlot] = uHash;
+   psClock->pucUsed[uSlot] = 1;
+   return uSlot;
+}
+
+/* Clock_drop takes in a psClock and the index uSlot of the slot of a
+   binding that leaves, and frees the slot. */
+static void Clock_drop(struct Clock *psClock, size_t uSlot) {
+   psClock->puHashes[uSlot] = psClock->uFree;
+   psClock->uFree = uSlot;
+}
 
 /* LinkedList_new returns a new LinkedList_T */
 static LinkedList_T LinkedList_new(void) {
@@ -77,8 +967,10 @@ static LinkedList_T LinkedList_new(void) {
    if (oLinkedList == NULL) {
       return NULL;
    }
+   memset(oLinkedList->aucTags, TAG_EMPTY, GROUP_WIDTH);
    oLinkedList->psFirst = NULL;
    oLinkedList->length = 0;
+   oLinkedList->uRefs = 1;
    return oLinkedList;
 }
 
@@ -88,130 +980,255 @@ static size_t LinkedList_getLength(LinkedList_T oLinkedList) {
    return oLinkedList->length;
 }
 
-/* LinkedList_put gets a oLinkedList, pcKey, and pvItem. Tries to
-   put the binding into the linkedlist. Returns 1 if successful, 
-   otherwise return 0. */
-static int LinkedList_put(LinkedList_T oLinkedList, const char *pcKey, 
-   const void* pvValue) {
-   struct Node *NewNode;
-   char* copyKey;
+/* LinkedList_tag gets a hash code uHash and returns its 7-bit tag.
+   The bucket index is uHash modulo a prime, so the tag folds in
+   the upper bits of uHash to stay independent of it. */
+static unsigned char LinkedList_tag(size_t uHash) {
+   return (unsigned char)((uHash ^ (uHash >> 7) ^ (uHash >> 29)) & 0x7F);
+}
+
+/* LinkedList_match gets a oLinkedList and a tag ucTag, and returns a
+   mask with bit i set if lane i of the control group holds ucTag.
+   The whole group is checked with one SSE2 or NEON compare when the
+   compiler targets them, and with a plain loop otherwise. */
+static unsigned int LinkedList_match(LinkedList_T oLinkedList,
+   unsigned char ucTag) {
+#if defined(__SSE2__)
+   __m128i group;
+   __m128i equal;
+   group = _mm_loadu_si128((const __m128i *)(const void *)
+      oLinkedList->aucTags);
+   equal = _mm_cmpeq_epi8(group, _mm_set1_epi8((char)ucTag));
+   return (unsigned int)_mm_movemask_epi8(equal);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+   static const uint8_t aucLaneBits[GROUP_WIDTH] = {1, 2, 4, 8, 16,
+      32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+   uint8x16_t equal;
+   equal = vceqq_u8(vld1q_u8(oLinkedList->aucTags), vdupq_n_u8(ucTag));
+   equal = vandq_u8(equal, vld1q_u8(aucLaneBits));
+   return (unsigned int)vaddv_u8(vget_low_u8(equal)) |
+      ((unsigned int)vaddv_u8(vget_high_u8(equal)) << 8);
+#else
+   unsigned int uMask = 0;
+   size_t i;
+   for (i = 0; i < GROUP_WIDTH; i++) {
+      if (oLinkedList->aucTags[i] == ucTag) {
+         uMask |= 1u << i;
+      }
+   }
+   return uMask;
+#endif
+}
+
+/* LinkedList_search gets a oLinkedList, pcKey of uLength characters
+   and its hash code uHash, and returns the node that holds pcKey, or
+   NULL if there is none. It also stores the node before it in
+   *ppsPrev (NULL if it is the first node) and its position in
+   *puIndex. Only nodes whose tag matches are compared with
+   Key_equals, and a miss in a linkedlist no longer than the control
+   group returns without touching any node. */
+static struct Node *LinkedList_search(LinkedList_T oLinkedList,
+   const char *pcKey, size_t uLength, size_t uHash, struct Node **ppsPrev,
+   size_t *puIndex STATS_PARAM) {
+   struct Node *psPrev = NULL;
    struct Node *psCurr;
+   unsigned int uMask;
+   size_t i;
    assert(oLinkedList != NULL);
    assert(pcKey != NULL);
+   uMask = LinkedList_match(oLinkedList, LinkedList_tag(uHash));
+   if (uMask == 0 && oLinkedList->length <= GROUP_WIDTH) {
+      STAT_ADD(psStats, uMisses, 1);
+      return NULL;
+   }
    psCurr = oLinkedList->psFirst;
-   while(psCurr != NULL && strcmp(psCurr->pvKey, pcKey) != 0){
+   for (i = 0; psCurr != NULL; i++) {
+      STAT_ADD(psStats, uProbes, 1);
+      if ((i >= GROUP_WIDTH || (uMask & (1u << i)) != 0) &&
+         psCurr->uHash == uHash) {
+         STAT_ADD(psStats, uCompares, 1);
+         if (Key_equals(psCurr->pvKey, pcKey, uLength)) {
+            STAT_ADD(psStats, uHits, 1);
+            *ppsPrev = psPrev;
+            *puIndex = i;
+            return psCurr;
+         }
+      }
+      /* no lane after this one matches the tag */
+      if (i < GROUP_WIDTH && (uMask >> (i + 1)) == 0 &&
+         oLinkedList->length <= GROUP_WIDTH) {
+         break;
+      }
+      psPrev = psCurr;
       psCurr = psCurr->psNext;
    }
-   if (psCurr != NULL) {
-      return 0;
+   STAT_ADD(psStats, uMisses, 1);
+   return NULL;
+}
+
+/* LinkedList_find gets a oLinkedList, pcKey of uLength characters,
+   its hash code uHash and the flags uFlags of the SymTable, and
+   returns the node that holds pcKey, or NULL if there is none, and
+   stores the position it was found at in *puIndex. With
+   SYMTABLE_MOVE_TO_FRONT the node found becomes the first node, and
+   with SYMTABLE_TRANSPOSE it trades places with the node before it,
+   so that hot keys drift to the front of the linkedlist. */
+static struct Node *LinkedList_find(LinkedList_T oLinkedList,
+   const char *pcKey, size_t uLength, size_t uHash,
+   unsigned int uFlags, size_t *puIndex STATS_PARAM) {
+   struct Node *psCurr;
+   struct Node *psPrev;
+   struct Node sSwap;
+   size_t i;
+   psCurr = LinkedList_search(oLinkedList, pcKey, uLength, uHash, &psPrev,
+      &i STATS_PASS);
+   if (psCurr == NULL) {
+      return NULL;
    }
-   NewNode =(struct Node*)malloc(sizeof(struct Node));
-   if (NewNode == NULL) {
-      return 0;
+   *puIndex = i;
+   if (psPrev == NULL) {
+      return psCurr;
    }
-   NewNode->pvItem = pvValue;
-   copyKey = malloc(strlen(pcKey) + 1);
-   strcpy(copyKey, pcKey);
-   NewNode->pvKey = copyKey;
-   NewNode->psNext = oLinkedList->psFirst;
-   oLinkedList->psFirst = NewNode;
+   if (uFlags & SYMTABLE_MOVE_TO_FRONT) {
+      psPrev->psNext = psCurr->psNext;
+      psCurr->psNext = oLinkedList->psFirst;
+      oLinkedList->psFirst = psCurr;
+      if (i > GROUP_WIDTH - 1) {
+         i = GROUP_WIDTH - 1;
+      }
+      memmove(&oLinkedList->aucTags[1], &oLinkedList->aucTags[0], i);
+      oLinkedList->aucTags[0] = LinkedList_tag(psCurr->uHash);
+   }
+   else if (uFlags & SYMTABLE_TRANSPOSE) {
+      /* swap the bindings rather than the nodes, so that no link
+         before psPrev has to change */
+      sSwap = *psPrev;
+      psPrev->pvItem = psCurr->pvItem;
+      psPrev->pvKey = psCurr->pvKey;
+      psPrev->uHash = psCurr->uHash;
+      psPrev->uSlot = psCurr->uSlot;
+      psCurr->pvItem = sSwap.pvItem;
+      psCurr->pvKey = sSwap.pvKey;
+      psCurr->uHash = sSwap.uHash;
+      psCurr->uSlot = sSwap.uSlot;
+      if (i <= GROUP_WIDTH) {
+         oLinkedList->aucTags[i - 1] = LinkedList_tag(psPrev->uHash);
+      }
+      if (i < GROUP_WIDTH) {
+         oLinkedList->aucTags[i] = LinkedList_tag(psCurr->uHash);
+      }
+      psCurr = psPrev;
+   }
+   return psCurr;
+}
+
+/* LinkedList_claim gets a oLinkedList and the hash code uHash of a
+   node about to become its first, and counts the node and shifts the
+   control group one lane to make room for its tag, without linking
+   it yet. */
+static void LinkedList_claim(LinkedList_T oLinkedList, size_t uHash) {
+   memmove(&oLinkedList->aucTags[1], &oLinkedList->aucTags[0],
+      GROUP_WIDTH - 1);
+   oLinkedList->aucTags[0] = LinkedList_tag(uHash);
    oLinkedList->length += 1;
-   return 1;
 }
 
-/* LinkedList_contains gets a oLinkedList and pcKey, and returns 1 if the
-   key binding exist. Otherwise returns 0. */
-static int LinkedList_contains(LinkedList_T oLinkedList, const char *pcKey) {
-   struct Node *psCurr;
-   assert( oLinkedList != NULL);
+/* LinkedList_link gets a oLinkedList and a psNode, and makes psNode
+   the first node of the linkedlist. The control group is shifted
+   one lane to make room for the tag of psNode. */
+static void LinkedList_link(LinkedList_T oLinkedList,
+   struct Node *psNode) {
+   assert(oLinkedList != NULL);
+   assert(psNode != NULL);
+   LinkedList_claim(oLinkedList, psNode->uHash);
+   psNode->psNext = oLinkedList->psFirst;
+   oLinkedList->psFirst = psNode;
+}
+
+/* LinkedList_put gets a oLinkedList, pcKey of uLength characters,
+   its hash code uHash, pvItem and the value size uValueSize and flags
+   uFlags of the SymTable, where pcKey is not in the linkedlist yet.
+   Tries to put the binding into the linkedlist. Returns 1 if
+   successful, otherwise return 0. */
+static int LinkedList_put(LinkedList_T oLinkedList, const char *pcKey, 
+   size_t uLength, size_t uHash, const void* pvValue,
+   size_t uValueSize, unsigned int uFlags STATS_PARAM) {
+   struct Node *NewNode;
+   char* copyKey;
+   assert(oLinkedList != NULL);
    assert(pcKey != NULL);
-   psCurr = oLinkedList->psFirst;
-   while(psCurr != NULL && strcmp(psCurr->pvKey, pcKey) != 0){
-      psCurr = psCurr->psNext;
+   NewNode = Node_new(uFlags);
+   if (NewNode == NULL) {
+      return 0;
    }
-   if (psCurr == NULL) {
+   copyKey = Key_new(uFlags, pcKey, uLength, &pvValue, uValueSize);
+   if (copyKey == NULL) {
+      Node_free(uFlags, NewNode);
       return 0;
    }
+   STAT_ADD(psStats, uAllocations, copyKey == pcKey ? 1 : 2);
+   NewNode->pvItem = pvValue;
+   NewNode->pvKey = copyKey;
+   NewNode->uHash = uHash;
+   LinkedList_link(oLinkedList, NewNode);
    return 1;
 }
 
-/* LinkedList_gets gets a oLinkedList and pcKey, and returns the value 
-   if the key binding exist. Otherwise returns NULL. */
-static void* LinkedList_get(LinkedList_T oLinkedList, const char *pcKey) {
+/* LinkedList_unlink takes in a oLinkedList, a removalNode in it, the
+    node psPrev before it (NULL if it is the first node) and its
+    position i, and takes removalNode out of the oLinkedList without
+    freeing it. */
+static void LinkedList_unlink(LinkedList_T oLinkedList,
+   struct Node *removalNode, struct Node *psPrev, size_t i) {
    struct Node *psCurr;
-   assert( oLinkedList != NULL);
-   assert(pcKey != NULL);
-   psCurr = oLinkedList->psFirst;
-   while(psCurr != NULL && strcmp(psCurr->pvKey, pcKey) != 0){
-      psCurr = psCurr->psNext;
-   }
-   if (psCurr == NULL) {
-      return NULL;
+   if (psPrev == NULL) {
+      oLinkedList->psFirst = removalNode->psNext;
    }
-   return (void*) psCurr->pvItem;
-}
-
-/* LinkedList_replace gets a oLinkedList, pcKey and pvValue, and returns 
-   the replaces the oldValue related with the key with the new value. It
-   returns the oldValue if successful, otherwise return NULL. */
-static void* LinkedList_replace(LinkedList_T oLinkedList, const char *pcKey, 
-   const void *pvValue) {
-   const void *outItem;
-   struct Node *psCurr;
-   assert( oLinkedList != NULL);
-   assert(pcKey != NULL);
-   psCurr = oLinkedList->psFirst;
-   while(psCurr != NULL && strcmp(psCurr->pvKey, pcKey) != 0){
-      psCurr = psCurr->psNext;
+   else {
+      psPrev->psNext = removalNode->psNext;
    }
-   if (psCurr == NULL) {
-      return NULL;
+   psCurr = removalNode->psNext;
+   oLinkedList->length -= 1;
+   /* close the gap in the control group and refill its last lane
+      with the node that moved into the group, if any */
+   if (i < GROUP_WIDTH) {
+      memmove(&oLinkedList->aucTags[i], &oLinkedList->aucTags[i + 1],
+         GROUP_WIDTH - 1 - i);
+      oLinkedList->aucTags[GROUP_WIDTH - 1] = TAG_EMPTY;
+      for (; psCurr != NULL && i < GROUP_WIDTH - 1; i++) {
+         psCurr = psCurr->psNext;
+      }
+      if (psCurr != NULL) {
+         oLinkedList->aucTags[GROUP_WIDTH - 1] =
+            LinkedList_tag(psCurr->uHash);
+      }
    }
-   outItem = (void*) psCurr->pvItem;
-   psCurr->pvItem = pvValue;
-   return (void*) outItem;
 }
 
-/* LinkedList_remove takes in a oLinkedList and a string pcKey. If the
-    string key is in the oLinkedList, remove the binding from the
-    oLinkedList and return the value. Otherwise return NULL. */
-static void *LinkedList_remove(LinkedList_T oLinkedList, const char *pcKey) {
+/* LinkedList_remove takes in a oLinkedList, a pcKey of uLength
+    characters and its hash code uHash. If the string key is in the
+    oLinkedList, takes its node out of the oLinkedList and returns it,
+    for the caller to free. Otherwise return NULL. */
+static struct Node *LinkedList_remove(LinkedList_T oLinkedList,
+   const char *pcKey, size_t uLength, size_t uHash STATS_PARAM) {
    struct Node*removalNode;
-   const void* outItem;
-   struct Node *psCurr;
+   struct Node *psPrev;
+   size_t i;
    assert( oLinkedList != NULL);
    assert(pcKey != NULL);
-   psCurr = oLinkedList->psFirst;
-   if (psCurr == NULL) {
-      return NULL;
-   } 
-   if (strcmp(psCurr->pvKey, pcKey) == 0) {
-      outItem = (void*) psCurr->pvItem;
-      removalNode = psCurr;
-      oLinkedList->psFirst = psCurr->psNext;
-      free(removalNode->pvKey);
-      free(removalNode);
-      oLinkedList->length -=  1;
-      return (void *) outItem;
-   }
-   while(psCurr->psNext != NULL && 
-      strcmp(psCurr->psNext->pvKey, pcKey) != 0){
-      psCurr = psCurr->psNext;
-   }
-   if (psCurr->psNext == NULL) {
+   removalNode = LinkedList_search(oLinkedList, pcKey, uLength, uHash,
+      &psPrev, &i STATS_PASS);
+   if (removalNode == NULL) {
       return NULL;
    }
-   outItem = (void*)psCurr->psNext->pvItem;
-   removalNode = psCurr->psNext;
-   psCurr->psNext = psCurr->psNext->psNext;
-   free(removalNode->pvKey);
-   free(removalNode);
-   oLinkedList->length -= 1;
-   return (void *) outItem;
+   LinkedList_unlink(oLinkedList, removalNode, psPrev, i);
+   return removalNode;
 }
 
-/* Linkedist_free takes a oLinkedList and frees it */
-static void LinkedList_free(LinkedList_T oLinkedList) {
+/* Linkedist_free takes a oLinkedList and the oSymTable it is of
+   and frees it */
+static void LinkedList_free(LinkedList_T oLinkedList,
+   SymTable_T oSymTable) {
    struct Node* curr;
    struct Node* next;
    assert(oLinkedList != NULL);
@@ -219,12 +1236,59 @@ static void LinkedList_free(LinkedList_T oLinkedList) {
    for (curr = oLinkedList->psFirst; curr != NULL; 
       curr = next) {
       next = curr->psNext;
-      free(curr->pvKey);
-      free(curr);
+      SymTable_freeNode(oSymTable, curr);
    }
    free(oLinkedList);
 }
 
+/* LinkedList_copy takes a oLinkedList and the oSymTable it is of
+   and returns a new LinkedList with copies of its nodes in the same
+   order, sharing their keys, or NULL if there is no memory. */
+static LinkedList_T LinkedList_copy(LinkedList_T oLinkedList,
+   SymTable_T oSymTable STATS_PARAM) {
+   LinkedList_T oCopy;
+   struct Node **ppsLink;
+   struct Node *psCurr;
+   struct Node *psNode;
+   assert(oLinkedList != NULL);
+   oCopy = LinkedList_new();
+   if (oCopy == NULL) {
+      return NULL;
+   }
+   memcpy(oCopy->aucTags, oLinkedList->aucTags, GROUP_WIDTH);
+   ppsLink = &oCopy->psFirst;
+   for (psCurr = oLinkedList->psFirst; psCurr != NULL;
+      psCurr = psCurr->psNext) {
+      psNode = Node_new(oSymTable->uFlags);
+      if (psNode == NULL) {
+         *ppsLink = NULL;
+         LinkedList_free(oCopy, oSymTable);
+         return NULL;
+      }
+      Key_retain(oSymTable->uFlags, psCurr->pvKey);
+      psNode->pvKey = psCurr->pvKey;
+      psNode->pvItem = psCurr->pvItem;
+      psNode->uHash = psCurr->uHash;
+      psNode->uSlot = psCurr->uSlot;
+      *ppsLink = psNode;
+      ppsLink = &psNode->psNext;
+      oCopy->length += 1;
+   }
+   *ppsLink = NULL;
+   STAT_ADD(psStats, uAllocations, 1 + oCopy->length);
+   return oCopy;
+}
+
+/* LinkedList_release takes a oLinkedList and the oSymTable it is of,
+   and drops one psArray's hold on the oLinkedList, freeing it if
+   that was the last. */
+static void LinkedList_release(LinkedList_T oLinkedList,
+   SymTable_T oSymTable) {
+   if (REF_DEC(&oLinkedList->uRefs) == 0) {
+      LinkedList_free(oLinkedList, oSymTable);
+   }
+}
+
 /* LinkedList_map takes in a oLinkedList, function pfApply with parameters
     pcKey, pvValue, and pvExtra, and pvExtra. It applys the function
     pfApply with its paramters on all the bindings using the binding's
@@ -247,175 +1311,3131 @@ static void LinkedList_map(LinkedList_T oLinkedList,
    file */
 
 
-/* Return a hash code for pcKey that is between 0 and uBucketCount-1,
-        inclusive. */
-        
-static size_t SymTable_hash(const char *pcKey, size_t uBucketCount) {
-    const size_t HASH_MULTIPLIER = 65599;
-    size_t u;
-    size_t uHash = 0;
-    assert(pcKey != NULL);
+/* SymTable_sipRound applies one SipRound to the SipHash state auV */
+static void SymTable_sipRound(uint64_t auV[4]) {
+    auV[0] += auV[1];
+    auV[1] = (auV[1] << 13) | (auV[1] >> 51);
+    auV[1] ^= auV[0];
+    auV[0] = (auV[0] << 32) | (auV[0] >> 32);
+    auV[2] += auV[3];
+    auV[3] = (auV[3] << 16) | (auV[3] >> 48);
+    auV[3] ^= auV[2];
+    auV[0] += auV[3];
+    auV[3] = (auV[3] << 21) | (auV[3] >> 43);
+    auV[3] ^= auV[0];
+    auV[2] += auV[1];
+    auV[1] = (auV[1] << 17) | (auV[1] >> 47);
+    auV[1] ^= auV[2];
+    auV[2] = (auV[2] << 32) | (auV[2] >> 32);
+}
 
-    for (u = 0; pcKey[u] != '\0'; u++)
-    uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
-        
-    return uHash % uBucketCount;
+/* SymTable_sipHash takes in a 128-bit seed auSeed and a pcKey of uLen
+   characters and returns the SipHash-1-3 of pcKey. Without the seed,
+   an attacker cannot choose keys that all land in one bucket. */
+static uint64_t SymTable_sipHash(const uint64_t auSeed[2],
+    const char *pcKey, size_t uLen) {
+    const unsigned char *pucIn = (const unsigned char *)pcKey;
+    size_t i;
+    uint64_t uWord;
+    uint64_t auV[4];
+    assert(pcKey != NULL);
+    auV[0] = auSeed[0] ^ UINT64_C(0x736f6d6570736575);
+    auV[1] = auSeed[1] ^ UINT64_C(0x646f72616e646f6d);
+    auV[2] = auSeed[0] ^ UINT64_C(0x6c7967656e657261);
+    auV[3] = auSeed[1] ^ UINT64_C(0x7465646279746573);
+    /* compress the key 8 bytes at a time, read little-endian */
+    for (; uLen - (size_t)(pucIn - (const unsigned char *)pcKey) >= 8;
+        pucIn += 8) {
+        uWord = 0;
+        for (i = 0; i < 8; i++) {
+            uWord |= (uint64_t)pucIn[i] << (8 * i);
+        }
+        auV[3] ^= uWord;
+        SymTable_sipRound(auV);
+        auV[0] ^= uWord;
+    }
+    /* the last block holds the leftover bytes and the key length */
+    uWord = (uint64_t)uLen << 56;
+    for (i = 0; i < uLen % 8; i++) {
+        uWord |= (uint64_t)pucIn[i] << (8 * i);
+    }
+    auV[3] ^= uWord;
+    SymTable_sipRound(auV);
+    auV[0] ^= uWord;
+    auV[2] ^= 0xff;
+    SymTable_sipRound(auV);
+    SymTable_sipRound(auV);
+    SymTable_sipRound(auV);
+    return auV[0] ^ auV[1] ^ auV[2] ^ auV[3];
+}
+
+/* SymTable_randomSeed takes in an array auSeed and a pointer pvSalt
+   and fills auSeed with 128 random bits from /dev/urandom. If that is
+   not available, the bits are mixed from the clock, the time and
+   pvSalt, which still differs between tables. */
+static void SymTable_randomSeed(uint64_t auSeed[2], const void *pvSalt) {
+    FILE *psFile;
+    size_t uRead = 0;
+    psFile = fopen("/dev/urandom", "rb");
+    if (psFile != NULL) {
+        uRead = fread(auSeed, sizeof(uint64_t), 2, psFile);
+        fclose(psFile);
+    }
+    if (uRead != 2) {
+        auSeed[0] = (uint64_t)time(NULL) * UINT64_C(0x9e3779b97f4a7c15) ^
+            (uint64_t)(size_t)pvSalt;
+        auSeed[1] = (uint64_t)clock() * UINT64_C(0xbf58476d1ce4e5b9) ^
+            (auSeed[0] >> 31);
+    }
+}
+
+/* Return the hash code for the uLength characters of pcKey. The
+   bucket of pcKey is the hash code modulo the bucket count. Unless
+   the oSymTable is keyed, this is the hash function from the
+   assignment specification. */
+        
+static size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength) {
+    assert(pcKey != NULL);
+
+    if (oSymTable->iKeyed) {
+        return (size_t)SymTable_sipHash(oSymTable->auSeed, pcKey, uLength);
+    }
+
+    return SymTable_hashBytes(pcKey, uLength);
+    }
+
+/* SymTable_releaseArray takes in a psArray of uLen Buckets and a
+   oSymTable it is of, and drops one SymTable's hold on psArray. The
+   last SymTable to let go of psArray frees it and drops its holds on
+   the keys and LinkedLists in it. */
+static void SymTable_releaseArray(struct Bucket *psArray, size_t uLen,
+    SymTable_T oSymTable) {
+    size_t i;
+    if (REF_DEC(&Array_header(psArray)->uRefs) != 0) {
+        return;
+    }
+    for (i = 0; i < uLen; i++) {
+        if (psArray[i].pcKey != NULL) {
+            Key_release(oSymTable->uFlags, psArray[i].pcKey);
+        }
+        if (psArray[i].oOverflow != NULL) {
+            LinkedList_release(psArray[i].oOverflow, oSymTable);
+        }
+    }
+    Array_free(psArray);
+}
+
+/* SymTable_ownArray takes in a oSymTable and makes sure that no
+   snapshot shares its psArray, giving it a copy of the array if one
+   does. The keys and LinkedLists in it stay shared. Returns 1 if
+   successful, or 0 if there is no memory. */
+static int SymTable_ownArray(SymTable_T oSymTable) {
+    struct Bucket *newArray;
+    size_t i;
+    if (REF_GET(&Array_header(oSymTable->psArray)->uRefs) == 1) {
+        return 1;
+    }
+    newArray = Array_new(oSymTable->maxbucket, oSymTable->uFlags,
+        oSymTable->iNode);
+    if (newArray == NULL) {
+        return 0;
+    }
+    STAT_ADD(&oSymTable->sStats, uAllocations, 1);
+    for (i = 0; i < oSymTable->maxbucket; i++) {
+        newArray[i] = oSymTable->psArray[i];
+        if (newArray[i].pcKey != NULL) {
+            Key_retain(oSymTable->uFlags, newArray[i].pcKey);
+        }
+        if (newArray[i].oOverflow != NULL) {
+            REF_INC(&newArray[i].oOverflow->uRefs);
+        }
+    }
+    SymTable_releaseArray(oSymTable->psArray, oSymTable->maxbucket,
+        oSymTable);
+    oSymTable->psArray = newArray;
+    return 1;
+}
+
+/* SymTable_ownBucket takes in a oSymTable and a bucket index hashval,
+   and makes sure that no snapshot shares the psArray of oSymTable or
+   the LinkedList at hashval, copying them if one does, so that they
+   can change. Returns 1 if successful, or 0 if there is no memory. */
+static int SymTable_ownBucket(SymTable_T oSymTable, size_t hashval) {
+    LinkedList_T oLinkedList;
+    LinkedList_T oCopy;
+    if (! SymTable_ownArray(oSymTable)) {
+        return 0;
+    }
+    oLinkedList = oSymTable->psArray[hashval].oOverflow;
+    if (oLinkedList == NULL || REF_GET(&oLinkedList->uRefs) == 1) {
+        return 1;
+    }
+    oCopy = LinkedList_copy(oLinkedList, oSymTable
+        STATS_ARG(oSymTable));
+    if (oCopy == NULL) {
+        return 0;
+    }
+    LinkedList_release(oLinkedList, oSymTable);
+    oSymTable->psArray[hashval].oOverflow = oCopy;
+    return 1;
+}
+
+/* SymTable_findFlags takes in a oSymTable and a bucket index hashval,
+   and returns the flags to look up a key in the Bucket at hashval
+   with. That is uFlags, unless the Bucket is shared with a snapshot,
+   which must not see it reordered. */
+static unsigned int SymTable_findFlags(SymTable_T oSymTable,
+    size_t hashval) {
+    LinkedList_T oLinkedList = oSymTable->psArray[hashval].oOverflow;
+    if (REF_GET(&Array_header(oSymTable->psArray)->uRefs) != 1 ||
+        (oLinkedList != NULL && REF_GET(&oLinkedList->uRefs) != 1)) {
+        return 0;
+    }
+    return oSymTable->uFlags;
+}
+
+/* SymTable_promote takes in a oSymTable, the index hashval of a
+   Bucket that no snapshot shares and the first psNode of its
+   LinkedList, and trades the binding of psNode with the inline
+   binding of the Bucket, slot and all if the oSymTable is
+   bounded. */
+static void SymTable_promote(SymTable_T oSymTable, size_t hashval,
+    struct Node *psNode) {
+    struct Bucket *psBucket = &oSymTable->psArray[hashval];
+    struct Node sSwap = *psNode;
+    size_t uSlot;
+    psNode->pvKey = psBucket->pcKey;
+    psNode->pvItem = psBucket->pvItem;
+    psNode->uHash = psBucket->uHash;
+    psBucket->pcKey = sSwap.pvKey;
+    psBucket->pvItem = sSwap.pvItem;
+    psBucket->uHash = sSwap.uHash;
+    psBucket->oOverflow->aucTags[0] = LinkedList_tag(psNode->uHash);
+    if (oSymTable->psClock != NULL) {
+        uSlot = oSymTable->psClock->puSlots[hashval];
+        oSymTable->psClock->puSlots[hashval] = psNode->uSlot;
+        psNode->uSlot = uSlot;
+    }
+}
+
+/* SymTable_find takes in a oSymTable, a bucket index hashval, a pcKey
+   of uLength characters, its hash code uHash and flags uFlags. It
+   checks the Filter first, if there is one, then the inline binding
+   of the Bucket at hashval and its LinkedList after, which may be
+   reordered as uFlags asks. With SYMTABLE_MOVE_TO_FRONT, and with
+   SYMTABLE_TRANSPOSE if it was first already, the binding found in
+   the LinkedList goes on to trade places with the inline one, so
+   that a hot key comes to be found in the first probe. Returns a
+   pointer to the value bound to pcKey, or NULL if pcKey is not in
+   the oSymTable. */
+static const void **SymTable_find(SymTable_T oSymTable, size_t hashval,
+    const char *pcKey, size_t uLength, size_t uHash, unsigned int uFlags) {
+    struct Bucket *psBucket;
+    struct Node *psNode;
+    size_t uIndex;
+    if (oSymTable->psFilter != NULL &&
+        ! Filter_mayContain(oSymTable->psFilter, uHash)) {
+        STAT_ADD(&oSymTable->sStats, uMisses, 1);
+        return NULL;
+    }
+    psBucket = &oSymTable->psArray[hashval];
+    if (psBucket->pcKey == NULL) {
+        STAT_ADD(&oSymTable->sStats, uMisses, 1);
+        return NULL;
+    }
+    STAT_ADD(&oSymTable->sStats, uProbes, 1);
+    if (psBucket->uHash == uHash) {
+        STAT_ADD(&oSymTable->sStats, uCompares, 1);
+        if (Key_equals(psBucket->pcKey, pcKey, uLength)) {
+            STAT_ADD(&oSymTable->sStats, uHits, 1);
+            return &psBucket->pvItem;
+        }
+    }
+    if (psBucket->oOverflow == NULL) {
+        STAT_ADD(&oSymTable->sStats, uMisses, 1);
+        return NULL;
+    }
+    psNode = LinkedList_find(psBucket->oOverflow, pcKey, uLength, uHash,
+        uFlags, &uIndex STATS_ARG(oSymTable));
+    if (psNode == NULL) {
+        return NULL;
+    }
+    if ((uFlags & SYMTABLE_MOVE_TO_FRONT) ||
+        ((uFlags & SYMTABLE_TRANSPOSE) && uIndex == 0)) {
+        SymTable_promote(oSymTable, hashval, psNode);
+        return &psBucket->pvItem;
+    }
+    return &psNode->pvItem;
+}
+
+/* SymTable_bucketLength takes in a psBucket and returns how many
+   bindings are in it. */
+static size_t SymTable_bucketLength(const struct Bucket *psBucket) {
+    if (psBucket->pcKey == NULL) {
+        return 0;
+    }
+    if (psBucket->oOverflow == NULL) {
+        return 1;
+    }
+    return 1 + LinkedList_getLength(psBucket->oOverflow);
+}
+
+/* SymTable_count takes in an array aucCounts of how many bindings,
+   up to 2, each new Bucket has so far, a bucket index hashval and the
+   count puNodes of bindings that need a Node. It counts one more
+   binding for the Bucket at hashval. */
+static void SymTable_count(unsigned char *aucCounts, size_t hashval,
+    size_t *puNodes) {
+    if (aucCounts[hashval] != 0) {
+        *puNodes += 1;
+    }
+    if (aucCounts[hashval] < 2) {
+        aucCounts[hashval]++;
+    }
+}
+
+/* SymTable_discard takes in a oSymTable and a psNode taken out of it,
+   and frees psNode and drops its key, or with SYMTABLE_DEFER_FREE
+   keeps it for SymTable_reclaim. */
+static void SymTable_discard(SymTable_T oSymTable, struct Node *psNode) {
+    if (! (oSymTable->uFlags & SYMTABLE_DEFER_FREE)) {
+        SymTable_freeNode(oSymTable, psNode);
+        return;
+    }
+    psNode->psNext = oSymTable->psDead;
+    oSymTable->psDead = psNode;
+    oSymTable->uDead += 1;
+}
+
+/* SymTable_discardKey takes in a oSymTable and a pcKey taken out of
+   one of its Buckets, and drops the Bucket's reference to pcKey. With
+   SYMTABLE_DEFER_FREE a key with no references left is kept for
+   SymTable_reclaim, linked through the space of its reference
+   count. */
+static void SymTable_discardKey(SymTable_T oSymTable, char *pcKey) {
+    if (! (oSymTable->uFlags & SYMTABLE_DEFER_FREE) ||
+        (oSymTable->uFlags & SYMTABLE_BORROW_KEYS)) {
+        Key_release(oSymTable->uFlags, pcKey);
+        return;
+    }
+    if (REF_DEC(Key_refs(pcKey)) != 0) {
+        return;
+    }
+    *(char **)(void *)Key_refs(pcKey) = oSymTable->pcDeadKeys;
+    oSymTable->pcDeadKeys = pcKey;
+    oSymTable->uDead += 1;
+}
+
+/* SymTable_removeInline takes in a oSymTable and the index hashval of
+   a Bucket that has bindings and that no snapshot shares, and removes
+   the inline binding of the Bucket. The first binding of the
+   LinkedList takes its place, so that a Bucket with any bindings
+   always has one inline. Returns the value of the removed binding. */
+static const void *SymTable_removeInline(SymTable_T oSymTable,
+    size_t hashval) {
+    struct Bucket *psBucket = &oSymTable->psArray[hashval];
+    struct Node *psFirst;
+    char *pcOldKey;
+    const void *output;
+    output = psBucket->pvItem;
+    oSymTable->length -= 1;
+    if (oSymTable->psFilter != NULL) {
+       Filter_drop(oSymTable->psFilter, psBucket->uHash);
+    }
+    if (oSymTable->psClock != NULL) {
+       Clock_drop(oSymTable->psClock,
+          oSymTable->psClock->puSlots[hashval]);
+    }
+    if (psBucket->oOverflow != NULL &&
+       psBucket->oOverflow->psFirst != NULL) {
+       /* the binding of the first Node moves inline, and the Node
+         leaves with the removed key */
+       psFirst = psBucket->oOverflow->psFirst;
+       LinkedList_unlink(psBucket->oOverflow, psFirst, NULL, 0);
+       pcOldKey = psBucket->pcKey;
+       psBucket->uHash = psFirst->uHash;
+       psBucket->pcKey = psFirst->pvKey;
+       psBucket->pvItem = psFirst->pvItem;
+       if (oSymTable->psClock != NULL) {
+          oSymTable->psClock->puSlots[hashval] = psFirst->uSlot;
+       }
+       psFirst->pvKey = pcOldKey;
+       SymTable_discard(oSymTable, psFirst);
+    }
+    else {
+       SymTable_discardKey(oSymTable, psBucket->pcKey);
+       psBucket->pcKey = NULL;
+    }
+    return output;
+}
+
+/* SymTable_slot takes in a bounded oSymTable, the index hashval of a
+   Bucket and a pointer ppvItem to the value of a binding in it, and
+   returns a pointer to the index of the slot of the binding. */
+static size_t *SymTable_slot(SymTable_T oSymTable, size_t hashval,
+    const void **ppvItem) {
+    struct Node *psNode;
+    if (ppvItem == &oSymTable->psArray[hashval].pvItem) {
+        return &oSymTable->psClock->puSlots[hashval];
+    }
+    psNode = (struct Node *)(void *)
+        ((char *)ppvItem - offsetof(struct Node, pvItem));
+    return &psNode->uSlot;
+}
+
+/* SymTable_touch takes in a oSymTable, the index hashval of a Bucket
+   and a pointer ppvItem to the value of a binding in it that was just
+   found, and marks the binding as used if the oSymTable is
+   bounded. */
+static void SymTable_touch(SymTable_T oSymTable, size_t hashval,
+    const void **ppvItem) {
+    if (oSymTable->psClock != NULL) {
+        oSymTable->psClock->pucUsed[*SymTable_slot(oSymTable, hashval,
+            ppvItem)] = 1;
+    }
+}
+
+/* SymTable_admit takes in a oSymTable, the index hashval of a Bucket,
+   a pointer ppvItem to the value of a binding just put into it and its
+   hash code uHash, and gives the binding a slot marked as used if the
+   oSymTable is bounded. SymTable_makeRoom must have made sure there
+   is a free slot. */
+static void SymTable_admit(SymTable_T oSymTable, size_t hashval,
+    const void **ppvItem, size_t uHash) {
+    if (oSymTable->psClock != NULL) {
+        *SymTable_slot(oSymTable, hashval, ppvItem) =
+            Clock_take(oSymTable->psClock, uHash);
+    }
+}
+
+/* SymTable_evict takes in a bounded oSymTable that is full, moves the
+   clock hand to the first slot whose binding has not been used since
+   the hand last passed it, and evicts that binding. Every flag the
+   hand clears was set by a use, so this takes constant amortized
+   time. Returns 1 if successful, or 0 if there is no memory to copy
+   the Bucket of the binding from a snapshot, in which case nothing is
+   evicted. */
+static int SymTable_evict(SymTable_T oSymTable) {
+    struct Clock *psClock = oSymTable->psClock;
+    struct Bucket *psBucket;
+    struct Node *psPrev = NULL;
+    struct Node *psCurr;
+    size_t uSlot;
+    size_t hashval;
+    size_t i = 0;
+    /* a full SymTable has a binding in every slot */
+    assert(psClock->uFree == NO_SLOT);
+    while (psClock->pucUsed[psClock->uHand]) {
+        psClock->pucUsed[psClock->uHand] = 0;
+        psClock->uHand = (psClock->uHand + 1) % psClock->uSlots;
+    }
+    uSlot = psClock->uHand;
+    hashval = psClock->puHashes[uSlot] % oSymTable->maxbucket;
+    if (! SymTable_ownBucket(oSymTable, hashval)) {
+        return 0;
+    }
+    psBucket = &oSymTable->psArray[hashval];
+    psClock->uHand = (uSlot + 1) % psClock->uSlots;
+    if (psClock->puSlots[hashval] == uSlot) {
+        if (psClock->pfEvict != NULL) {
+            (*psClock->pfEvict)(psBucket->pcKey, (void *)psBucket->pvItem,
+                (void *)psClock->pvExtra);
+        }
+        SymTable_removeInline(oSymTable, hashval);
+        return 1;
+    }
+    for (psCurr = psBucket->oOverflow->psFirst; psCurr->uSlot != uSlot;
+        psCurr = psCurr->psNext) {
+        psPrev = psCurr;
+        i++;
+    }
+    if (psClock->pfEvict != NULL) {
+        (*psClock->pfEvict)(psCurr->pvKey, (void *)psCurr->pvItem,
+            (void *)psClock->pvExtra);
+    }
+    LinkedList_unlink(psBucket->oOverflow, psCurr, psPrev, i);
+    if (oSymTable->psFilter != NULL) {
+        Filter_drop(oSymTable->psFilter, psCurr->uHash);
+    }
+    Clock_drop(psClock, uSlot);
+    SymTable_discard(oSymTable, psCurr);
+    oSymTable->length -= 1;
+    return 1;
+}
+
+/* SymTable_makeRoom takes in a oSymTable about to get a new binding.
+   If it is bounded and full, it evicts a binding, and otherwise makes
+   sure there is a free slot. Returns 1 if successful, or 0 if there is
+   no memory. */
+static int SymTable_makeRoom(SymTable_T oSymTable) {
+    if (oSymTable->psClock == NULL) {
+        return 1;
+    }
+    if (oSymTable->length >= oSymTable->psClock->uCapacity) {
+        return SymTable_evict(oSymTable);
+    }
+    return Clock_reserve(oSymTable->psClock);
+}
+
+/* SymTable_replaceValue takes in a oSymTable made by SymTable_newSized,
+   the index hashval of a Bucket that no snapshot shares, a pointer
+   ppvItem to the value of a binding in the Bucket and a pvValue, and
+   copies pvValue over the value of the binding. If a snapshot shares
+   the key the value is kept with, the binding first gets a copy of
+   its own. Returns a pointer to the value, or NULL if there is no
+   memory. */
+static void *SymTable_replaceValue(SymTable_T oSymTable, size_t hashval,
+    const void **ppvItem, const void *pvValue) {
+    struct Bucket *psBucket = &oSymTable->psArray[hashval];
+    struct Node *psNode;
+    char **ppcKey;
+    char *pcCopy;
+    const void *pvCopy;
+    if (ppvItem == &psBucket->pvItem) {
+        ppcKey = &psBucket->pcKey;
+    }
+    else {
+        psNode = (struct Node *)(void *)
+            ((char *)ppvItem - offsetof(struct Node, pvItem));
+        ppcKey = &psNode->pvKey;
+    }
+    if (REF_GET(Key_refs(*ppcKey)) != 1) {
+        pvCopy = *ppvItem;
+        pcCopy = Key_new(oSymTable->uFlags, *ppcKey, strlen(*ppcKey),
+            &pvCopy, oSymTable->uValueSize);
+        if (pcCopy == NULL) {
+            return NULL;
+        }
+        STAT_ADD(&oSymTable->sStats, uAllocations, 1);
+        Key_release(oSymTable->uFlags, *ppcKey);
+        *ppcKey = pcCopy;
+        *ppvItem = pvCopy;
+    }
+    memcpy((void *)*ppvItem, pvValue, oSymTable->uValueSize);
+    return (void *)*ppvItem;
+}
+
+/* SymTable_rehash takes in a oSymTable, a pcKey, its hash code uHash
+   and a flag iRehash, and returns uHash if iRehash is 0, or the hash
+   code of pcKey with the current seed otherwise. */
+static size_t SymTable_rehash(SymTable_T oSymTable, const char *pcKey,
+    size_t uHash, int iRehash) {
+    if (iRehash) {
+        return SymTable_hash(oSymTable, pcKey, strlen(pcKey));
+    }
+    return uHash;
+}
+
+/* SymTable_refilter takes in a oSymTable that has just been rebuilt
+   and a flag iRehash, and gives it a new Filter sized for its new
+   psArray. If there is no memory for one, the old Filter is kept if
+   the hash codes are the same, or dropped if iRehash changed them. */
+static void SymTable_refilter(SymTable_T oSymTable, int iRehash) {
+    struct Filter *psFilter;
+    struct Bucket *psBucket;
+    struct Node *psNode;
+    size_t i;
+    if (oSymTable->psFilter == NULL) {
+        return;
+    }
+    psFilter = Filter_new(oSymTable->maxbucket);
+    if (psFilter == NULL && ! iRehash) {
+        return;
+    }
+    free(oSymTable->psFilter);
+    oSymTable->psFilter = psFilter;
+    if (psFilter == NULL) {
+        return;
+    }
+    STAT_ADD(&oSymTable->sStats, uAllocations, 1);
+    for (i = 0; i < oSymTable->maxbucket; i++) {
+        psBucket = &oSymTable->psArray[i];
+        if (psBucket->pcKey == NULL) {
+            continue;
+        }
+        Filter_add(psFilter, psBucket->uHash);
+        if (psBucket->oOverflow == NULL) {
+            continue;
+        }
+        for (psNode = psBucket->oOverflow->psFirst; psNode != NULL;
+            psNode = psNode->psNext) {
+            Filter_add(psFilter, psNode->uHash);
+        }
+    }
+}
+
+/* SymTable_rebuild takes in a oSymTable, an index uBucketnum into
+   auBucketCounts and a flag iRehash, and moves all of the bindings
+   into a new psArray of auBucketCounts[uBucketnum] Buckets. If
+   iRehash is 0, every binding keeps its hash code, so it is moved
+   without touching its key. Otherwise its hash code is computed
+   again with the current seed. Returns 1 if successful. If there is
+   no memory for the new psArray, returns 0 and the oSymTable keeps
+   its current psArray. */
+static int SymTable_rebuild(SymTable_T oSymTable, size_t uBucketnum,
+    int iRehash) {
+    struct Bucket* oldArray;
+    struct Bucket* newArray;
+    struct Bucket* psBucket;
+    unsigned char *aucCounts;
+    struct Clock *psClock = oSymTable->psClock;
+    size_t *puSlots = NULL;
+    size_t uSlot;
+    struct Node* psSpare = NULL;
+    size_t oldLen;
+    size_t newLen;
+    size_t uNodes = 0;
+    size_t uNeeded = 0;
+    size_t i;
+    int iSuccessful = 1;
+    struct Node* head;
+    struct Node* next;
+    oldLen = oSymTable->maxbucket;
+    newLen = auBucketCounts[uBucketnum];
+    /* the nodes are relinked in place, so no snapshot may share
+      them */
+    for (i = 0; i < oldLen; i++) {
+        if (! SymTable_ownBucket(oSymTable, i)) {
+            return 0;
+        }
+    }
+    oldArray = oSymTable->psArray;
+    newArray = Array_new(newLen, oSymTable->uFlags, oSymTable->iNode);
+    aucCounts = (unsigned char*) calloc(newLen, 1);
+    if (newArray == NULL || aucCounts == NULL) {
+        if (newArray != NULL) {
+            Array_free(newArray);
+        }
+        free(aucCounts);
+        return 0;
+    }
+    STAT_ADD(&oSymTable->sStats, uAllocations, 2);
+    /* count the bindings of each new Bucket, and how many of them will
+      not fit inline and need a Node */
+    for (i = 0; i < oldLen; i++) {
+        if (oldArray[i].pcKey == NULL) {
+            continue;
+        }
+        SymTable_count(aucCounts, SymTable_rehash(oSymTable,
+            oldArray[i].pcKey, oldArray[i].uHash, iRehash) % newLen,
+            &uNeeded);
+        if (oldArray[i].oOverflow == NULL) {
+            continue;
+        }
+        for (head = oldArray[i].oOverflow->psFirst; head != NULL;
+            head = head->psNext) {
+            SymTable_count(aucCounts, SymTable_rehash(oSymTable,
+                head->pvKey, head->uHash, iRehash) % newLen, &uNeeded);
+            uNodes++;
+        }
+    }
+    /* make every LinkedList and Node the bindings need before moving
+      any of them, so that running out of memory leaves oSymTable
+      intact */
+    for (i = 0; iSuccessful && i < newLen; i++) {
+        if (aucCounts[i] == 2) {
+            newArray[i].oOverflow = LinkedList_new();
+            if (newArray[i].oOverflow == NULL) {
+                iSuccessful = 0;
+            }
+            else {
+                STAT_ADD(&oSymTable->sStats, uAllocations, 1);
+            }
+        }
+    }
+    for (; iSuccessful && uNodes < uNeeded; uNodes++) {
+        head = (struct Node*) malloc(sizeof(struct Node));
+        if (head == NULL) {
+            iSuccessful = 0;
+        }
+        else {
+            STAT_ADD(&oSymTable->sStats, uAllocations, 1);
+            head->psNext = psSpare;
+            psSpare = head;
+        }
+    }
+    if (iSuccessful && psClock != NULL) {
+        puSlots = (size_t*) malloc(newLen * sizeof(size_t));
+        if (puSlots == NULL) {
+            iSuccessful = 0;
+        }
+        else {
+            STAT_ADD(&oSymTable->sStats, uAllocations, 1);
+        }
+    }
+    free(aucCounts);
+    if (! iSuccessful) {
+        for (i = 0; i < newLen; i++) {
+            free(newArray[i].oOverflow);
+        }
+        Array_free(newArray);
+        for (; psSpare != NULL; psSpare = next) {
+            next = psSpare->psNext;
+            free(psSpare);
+        }
+        return 0;
+    }
+    /* move the old Nodes first. One that lands in an empty Bucket
+      goes inline and leaves its Node spare for the inline bindings
+      moved after them that land in a taken Bucket */
+    for (i = 0; i < oldLen; i++) {
+        if (oldArray[i].oOverflow == NULL) {
+            continue;
+        }
+        for (head = oldArray[i].oOverflow->psFirst; head != NULL;
+            head = next) {
+            next = head->psNext;
+            head->uHash = SymTable_rehash(oSymTable, head->pvKey,
+                head->uHash, iRehash);
+            if (psClock != NULL) {
+                psClock->puHashes[head->uSlot] = head->uHash;
+            }
+            psBucket = &newArray[head->uHash % newLen];
+            if (psBucket->pcKey == NULL) {
+                psBucket->uHash = head->uHash;
+                psBucket->pcKey = head->pvKey;
+                psBucket->pvItem = head->pvItem;
+                if (psClock != NULL) {
+                    puSlots[head->uHash % newLen] = head->uSlot;
+                }
+                head->psNext = psSpare;
+                psSpare = head;
+            }
+            else {
+                LinkedList_link(psBucket->oOverflow, head);
+            }
+        }
+        free(oldArray[i].oOverflow);
+    }
+    for (i = 0; i < oldLen; i++) {
+        if (oldArray[i].pcKey == NULL) {
+            continue;
+        }
+        oldArray[i].uHash = SymTable_rehash(oSymTable, oldArray[i].pcKey,
+            oldArray[i].uHash, iRehash);
+        uSlot = 0;
+        if (psClock != NULL) {
+            uSlot = psClock->puSlots[i];
+            psClock->puHashes[uSlot] = oldArray[i].uHash;
+        }
+        psBucket = &newArray[oldArray[i].uHash % newLen];
+        if (psBucket->pcKey == NULL) {
+            psBucket->uHash = oldArray[i].uHash;
+            psBucket->pcKey = oldArray[i].pcKey;
+            psBucket->pvItem = oldArray[i].pvItem;
+            if (psClock != NULL) {
+                puSlots[oldArray[i].uHash % newLen] = uSlot;
+            }
+        }
+        else {
+            head = psSpare;
+            psSpare = head->psNext;
+            head->uHash = oldArray[i].uHash;
+            head->pvKey = oldArray[i].pcKey;
+            head->pvItem = oldArray[i].pvItem;
+            head->uSlot = uSlot;
+            LinkedList_link(psBucket->oOverflow, head);
+        }
+    }
+    /* the Nodes left spare had their bindings go inline */
+    for (; psSpare != NULL; psSpare = next) {
+        next = psSpare->psNext;
+        if (! SymTable_holdsNode(oSymTable, psSpare)) {
+            free(psSpare);
+        }
+    }
+    Array_free(oldArray);
+    oSymTable->psArray = newArray;
+    oSymTable->maxbucket = newLen;
+    oSymTable->bucketnum = uBucketnum;
+    if (psClock != NULL) {
+        free(psClock->puSlots);
+        psClock->puSlots = puSlots;
+    }
+    SymTable_refilter(oSymTable, iRehash);
+    return 1;
+}
+
+/* SymTable_expand takes in a oSymTable and moves all of its bindings
+   into a psArray of the next size in auBucketCounts. If there is no
+   memory for the new psArray, the oSymTable keeps its current size. */
+static void SymTable_expand(SymTable_T oSymTable) {
+#ifdef SYMTABLE_STATS
+    clock_t iInitialClock = clock();
+#endif
+    if (SymTable_rebuild(oSymTable, oSymTable->bucketnum + 1, 0)) {
+        STAT_ADD(&oSymTable->sStats, uResizes, 1);
+    }
+#ifdef SYMTABLE_STATS
+    oSymTable->sStats.dResizeSeconds +=
+        ((double)(clock() - iInitialClock)) / CLOCKS_PER_SEC;
+#endif
+}
+
+/* SymTable_reseed takes in a oSymTable whose keys are flooding one
+   bucket, switches it to SymTable_sipHash with a fresh random seed
+   and moves every binding to its new bucket. If there is no memory
+   to do so, the oSymTable keeps its current hash function. Buckets
+   are not turned into trees: a fresh seed spreads the keys out again
+   without a second kind of bucket for every lookup to check for. */
+static void SymTable_reseed(SymTable_T oSymTable) {
+    uint64_t auOldSeed[2];
+    int iWasKeyed;
+    iWasKeyed = oSymTable->iKeyed;
+    auOldSeed[0] = oSymTable->auSeed[0];
+    auOldSeed[1] = oSymTable->auSeed[1];
+    SymTable_randomSeed(oSymTable->auSeed, oSymTable);
+    oSymTable->iKeyed = 1;
+    if (! SymTable_rebuild(oSymTable, oSymTable->bucketnum, 1)) {
+        oSymTable->iKeyed = iWasKeyed;
+        oSymTable->auSeed[0] = auOldSeed[0];
+        oSymTable->auSeed[1] = auOldSeed[1];
+    }
+}
+
+/* SymTable_inRange takes in a string pcKey, bounds pcLo and pcHi and
+   a prefix pcPrefix of length uPrefixLength, and returns 1 if pcKey
+   is at least pcLo, less than pcHi and starts with pcPrefix, where a
+   NULL pcLo, pcHi or pcPrefix is no limit. Otherwise returns 0. */
+static int SymTable_inRange(const char *pcKey, const char *pcLo,
+   const char *pcHi, const char *pcPrefix, size_t uPrefixLength) {
+   if (pcLo != NULL && strcmp(pcKey, pcLo) < 0) {
+      return 0;
+   }
+   if (pcHi != NULL && strcmp(pcKey, pcHi) >= 0) {
+      return 0;
+   }
+   if (pcPrefix != NULL && strncmp(pcKey, pcPrefix, uPrefixLength) != 0) {
+      return 0;
+   }
+   return 1;
+}
+
+/* SymTable_compareNodes takes in pointers pvFirst and pvSecond to two
+   Nodes and compares their keys with strcmp, for qsort. */
+static int SymTable_compareNodes(const void *pvFirst,
+   const void *pvSecond) {
+   const struct Node *psFirst = (const struct Node *)pvFirst;
+   const struct Node *psSecond = (const struct Node *)pvSecond;
+   return strcmp(psFirst->pvKey, psSecond->pvKey);
+}
+
+/* SymTable_collect takes in a pcKey, its value pvItem, the bounds and
+   prefix of SymTable_inRange and an array psMatches with room at
+   *puCount, or NULL. If pcKey is in range, it counts it in *puCount
+   and copies the binding into psMatches if there is one. */
+static void SymTable_collect(char *pcKey, const void *pvItem,
+   const char *pcLo, const char *pcHi, const char *pcPrefix,
+   size_t uPrefixLength, struct Node *psMatches, size_t *puCount) {
+   if (! SymTable_inRange(pcKey, pcLo, pcHi, pcPrefix, uPrefixLength)) {
+      return;
+   }
+   if (psMatches != NULL) {
+      psMatches[*puCount].pvKey = pcKey;
+      psMatches[*puCount].pvItem = pvItem;
+   }
+   *puCount += 1;
+}
+
+/* SymTable_mapSorted takes in a oSymTable, bounds pcLo and pcHi, a
+   prefix pcPrefix, function pfApply and pvExtra. It collects the
+   bindings whose keys are in range as for SymTable_inRange, sorts
+   them by key and applies pfApply to each in that order. Returns 1 if
+   successful, or 0 if there is no memory for the sorting, in which
+   case pfApply is never called. */
+static int SymTable_mapSorted(SymTable_T oSymTable, const char *pcLo,
+    const char *pcHi, const char *pcPrefix,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   struct Node *psMatches = NULL;
+   struct Node *psCurr;
+   struct Bucket *psBucket;
+   size_t uPrefixLength = 0;
+   size_t uCount = 0;
+   size_t i;
+   size_t uBucket;
+   int iPass;
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+   if (pcPrefix != NULL) {
+      uPrefixLength = strlen(pcPrefix);
+   }
+   /* the first pass counts the bindings in range and the second
+     copies them */
+   for (iPass = 0; iPass < 2; iPass++) {
+      if (iPass == 1) {
+         if (uCount == 0) {
+            return 1;
+         }
+         psMatches = (struct Node *) malloc(uCount * sizeof(struct Node));
+         if (psMatches == NULL) {
+            return 0;
+         }
+         uCount = 0;
+      }
+      for (uBucket = 0; uBucket < oSymTable->maxbucket; uBucket++) {
+         psBucket = &oSymTable->psArray[uBucket];
+         if (psBucket->pcKey == NULL) {
+            continue;
+         }
+         SymTable_collect(psBucket->pcKey, psBucket->pvItem, pcLo, pcHi,
+            pcPrefix, uPrefixLength, psMatches, &uCount);
+         if (psBucket->oOverflow == NULL) {
+            continue;
+         }
+         for (psCurr = psBucket->oOverflow->psFirst; psCurr != NULL;
+              psCurr = psCurr->psNext) {
+            SymTable_collect(psCurr->pvKey, psCurr->pvItem, pcLo, pcHi,
+               pcPrefix, uPrefixLength, psMatches, &uCount);
+         }
+      }
+   }
+   qsort(psMatches, uCount, sizeof(struct Node), SymTable_compareNodes);
+   for (i = 0; i < uCount; i++) {
+      (*pfApply)(psMatches[i].pvKey, (void *)psMatches[i].pvItem,
+         (void *)pvExtra);
+   }
+   free(psMatches);
+   return 1;
+}
+
+SymTable_T SymTable_new(void) {
+   return SymTable_newWithFlags(0);
+}
+
+SymTable_T SymTable_newWithFlags(unsigned int uFlags) {
+   return SymTable_newOnNode(uFlags, -1);
+}
+
+SymTable_T SymTable_newOnNode(unsigned int uFlags, int iNode) {
+   SymTable_T oSymTable = (SymTable_T) malloc(sizeof(struct SymTable));
+   if (oSymTable == NULL) {
+      return NULL;
+   }
+   oSymTable->length = 0;
+   oSymTable->maxbucket = auBucketCounts[0];
+   oSymTable->iNode = iNode;
+   oSymTable->psArray = Array_new(oSymTable->maxbucket, uFlags, iNode);
+   if (oSymTable->psArray == NULL) {
+      free(oSymTable);
+      return NULL;
+   }
+   oSymTable->bucketnum = 0;
+   oSymTable->uFlags = uFlags;
+   oSymTable->psArenas = NULL;
+   oSymTable->psNodes = NULL;
+   oSymTable->uNodes = 0;
+   oSymTable->puArenaRefs = NULL;
+   oSymTable->iReadOnly = 0;
+   oSymTable->uValueSize = 0;
+   oSymTable->psFilter = NULL;
+   oSymTable->psClock = NULL;
+   oSymTable->psDead = NULL;
+   oSymTable->pcDeadKeys = NULL;
+   oSymTable->uDead = 0;
+   oSymTable->oYoung = NULL;
+   oSymTable->uBaseLength = 0;
+   oSymTable->psResize = NULL;
+   oSymTable->iKeyed = 0;
+   oSymTable->auSeed[0] = 0;
+   oSymTable->auSeed[1] = 0;
+   if (uFlags & SYMTABLE_HARDENED) {
+      SymTable_randomSeed(oSymTable->auSeed, oSymTable);
+      oSymTable->iKeyed = 1;
+   }
+   if (uFlags & SYMTABLE_FILTER) {
+      oSymTable->psFilter = Filter_new(oSymTable->maxbucket);
+      if (oSymTable->psFilter == NULL) {
+         Array_free(oSymTable->psArray);
+         free(oSymTable);
+         return NULL;
+      }
+   }
+#ifdef SYMTABLE_STATS
+   memset(&oSymTable->sStats, 0, sizeof(oSymTable->sStats));
+   oSymTable->sStats.uAllocations = 2;
+   if (oSymTable->psFilter != NULL) {
+      oSymTable->sStats.uAllocations += 1;
+   }
+#endif
+   return oSymTable;
+}
+
+SymTable_T SymTable_newSized(size_t uValueSize) {
+   SymTable_T oSymTable;
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL) {
+      return NULL;
+   }
+   oSymTable->uValueSize = uValueSize;
+   return oSymTable;
+}
+
+SymTable_T SymTable_newBounded(size_t uCapacity, unsigned int uFlags,
+    void (*pfEvict)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   SymTable_T oSymTable;
+   struct Clock *psClock;
+   assert(uCapacity >= 1);
+   oSymTable = SymTable_newWithFlags(uFlags);
+   if (oSymTable == NULL) {
+      return NULL;
+   }
+   psClock = Clock_new(uCapacity, oSymTable->maxbucket);
+   if (psClock == NULL) {
+      SymTable_free(oSymTable);
+      return NULL;
+   }
+   STAT_ADD(&oSymTable->sStats, uAllocations, 2);
+   psClock->pfEvict = pfEvict;
+   psClock->pvExtra = pvExtra;
+   oSymTable->psClock = psClock;
+   return oSymTable;
+}
+
+/* A Build is a SymTable_build in progress. Its keys are split among
+   uParts BuildParts, one for each thread. Each BuildPart owns a run
+   of neighbouring Buckets and builds them from the keys that hash to
+   them, with a run of the Nodes of the SymTable and keys in Arenas of
+   its own, so that no two threads ever write the same memory and
+   none of them has to lock. */
+struct Build
+{
+   /* oSymTable is the SymTable being built. The threads only read it,
+      apart from the Buckets of their own BuildParts */
+   SymTable_T oSymTable;
+   /* ppcKeys and ppvValues are the bindings to build from */
+   const char *const *ppcKeys;
+   const void *const *ppvValues;
+   /* auHashes and auLengths are the hash code and length of each key */
+   size_t *auHashes;
+   size_t *auLengths;
+   /* auOrder lists the keys handed to each BuildPart in turn, each
+      BuildPart's keys in their order in ppcKeys */
+   size_t *auOrder;
+   /* uParts is the number of BuildParts in psParts */
+   size_t uParts;
+   struct BuildPart *psParts;
+};
+
+/* A BuildPart is the share of a Build one thread does. The thread
+   first hashes the keys uFirstKey up to but not including uLastKey,
+   then hands them to the BuildParts whose Buckets they go in, and last
+   builds the Buckets uFirstBucket up to but not including
+   uLastBucket from the keys it was handed. */
+struct BuildPart
+{
+   struct Build *psBuild;
+   size_t uFirstKey;
+   size_t uLastKey;
+   size_t uFirstBucket;
+   size_t uLastBucket;
+   /* puCounts[p] is how many of the keys uFirstKey to uLastKey go to
+      BuildPart p, and later where the next of them goes in auOrder */
+   size_t *puCounts;
+   /* the keys handed to the BuildPart are auOrder[uStart] up to but
+      not including auOrder[uEnd] */
+   size_t uStart;
+   size_t uEnd;
+   /* psArenas holds the keys the BuildPart made, until they are
+      handed to the SymTable */
+   struct Arena *psArenas;
+   /* uLength is the number of bindings the BuildPart made, and
+      uLongest the length of its longest Bucket */
+   size_t uLength;
+   size_t uLongest;
+   /* iSuccessful is 0 if the BuildPart ran out of memory */
+   int iSuccessful;
+#ifdef SYMTABLE_THREADS
+   /* sThread runs the BuildPart, if iStarted is 1 */
+   pthread_t sThread;
+   int iStarted;
+#endif
+#ifdef SYMTABLE_STATS
+   struct SymTableStats sStats;
+#endif
+};
+
+/* Build_part takes in a psBuild and a bucket index hashval, and
+   returns the index of the BuildPart whose Buckets include it. */
+static size_t Build_part(const struct Build *psBuild, size_t hashval) {
+    return hashval * psBuild->uParts / psBuild->oSymTable->maxbucket;
+}
+
+/* Build_hash takes in a BuildPart pvPart, hashes its keys and counts
+   how many of them go to each BuildPart. Returns NULL. */
+static void *Build_hash(void *pvPart) {
+    struct BuildPart *psPart = (struct BuildPart *)pvPart;
+    struct Build *psBuild = psPart->psBuild;
+    size_t i;
+    for (i = psPart->uFirstKey; i < psPart->uLastKey; i++) {
+        assert(psBuild->ppcKeys[i] != NULL);
+        psBuild->auLengths[i] = strlen(psBuild->ppcKeys[i]);
+        psBuild->auHashes[i] = SymTable_hash(psBuild->oSymTable,
+            psBuild->ppcKeys[i], psBuild->auLengths[i]);
+        psPart->puCounts[Build_part(psBuild, psBuild->auHashes[i] %
+            psBuild->oSymTable->maxbucket)]++;
+    }
+    STAT_ADD(&psPart->sStats, uHashes,
+        psPart->uLastKey - psPart->uFirstKey);
+    return NULL;
+}
+
+/* Build_scatter takes in a BuildPart pvPart whose puCounts have been
+   turned into places in auOrder, and puts each of its keys in the
+   place of the BuildPart it goes to. Returns NULL. */
+static void *Build_scatter(void *pvPart) {
+    struct BuildPart *psPart = (struct BuildPart *)pvPart;
+    struct Build *psBuild = psPart->psBuild;
+    size_t i;
+    for (i = psPart->uFirstKey; i < psPart->uLastKey; i++) {
+        psBuild->auOrder[psPart->puCounts[Build_part(psBuild,
+            psBuild->auHashes[i] % psBuild->oSymTable->maxbucket)]++] = i;
+    }
+    return NULL;
+}
+
+/* Build_contains takes in a psPart, a psBucket of it and the index
+   uKey of a key, and returns 1 if the key is in psBucket already,
+   otherwise 0. It is SymTable_find without the Filter, which a Build
+   never has, and counts in the SymTableStats of psPart, so that the
+   threads do not share counters. */
+static int Build_contains(struct BuildPart *psPart,
+    const struct Bucket *psBucket, size_t uKey) {
+    const struct Build *psBuild = psPart->psBuild;
+    struct Node *psPrev;
+    size_t uIndex;
+    if (psBucket->pcKey == NULL) {
+        return 0;
+    }
+    STAT_ADD(&psPart->sStats, uProbes, 1);
+    if (psBucket->uHash == psBuild->auHashes[uKey]) {
+        STAT_ADD(&psPart->sStats, uCompares, 1);
+        if (Key_equals(psBucket->pcKey, psBuild->ppcKeys[uKey],
+            psBuild->auLengths[uKey])) {
+            STAT_ADD(&psPart->sStats, uHits, 1);
+            return 1;
+        }
+    }
+    return psBucket->oOverflow != NULL &&
+        LinkedList_search(psBucket->oOverflow, psBuild->ppcKeys[uKey],
+        psBuild->auLengths[uKey], psBuild->auHashes[uKey], &psPrev,
+        &uIndex STATS_ARG(psPart)) != NULL;
+}
+
+/* Build_buckets takes in a BuildPart pvPart and builds its Buckets
+   from the keys handed to it, as SymTable_fromArrays describes: the
+   first key of every bucket goes inline, and the rest get a run of
+   neighbouring Nodes, out of the psNodes of the SymTable from index
+   uStart on. The Nodes of a bucket are filled from the back
+   of its run, so that linking each at the front leaves the linkedlist
+   running forward through memory. A key that is already in its
+   bucket is skipped, so the first of any duplicate keys wins, as with
+   SymTable_put. Returns NULL. */
+static void *Build_buckets(void *pvPart) {
+    struct BuildPart *psPart = (struct BuildPart *)pvPart;
+    struct Build *psBuild = psPart->psBuild;
+    size_t uBuckets = psPart->uLastBucket - psPart->uFirstBucket;
+    size_t uKeys = psPart->uEnd - psPart->uStart;
+    const size_t *auKeys = &psBuild->auOrder[psPart->uStart];
+    size_t *auStarts;
+    size_t *auOrder;
+    struct Bucket *psBucket;
+    struct Node *psNodes = NULL;
+    struct Node *psNode;
+    char *pcKeys = NULL;
+    char *pcKey;
+    size_t uKeyBytes = 0;
+    size_t uStart;
+    size_t uEnd;
+    size_t uKey;
+    size_t i;
+    size_t k;
+    auStarts = (size_t*) calloc(uBuckets + 1, sizeof(size_t));
+    auOrder = (size_t*) malloc((uKeys == 0 ? 1 : uKeys) * sizeof(size_t));
+    if (auStarts == NULL || auOrder == NULL) {
+        psPart->iSuccessful = 0;
+    }
+    if (psPart->iSuccessful) {
+        /* counting sort the keys by bucket. Afterwards the keys of
+          bucket uFirstBucket + b are auOrder[auStarts[b - 1]] up to
+          but not including auOrder[auStarts[b]], in their order in
+          ppcKeys */
+        for (i = 0; i < uKeys; i++) {
+            auStarts[psBuild->auHashes[auKeys[i]] %
+                psBuild->oSymTable->maxbucket - psPart->uFirstBucket + 1]++;
+            uKeyBytes += Key_size(psBuild->auLengths[auKeys[i]] + 1);
+        }
+        for (k = 1; k <= uBuckets; k++) {
+            auStarts[k] += auStarts[k - 1];
+        }
+        for (i = 0; i < uKeys; i++) {
+            auOrder[auStarts[psBuild->auHashes[auKeys[i]] %
+                psBuild->oSymTable->maxbucket - psPart->uFirstBucket]++] =
+                auKeys[i];
+        }
+        psNodes = &psBuild->oSymTable->psNodes[psPart->uStart];
+        pcKeys = (char*) Arena_new(&psPart->psArenas, uKeyBytes);
+        if (pcKeys == NULL) {
+            psPart->iSuccessful = 0;
+        }
+        STAT_ADD(&psPart->sStats, uAllocations, 4);
+    }
+    for (k = 0, uStart = 0; psPart->iSuccessful && k < uBuckets;
+        uStart = auStarts[k], k++) {
+        uEnd = auStarts[k];
+        psBucket = &psBuild->oSymTable->psArray[psPart->uFirstBucket + k];
+        psNode = &psNodes[uEnd];
+        for (i = uStart; psPart->iSuccessful && i < uEnd; i++) {
+            uKey = auOrder[i];
+            if (Build_contains(psPart, psBucket, uKey)) {
+                continue;
+            }
+            pcKey = Key_init(pcKeys, psBuild->ppcKeys[uKey],
+                psBuild->auLengths[uKey] + 1);
+            *Key_refs(pcKey) += KEY_ARENA;
+            pcKeys += Key_size(psBuild->auLengths[uKey] + 1);
+            if (psBucket->pcKey == NULL) {
+                psBucket->uHash = psBuild->auHashes[uKey];
+                psBucket->pcKey = pcKey;
+                psBucket->pvItem = psBuild->ppvValues[uKey];
+            }
+            else {
+                if (psBucket->oOverflow == NULL) {
+                    psBucket->oOverflow = LinkedList_new();
+                    if (psBucket->oOverflow == NULL) {
+                        psPart->iSuccessful = 0;
+                        break;
+                    }
+                }
+                psNode--;
+                psNode->pvKey = pcKey;
+                psNode->pvItem = psBuild->ppvValues[uKey];
+                psNode->uHash = psBuild->auHashes[uKey];
+                LinkedList_link(psBucket->oOverflow, psNode);
+            }
+            psPart->uLength += 1;
+        }
+        if (SymTable_bucketLength(psBucket) > psPart->uLongest) {
+            psPart->uLongest = SymTable_bucketLength(psBucket);
+        }
+    }
+    free(auStarts);
+    free(auOrder);
+    return NULL;
+}
+
+/* Build_run takes in a psBuild and a function pfWork, and calls pfWork
+   on every BuildPart of psBuild, each on a thread of its own where
+   threads are available, and returns once all of them are done. A
+   BuildPart whose thread cannot be started runs on the calling
+   thread instead. */
+static void Build_run(struct Build *psBuild, void *(*pfWork)(void *)) {
+    size_t p;
+#ifdef SYMTABLE_THREADS
+    for (p = 1; p < psBuild->uParts; p++) {
+        psBuild->psParts[p].iStarted = pthread_create(
+            &psBuild->psParts[p].sThread, NULL, pfWork,
+            &psBuild->psParts[p]) == 0;
+    }
+    (*pfWork)(&psBuild->psParts[0]);
+    for (p = 1; p < psBuild->uParts; p++) {
+        if (psBuild->psParts[p].iStarted) {
+            pthread_join(psBuild->psParts[p].sThread, NULL);
+        }
+        else {
+            (*pfWork)(&psBuild->psParts[p]);
+        }
+    }
+#else
+    for (p = 0; p < psBuild->uParts; p++) {
+        (*pfWork)(&psBuild->psParts[p]);
+    }
+#endif
+}
+
+/* SymTable_build takes in the arguments of SymTable_buildParallel and
+   does what it describes, with uParts BuildParts. */
+static SymTable_T SymTable_build(const char *const *ppcKeys,
+    const void *const *ppvValues, size_t uCount, size_t uParts) {
+    SymTable_T oSymTable;
+    struct Bucket* newArray;
+    struct Build sBuild;
+    struct BuildPart *psPart;
+    struct Arena *psLast;
+    size_t *auCounts;
+    size_t uBucketnum = 0;
+    size_t uLongest = 0;
+    size_t uNext;
+    size_t p;
+    size_t q;
+    int iSuccessful = 1;
+    assert(uCount == 0 || ppcKeys != NULL);
+    assert(uCount == 0 || ppvValues != NULL);
+    oSymTable = SymTable_new();
+    if (oSymTable == NULL || uCount == 0) {
+        return oSymTable;
+    }
+    /* size the psArray once, for a load factor below 1 */
+    while (uBucketnum < sizeof(auBucketCounts)/sizeof(auBucketCounts[0]) - 1
+        && auBucketCounts[uBucketnum] <= uCount) {
+        uBucketnum++;
+    }
+    if (uBucketnum != 0) {
+        newArray = Array_new(auBucketCounts[uBucketnum],
+            oSymTable->uFlags, oSymTable->iNode);
+        if (newArray == NULL) {
+            SymTable_free(oSymTable);
+            return NULL;
+        }
+        Array_free(oSymTable->psArray);
+        oSymTable->psArray = newArray;
+        oSymTable->maxbucket = auBucketCounts[uBucketnum];
+        oSymTable->bucketnum = uBucketnum;
+    }
+    /* a BuildPart with few keys would cost more than it saves */
+    if (uParts > BUILD_MAX_PARTS) {
+        uParts = BUILD_MAX_PARTS;
+    }
+    if (uParts > uCount / BUILD_PART_KEYS) {
+        uParts = uCount / BUILD_PART_KEYS;
+    }
+    if (uParts == 0) {
+        uParts = 1;
+    }
+    sBuild.oSymTable = oSymTable;
+    sBuild.ppcKeys = ppcKeys;
+    sBuild.ppvValues = ppvValues;
+    sBuild.uParts = uParts;
+    sBuild.auHashes = (size_t*) malloc(uCount * sizeof(size_t));
+    sBuild.auLengths = (size_t*) malloc(uCount * sizeof(size_t));
+    sBuild.auOrder = (size_t*) malloc(uCount * sizeof(size_t));
+    sBuild.psParts = (struct BuildPart*) calloc(uParts,
+        sizeof(struct BuildPart));
+    auCounts = (size_t*) calloc(uParts * uParts, sizeof(size_t));
+    if (sBuild.auHashes == NULL || sBuild.auLengths == NULL ||
+        sBuild.auOrder == NULL || sBuild.psParts == NULL ||
+        auCounts == NULL) {
+        free(sBuild.auHashes);
+        free(sBuild.auLengths);
+        free(sBuild.auOrder);
+        free(sBuild.psParts);
+        free(auCounts);
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    for (p = 0; p < uParts; p++) {
+        psPart = &sBuild.psParts[p];
+        psPart->psBuild = &sBuild;
+        psPart->uFirstKey = p * uCount / uParts;
+        psPart->uLastKey = (p + 1) * uCount / uParts;
+        psPart->uFirstBucket = (p * oSymTable->maxbucket + uParts - 1) /
+            uParts;
+        psPart->uLastBucket = ((p + 1) * oSymTable->maxbucket + uParts -
+            1) / uParts;
+        psPart->puCounts = &auCounts[p * uParts];
+        psPart->iSuccessful = 1;
+    }
+    Build_run(&sBuild, Build_hash);
+    /* lay the keys out in auOrder by the BuildPart they go to, and
+      within that by the BuildPart that hashed them, which keeps them
+      in their order in ppcKeys */
+    uNext = 0;
+    for (q = 0; q < uParts; q++) {
+        sBuild.psParts[q].uStart = uNext;
+        for (p = 0; p < uParts; p++) {
+            psPart = &sBuild.psParts[p];
+            uNext += psPart->puCounts[q];
+            psPart->puCounts[q] = uNext - psPart->puCounts[q];
+        }
+        sBuild.psParts[q].uEnd = uNext;
+    }
+    Build_run(&sBuild, Build_scatter);
+    /* no key needs more than one Node */
+    oSymTable->psNodes = (struct Node*) Arena_new(&oSymTable->psArenas,
+        uCount * sizeof(struct Node));
+    if (oSymTable->psNodes == NULL) {
+        for (p = 0; p < uParts; p++) {
+            sBuild.psParts[p].iSuccessful = 0;
+        }
+    }
+    else {
+        oSymTable->uNodes = uCount;
+        STAT_ADD(&oSymTable->sStats, uAllocations, 2);
+        Build_run(&sBuild, Build_buckets);
+    }
+    /* hand the Arenas and counts of every BuildPart to the SymTable */
+    for (p = 0; p < uParts; p++) {
+        psPart = &sBuild.psParts[p];
+        if (psPart->psArenas != NULL) {
+            for (psLast = psPart->psArenas; psLast->psNext != NULL;
+                psLast = psLast->psNext) {
+            }
+            psLast->psNext = oSymTable->psArenas;
+            oSymTable->psArenas = psPart->psArenas;
+        }
+        oSymTable->length += psPart->uLength;
+        if (psPart->uLongest > uLongest) {
+            uLongest = psPart->uLongest;
+        }
+        if (! psPart->iSuccessful) {
+            iSuccessful = 0;
+        }
+#ifdef SYMTABLE_STATS
+        oSymTable->sStats.uHashes += psPart->sStats.uHashes;
+        oSymTable->sStats.uProbes += psPart->sStats.uProbes;
+        oSymTable->sStats.uCompares += psPart->sStats.uCompares;
+        oSymTable->sStats.uHits += psPart->sStats.uHits;
+        oSymTable->sStats.uMisses += psPart->sStats.uMisses;
+        oSymTable->sStats.uAllocations += psPart->sStats.uAllocations;
+#endif
+    }
+    free(sBuild.auHashes);
+    free(sBuild.auLengths);
+    free(sBuild.auOrder);
+    free(sBuild.psParts);
+    free(auCounts);
+    if (! iSuccessful) {
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    if (uLongest > FLOOD_LENGTH && uLongest >
+       FLOOD_FACTOR * (oSymTable->length / oSymTable->maxbucket + 1)) {
+        SymTable_reseed(oSymTable);
+    }
+    return oSymTable;
+}
+
+SymTable_T SymTable_fromArrays(const char *const *ppcKeys,
+    const void *const *ppvValues, size_t uCount) {
+    return SymTable_build(ppcKeys, ppvValues, uCount, 1);
+}
+
+SymTable_T SymTable_buildParallel(const char *const *ppcKeys,
+    const void *const *ppvValues, size_t uCount, size_t uThreads) {
+    return SymTable_build(ppcKeys, ppvValues, uCount, uThreads);
+}
+
+
+/* cTombstone is what a key removed from psArray while a Resize copies
+   it is bound to in oYoung, so that its address tells removals from
+   values */
+static const char cTombstone = '\0';
+
+#ifdef SYMTABLE_THREADS
+/* A Resize is the growth of a SYMTABLE_BACKGROUND_RESIZE SymTable to
+   the next size in auBucketCounts, done on a thread of its own. The
+   thread builds a new psArray over the bindings of psOld, which
+   nothing changes until it is done, sharing the keys, and then waits
+   for the SymTable to take it or throw it away. When psOld and its
+   LinkedLists are the SymTable's alone their Nodes move into the new
+   psArray instead of being copied, and since the SymTable still reads
+   them meanwhile, SymTable_install links them. The thread frees
+   whatever is left over, so that the caller never pays for that
+   either. It only reads the SymTable through the Resize, and
+   oSymTable only for what never changes */
+struct Resize
+{
+   /* sThread runs Resize_run */
+   pthread_t sThread;
+   /* sLock guards the waits for iState to change, and sChanged is
+      signalled when it does */
+   pthread_mutex_t sLock;
+   pthread_cond_t sChanged;
+   /* psOld is the psArray being resized, of uOldLen Buckets and
+      uLength bindings, of oSymTable */
+   struct Bucket *psOld;
+   size_t uOldLen;
+   size_t uLength;
+   SymTable_T oSymTable;
+   /* uBucketnum is the index into auBucketCounts of the new size, and
+      uFlags and iNode those of the SymTable, for Array_new */
+   size_t uBucketnum;
+   unsigned int uFlags;
+   int iNode;
+   /* iFilter is 1 if the SymTable has a Filter, so that psNew needs
+      one too */
+   int iFilter;
+   /* psNew and psFilter are the new psArray and its Filter, or NULL if
+      the thread ran out of memory, and uAllocations is how many blocks
+      the thread malloc'd for them */
+   struct Bucket *psNew;
+   struct Filter *psFilter;
+   size_t uAllocations;
+   /* ppsNodes is NULL if the Nodes of psOld are copied, and otherwise
+      holds uLength places for them: from the front the uLinks Nodes
+      that join LinkedLists of psNew, in the order they are to be
+      linked, and from the back the uSpares Nodes whose bindings went
+      inline, for the thread to free */
+   struct Node **ppsNodes;
+   size_t uLinks;
+   size_t uSpares;
+   /* iState is RESIZE_BUILDING until psNew is done, then RESIZE_BUILT,
+      and then RESIZE_INSTALLED or RESIZE_DISCARDED as the SymTable
+      takes psNew or not. It only changes under sLock, but where the
+      compiler allows it is read without it */
+   int iState;
+};
+
+/* Resize_canMove takes in a psResize and returns 1 if no snapshot
+   shares psOld or any of its LinkedLists, so that their Nodes may
+   move, otherwise 0. A snapshot can only let go of them meanwhile. */
+static int Resize_canMove(struct Resize *psResize) {
+    size_t i;
+    if (REF_GET(&Array_header(psResize->psOld)->uRefs) != 1) {
+        return 0;
+    }
+    for (i = 0; i < psResize->uOldLen; i++) {
+        if (psResize->psOld[i].oOverflow != NULL &&
+            REF_GET(&psResize->psOld[i].oOverflow->uRefs) != 1) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Resize_place takes in a psResize, a psArray of the new size, a
+   binding of psOld with hash code uHash, key pcKey and value pvItem,
+   and the psNode of psOld holding it if it is to move, or NULL.
+   Puts the binding in psArray sharing its key: inline if its Bucket
+   is empty, leaving psNode spare, and otherwise in psNode, which is
+   counted into the LinkedList but linked later, or in a new Node.
+   Returns 1 if successful, or 0 if there is no memory. */
+static int Resize_place(struct Resize *psResize, struct Bucket *psArray,
+    size_t uHash, char *pcKey, const void *pvItem, struct Node *psNode) {
+    struct Bucket *psBucket;
+    psBucket = &psArray[uHash % auBucketCounts[psResize->uBucketnum]];
+    if (psResize->psFilter != NULL) {
+        Filter_add(psResize->psFilter, uHash);
+    }
+    if (psBucket->pcKey == NULL) {
+        psBucket->uHash = uHash;
+        psBucket->pcKey = pcKey;
+        psBucket->pvItem = pvItem;
+        Key_retain(psResize->uFlags, pcKey);
+        if (psNode != NULL) {
+            psResize->uSpares += 1;
+            psResize->ppsNodes[psResize->uLength - psResize->uSpares] =
+                psNode;
+        }
+        return 1;
+    }
+    if (psBucket->oOverflow == NULL) {
+        psBucket->oOverflow = LinkedList_new();
+        if (psBucket->oOverflow == NULL) {
+            return 0;
+        }
+        psResize->uAllocations += 1;
+    }
+    if (psNode != NULL) {
+        LinkedList_claim(psBucket->oOverflow, uHash);
+        psResize->ppsNodes[psResize->uLinks] = psNode;
+        psResize->uLinks += 1;
+        return 1;
+    }
+    psNode = (struct Node *) malloc(sizeof(struct Node));
+    if (psNode == NULL) {
+        return 0;
+    }
+    psResize->uAllocations += 1;
+    psNode->uHash = uHash;
+    psNode->pvKey = pcKey;
+    psNode->pvItem = pvItem;
+    Key_retain(psResize->uFlags, pcKey);
+    LinkedList_link(psBucket->oOverflow, psNode);
+    return 1;
+}
+
+/* Resize_build takes in a psResize and puts every binding of psOld
+   into psNew, keeping its hash code, and fills psFilter if the
+   SymTable has a Filter. The inline bindings of psOld go first, so
+   that the Nodes SymTable_install links later go in front of any
+   Nodes made for them. If there is no memory, psNew, psFilter and
+   ppsNodes are left NULL. */
+static void Resize_build(struct Resize *psResize) {
+    size_t newLen = auBucketCounts[psResize->uBucketnum];
+    struct Bucket *newArray;
+    struct Bucket *psBucket;
+    struct Node *psNode;
+    size_t i;
+    int iSuccessful = 1;
+    newArray = Array_new(newLen, psResize->uFlags, psResize->iNode);
+    if (newArray == NULL) {
+        return;
+    }
+    psResize->uAllocations += 1;
+    if (psResize->iFilter) {
+        psResize->psFilter = Filter_new(newLen);
+        iSuccessful = psResize->psFilter != NULL;
+        psResize->uAllocations += 1;
+    }
+    if (iSuccessful && Resize_canMove(psResize)) {
+        psResize->ppsNodes = (struct Node **)
+            malloc(sizeof(struct Node *) * psResize->uLength);
+        iSuccessful = psResize->ppsNodes != NULL;
+        psResize->uAllocations += 1;
+    }
+    for (i = 0; iSuccessful && i < psResize->uOldLen; i++) {
+        psBucket = &psResize->psOld[i];
+        if (psBucket->pcKey == NULL) {
+            continue;
+        }
+        iSuccessful = Resize_place(psResize, newArray, psBucket->uHash,
+            psBucket->pcKey, psBucket->pvItem, NULL);
+        if (psBucket->oOverflow == NULL || psResize->ppsNodes != NULL) {
+            continue;
+        }
+        for (psNode = psBucket->oOverflow->psFirst;
+            iSuccessful && psNode != NULL; psNode = psNode->psNext) {
+            iSuccessful = Resize_place(psResize, newArray, psNode->uHash,
+                psNode->pvKey, psNode->pvItem, NULL);
+        }
+    }
+    for (i = 0; iSuccessful && psResize->ppsNodes != NULL &&
+        i < psResize->uOldLen; i++) {
+        psBucket = &psResize->psOld[i];
+        if (psBucket->pcKey == NULL || psBucket->oOverflow == NULL) {
+            continue;
+        }
+        for (psNode = psBucket->oOverflow->psFirst;
+            iSuccessful && psNode != NULL; psNode = psNode->psNext) {
+            iSuccessful = Resize_place(psResize, newArray, psNode->uHash,
+                psNode->pvKey, psNode->pvItem, psNode);
+        }
+    }
+    if (! iSuccessful) {
+        /* the Nodes still to be linked are psOld's, so releasing
+          newArray leaves them be */
+        SymTable_releaseArray(newArray, newLen, psResize->oSymTable);
+        free(psResize->psFilter);
+        free(psResize->ppsNodes);
+        psResize->psFilter = NULL;
+        psResize->ppsNodes = NULL;
+        return;
+    }
+    psResize->psNew = newArray;
+}
+
+/* Resize_freeOld takes in a psResize whose psNew the SymTable took
+   with the Nodes of psOld, and frees what is left of psOld: the
+   references of its Buckets to their keys, its LinkedLists, whose
+   Nodes moved, the spare Nodes and the array itself. */
+static void Resize_freeOld(struct Resize *psResize) {
+    size_t i;
+    for (i = 0; i < psResize->uOldLen; i++) {
+        if (psResize->psOld[i].pcKey != NULL) {
+            Key_release(psResize->uFlags, psResize->psOld[i].pcKey);
+        }
+        free(psResize->psOld[i].oOverflow);
+    }
+    for (i = psResize->uLength - psResize->uSpares; i < psResize->uLength;
+        i++) {
+        SymTable_freeNode(psResize->oSymTable, psResize->ppsNodes[i]);
+    }
+    Array_free(psResize->psOld);
+}
+
+/* Resize_setState takes in a psResize and an iState, and sets its
+   iState to it, for Resize_state to see without sLock. sLock must be
+   held. */
+static void Resize_setState(struct Resize *psResize, int iState) {
+#if defined(__GNUC__)
+    __atomic_store_n(&psResize->iState, iState, __ATOMIC_RELEASE);
+#else
+    psResize->iState = iState;
+#endif
+    pthread_cond_broadcast(&psResize->sChanged);
+}
+
+/* Resize_run is the thread of a Resize pvResize. */
+static void *Resize_run(void *pvResize) {
+    struct Resize *psResize = (struct Resize *) pvResize;
+    int iState;
+    Resize_build(psResize);
+    pthread_mutex_lock(&psResize->sLock);
+    Resize_setState(psResize, RESIZE_BUILT);
+    while (psResize->iState == RESIZE_BUILT) {
+        pthread_cond_wait(&psResize->sChanged, &psResize->sLock);
+    }
+    iState = psResize->iState;
+    pthread_mutex_unlock(&psResize->sLock);
+    /* the SymTable handed its hold on psOld over with psNew */
+    if (iState == RESIZE_INSTALLED && psResize->ppsNodes != NULL) {
+        Resize_freeOld(psResize);
+    }
+    else if (iState == RESIZE_INSTALLED) {
+        SymTable_releaseArray(psResize->psOld, psResize->uOldLen,
+            psResize->oSymTable);
+    }
+    else if (psResize->psNew != NULL) {
+        SymTable_releaseArray(psResize->psNew,
+            auBucketCounts[psResize->uBucketnum], psResize->oSymTable);
+        free(psResize->psFilter);
+    }
+    free(psResize->ppsNodes);
+    return NULL;
+}
+
+/* Resize_state takes in a psResize and a flag iWait, and returns its
+   iState, once it is no longer RESIZE_BUILDING if iWait is 1. Where
+   the compiler allows it, the iState is read without sLock unless
+   there is a wait, so that polling a Resize on every change costs no
+   lock; its release by Resize_setState makes psNew visible with it. */
+static int Resize_state(struct Resize *psResize, int iWait) {
+    int iState;
+#if defined(__GNUC__)
+    iState = __atomic_load_n(&psResize->iState, __ATOMIC_ACQUIRE);
+    if (! iWait || iState != RESIZE_BUILDING) {
+        return iState;
+    }
+#endif
+    pthread_mutex_lock(&psResize->sLock);
+    while (iWait && psResize->iState == RESIZE_BUILDING) {
+        pthread_cond_wait(&psResize->sChanged, &psResize->sLock);
+    }
+    iState = psResize->iState;
+    pthread_mutex_unlock(&psResize->sLock);
+    return iState;
+}
+
+/* Resize_decide takes in a psResize whose psNew is built and iState,
+   which is RESIZE_INSTALLED or RESIZE_DISCARDED, and tells the thread
+   what became of psNew. */
+static void Resize_decide(struct Resize *psResize, int iState) {
+    pthread_mutex_lock(&psResize->sLock);
+    Resize_setState(psResize, iState);
+    pthread_mutex_unlock(&psResize->sLock);
+}
+
+/* Resize_finish takes in a psResize, throws psNew away unless the
+   SymTable took it, waits for its thread to end and frees it. */
+static void Resize_finish(struct Resize *psResize) {
+    if (Resize_state(psResize, 1) == RESIZE_BUILT) {
+        Resize_decide(psResize, RESIZE_DISCARDED);
+    }
+    pthread_join(psResize->sThread, NULL);
+    pthread_cond_destroy(&psResize->sChanged);
+    pthread_mutex_destroy(&psResize->sLock);
+    free(psResize);
+}
+
+/* Resize_start takes in a full oSymTable and starts a Resize of it,
+   after which its changes go to a new oYoung. oYoung hashes as the
+   oSymTable does, so that its bindings keep their hash codes when
+   SymTable_settle folds them in. Returns 1 if successful, or 0 if
+   there is no memory or no thread for it. */
+static int Resize_start(SymTable_T oSymTable) {
+    struct Resize *psResize;
+    SymTable_T oYoung;
+    if (oSymTable->psResize != NULL) {
+        Resize_finish(oSymTable->psResize);
+        oSymTable->psResize = NULL;
+    }
+    oYoung = SymTable_newWithFlags(oSymTable->uFlags & SYMTABLE_HARDENED);
+    if (oYoung == NULL) {
+        return 0;
+    }
+    oYoung->iKeyed = oSymTable->iKeyed;
+    oYoung->auSeed[0] = oSymTable->auSeed[0];
+    oYoung->auSeed[1] = oSymTable->auSeed[1];
+    psResize = (struct Resize *) malloc(sizeof(struct Resize));
+    if (psResize == NULL) {
+        SymTable_free(oYoung);
+        return 0;
+    }
+    psResize->psOld = oSymTable->psArray;
+    psResize->uOldLen = oSymTable->maxbucket;
+    psResize->uLength = oSymTable->length;
+    psResize->oSymTable = oSymTable;
+    psResize->uBucketnum = oSymTable->bucketnum + 1;
+    psResize->uFlags = oSymTable->uFlags;
+    psResize->iNode = oSymTable->iNode;
+    psResize->iFilter = oSymTable->psFilter != NULL;
+    psResize->psNew = NULL;
+    psResize->psFilter = NULL;
+    psResize->uAllocations = 0;
+    psResize->ppsNodes = NULL;
+    psResize->uLinks = 0;
+    psResize->uSpares = 0;
+    psResize->iState = RESIZE_BUILDING;
+    if (pthread_mutex_init(&psResize->sLock, NULL) != 0) {
+        free(psResize);
+        SymTable_free(oYoung);
+        return 0;
+    }
+    if (pthread_cond_init(&psResize->sChanged, NULL) != 0) {
+        pthread_mutex_destroy(&psResize->sLock);
+        free(psResize);
+        SymTable_free(oYoung);
+        return 0;
+    }
+    if (pthread_create(&psResize->sThread, NULL, Resize_run,
+        psResize) != 0) {
+        pthread_cond_destroy(&psResize->sChanged);
+        pthread_mutex_destroy(&psResize->sLock);
+        free(psResize);
+        SymTable_free(oYoung);
+        return 0;
+    }
+    STAT_ADD(&oSymTable->sStats, uAllocations, 1);
+    oSymTable->psResize = psResize;
+    oSymTable->oYoung = oYoung;
+    oSymTable->uBaseLength = oSymTable->length;
+    return 1;
+}
+
+/* SymTable_install takes in a oSymTable whose Resize is built, and
+   switches it over to psNew, linking the Nodes that moved into its
+   LinkedLists now that psOld is no longer read, or if the thread ran
+   out of memory, keeps psArray and ends the Resize. */
+static void SymTable_install(SymTable_T oSymTable) {
+    struct Resize *psResize = oSymTable->psResize;
+    size_t newLen = auBucketCounts[psResize->uBucketnum];
+    LinkedList_T oLinkedList;
+    struct Node *psNode;
+    size_t i;
+    if (psResize->psNew == NULL) {
+        Resize_finish(psResize);
+        oSymTable->psResize = NULL;
+        return;
+    }
+    for (i = 0; i < psResize->uLinks; i++) {
+        psNode = psResize->ppsNodes[i];
+        oLinkedList = psResize->psNew[psNode->uHash % newLen].oOverflow;
+        psNode->psNext = oLinkedList->psFirst;
+        oLinkedList->psFirst = psNode;
+    }
+    oSymTable->psArray = psResize->psNew;
+    oSymTable->maxbucket = newLen;
+    oSymTable->bucketnum = psResize->uBucketnum;
+    if (psResize->psFilter != NULL) {
+        free(oSymTable->psFilter);
+        oSymTable->psFilter = psResize->psFilter;
+    }
+    STAT_ADD(&oSymTable->sStats, uAllocations, psResize->uAllocations);
+    STAT_ADD(&oSymTable->sStats, uResizes, 1);
+    Resize_decide(psResize, RESIZE_INSTALLED);
+}
+#endif
+
+/* SymTable_grow takes in a oSymTable that is full and moves it to the
+   next size in auBucketCounts: on a thread of its own if it is a
+   SYMTABLE_BACKGROUND_RESIZE SymTable that can be, otherwise at once
+   with SymTable_expand. */
+static void SymTable_grow(SymTable_T oSymTable) {
+#ifdef SYMTABLE_THREADS
+    if ((oSymTable->uFlags & SYMTABLE_BACKGROUND_RESIZE) &&
+        oSymTable->psClock == NULL &&
+        ! (oSymTable->uFlags & SYMTABLE_BORROW_KEYS) &&
+        Resize_start(oSymTable)) {
+        return;
+    }
+#endif
+    SymTable_expand(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+   return oSymTable->length;
+}
+
+unsigned int SymTable_getFlags(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+   return oSymTable->uFlags;
+}
+
+/* SymTable_putKey takes in a oSymTable, a pcKey of uLength characters
+   and a pvValue, hashes the pcKey and puts the binding pair into the
+   oSymTable, inline if its Bucket is empty. If the SymTable length is
+   at least maxbucket, it resizes. Returns 1 if successful, otherwise
+   0. */
+static int SymTable_putKey(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue) {
+    size_t uHash;
+    size_t hashval;
+    struct Bucket *psBucket;
+    char *copyKey;
+    if (oSymTable->uDead != 0) {
+       SymTable_reclaim(oSymTable, RECLAIM_STEP);
+    }
+    /* this portion hashes the string pcKey based on max bucket and
+      puts the binding pair into its Bucket */
+    uHash = SymTable_hash(oSymTable, pcKey, uLength);
+    STAT_ADD(&oSymTable->sStats, uHashes, 1);
+    hashval = uHash % oSymTable->maxbucket;
+    if (! SymTable_ownBucket(oSymTable, hashval)) {
+       return 0;
+    }
+    if (SymTable_find(oSymTable, hashval, pcKey, uLength, uHash, 0)
+       != NULL) {
+       return 0;
+    }
+    /* a full bounded SymTable evicts before it takes the binding, so
+      that it never holds more than its capacity */
+    if (! SymTable_makeRoom(oSymTable)) {
+       return 0;
+    }
+    psBucket = &oSymTable->psArray[hashval];
+    if (psBucket->pcKey == NULL) {
+       copyKey = Key_new(oSymTable->uFlags, pcKey, uLength, &pvValue,
+          oSymTable->uValueSize);
+       if (copyKey == NULL) {
+          return 0;
+       }
+       STAT_ADD(&oSymTable->sStats, uAllocations, copyKey != pcKey);
+       psBucket->uHash = uHash;
+       psBucket->pcKey = copyKey;
+       psBucket->pvItem = pvValue;
+       SymTable_admit(oSymTable, hashval, &psBucket->pvItem, uHash);
+    }
+    else {
+       if (psBucket->oOverflow == NULL) {
+          psBucket->oOverflow = LinkedList_new();
+          if (psBucket->oOverflow == NULL) {
+             return 0;
+          }
+          STAT_ADD(&oSymTable->sStats, uAllocations, 1);
+       }
+       if (! LinkedList_put(psBucket->oOverflow, pcKey, uLength, uHash,
+          pvValue, oSymTable->uValueSize, oSymTable->uFlags
+          STATS_ARG(oSymTable))) {
+          return 0;
+       }
+       SymTable_admit(oSymTable, hashval,
+          &psBucket->oOverflow->psFirst->pvItem, uHash);
+    }
+    oSymTable->length += 1;
+    if (oSymTable->psFilter != NULL) {
+       Filter_add(oSymTable->psFilter, uHash);
+    }
+    /* a bucket far longer than the average means colliding keys, so
+      switch to a keyed hash with a new seed and spread them out */
+    if (SymTable_bucketLength(psBucket) > FLOOD_LENGTH &&
+       SymTable_bucketLength(psBucket) >
+       FLOOD_FACTOR * (oSymTable->length / oSymTable->maxbucket + 1)) {
+        SymTable_reseed(oSymTable);
+    }
+    /* this if statement contains the resizing of the oSymTable if the
+      SymTable length is at least the maxbucket length */
+   if (SYMTABLE_SHOULD_EXPAND(oSymTable->length, oSymTable->maxbucket,
+         oSymTable->bucketnum,
+         sizeof(auBucketCounts)/sizeof(auBucketCounts[0]))) {
+        SymTable_grow(oSymTable);
+    }
+    return 1;
     }
 
+/* SymTable_findKey takes in a oSymTable and a pcKey of uLength
+   characters, and returns a pointer to the value bound to pcKey in
+   psArray, or NULL if there is none. It reorders nothing, so it may
+   look in a psArray that a Resize is copying. */
+static const void **SymTable_findKey(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength) {
+    size_t uHash;
+    uHash = SymTable_hash(oSymTable, pcKey, uLength);
+    STAT_ADD(&oSymTable->sStats, uHashes, 1);
+    return SymTable_find(oSymTable, uHash % oSymTable->maxbucket, pcKey,
+        uLength, uHash, 0);
+}
 
-SymTable_T SymTable_new(void) {
-   SymTable_T oSymTable = (SymTable_T) malloc(sizeof(struct SymTable));
-   if (oSymTable == NULL) {
-      return NULL;
-   }
-   oSymTable->length = 0;
-   oSymTable->maxbucket = auBucketCounts[0];
-   oSymTable->psArray = (LinkedList_T*) calloc(sizeof(LinkedList_T),
-        (oSymTable->maxbucket)); 
-   oSymTable->bucketnum = 0;
-   return oSymTable;
+/* SymTable_sameHash takes in two SymTables oSymTable and oOther, and
+   returns 1 if they give every key the same hash code, otherwise 0. */
+static int SymTable_sameHash(SymTable_T oSymTable, SymTable_T oOther) {
+    if (oSymTable->iKeyed != oOther->iKeyed) {
+        return 0;
+    }
+    return ! oSymTable->iKeyed ||
+        (oSymTable->auSeed[0] == oOther->auSeed[0] &&
+        oSymTable->auSeed[1] == oOther->auSeed[1]);
 }
 
+/* SymTable_mergeSlot takes in a oDst and a pcKey with hash code uHash
+   in oDst, gets the Bucket of oDst where pcKey belongs ready to
+   change, and stores its index in *puHashval. Stores a pointer to the
+   value bound to pcKey in *pppvItem, or NULL if oDst lacks pcKey, in
+   which case the Bucket gets a LinkedList if its inline binding is
+   taken. Returns 1 if successful, or 0 if there is no memory. */
+static int SymTable_mergeSlot(SymTable_T oDst, const char *pcKey,
+    size_t uHash, size_t *puHashval, const void ***pppvItem) {
+    struct Bucket *psBucket;
+    size_t hashval = uHash % oDst->maxbucket;
+    if (! SymTable_ownBucket(oDst, hashval)) {
+        return 0;
+    }
+    *puHashval = hashval;
+    *pppvItem = SymTable_find(oDst, hashval, pcKey, strlen(pcKey), uHash,
+        0);
+    psBucket = &oDst->psArray[hashval];
+    if (*pppvItem == NULL && psBucket->pcKey != NULL &&
+        psBucket->oOverflow == NULL) {
+        psBucket->oOverflow = LinkedList_new();
+        if (psBucket->oOverflow == NULL) {
+            return 0;
+        }
+        STAT_ADD(&oDst->sStats, uAllocations, 1);
+    }
+    return 1;
+}
 
-size_t SymTable_getLength(SymTable_T oSymTable) {
-   return oSymTable->length;
+/* SymTable_mergeLink takes in a oDst, the index hashval of a Bucket
+   made ready by SymTable_mergeSlot, a binding oDst lacks with hash
+   code uHash, key pcKey and value pvItem, and a psNode to hold it or
+   NULL. SymTable_makeRoom must have made room for the binding. Puts
+   the binding inline if the Bucket is empty, freeing psNode, or
+   otherwise at the front of its LinkedList, in psNode or in a new
+   Node. Returns 1 if successful, or 0 if there is no memory, in which
+   case oDst does not change. */
+static int SymTable_mergeLink(SymTable_T oDst, size_t hashval,
+    size_t uHash, char *pcKey, const void *pvItem, struct Node *psNode) {
+    struct Bucket *psBucket = &oDst->psArray[hashval];
+    if (psBucket->pcKey == NULL) {
+        psBucket->uHash = uHash;
+        psBucket->pcKey = pcKey;
+        psBucket->pvItem = pvItem;
+        SymTable_admit(oDst, hashval, &psBucket->pvItem, uHash);
+        if (psNode != NULL) {
+            Node_free(oDst->uFlags, psNode);
+        }
+    }
+    else {
+        if (psNode == NULL) {
+            psNode = Node_new(oDst->uFlags);
+            if (psNode == NULL) {
+                return 0;
+            }
+            STAT_ADD(&oDst->sStats, uAllocations, 1);
+        }
+        psNode->uHash = uHash;
+        psNode->pvKey = pcKey;
+        psNode->pvItem = pvItem;
+        LinkedList_link(psBucket->oOverflow, psNode);
+        SymTable_admit(oDst, hashval, &psNode->pvItem, uHash);
+    }
+    oDst->length += 1;
+    if (oDst->psFilter != NULL) {
+        Filter_add(oDst->psFilter, uHash);
+    }
+    return 1;
+}
+
+/* SymTable_mergeCopy works like SymTable_mergeLink with no psNode,
+   but puts a copy of pcKey into oDst, made in the Arenas of oDst. */
+static int SymTable_mergeCopy(SymTable_T oDst, size_t hashval,
+    size_t uHash, const char *pcKey, const void *pvItem) {
+    char *pcCopy;
+    pcCopy = Key_new(oDst->uFlags, pcKey, strlen(pcKey), &pvItem,
+        oDst->uValueSize);
+    if (pcCopy == NULL) {
+        return 0;
+    }
+    STAT_ADD(&oDst->sStats, uAllocations, 1);
+    if (! SymTable_mergeLink(oDst, hashval, uHash, pcCopy, pvItem,
+        NULL)) {
+        Key_release(oDst->uFlags, pcCopy);
+        return 0;
+    }
+    return 1;
+}
+
+/* SymTable_mergeReplace takes in a oDst, the index hashval of a
+   Bucket made ready by SymTable_mergeSlot, a pointer ppvDst to a
+   value in it, and a pointer ppvSrc to the value of the same key in
+   a Bucket of another SymTable that no snapshot shares. The two
+   values trade places, or with SymTable_newSized the value at ppvSrc
+   is copied over the one at ppvDst. Returns 1 if successful, or 0 if
+   there is no memory. */
+static int SymTable_mergeReplace(SymTable_T oDst, size_t hashval,
+    const void **ppvDst, const void **ppvSrc) {
+    const void *pvOld;
+    SymTable_touch(oDst, hashval, ppvDst);
+    if (oDst->uValueSize != 0) {
+        return SymTable_replaceValue(oDst, hashval, ppvDst, *ppvSrc)
+            != NULL;
+    }
+    pvOld = *ppvDst;
+    *ppvDst = *ppvSrc;
+    *ppvSrc = pvOld;
+    return 1;
+}
+
+/* SymTable_removeFound takes in a oSymTable, the index hashval of a
+   Bucket made ready by SymTable_mergeSlot and a pointer ppvItem to a
+   value in it, and removes the binding of that value. */
+static void SymTable_removeFound(SymTable_T oSymTable, size_t hashval,
+    const void **ppvItem) {
+    struct Bucket *psBucket = &oSymTable->psArray[hashval];
+    struct Node *psPrev = NULL;
+    struct Node *psCurr;
+    size_t i = 0;
+    assert(oSymTable->psClock == NULL);
+    if (ppvItem == &psBucket->pvItem) {
+        SymTable_removeInline(oSymTable, hashval);
+        return;
+    }
+    for (psCurr = psBucket->oOverflow->psFirst;
+        &psCurr->pvItem != ppvItem; psCurr = psCurr->psNext) {
+        psPrev = psCurr;
+        i++;
+    }
+    LinkedList_unlink(psBucket->oOverflow, psCurr, psPrev, i);
+    if (oSymTable->psFilter != NULL) {
+        Filter_drop(oSymTable->psFilter, psCurr->uHash);
+    }
+    SymTable_discard(oSymTable, psCurr);
+    oSymTable->length -= 1;
+}
+
+/* SymTable_foldOne takes in a oSymTable being settled, the index
+   hashval of a Bucket made ready by SymTable_mergeSlot, a pointer
+   ppvItem to the value of a key in it, and a pointer ppvYoung to the
+   value of the same key in oYoung. Removes the binding if ppvYoung
+   points to &cTombstone, and otherwise gives it the value of oYoung.
+   Returns 1 if successful, or 0 if there is no memory. */
+static int SymTable_foldOne(SymTable_T oSymTable, size_t hashval,
+    const void **ppvItem, const void **ppvYoung) {
+    if (*ppvYoung == &cTombstone) {
+        SymTable_removeFound(oSymTable, hashval, ppvItem);
+        return 1;
+    }
+    return SymTable_mergeReplace(oSymTable, hashval, ppvItem, ppvYoung);
+}
+
+/* SymTable_foldBucket takes in a oSymTable being settled, its oYoung,
+   the index hashval of a Bucket of oYoung with bindings, and iSameHash
+   as for SymTable_mergeBucket. Makes the changes the bindings of the
+   Bucket stand for in oSymTable, each probing it once, and takes them
+   out of oYoung, the LinkedList first. The Nodes and keys of new
+   bindings move as they are, unless oSymTable keeps its values with
+   its keys. Returns 1 if successful, or 0 if there is no memory, in
+   which case the bindings not applied yet stay in oYoung. */
+static int SymTable_foldBucket(SymTable_T oSymTable, SymTable_T oYoung,
+    size_t hashval, int iSameHash) {
+    struct Bucket *psBucket = &oYoung->psArray[hashval];
+    struct Node *psCurr;
+    const void **ppvItem;
+    size_t uDstval;
+    size_t uHash;
+    int iSteal = oSymTable->uValueSize == 0;
+    while (psBucket->oOverflow != NULL &&
+        psBucket->oOverflow->psFirst != NULL) {
+        psCurr = psBucket->oOverflow->psFirst;
+        uHash = iSameHash ? psCurr->uHash :
+            SymTable_hash(oSymTable, psCurr->pvKey, strlen(psCurr->pvKey));
+        if (! SymTable_mergeSlot(oSymTable, psCurr->pvKey, uHash, &uDstval,
+            &ppvItem)) {
+            return 0;
+        }
+        if (ppvItem != NULL) {
+            if (! SymTable_foldOne(oSymTable, uDstval, ppvItem,
+                &psCurr->pvItem)) {
+                return 0;
+            }
+        }
+        else if (! iSteal && ! SymTable_mergeCopy(oSymTable, uDstval,
+            uHash, psCurr->pvKey, psCurr->pvItem)) {
+            return 0;
+        }
+        LinkedList_unlink(psBucket->oOverflow, psCurr, NULL, 0);
+        oYoung->length -= 1;
+        if (ppvItem == NULL && iSteal) {
+            SymTable_mergeLink(oSymTable, uDstval, uHash, psCurr->pvKey,
+                psCurr->pvItem, psCurr);
+        }
+        else {
+            SymTable_discard(oYoung, psCurr);
+        }
+    }
+    uHash = iSameHash ? psBucket->uHash :
+        SymTable_hash(oSymTable, psBucket->pcKey, strlen(psBucket->pcKey));
+    if (! SymTable_mergeSlot(oSymTable, psBucket->pcKey, uHash, &uDstval,
+        &ppvItem)) {
+        return 0;
+    }
+    if (ppvItem != NULL) {
+        if (! SymTable_foldOne(oSymTable, uDstval, ppvItem,
+            &psBucket->pvItem)) {
+            return 0;
+        }
+    }
+    else if (iSteal) {
+        if (! SymTable_mergeLink(oSymTable, uDstval, uHash,
+            psBucket->pcKey, psBucket->pvItem, NULL)) {
+            return 0;
+        }
+        /* oSymTable holds the key now, so the reference oYoung drops
+          on removing the binding must not be the last */
+        Key_retain(oYoung->uFlags, psBucket->pcKey);
+    }
+    else if (! SymTable_mergeCopy(oSymTable, uDstval, uHash,
+        psBucket->pcKey, psBucket->pvItem)) {
+        return 0;
+    }
+    SymTable_removeInline(oYoung, hashval);
+    return 1;
+}
+
+/* SymTable_settle takes in a oSymTable and a flag iWait. Once the
+   Resize of the oSymTable is built, waiting for it if iWait is 1, it
+   switches the oSymTable over to the new psArray and folds the
+   changes in oYoung into it with SymTable_foldBucket. Returns 1 if no
+   changes are left aside, or 0 if the Resize is still being built or
+   there was no memory to apply them all, in which case the rest stay
+   in oYoung. */
+static int SymTable_settle(SymTable_T oSymTable, int iWait) {
+    SymTable_T oYoung = oSymTable->oYoung;
+    size_t uLength;
+    size_t i;
+    int iSameHash;
+    int iSuccessful = 1;
+    if (oYoung == NULL) {
+        return 1;
+    }
+#ifdef SYMTABLE_THREADS
+    if (oSymTable->psResize != NULL) {
+        switch (Resize_state(oSymTable->psResize, iWait)) {
+        case RESIZE_BUILDING:
+            return 0;
+        case RESIZE_BUILT:
+            SymTable_install(oSymTable);
+            break;
+        default:
+            break;
+        }
+    }
+#endif
+    uLength = oSymTable->length;
+    oSymTable->length = oSymTable->uBaseLength;
+    oSymTable->oYoung = NULL;
+    iSameHash = SymTable_sameHash(oSymTable, oYoung);
+    for (i = 0; iSuccessful && i < oYoung->maxbucket; i++) {
+        if (oYoung->psArray[i].pcKey != NULL) {
+            iSuccessful = SymTable_foldBucket(oSymTable, oYoung, i,
+                iSameHash);
+        }
+    }
+    if (! iSuccessful) {
+        oSymTable->uBaseLength = oSymTable->length;
+        oSymTable->length = uLength;
+        oSymTable->oYoung = oYoung;
+        return 0;
+    }
+    SymTable_free(oYoung);
+    assert(oSymTable->length == uLength);
+    /* puts kept aside may have filled the new psArray already, and
+      growing it again starts another Resize to settle */
+    if (oSymTable->length >= oSymTable->maxbucket &&
+        oSymTable->bucketnum <
+        sizeof(auBucketCounts)/sizeof(auBucketCounts[0]) - 1) {
+        SymTable_grow(oSymTable);
+        return SymTable_settle(oSymTable, iWait);
+    }
+    return 1;
+}
+
+/* SymTable_lookupYoung takes in a oSymTable with an oYoung and a pcKey
+   of uLength characters, and returns a pointer to the value bound to
+   pcKey, in oYoung if it is there and in psArray otherwise, or NULL
+   if pcKey is not in the oSymTable. */
+static const void **SymTable_lookupYoung(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength) {
+    const void **ppvItem;
+    ppvItem = SymTable_findKey(oSymTable->oYoung, pcKey, uLength);
+    if (ppvItem != NULL) {
+        return *ppvItem == &cTombstone ? NULL : ppvItem;
+    }
+    return SymTable_findKey(oSymTable, pcKey, uLength);
+}
+
+/* SymTable_putYoung takes in a oSymTable with an oYoung, a pcKey of
+   uLength characters and a pvValue, and puts the binding into oYoung
+   if pcKey is not in the oSymTable. Returns 1 if successful, otherwise
+   0. */
+static int SymTable_putYoung(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue) {
+    const void **ppvItem;
+    ppvItem = SymTable_findKey(oSymTable->oYoung, pcKey, uLength);
+    if (ppvItem != NULL) {
+        if (*ppvItem != &cTombstone) {
+            return 0;
+        }
+        *ppvItem = pvValue;
+    }
+    else if (SymTable_findKey(oSymTable, pcKey, uLength) != NULL ||
+        ! SymTable_putKey(oSymTable->oYoung, pcKey, uLength, pvValue)) {
+        return 0;
+    }
+    oSymTable->length += 1;
+    return 1;
+}
+
+/* SymTable_replaceYoung takes in a oSymTable with an oYoung, a pcKey
+   and a pvValue, and binds pcKey to pvValue in oYoung if pcKey is in
+   the oSymTable. Returns the value pcKey was bound to, or NULL if it
+   is not in the oSymTable or there is no memory. */
+static void *SymTable_replaceYoung(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+    size_t uLength = strlen(pcKey);
+    const void **ppvItem;
+    const void *pvOld;
+    ppvItem = SymTable_findKey(oSymTable->oYoung, pcKey, uLength);
+    if (ppvItem != NULL) {
+        if (*ppvItem == &cTombstone) {
+            return NULL;
+        }
+        pvOld = *ppvItem;
+        *ppvItem = pvValue;
+        return (void *) pvOld;
+    }
+    ppvItem = SymTable_findKey(oSymTable, pcKey, uLength);
+    if (ppvItem == NULL ||
+        ! SymTable_putKey(oSymTable->oYoung, pcKey, uLength, pvValue)) {
+        return NULL;
+    }
+    return (void *) *ppvItem;
+}
+
+/* SymTable_removeYoung takes in a oSymTable with an oYoung and a pcKey
+   of uLength characters, and removes the binding of pcKey: from
+   oYoung if only oYoung has it, and otherwise by binding it to
+   &cTombstone in oYoung. Returns the value pcKey was bound to, or
+   NULL if it is not in the oSymTable or there is no memory. */
+static void *SymTable_removeYoung(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength) {
+    const void **ppvYoung;
+    const void **ppvItem;
+    const void *output;
+    ppvYoung = SymTable_findKey(oSymTable->oYoung, pcKey, uLength);
+    ppvItem = SymTable_findKey(oSymTable, pcKey, uLength);
+    if (ppvYoung != NULL) {
+        if (*ppvYoung == &cTombstone) {
+            return NULL;
+        }
+        output = *ppvYoung;
+        if (ppvItem != NULL) {
+            *ppvYoung = &cTombstone;
+        }
+        else {
+            SymTable_removeN(oSymTable->oYoung, pcKey, uLength);
+        }
+    }
+    else {
+        if (ppvItem == NULL || ! SymTable_putKey(oSymTable->oYoung,
+            pcKey, uLength, &cTombstone)) {
+            return NULL;
+        }
+        output = *ppvItem;
+    }
+    oSymTable->length -= 1;
+    return (void *) output;
 }
 
-/* SymTable_put hashes the pcKey and puts the binding pair into
-   the oSymTable. If the SymTable length is equal to maxbucket, it
-   resizes. */
 int SymTable_put(SymTable_T oSymTable, const char *pcKey, 
     const void *pvValue) {
-    size_t hashval;
-    int output;
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
-    /* this portion hashes the string pcKey based on max bucket and
-      puts the binding pair into the oSymTable using LinkedList */
-    hashval = SymTable_hash(pcKey, oSymTable->maxbucket);
-    if (oSymTable->psArray[hashval] == NULL) {
-       oSymTable->psArray[hashval] = LinkedList_new();
+    assert(! oSymTable->iReadOnly);
+    SymTable_settle(oSymTable, 0);
+    if (oSymTable->oYoung != NULL) {
+       return SymTable_putYoung(oSymTable, pcKey, strlen(pcKey), pvValue);
     }
-    output = LinkedList_put(oSymTable->psArray[hashval], pcKey, pvValue);
-    if (output) {
-        oSymTable->length += 1;
+    return SymTable_putKey(oSymTable, pcKey, strlen(pcKey), pvValue);
     }
-    /* this if statement contains the resizing of the oSymTable if the
-      SymTable length is equal to the maxbucket length */
-   if (oSymTable->length == oSymTable->maxbucket && oSymTable->length == 
-      auBucketCounts[oSymTable->bucketnum] && oSymTable->bucketnum < 
-         sizeof(auBucketCounts)/sizeof(auBucketCounts[0]) - 1) {
-        LinkedList_T* oldArray = oSymTable->psArray;
-        size_t bucketLen;
-        size_t i = 0;
-        struct Node* head;
-        bucketLen = oSymTable->maxbucket;
-        oSymTable->bucketnum += 1;
-        oSymTable->maxbucket = auBucketCounts[oSymTable->bucketnum];
-        oSymTable->psArray = (LinkedList_T*) calloc(sizeof(LinkedList_T),
-        (oSymTable->maxbucket));
-        oSymTable->length = 0;
-        /* puts all the old bindings in the new Symtable */
-        while(i < bucketLen) {
-            head = NULL;
-            if (oldArray[i] != NULL) {
-            head = oldArray[i]->psFirst;
-            }
-            while (head != NULL) {
-                SymTable_put(oSymTable, head->pvKey, head->pvItem);
-                head = head->psNext;
-            }
-            if (oldArray[i] != NULL) {
-            LinkedList_free(oldArray[i]);
-            }
-            i++;
-        }
-        /* frees all the old linkedlist */
-        free(oldArray);
+
+int SymTable_putN(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL || uLength == 0);
+    assert(uLength == 0 || memchr(pcKey, '\0', uLength) == NULL);
+    assert(! oSymTable->iReadOnly);
+    SymTable_settle(oSymTable, 0);
+    if (oSymTable->oYoung != NULL) {
+       return SymTable_putYoung(oSymTable, pcKey == NULL ? "" : pcKey,
+          uLength, pvValue);
     }
-    return output;
+    return SymTable_putKey(oSymTable, pcKey == NULL ? "" : pcKey, uLength,
+       pvValue);
+    }
+
+/* SymTable_lookup takes in a oSymTable and a pcKey of uLength
+   characters, and returns a pointer to the value bound to pcKey, or
+   NULL if pcKey is not in the oSymTable. It also stores the bucket
+   index of pcKey in *puHashval, unless the oSymTable has changes kept
+   in oYoung. */
+static const void **SymTable_lookup(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, size_t *puHashval) {
+    size_t uHash;
+    size_t hashval;
+    const void **ppvItem;
+    SymTable_settle(oSymTable, 0);
+    if (oSymTable->oYoung != NULL) {
+       return SymTable_lookupYoung(oSymTable, pcKey, uLength);
+    }
+    uHash = SymTable_hash(oSymTable, pcKey, uLength);
+    STAT_ADD(&oSymTable->sStats, uHashes, 1);
+    hashval = uHash % oSymTable->maxbucket;
+    ppvItem = SymTable_find(oSymTable, hashval, pcKey, uLength, uHash,
+       SymTable_findFlags(oSymTable, hashval));
+    if (ppvItem == NULL) {
+       return NULL;
+    }
+    SymTable_touch(oSymTable, hashval, ppvItem);
+    *puHashval = hashval;
+    return ppvItem;
     }
 
 int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
     size_t hashval;
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
-    hashval = SymTable_hash(pcKey, oSymTable->maxbucket);
-    if (oSymTable->psArray[hashval] == NULL) {
-       return 0;
-    }
-    return LinkedList_contains(oSymTable->psArray[hashval], pcKey);
+    return SymTable_lookup(oSymTable, pcKey, strlen(pcKey), &hashval)
+       != NULL;
     }
 
 void* SymTable_get(SymTable_T oSymTable, const char *pcKey) {
     size_t hashval;
+    const void **ppvItem;
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
-    hashval = SymTable_hash(pcKey, oSymTable->maxbucket);
-    if (oSymTable->psArray[hashval] == NULL) {
+    ppvItem = SymTable_lookup(oSymTable, pcKey, strlen(pcKey), &hashval);
+    if (ppvItem == NULL) {
        return NULL;
     }
-    return LinkedList_get(oSymTable->psArray[hashval], pcKey);
+    return (void *) *ppvItem;
+    }
+
+/* A cursor at the inline binding of the Bucket at hashval has uIndex
+   hashval + 1 and a NULL pvPlace, and one at a Node of its LinkedList
+   has that Node as pvPlace. One past the last binding has uIndex
+   maxbucket + 1. */
+int SymTable_lookupN(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, struct SymTableCursor *psCursor) {
+    size_t hashval;
+    const void **ppvItem;
+    struct Node *psNode;
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL || uLength == 0);
+    assert(uLength == 0 || memchr(pcKey, '\0', uLength) == NULL);
+    assert(psCursor != NULL);
+    if (! SymTable_settle(oSymTable, 1)) {
+       return 0;
+    }
+    ppvItem = SymTable_lookup(oSymTable, pcKey == NULL ? "" : pcKey,
+       uLength, &hashval);
+    if (ppvItem == NULL) {
+       return 0;
+    }
+    psCursor->uIndex = hashval + 1;
+    if (ppvItem == &oSymTable->psArray[hashval].pvItem) {
+       psCursor->pvPlace = NULL;
+       psCursor->pcKey = oSymTable->psArray[hashval].pcKey;
+    }
+    else {
+       psNode = (struct Node *)(void *)
+          ((char *)ppvItem - offsetof(struct Node, pvItem));
+       psCursor->pvPlace = psNode;
+       psCursor->pcKey = psNode->pvKey;
+    }
+    psCursor->pvValue = (void *) *ppvItem;
+    return 1;
+    }
+
+int SymTable_next(SymTable_T oSymTable, struct SymTableCursor *psCursor) {
+    const struct Node *psNode = NULL;
+    struct Bucket *psBucket;
+    size_t hashval;
+    assert(oSymTable != NULL);
+    assert(psCursor != NULL);
+    if (! SymTable_settle(oSymTable, 1)) {
+       return 0;
+    }
+    hashval = psCursor->uIndex;
+    if (hashval > oSymTable->maxbucket) {
+       return 0;
+    }
+    /* step to the Node after the current binding in its Bucket, if
+      there is one */
+    if (hashval != 0) {
+       psBucket = &oSymTable->psArray[hashval - 1];
+       if (psCursor->pvPlace != NULL) {
+          psNode = ((const struct Node *)psCursor->pvPlace)->psNext;
+       }
+       else if (psBucket->oOverflow != NULL) {
+          psNode = psBucket->oOverflow->psFirst;
+       }
+       if (psNode != NULL) {
+          psCursor->pvPlace = psNode;
+          psCursor->pcKey = psNode->pvKey;
+          psCursor->pvValue = (void *) psNode->pvItem;
+          return 1;
+       }
+    }
+    /* otherwise go on to the inline binding of the next Bucket that
+      has one */
+    for (; hashval < oSymTable->maxbucket; hashval++) {
+       psBucket = &oSymTable->psArray[hashval];
+       if (psBucket->pcKey != NULL) {
+          psCursor->uIndex = hashval + 1;
+          psCursor->pvPlace = NULL;
+          psCursor->pcKey = psBucket->pcKey;
+          psCursor->pvValue = (void *) psBucket->pvItem;
+          return 1;
+       }
+    }
+    psCursor->uIndex = oSymTable->maxbucket + 1;
+    psCursor->pvPlace = NULL;
+    return 0;
     }
 
 void* SymTable_replace(SymTable_T oSymTable, const char *pcKey, 
     const void *pvValue) {
+    size_t uHash;
     size_t hashval;
+    const void **ppvItem;
+    const void *pvOld;
+    size_t uLength;
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
-    hashval = SymTable_hash(pcKey, oSymTable->maxbucket);
-    if (oSymTable->psArray[hashval] == NULL) {
+    assert(! oSymTable->iReadOnly);
+    SymTable_settle(oSymTable, 0);
+    if (oSymTable->oYoung != NULL) {
+       return SymTable_replaceYoung(oSymTable, pcKey, pvValue);
+    }
+    uLength = strlen(pcKey);
+    uHash = SymTable_hash(oSymTable, pcKey, uLength);
+    STAT_ADD(&oSymTable->sStats, uHashes, 1);
+    hashval = uHash % oSymTable->maxbucket;
+    if ((oSymTable->psFilter != NULL &&
+       ! Filter_mayContain(oSymTable->psFilter, uHash)) ||
+       oSymTable->psArray[hashval].pcKey == NULL) {
+       STAT_ADD(&oSymTable->sStats, uMisses, 1);
+       return NULL;
+    }
+    if (! SymTable_ownBucket(oSymTable, hashval)) {
+       return NULL;
+    }
+    ppvItem = SymTable_find(oSymTable, hashval, pcKey, uLength, uHash,
+       oSymTable->uFlags);
+    if (ppvItem == NULL) {
        return NULL;
     }
-    return LinkedList_replace(oSymTable->psArray[hashval], pcKey,
-    pvValue);
+    SymTable_touch(oSymTable, hashval, ppvItem);
+    if (oSymTable->uValueSize != 0) {
+       return SymTable_replaceValue(oSymTable, hashval, ppvItem, pvValue);
+    }
+    pvOld = *ppvItem;
+    *ppvItem = pvValue;
+    return (void *) pvOld;
     }
 
-void* SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+/* SymTable_removeKey takes in a oSymTable and a pcKey of uLength
+   characters, and removes the binding of pcKey as SymTable_remove
+   does. */
+static void *SymTable_removeKey(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength) {
+    size_t uHash;
     size_t hashval;
-    void* output;
-    size_t prevlen;
+    struct Bucket *psBucket;
+    struct Node *psFirst;
+    const void *output;
+    SymTable_settle(oSymTable, 0);
+    if (oSymTable->oYoung != NULL) {
+       return SymTable_removeYoung(oSymTable, pcKey, uLength);
+    }
+    uHash = SymTable_hash(oSymTable, pcKey, uLength);
+    STAT_ADD(&oSymTable->sStats, uHashes, 1);
+    hashval = uHash % oSymTable->maxbucket;
+    if ((oSymTable->psFilter != NULL &&
+       ! Filter_mayContain(oSymTable->psFilter, uHash)) ||
+       oSymTable->psArray[hashval].pcKey == NULL) {
+       STAT_ADD(&oSymTable->sStats, uMisses, 1);
+       return NULL;
+    }
+    if (! SymTable_ownBucket(oSymTable, hashval)) {
+       return NULL;
+    }
+    psBucket = &oSymTable->psArray[hashval];
+    STAT_ADD(&oSymTable->sStats, uProbes, 1);
+    if (psBucket->uHash != uHash ||
+       ! Key_equals(psBucket->pcKey, pcKey, uLength)) {
+       if (psBucket->oOverflow == NULL) {
+          STAT_ADD(&oSymTable->sStats, uMisses, 1);
+          return NULL;
+       }
+       psFirst = LinkedList_remove(psBucket->oOverflow, pcKey, uLength,
+          uHash STATS_ARG(oSymTable));
+       if (psFirst == NULL) {
+          return NULL;
+       }
+       output = psFirst->pvItem;
+       if (oSymTable->psClock != NULL) {
+          Clock_drop(oSymTable->psClock, psFirst->uSlot);
+       }
+       SymTable_discard(oSymTable, psFirst);
+       if (oSymTable->uValueSize != 0) {
+          output = NULL;
+       }
+       oSymTable->length -= 1;
+       if (oSymTable->psFilter != NULL) {
+          Filter_drop(oSymTable->psFilter, uHash);
+       }
+       return (void *) output;
+    }
+    STAT_ADD(&oSymTable->sStats, uHits, 1);
+    output = SymTable_removeInline(oSymTable, hashval);
+    if (oSymTable->uValueSize != 0) {
+       return NULL;
+    }
+    return (void *) output;
+    }
+
+void* SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
-    hashval = SymTable_hash(pcKey, oSymTable->maxbucket);
-    if (oSymTable->psArray[hashval] == NULL) {
-       return NULL;
+    assert(! oSymTable->iReadOnly);
+    return SymTable_removeKey(oSymTable, pcKey, strlen(pcKey));
+    }
+
+void *SymTable_removeN(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL || uLength == 0);
+    assert(uLength == 0 || memchr(pcKey, '\0', uLength) == NULL);
+    assert(! oSymTable->iReadOnly);
+    return SymTable_removeKey(oSymTable, pcKey == NULL ? "" : pcKey,
+       uLength);
     }
-    prevlen = LinkedList_getLength(oSymTable->psArray[hashval]);
-    output = LinkedList_remove(oSymTable->psArray[hashval], pcKey);
-    if (prevlen > LinkedList_getLength(oSymTable->psArray[hashval])) {
-        oSymTable->length -= 1;
+
+/* SymTable_reclaim frees removed Nodes before removed keys, as a Node
+   costs two frees. */
+size_t SymTable_reclaim(SymTable_T oSymTable, size_t uBudget) {
+    struct Node *psDead;
+    char *pcDeadKey;
+    assert(oSymTable != NULL);
+    for (; uBudget > 0 && oSymTable->psDead != NULL; uBudget--) {
+        psDead = oSymTable->psDead;
+        oSymTable->psDead = psDead->psNext;
+        SymTable_freeNode(oSymTable, psDead);
+        oSymTable->uDead -= 1;
     }
-    return output;
+    for (; uBudget > 0 && oSymTable->pcDeadKeys != NULL; uBudget--) {
+        pcDeadKey = oSymTable->pcDeadKeys;
+        oSymTable->pcDeadKeys = *(char **)(void *)Key_refs(pcDeadKey);
+        Key_free(oSymTable->uFlags, pcDeadKey);
+        oSymTable->uDead -= 1;
     }
+    return oSymTable->uDead;
+}
 
 void SymTable_free(SymTable_T oSymTable) {
-    size_t bucketLen;
-    size_t i = 0;
     assert(oSymTable != NULL);
-    bucketLen = oSymTable->maxbucket;
-    while(i < bucketLen) {
-      if (oSymTable->psArray[i] != NULL) {
-      LinkedList_free(oSymTable->psArray[i]);
-      }
-      i++;
+#ifdef SYMTABLE_THREADS
+    if (oSymTable->psResize != NULL) {
+        Resize_finish(oSymTable->psResize);
+    }
+#endif
+    if (oSymTable->oYoung != NULL) {
+        SymTable_free(oSymTable->oYoung);
+    }
+    SymTable_reclaim(oSymTable, oSymTable->uDead);
+    SymTable_releaseArray(oSymTable->psArray, oSymTable->maxbucket,
+        oSymTable);
+    free(oSymTable->psFilter);
+    if (oSymTable->psClock != NULL) {
+        Clock_free(oSymTable->psClock);
+    }
+    /* the Arenas go last, as the keys and Nodes released above may
+      live in them */
+    if (oSymTable->puArenaRefs == NULL ||
+        REF_DEC(oSymTable->puArenaRefs) == 0) {
+        Arena_freeAll(oSymTable->psArenas);
+        free(oSymTable->puArenaRefs);
     }
-    free(oSymTable->psArray);
     free(oSymTable);
 }
 
+/* SymTable_snapshot shares psArray, and with it every key and
+   LinkedList, and the Arenas with the snapshot. The first change to
+   the oSymTable afterwards copies psArray, and each LinkedList is
+   copied when a binding in it first changes. */
+SymTable_T SymTable_snapshot(SymTable_T oSymTable) {
+    SymTable_T oSnapshot;
+    assert(oSymTable != NULL);
+    if (! SymTable_settle(oSymTable, 1)) {
+        return NULL;
+    }
+    oSnapshot = (SymTable_T) malloc(sizeof(struct SymTable));
+    if (oSnapshot == NULL) {
+        return NULL;
+    }
+    if (oSymTable->psArenas != NULL && oSymTable->puArenaRefs == NULL) {
+        oSymTable->puArenaRefs = (size_t*) malloc(sizeof(size_t));
+        if (oSymTable->puArenaRefs == NULL) {
+            free(oSnapshot);
+            return NULL;
+        }
+        *oSymTable->puArenaRefs = 1;
+    }
+    REF_INC(&Array_header(oSymTable->psArray)->uRefs);
+    if (oSymTable->puArenaRefs != NULL) {
+        REF_INC(oSymTable->puArenaRefs);
+    }
+    *oSnapshot = *oSymTable;
+    oSnapshot->uFlags = oSymTable->uFlags & SYMTABLE_BORROW_KEYS;
+    oSnapshot->iReadOnly = 1;
+    /* the oSymTable keeps changing its Filter, so the snapshot looks
+      its keys up without one */
+    oSnapshot->psFilter = NULL;
+    /* nor is a snapshot bounded, as it never grows */
+    oSnapshot->psClock = NULL;
+    oSnapshot->psDead = NULL;
+    oSnapshot->pcDeadKeys = NULL;
+    oSnapshot->uDead = 0;
+    oSnapshot->psResize = NULL;
+#ifdef SYMTABLE_STATS
+    memset(&oSnapshot->sStats, 0, sizeof(oSnapshot->sStats));
+    oSnapshot->sStats.uAllocations = 1;
+#endif
+    return oSnapshot;
+}
+
+/* SymTable_inYoung takes in an oYoung, a pcKey of a binding of the
+   SymTable of oYoung, its hash code uHash in that SymTable, and
+   iSameHash, which is 1 if the two hash alike. Returns 1 if oYoung
+   has pcKey, probing it with uHash if it can, otherwise 0. */
+static int SymTable_inYoung(SymTable_T oYoung, const char *pcKey,
+    size_t uHash, int iSameHash) {
+    size_t uLength = strlen(pcKey);
+    if (! iSameHash) {
+       return SymTable_findKey(oYoung, pcKey, uLength) != NULL;
+    }
+    return SymTable_find(oYoung, uHash % oYoung->maxbucket, pcKey,
+       uLength, uHash, 0) != NULL;
+}
+
+/* SymTable_mapYoung takes in a oSymTable with an oYoung, and pfApply
+   and pvExtra as for SymTable_map. It applies pfApply to the bindings
+   of psArray whose keys oYoung does not have, then to those of oYoung
+   that are not removals. */
+static void SymTable_mapYoung(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    SymTable_T oYoung = oSymTable->oYoung;
+    struct Bucket *psBucket;
+    struct Node *psNode;
+    size_t i;
+    int iSameHash = SymTable_sameHash(oSymTable, oYoung);
+    for (i = 0; i < oSymTable->maxbucket; i++) {
+       psBucket = &oSymTable->psArray[i];
+       if (psBucket->pcKey == NULL) {
+          continue;
+       }
+       if (! SymTable_inYoung(oYoung, psBucket->pcKey, psBucket->uHash,
+          iSameHash)) {
+          (*pfApply)(psBucket->pcKey, (void *)psBucket->pvItem,
+             (void *)pvExtra);
+       }
+       if (psBucket->oOverflow == NULL) {
+          continue;
+       }
+       for (psNode = psBucket->oOverflow->psFirst; psNode != NULL;
+          psNode = psNode->psNext) {
+          if (! SymTable_inYoung(oYoung, psNode->pvKey, psNode->uHash,
+             iSameHash)) {
+             (*pfApply)(psNode->pvKey, (void *)psNode->pvItem,
+                (void *)pvExtra);
+          }
+       }
+    }
+    for (i = 0; i < oYoung->maxbucket; i++) {
+       psBucket = &oYoung->psArray[i];
+       if (psBucket->pcKey == NULL) {
+          continue;
+       }
+       if (psBucket->pvItem != &cTombstone) {
+          (*pfApply)(psBucket->pcKey, (void *)psBucket->pvItem,
+             (void *)pvExtra);
+       }
+       if (psBucket->oOverflow == NULL) {
+          continue;
+       }
+       for (psNode = psBucket->oOverflow->psFirst; psNode != NULL;
+          psNode = psNode->psNext) {
+          if (psNode->pvItem != &cTombstone) {
+             (*pfApply)(psNode->pvKey, (void *)psNode->pvItem,
+                (void *)pvExtra);
+          }
+       }
+    }
+}
+
+/* SymTable_map leaves a Resize in progress alone, and reads both
+   psArray and the changes kept aside instead. */
 void SymTable_map(SymTable_T oSymTable,
     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
     const void *pvExtra) {
     size_t bucketLen;
     size_t i = 0;
+    struct Bucket *psBucket;
     assert(oSymTable != NULL);
+    if (oSymTable->oYoung != NULL) {
+      SymTable_mapYoung(oSymTable, pfApply, pvExtra);
+      return;
+    }
     bucketLen = oSymTable->maxbucket;
     while(i < bucketLen) {
-      if (oSymTable->psArray[i] != NULL) {
-      LinkedList_map(oSymTable->psArray[i], pfApply, pvExtra);
+      psBucket = &oSymTable->psArray[i];
+      if (psBucket->pcKey != NULL) {
+      (*pfApply)(psBucket->pcKey, (void *)psBucket->pvItem,
+         (void *)pvExtra);
+      }
+      if (psBucket->oOverflow != NULL) {
+      LinkedList_map(psBucket->oOverflow, pfApply, pvExtra);
       }
       i++;
     }
 }
 
+/* SymTable_keep takes in a oSymTable, a binding of it with key pcKey,
+   hash code uHash and value pvItem, and pfKeep, pvExtra and oOther as
+   for SymTable_retainBucket. Returns 1 if the binding is to be kept,
+   otherwise 0. */
+static int SymTable_keep(SymTable_T oSymTable, const char *pcKey,
+    size_t uHash, const void *pvItem,
+    int (*pfKeep)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra, SymTable_T oOther) {
+    size_t uLength;
+    if (oOther == NULL) {
+        return (*pfKeep)(pcKey, (void *)pvItem, (void *)pvExtra);
+    }
+    uLength = strlen(pcKey);
+    if (! SymTable_sameHash(oSymTable, oOther)) {
+        uHash = SymTable_hash(oOther, pcKey, uLength);
+    }
+    return SymTable_find(oOther, uHash % oOther->maxbucket, pcKey,
+        uLength, uHash, 0) == NULL;
+}
+
+/* SymTable_retainBucket takes in a oSymTable, the index hashval of a
+   Bucket with bindings, pfKeep, pfFree and pvExtra as for
+   SymTable_retain, and a SymTable oOther, and removes the bindings of
+   the Bucket that pfKeep rejects. If oOther is not NULL, pfKeep is
+   not called, and the bindings whose keys oOther has are rejected
+   instead, found by their stored hash codes when the two SymTables
+   hash alike. The Bucket is only copied from a snapshot once one of
+   its bindings is rejected. Returns 1 if successful, or 0 if there
+   is no memory for that copy. */
+static int SymTable_retainBucket(SymTable_T oSymTable, size_t hashval,
+    int (*pfKeep)(const char *pcKey, void *pvValue, void *pvExtra),
+    void (*pfFree)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra, SymTable_T oOther) {
+    struct Bucket *psBucket = &oSymTable->psArray[hashval];
+    struct Node *psPrev = NULL;
+    struct Node *psCurr;
+    struct Node *psNext;
+    size_t i = 0;
+    size_t j;
+    int iOwned = 0;
+    /* a rejected inline binding is replaced by the first binding of
+      the LinkedList, which is then judged in its turn */
+    while (psBucket->pcKey != NULL && ! SymTable_keep(oSymTable,
+       psBucket->pcKey, psBucket->uHash, psBucket->pvItem, pfKeep,
+       pvExtra, oOther)) {
+       if (! iOwned) {
+          if (! SymTable_ownBucket(oSymTable, hashval)) {
+             return 0;
+          }
+          iOwned = 1;
+          psBucket = &oSymTable->psArray[hashval];
+       }
+       if (pfFree != NULL) {
+          (*pfFree)(psBucket->pcKey, (void *)psBucket->pvItem,
+             (void *)pvExtra);
+       }
+       SymTable_removeInline(oSymTable, hashval);
+    }
+    if (psBucket->pcKey == NULL || psBucket->oOverflow == NULL) {
+       return 1;
+    }
+    psCurr = psBucket->oOverflow->psFirst;
+    while (psCurr != NULL) {
+       if (SymTable_keep(oSymTable, psCurr->pvKey, psCurr->uHash,
+          psCurr->pvItem, pfKeep, pvExtra, oOther)) {
+          psPrev = psCurr;
+          psCurr = psCurr->psNext;
+          i++;
+          continue;
+       }
+       if (! iOwned) {
+          if (! SymTable_ownBucket(oSymTable, hashval)) {
+             return 0;
+          }
+          iOwned = 1;
+          psBucket = &oSymTable->psArray[hashval];
+          /* a copy keeps the order of the nodes, so the same place
+            in it is found by counting */
+          psPrev = NULL;
+          psCurr = psBucket->oOverflow->psFirst;
+          for (j = 0; j < i; j++) {
+             psPrev = psCurr;
+             psCurr = psCurr->psNext;
+          }
+       }
+       if (pfFree != NULL) {
+          (*pfFree)(psCurr->pvKey, (void *)psCurr->pvItem,
+             (void *)pvExtra);
+       }
+       psNext = psCurr->psNext;
+       LinkedList_unlink(psBucket->oOverflow, psCurr, psPrev, i);
+       if (oSymTable->psFilter != NULL) {
+          Filter_drop(oSymTable->psFilter, psCurr->uHash);
+       }
+       if (oSymTable->psClock != NULL) {
+          Clock_drop(oSymTable->psClock, psCurr->uSlot);
+       }
+       SymTable_discard(oSymTable, psCurr);
+       oSymTable->length -= 1;
+       psCurr = psNext;
+    }
+    return 1;
+}
+
+/* SymTable_retain walks psArray once, and takes rejected bindings out
+   where it finds them, as SymTable_remove would after its lookup. */
+int SymTable_retain(SymTable_T oSymTable,
+    int (*pfKeep)(const char *pcKey, void *pvValue, void *pvExtra),
+    void (*pfFree)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    size_t i;
+    assert(oSymTable != NULL);
+    assert(pfKeep != NULL);
+    assert(! oSymTable->iReadOnly);
+    if (! SymTable_settle(oSymTable, 1)) {
+       return 0;
+    }
+    for (i = 0; i < oSymTable->maxbucket; i++) {
+       if (oSymTable->psArray[i].pcKey != NULL &&
+          ! SymTable_retainBucket(oSymTable, i, pfKeep, pfFree,
+          pvExtra, NULL)) {
+          return 0;
+       }
+    }
+    return 1;
+}
+
+/* SymTable_difference judges every binding of oSymTable by whether
+   oOther has its key, in the same single pass as SymTable_retain. */
+int SymTable_difference(SymTable_T oSymTable, SymTable_T oOther,
+    void (*pfFree)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    size_t i;
+    assert(oSymTable != NULL);
+    assert(oOther != NULL);
+    assert(oSymTable != oOther);
+    assert(! oSymTable->iReadOnly);
+    if (! SymTable_settle(oSymTable, 1) || ! SymTable_settle(oOther, 1)) {
+       return 0;
+    }
+    for (i = 0; i < oSymTable->maxbucket; i++) {
+       if (oSymTable->psArray[i].pcKey != NULL &&
+          ! SymTable_retainBucket(oSymTable, i, NULL, pfFree, pvExtra,
+          oOther)) {
+          return 0;
+       }
+    }
+    return 1;
+}
+
+/* SymTable_canSteal takes in a oSrc and returns 1 if its keys and
+   Nodes may move to another SymTable as they are, which needs that
+   none of them lives in an Arena of oSrc. Otherwise returns 0. */
+static int SymTable_canSteal(SymTable_T oSrc) {
+    return oSrc->psArenas == NULL;
+}
+
+/* SymTable_mergeBucket takes in a oDst, a oSrc, the index hashval of
+   a Bucket of oSrc with bindings, and uPolicy as for SymTable_merge.
+   iSameHash is 1 if the two SymTables hash alike, so that a binding
+   keeps its stored hash code, and iSteal is 1 if the keys and Nodes
+   of oSrc may move as they are. Moves the bindings of the Bucket
+   whose keys oDst lacks into oDst, the LinkedList first, so that the
+   inline binding moves last. Returns 1 if successful, or 0 if there
+   is no memory. */
+static int SymTable_mergeBucket(SymTable_T oDst, SymTable_T oSrc,
+    size_t hashval, unsigned int uPolicy, int iSameHash, int iSteal) {
+    struct Bucket *psBucket;
+    struct Node *psPrev = NULL;
+    struct Node *psCurr;
+    struct Node *psNext;
+    const void **ppvDst;
+    size_t uDstval;
+    size_t uHash;
+    size_t i = 0;
+    if (! SymTable_ownBucket(oSrc, hashval)) {
+        return 0;
+    }
+    psBucket = &oSrc->psArray[hashval];
+    psCurr = psBucket->oOverflow == NULL ? NULL :
+        psBucket->oOverflow->psFirst;
+    for (; psCurr != NULL; psCurr = psNext) {
+        psNext = psCurr->psNext;
+        uHash = iSameHash ? psCurr->uHash :
+            SymTable_hash(oDst, psCurr->pvKey, strlen(psCurr->pvKey));
+        if (! SymTable_mergeSlot(oDst, psCurr->pvKey, uHash, &uDstval,
+            &ppvDst)) {
+            return 0;
+        }
+        if (ppvDst != NULL) {
+            if (uPolicy == SYMTABLE_MERGE_REPLACE &&
+                ! SymTable_mergeReplace(oDst, uDstval, ppvDst,
+                &psCurr->pvItem)) {
+                return 0;
+            }
+            psPrev = psCurr;
+            i++;
+            continue;
+        }
+        if (! SymTable_makeRoom(oDst)) {
+            return 0;
+        }
+        if (! iSteal && ! SymTable_mergeCopy(oDst, uDstval, uHash,
+            psCurr->pvKey, psCurr->pvItem)) {
+            return 0;
+        }
+        LinkedList_unlink(psBucket->oOverflow, psCurr, psPrev, i);
+        oSrc->length -= 1;
+        if (oSrc->psFilter != NULL) {
+            Filter_drop(oSrc->psFilter, psCurr->uHash);
+        }
+        if (oSrc->psClock != NULL) {
+            Clock_drop(oSrc->psClock, psCurr->uSlot);
+        }
+        if (iSteal) {
+            SymTable_mergeLink(oDst, uDstval, uHash, psCurr->pvKey,
+                psCurr->pvItem, psCurr);
+        }
+        else {
+            SymTable_discard(oSrc, psCurr);
+        }
+    }
+    uHash = iSameHash ? psBucket->uHash :
+        SymTable_hash(oDst, psBucket->pcKey, strlen(psBucket->pcKey));
+    if (! SymTable_mergeSlot(oDst, psBucket->pcKey, uHash, &uDstval,
+        &ppvDst)) {
+        return 0;
+    }
+    if (ppvDst != NULL) {
+        return uPolicy != SYMTABLE_MERGE_REPLACE ||
+            SymTable_mergeReplace(oDst, uDstval, ppvDst,
+            &psBucket->pvItem);
+    }
+    if (! SymTable_makeRoom(oDst)) {
+        return 0;
+    }
+    if (iSteal) {
+        if (! SymTable_mergeLink(oDst, uDstval, uHash, psBucket->pcKey,
+            psBucket->pvItem, NULL)) {
+            return 0;
+        }
+        /* oDst holds the key now, so the reference oSrc drops on
+          removing the binding must not be the last */
+        Key_retain(oSrc->uFlags, psBucket->pcKey);
+    }
+    else if (! SymTable_mergeCopy(oDst, uDstval, uHash, psBucket->pcKey,
+        psBucket->pvItem)) {
+        return 0;
+    }
+    SymTable_removeInline(oSrc, hashval);
+    return 1;
+}
+
+/* SymTable_merge grows oDst once to hold both SymTables, then works
+   bucket by bucket through oSrc. When the two hash alike every
+   binding keeps its stored hash code, so with the same bucket count
+   it lands in the Bucket of the same index, and when oSrc keeps
+   nothing in Arenas its keys and Nodes move instead of being
+   copied. */
+int SymTable_merge(SymTable_T oDst, SymTable_T oSrc, unsigned int uPolicy) {
+    size_t uSizes = sizeof(auBucketCounts)/sizeof(auBucketCounts[0]);
+    size_t uBucketnum;
+    size_t uTarget;
+    size_t i;
+    int iSameHash;
+    int iSteal;
+    assert(oDst != NULL);
+    assert(oSrc != NULL);
+    assert(oDst != oSrc);
+    assert(! oDst->iReadOnly && ! oSrc->iReadOnly);
+    assert(oDst->uValueSize == oSrc->uValueSize);
+    assert((oDst->uFlags & SYMTABLE_BORROW_KEYS) ==
+        (oSrc->uFlags & SYMTABLE_BORROW_KEYS));
+    assert(uPolicy == SYMTABLE_MERGE_KEEP ||
+        uPolicy == SYMTABLE_MERGE_REPLACE);
+    if (! SymTable_settle(oDst, 1) || ! SymTable_settle(oSrc, 1)) {
+        return 0;
+    }
+    if (oSrc->length == 0) {
+        return 1;
+    }
+    /* a bounded oDst evicts as the bindings go in, so it need not
+      grow past its capacity */
+    uTarget = oDst->length + oSrc->length;
+    if (oDst->psClock != NULL && uTarget > oDst->psClock->uCapacity) {
+        uTarget = oDst->psClock->uCapacity;
+    }
+    uBucketnum = oDst->bucketnum;
+    while (uBucketnum < uSizes - 1 &&
+        auBucketCounts[uBucketnum] <= uTarget) {
+        uBucketnum++;
+    }
+    if (uBucketnum != oDst->bucketnum) {
+        if (! SymTable_rebuild(oDst, uBucketnum, 0)) {
+            return 0;
+        }
+        STAT_ADD(&oDst->sStats, uResizes, 1);
+    }
+    iSameHash = SymTable_sameHash(oDst, oSrc);
+    iSteal = SymTable_canSteal(oSrc);
+    for (i = 0; i < oSrc->maxbucket; i++) {
+        if (oSrc->psArray[i].pcKey != NULL &&
+            ! SymTable_mergeBucket(oDst, oSrc, i, uPolicy, iSameHash,
+            iSteal)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int SymTable_mapRange(SymTable_T oSymTable, const char *pcLo,
+    const char *pcHi,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   assert(oSymTable != NULL);
+   if (! SymTable_settle(oSymTable, 1)) {
+      return 0;
+   }
+   return SymTable_mapSorted(oSymTable, pcLo, pcHi, NULL, pfApply,
+      pvExtra);
+}
+
+int SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   assert(oSymTable != NULL);
+   assert(pcPrefix != NULL);
+   if (! SymTable_settle(oSymTable, 1)) {
+      return 0;
+   }
+   return SymTable_mapSorted(oSymTable, pcPrefix, NULL, pcPrefix,
+      pfApply, pvExtra);
+}
+
+struct SymTableStats SymTable_getStats(SymTable_T oSymTable) {
+    struct SymTableStats sStats;
+    assert(oSymTable != NULL);
+#ifdef SYMTABLE_STATS
+    sStats = oSymTable->sStats;
+#else
+    memset(&sStats, 0, sizeof(sStats));
+#endif
+    return sStats;
+}
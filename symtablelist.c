@@ -10,6 +10,44 @@
 #include <stdlib.h>
 #include <stddef.h>
 
+#ifdef SYMTABLE_STATS
+/* When SYMTABLE_STATS is defined, STAT_ADD adds uCount to one of the
+   counters of a SymTable. Otherwise it expands to nothing, so the
+   normal build does no counting at all. */
+#define STAT_ADD(oSymTable, field, uCount) \
+   ((oSymTable)->sStats.field += (uCount))
+#else
+#define STAT_ADD(oSymTable, field, uCount) ((void)0)
+#endif
+
+/* REF_INC and REF_DEC add one to or take one from a reference count
+   and give the new count, and REF_GET reads one. They are atomic
+   where the compiler allows it, so that a snapshot may be used and
+   freed on another thread than the SymTable it was taken from. */
+#if defined(__GNUC__)
+#define REF_INC(puRefs) __atomic_add_fetch((puRefs), 1, __ATOMIC_RELAXED)
+#define REF_DEC(puRefs) __atomic_sub_fetch((puRefs), 1, __ATOMIC_ACQ_REL)
+#define REF_GET(puRefs) __atomic_load_n((puRefs), __ATOMIC_ACQUIRE)
+#else
+#define REF_INC(puRefs) (++*(puRefs))
+#define REF_DEC(puRefs) (--*(puRefs))
+#define REF_GET(puRefs) (*(puRefs))
+#endif
+
+/* RECLAIM_STEP is how many removed Nodes of a SYMTABLE_DEFER_FREE
+   SymTable each SymTable_put frees */
+enum {RECLAIM_STEP = 2};
+
+/* Align is a union of the types that need the most alignment, so that
+   a value of any type may start at a multiple of its size */
+union Align
+{
+   long double ld;
+   long long ll;
+   void *pv;
+   void (*pf)(void);
+};
+
 /* The Node Struct is used in the LinkedList SymTable and contains
    a void* pvItem, string psKey, and next node psNext */
 struct Node
@@ -21,6 +59,10 @@ struct Node
    /* psNext is a pointer that points to the next Node in the 
       linked List */
    struct Node *psNext;
+   /* uRefs is how many SymTables and Nodes link to the Node. A Node
+      with more than one link, or after one that has, is shared with
+      a snapshot and must be copied before it changes */
+   size_t uRefs;
 };
 
 /* The SymTable struct contains the first node of the linkedlist 
@@ -33,9 +75,336 @@ struct SymTable
    /* length is a size_t that stores how many bindings are in 
       the table */
    size_t length;
+   /* uFlags stores the SYMTABLE_ flags the SymTable was made with */
+   unsigned int uFlags;
+   /* iReadOnly is 1 if the SymTable is a snapshot, otherwise 0 */
+   int iReadOnly;
+   /* uValueSize is the size of the values a SymTable made by
+      SymTable_newSized keeps with its keys, or 0 if it keeps
+      pointers */
+   size_t uValueSize;
+   /* psDead points to the Nodes removed but not freed yet, linked
+      through psNext, and uDead is how many there are */
+   struct Node *psDead;
+   size_t uDead;
+   /* uCapacity is the most bindings a bounded SymTable may hold, or 0
+      if it has no capacity */
+   size_t uCapacity;
+   /* pfEvict is called with every evicted binding and pvExtra, unless
+      it is NULL */
+   void (*pfEvict)(const char *pcKey, void *pvValue, void *pvExtra);
+   const void *pvExtra;
+#ifdef SYMTABLE_STATS
+   /* sStats stores the operation counters of the SymTable */
+   struct SymTableStats sStats;
+#endif
 };
 
+/* SymTable_keyEquals takes in a key pcStored and a pcKey of uLength
+   characters with no '\0' among them, and returns 1 if they are the
+   same key, otherwise 0. */
+static int SymTable_keyEquals(const char *pcStored, const char *pcKey,
+   size_t uLength) {
+   return strncmp(pcStored, pcKey, uLength) == 0 &&
+      pcStored[uLength] == '\0';
+}
+
+/* SymTable_find takes in a oSymTable, a pcKey of uLength characters
+   and flags uFlags, and returns the node that holds pcKey, or NULL if there is
+   none. With SYMTABLE_MOVE_TO_FRONT the node found becomes the first
+   node, and with SYMTABLE_TRANSPOSE it trades places with the node
+   before it, unless that would change a node shared with a snapshot.
+   If piShared is not NULL, *piShared is set to 1 if the node found is
+   shared, otherwise 0. */
+static struct Node *SymTable_find(SymTable_T oSymTable,
+   const char *pcKey, size_t uLength, unsigned int uFlags,
+   int *piShared) {
+   struct Node *psPrev = NULL;
+   struct Node *psCurr;
+   struct Node sSwap;
+   int iShared = 0;
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   psCurr = oSymTable->psFirst;
+   while(psCurr != NULL) {
+      STAT_ADD(oSymTable, uProbes, 1);
+      STAT_ADD(oSymTable, uCompares, 1);
+      if (REF_GET(&psCurr->uRefs) > 1) {
+         iShared = 1;
+      }
+      if (SymTable_keyEquals(psCurr->psKey, pcKey, uLength)) {
+         break;
+      }
+      psPrev = psCurr;
+      psCurr = psCurr->psNext;
+   }
+   if (psCurr == NULL) {
+      STAT_ADD(oSymTable, uMisses, 1);
+      return NULL;
+   }
+   STAT_ADD(oSymTable, uHits, 1);
+   if (piShared != NULL) {
+      *piShared = iShared;
+   }
+   if (psPrev == NULL || iShared) {
+      return psCurr;
+   }
+   if (uFlags & SYMTABLE_MOVE_TO_FRONT) {
+      psPrev->psNext = psCurr->psNext;
+      psCurr->psNext = oSymTable->psFirst;
+      oSymTable->psFirst = psCurr;
+   }
+   else if (uFlags & SYMTABLE_TRANSPOSE) {
+      /* swap the bindings rather than the nodes, so that no link
+         before psPrev has to change */
+      sSwap = *psPrev;
+      psPrev->pvItem = psCurr->pvItem;
+      psPrev->psKey = psCurr->psKey;
+      psCurr->pvItem = sSwap.pvItem;
+      psCurr->psKey = sSwap.psKey;
+      psCurr = psPrev;
+   }
+   return psCurr;
+}
+
+/* SymTable_freeKey takes in a oSymTable and the pcKey of one of its
+   nodes, and frees pcKey unless the oSymTable borrows its keys. */
+static void SymTable_freeKey(SymTable_T oSymTable, char *pcKey) {
+   if (! (oSymTable->uFlags & SYMTABLE_BORROW_KEYS)) {
+      free(pcKey);
+   }
+}
+
+/* SymTable_release takes in a oSymTable and a psNode, and drops one
+   link to psNode. Every node whose last link is dropped is freed
+   along with its key, and drops its link to the next node in turn. */
+static void SymTable_release(SymTable_T oSymTable, struct Node *psNode) {
+   struct Node *psNext;
+   while (psNode != NULL && REF_DEC(&psNode->uRefs) == 0) {
+      psNext = psNode->psNext;
+      SymTable_freeKey(oSymTable, psNode->psKey);
+      free(psNode);
+      psNode = psNext;
+   }
+}
+
+/* SymTable_copyKey takes in a oSymTable, a pcKey of uLength
+   characters and a pointer ppvValue to its value, and returns a copy
+   of pcKey for a Node, or
+   NULL if there is no memory. If the oSymTable was made by
+   SymTable_newSized, the value is copied in after the key, and
+   *ppvValue is set to point to the copy. If the oSymTable borrows its
+   keys, pcKey itself is returned. */
+static char *SymTable_copyKey(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength, const void **ppvValue) {
+   size_t uLen = uLength + 1;
+   size_t uOffset;
+   char *pcCopy;
+   if (oSymTable->uFlags & SYMTABLE_BORROW_KEYS) {
+      assert(pcKey[uLength] == '\0');
+      return (char*)pcKey;
+   }
+   if (oSymTable->uValueSize == 0) {
+      pcCopy = (char*)malloc(uLen);
+      if (pcCopy != NULL) {
+         memcpy(pcCopy, pcKey, uLength);
+         pcCopy[uLength] = '\0';
+      }
+      return pcCopy;
+   }
+   uOffset = (uLen + sizeof(union Align) - 1) / sizeof(union Align) *
+      sizeof(union Align);
+   pcCopy = (char*)malloc(uOffset + oSymTable->uValueSize);
+   if (pcCopy == NULL) {
+      return NULL;
+   }
+   memcpy(pcCopy, pcKey, uLength);
+   pcCopy[uLength] = '\0';
+   memcpy(pcCopy + uOffset, *ppvValue, oSymTable->uValueSize);
+   *ppvValue = pcCopy + uOffset;
+   return pcCopy;
+}
+
+/* SymTable_ownPath takes in a oSymTable, a link ppsFrom in its linked
+   list that it owns, and a psTarget after ppsFrom, and copies every
+   shared node from the one ppsFrom points to up to and including
+   psTarget, so that the oSymTable can change them without a snapshot
+   seeing it. Returns the link that now points to psTarget or its
+   copy, or NULL if there is no memory, in which case the nodes copied
+   so far stay in place of the old ones. */
+static struct Node **SymTable_ownPath(SymTable_T oSymTable,
+   struct Node **ppsFrom, const struct Node *psTarget) {
+   struct Node **ppsLink = ppsFrom;
+   struct Node *psCurr;
+   struct Node *psCopy;
+   for (;;) {
+      psCurr = *ppsLink;
+      assert(psCurr != NULL);
+      /* copying a node adds a link to the node after it, which is so
+         found to be shared too */
+      if (REF_GET(&psCurr->uRefs) > 1) {
+         psCopy = (struct Node*)malloc(sizeof(struct Node));
+         if (psCopy == NULL) {
+            return NULL;
+         }
+         psCopy->pvItem = psCurr->pvItem;
+         psCopy->psKey = SymTable_copyKey(oSymTable, psCurr->psKey,
+            strlen(psCurr->psKey), &psCopy->pvItem);
+         if (psCopy->psKey == NULL) {
+            free(psCopy);
+            return NULL;
+         }
+         STAT_ADD(oSymTable, uAllocations, 2);
+         psCopy->psNext = psCurr->psNext;
+         psCopy->uRefs = 1;
+         if (psCopy->psNext != NULL) {
+            REF_INC(&psCopy->psNext->uRefs);
+         }
+         *ppsLink = psCopy;
+         SymTable_release(oSymTable, psCurr);
+      }
+      if (psCurr == psTarget) {
+         return ppsLink;
+      }
+      ppsLink = &(*ppsLink)->psNext;
+   }
+}
+
+/* SymTable_discard takes in a oSymTable and a psNode taken out of it,
+   and frees psNode and its key, or with SYMTABLE_DEFER_FREE keeps it
+   for SymTable_reclaim. */
+static void SymTable_discard(SymTable_T oSymTable, struct Node *psNode) {
+   if (oSymTable->uFlags & SYMTABLE_DEFER_FREE) {
+      psNode->psNext = oSymTable->psDead;
+      oSymTable->psDead = psNode;
+      oSymTable->uDead += 1;
+   }
+   else {
+      SymTable_freeKey(oSymTable, psNode->psKey);
+      free(psNode);
+   }
+}
+
+/* SymTable_evict takes in a bounded oSymTable with at least one
+   binding and evicts its last binding, which has gone the longest
+   without being put or found. If there is no memory to copy the nodes
+   a snapshot shares, nothing is evicted. */
+static void SymTable_evict(SymTable_T oSymTable) {
+   struct Node **ppsLink = &oSymTable->psFirst;
+   struct Node *psLast;
+   int iShared = 0;
+   for (;;) {
+      if (REF_GET(&(*ppsLink)->uRefs) > 1) {
+         iShared = 1;
+      }
+      if ((*ppsLink)->psNext == NULL) {
+         break;
+      }
+      ppsLink = &(*ppsLink)->psNext;
+   }
+   if (iShared) {
+      ppsLink = SymTable_ownPath(oSymTable, &oSymTable->psFirst,
+         *ppsLink);
+      if (ppsLink == NULL) {
+         return;
+      }
+   }
+   psLast = *ppsLink;
+   if (oSymTable->pfEvict != NULL) {
+      (*oSymTable->pfEvict)(psLast->psKey, (void *)psLast->pvItem,
+         (void *)oSymTable->pvExtra);
+   }
+   *ppsLink = NULL;
+   SymTable_discard(oSymTable, psLast);
+   oSymTable->length -= 1;
+}
+
+/* SymTable_inRange takes in a string pcKey, bounds pcLo and pcHi and
+   a prefix pcPrefix of length uPrefixLength, and returns 1 if pcKey
+   is at least pcLo, less than pcHi and starts with pcPrefix, where a
+   NULL pcLo, pcHi or pcPrefix is no limit. Otherwise returns 0. */
+static int SymTable_inRange(const char *pcKey, const char *pcLo,
+   const char *pcHi, const char *pcPrefix, size_t uPrefixLength) {
+   if (pcLo != NULL && strcmp(pcKey, pcLo) < 0) {
+      return 0;
+   }
+   if (pcHi != NULL && strcmp(pcKey, pcHi) >= 0) {
+      return 0;
+   }
+   if (pcPrefix != NULL && strncmp(pcKey, pcPrefix, uPrefixLength) != 0) {
+      return 0;
+   }
+   return 1;
+}
+
+/* SymTable_compareNodes takes in pointers pvFirst and pvSecond to two
+   Node pointers and compares their keys with strcmp, for qsort. */
+static int SymTable_compareNodes(const void *pvFirst,
+   const void *pvSecond) {
+   const struct Node *psFirst = *(const struct Node *const *)pvFirst;
+   const struct Node *psSecond = *(const struct Node *const *)pvSecond;
+   return strcmp(psFirst->psKey, psSecond->psKey);
+}
+
+/* SymTable_mapSorted takes in a oSymTable, bounds pcLo and pcHi, a
+   prefix pcPrefix, function pfApply and pvExtra. It collects the
+   nodes whose keys are in range as for SymTable_inRange, sorts them
+   by key and applies pfApply to each in that order. Returns 1 if
+   successful, or 0 if there is no memory for the sorting, in which
+   case pfApply is never called. */
+static int SymTable_mapSorted(SymTable_T oSymTable, const char *pcLo,
+    const char *pcHi, const char *pcPrefix,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   struct Node **ppsMatches;
+   struct Node *psCurr;
+   size_t uPrefixLength = 0;
+   size_t uCount = 0;
+   size_t i;
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+   if (pcPrefix != NULL) {
+      uPrefixLength = strlen(pcPrefix);
+   }
+   for (psCurr = oSymTable->psFirst; psCurr != NULL;
+        psCurr = psCurr->psNext) {
+      if (SymTable_inRange(psCurr->psKey, pcLo, pcHi, pcPrefix,
+         uPrefixLength)) {
+         uCount++;
+      }
+   }
+   if (uCount == 0) {
+      return 1;
+   }
+   ppsMatches = (struct Node **) malloc(uCount * sizeof(struct Node *));
+   if (ppsMatches == NULL) {
+      return 0;
+   }
+   uCount = 0;
+   for (psCurr = oSymTable->psFirst; psCurr != NULL;
+        psCurr = psCurr->psNext) {
+      if (SymTable_inRange(psCurr->psKey, pcLo, pcHi, pcPrefix,
+         uPrefixLength)) {
+         ppsMatches[uCount++] = psCurr;
+      }
+   }
+   qsort(ppsMatches, uCount, sizeof(struct Node *),
+      SymTable_compareNodes);
+   for (i = 0; i < uCount; i++) {
+      (*pfApply)(ppsMatches[i]->psKey, (void *)ppsMatches[i]->pvItem,
+         (void *)pvExtra);
+   }
+   free(ppsMatches);
+   return 1;
+}
+
 SymTable_T SymTable_new(void) {
+   return SymTable_newWithFlags(0);
+}
+
+/* A linked list does not hash its keys or resize, so it ignores
+   SYMTABLE_HARDENED, SYMTABLE_FILTER and SYMTABLE_BACKGROUND_RESIZE. */
+SymTable_T SymTable_newWithFlags(unsigned int uFlags) {
    SymTable_T oSymTable;
    oSymTable = (SymTable_T) malloc(sizeof(struct SymTable));
    if (oSymTable == NULL) {
@@ -43,23 +412,107 @@ SymTable_T SymTable_new(void) {
    }
    oSymTable->psFirst = NULL;
    oSymTable->length = 0;
+   oSymTable->uFlags = uFlags;
+   oSymTable->iReadOnly = 0;
+   oSymTable->uValueSize = 0;
+   oSymTable->psDead = NULL;
+   oSymTable->uDead = 0;
+   oSymTable->uCapacity = 0;
+   oSymTable->pfEvict = NULL;
+   oSymTable->pvExtra = NULL;
+#ifdef SYMTABLE_STATS
+   memset(&oSymTable->sStats, 0, sizeof(oSymTable->sStats));
+   oSymTable->sStats.uAllocations = 1;
+#endif
+   return oSymTable;
+}
+
+/* A linked list has no bucket array, so it ignores
+   SYMTABLE_HUGE_PAGES and iNode. */
+SymTable_T SymTable_newOnNode(unsigned int uFlags, int iNode) {
+   (void)iNode;
+   return SymTable_newWithFlags(uFlags);
+}
+
+SymTable_T SymTable_newSized(size_t uValueSize) {
+   SymTable_T oSymTable;
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL) {
+      return NULL;
+   }
+   oSymTable->uValueSize = uValueSize;
+   return oSymTable;
+}
+
+/* A bounded linked list moves every binding it finds to the front, so
+   that the last binding is always the least recently used one, and
+   evicts that. */
+SymTable_T SymTable_newBounded(size_t uCapacity, unsigned int uFlags,
+   void (*pfEvict)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+   SymTable_T oSymTable;
+   assert(uCapacity >= 1);
+   oSymTable = SymTable_newWithFlags(uFlags | SYMTABLE_MOVE_TO_FRONT);
+   if (oSymTable == NULL) {
+      return NULL;
+   }
+   oSymTable->uCapacity = uCapacity;
+   oSymTable->pfEvict = pfEvict;
+   oSymTable->pvExtra = pvExtra;
    return oSymTable;
 }
+
+/* A linked list has no buckets to group the bindings by, so this
+   puts them one at a time. */
+SymTable_T SymTable_fromArrays(const char *const *ppcKeys,
+   const void *const *ppvValues, size_t uCount) {
+   SymTable_T oSymTable;
+   size_t i;
+   assert(uCount == 0 || ppcKeys != NULL);
+   assert(uCount == 0 || ppvValues != NULL);
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL) {
+      return NULL;
+   }
+   for (i = 0; i < uCount; i++) {
+      if (! SymTable_put(oSymTable, ppcKeys[i], ppvValues[i]) &&
+         ! SymTable_contains(oSymTable, ppcKeys[i])) {
+         SymTable_free(oSymTable);
+         return NULL;
+      }
+   }
+   return oSymTable;
+}
+
+/* A linked list has no buckets to split among threads, so this
+   builds it on the calling thread, as SymTable_fromArrays does. */
+SymTable_T SymTable_buildParallel(const char *const *ppcKeys,
+   const void *const *ppvValues, size_t uCount, size_t uThreads) {
+   (void)uThreads;
+   return SymTable_fromArrays(ppcKeys, ppvValues, uCount);
+}
+
 size_t SymTable_getLength(SymTable_T oSymTable) {
    return oSymTable->length;
 }
 
-int SymTable_put(SymTable_T oSymTable, const char *pcKey, 
-   const void* pvValue) {
+unsigned int SymTable_getFlags(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+   return oSymTable->uFlags;
+}
+
+/* SymTable_putKey takes in a oSymTable, a pcKey of uLength characters
+   and a pvValue, and puts the binding at the front of the list as
+   SymTable_put does. */
+static int SymTable_putKey(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength, const void* pvValue) {
    struct Node *NewNode;
    char* copyKey;
    struct Node *psCurr;
-   assert(oSymTable != NULL);
-   assert(pcKey != NULL);
-   psCurr = oSymTable->psFirst;
-   while(psCurr != NULL && strcmp(psCurr->psKey, pcKey) != 0){
-      psCurr = psCurr->psNext;
+   if (oSymTable->psDead != NULL) {
+      SymTable_reclaim(oSymTable, RECLAIM_STEP);
    }
+   psCurr = SymTable_find(oSymTable, pcKey, uLength, 0, NULL);
    if (psCurr != NULL) {
       return 0;
    }
@@ -68,24 +521,52 @@ int SymTable_put(SymTable_T oSymTable, const char *pcKey,
       return 0;
    }
    NewNode->pvItem = pvValue;
-   copyKey = malloc(strlen(pcKey) + 1);
-   strcpy(copyKey, pcKey);
+   copyKey = SymTable_copyKey(oSymTable, pcKey, uLength,
+      &NewNode->pvItem);
+   if (copyKey == NULL) {
+      free(NewNode);
+      return 0;
+   }
+   STAT_ADD(oSymTable, uAllocations, 2);
    NewNode->psKey = copyKey;
+   NewNode->uRefs = 1;
+   /* the link from the oSymTable to the old first node moves to
+      NewNode, so nothing a snapshot shares has to change */
    NewNode->psNext = oSymTable->psFirst;
    oSymTable->psFirst = NewNode;
    oSymTable->length += 1;
+   if (oSymTable->uCapacity != 0 &&
+      oSymTable->length > oSymTable->uCapacity) {
+      SymTable_evict(oSymTable);
+   }
    return 1;
 }
 
+int SymTable_put(SymTable_T oSymTable, const char *pcKey, 
+   const void* pvValue) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(! oSymTable->iReadOnly);
+   return SymTable_putKey(oSymTable, pcKey, strlen(pcKey), pvValue);
+}
+
+int SymTable_putN(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength, const void *pvValue) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL || uLength == 0);
+   assert(uLength == 0 || memchr(pcKey, '\0', uLength) == NULL);
+   assert(! oSymTable->iReadOnly);
+   return SymTable_putKey(oSymTable, pcKey == NULL ? "" : pcKey, uLength,
+      pvValue);
+}
+
 
 int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
    struct Node *psCurr;
    assert( oSymTable != NULL);
    assert(pcKey != NULL);
-   psCurr = oSymTable->psFirst;
-   while(psCurr != NULL && strcmp(psCurr->psKey, pcKey) != 0){
-      psCurr = psCurr->psNext;
-   }
+   psCurr = SymTable_find(oSymTable, pcKey, strlen(pcKey),
+      oSymTable->uFlags, NULL);
    if (psCurr == NULL) {
       return 0;
    }
@@ -96,82 +577,201 @@ void* SymTable_get(SymTable_T oSymTable, const char *pcKey) {
    struct Node *psCurr;
    assert( oSymTable != NULL);
    assert(pcKey != NULL);
-   psCurr = oSymTable->psFirst;
-   while(psCurr != NULL && strcmp(psCurr->psKey, pcKey) != 0){
-      psCurr = psCurr->psNext;
-   }
+   psCurr = SymTable_find(oSymTable, pcKey, strlen(pcKey),
+      oSymTable->uFlags, NULL);
    if (psCurr == NULL) {
       return NULL;
    }
    return (void*) psCurr->pvItem;
 }
 
+/* A cursor at a binding has uIndex 1 and its Node as pvPlace, and one
+   past the last binding has uIndex 2. */
+int SymTable_lookupN(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength, struct SymTableCursor *psCursor) {
+   struct Node *psCurr;
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL || uLength == 0);
+   assert(uLength == 0 || memchr(pcKey, '\0', uLength) == NULL);
+   assert(psCursor != NULL);
+   psCurr = SymTable_find(oSymTable, pcKey == NULL ? "" : pcKey, uLength,
+      oSymTable->uFlags, NULL);
+   if (psCurr == NULL) {
+      return 0;
+   }
+   psCursor->uIndex = 1;
+   psCursor->pvPlace = psCurr;
+   psCursor->pcKey = psCurr->psKey;
+   psCursor->pvValue = (void*) psCurr->pvItem;
+   return 1;
+}
+
+int SymTable_next(SymTable_T oSymTable, struct SymTableCursor *psCursor) {
+   const struct Node *psCurr;
+   assert(oSymTable != NULL);
+   assert(psCursor != NULL);
+   if (psCursor->uIndex == 0) {
+      psCurr = oSymTable->psFirst;
+   }
+   else if (psCursor->uIndex == 1) {
+      psCurr = ((const struct Node *)psCursor->pvPlace)->psNext;
+   }
+   else {
+      return 0;
+   }
+   if (psCurr == NULL) {
+      psCursor->uIndex = 2;
+      psCursor->pvPlace = NULL;
+      return 0;
+   }
+   psCursor->uIndex = 1;
+   psCursor->pvPlace = psCurr;
+   psCursor->pcKey = psCurr->psKey;
+   psCursor->pvValue = (void*) psCurr->pvItem;
+   return 1;
+}
+
 void* SymTable_replace(SymTable_T oSymTable, const char *pcKey, 
    const void *pvValue) {
    const void *outItem;
    struct Node *psCurr;
+   struct Node **ppsLink;
+   int iShared;
    assert( oSymTable != NULL);
    assert(pcKey != NULL);
-   psCurr = oSymTable->psFirst;
-   while(psCurr != NULL && strcmp(psCurr->psKey, pcKey) != 0){
-      psCurr = psCurr->psNext;
-   }
+   assert(! oSymTable->iReadOnly);
+   psCurr = SymTable_find(oSymTable, pcKey, strlen(pcKey),
+      oSymTable->uFlags, &iShared);
    if (psCurr == NULL) {
       return NULL;
    }
+   if (iShared) {
+      ppsLink = SymTable_ownPath(oSymTable, &oSymTable->psFirst,
+         psCurr);
+      if (ppsLink == NULL) {
+         return NULL;
+      }
+      psCurr = *ppsLink;
+   }
+   if (oSymTable->uValueSize != 0) {
+      memcpy((void*)psCurr->pvItem, pvValue, oSymTable->uValueSize);
+      return (void*) psCurr->pvItem;
+   }
    outItem = (void*) psCurr->pvItem;
    psCurr->pvItem = pvValue;
    return (void*) outItem;
 }
 
-void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+/* SymTable_removeKey takes in a oSymTable and a pcKey of uLength
+   characters, and removes the binding of pcKey as SymTable_remove
+   does. */
+static void *SymTable_removeKey(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength) {
    struct Node*removalNode;
    const void* outItem;
-   struct Node *psCurr;
-   assert( oSymTable != NULL);
-   assert(pcKey != NULL);
-   psCurr = oSymTable->psFirst;
-   if (psCurr == NULL) {
-      return NULL;
-   } 
-   if (strcmp(psCurr->psKey, pcKey) == 0) {
-      outItem = (void*) psCurr->pvItem;
-      removalNode = psCurr;
-      oSymTable->psFirst = psCurr->psNext;
-      free(removalNode->psKey);
-      free(removalNode);
-      oSymTable->length -=  1;
-      return (void *) outItem;
-   }
-   while(psCurr->psNext != NULL && 
-      strcmp(psCurr->psNext->psKey, pcKey) != 0){
-      psCurr = psCurr->psNext;
+   struct Node **ppsLink;
+   int iShared = 0;
+   ppsLink = &oSymTable->psFirst;
+   while(*ppsLink != NULL) {
+      STAT_ADD(oSymTable, uProbes, 1);
+      STAT_ADD(oSymTable, uCompares, 1);
+      if (REF_GET(&(*ppsLink)->uRefs) > 1) {
+         iShared = 1;
+      }
+      if (SymTable_keyEquals((*ppsLink)->psKey, pcKey, uLength)) {
+         break;
+      }
+      ppsLink = &(*ppsLink)->psNext;
    }
-   if (psCurr->psNext == NULL) {
+   if (*ppsLink == NULL) {
+      STAT_ADD(oSymTable, uMisses, 1);
       return NULL;
    }
-   outItem = (void*)psCurr->psNext->pvItem;
-   removalNode = psCurr->psNext;
-   psCurr->psNext = psCurr->psNext->psNext;
-   free(removalNode->psKey);
-   free(removalNode);
+   STAT_ADD(oSymTable, uHits, 1);
+   if (iShared) {
+      ppsLink = SymTable_ownPath(oSymTable, &oSymTable->psFirst,
+         *ppsLink);
+      if (ppsLink == NULL) {
+         return NULL;
+      }
+   }
+   removalNode = *ppsLink;
+   outItem = (void*)removalNode->pvItem;
+   /* the link of removalNode to the next node moves into its place */
+   *ppsLink = removalNode->psNext;
+   SymTable_discard(oSymTable, removalNode);
    oSymTable->length -= 1;
+   if (oSymTable->uValueSize != 0) {
+      return NULL;
+   }
    return (void *) outItem;
 }
 
-void SymTable_free(SymTable_T oSymTable) {
-   struct Node* curr;
-   struct Node* next;
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+   assert( oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(! oSymTable->iReadOnly);
+   return SymTable_removeKey(oSymTable, pcKey, strlen(pcKey));
+}
+
+void *SymTable_removeN(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength) {
    assert(oSymTable != NULL);
+   assert(pcKey != NULL || uLength == 0);
+   assert(uLength == 0 || memchr(pcKey, '\0', uLength) == NULL);
+   assert(! oSymTable->iReadOnly);
+   return SymTable_removeKey(oSymTable, pcKey == NULL ? "" : pcKey,
+      uLength);
+}
 
-   for (curr = oSymTable->psFirst; curr != NULL; 
-      curr = next) {
-      next = curr->psNext;
-      free(curr->psKey);
-      free(curr);
+size_t SymTable_reclaim(SymTable_T oSymTable, size_t uBudget) {
+   struct Node *psDead;
+   assert(oSymTable != NULL);
+   for (; uBudget > 0 && oSymTable->psDead != NULL; uBudget--) {
+      psDead = oSymTable->psDead;
+      oSymTable->psDead = psDead->psNext;
+      SymTable_freeKey(oSymTable, psDead->psKey);
+      free(psDead);
+      oSymTable->uDead -= 1;
    }
+   return oSymTable->uDead;
+}
+
+void SymTable_free(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+   SymTable_reclaim(oSymTable, oSymTable->uDead);
+   SymTable_release(oSymTable, oSymTable->psFirst);
    free(oSymTable);
 }
+
+SymTable_T SymTable_snapshot(SymTable_T oSymTable) {
+   SymTable_T oSnapshot;
+   assert(oSymTable != NULL);
+   oSnapshot = (SymTable_T) malloc(sizeof(struct SymTable));
+   if (oSnapshot == NULL) {
+      return NULL;
+   }
+   if (oSymTable->psFirst != NULL) {
+      REF_INC(&oSymTable->psFirst->uRefs);
+   }
+   oSnapshot->psFirst = oSymTable->psFirst;
+   oSnapshot->length = oSymTable->length;
+   /* a snapshot never reorders its bindings, so that several threads
+      may read it at once, but frees only the keys it owns */
+   oSnapshot->uFlags = oSymTable->uFlags & SYMTABLE_BORROW_KEYS;
+   oSnapshot->iReadOnly = 1;
+   oSnapshot->uValueSize = oSymTable->uValueSize;
+   oSnapshot->psDead = NULL;
+   oSnapshot->uDead = 0;
+   oSnapshot->uCapacity = 0;
+   oSnapshot->pfEvict = NULL;
+   oSnapshot->pvExtra = NULL;
+#ifdef SYMTABLE_STATS
+   memset(&oSnapshot->sStats, 0, sizeof(oSnapshot->sStats));
+   oSnapshot->sStats.uAllocations = 1;
+#endif
+   return oSnapshot;
+}
  
 void SymTable_map(SymTable_T oSymTable,
     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
@@ -187,6 +787,205 @@ void SymTable_map(SymTable_T oSymTable,
       (*pfApply)((void*)psCurr->psKey, (void *)psCurr->pvItem, (void*)pvExtra);
 }
 
+/* Nodes shared with a snapshot are only copied once a binding in or
+   after them is rejected, and each copying starts from the last
+   removal, so the whole pass stays linear. */
+int SymTable_retain(SymTable_T oSymTable,
+    int (*pfKeep)(const char *pcKey, void *pvValue, void *pvExtra),
+    void (*pfFree)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   struct Node **ppsFrom;
+   struct Node **ppsLink;
+   struct Node *psCurr;
+   int iShared = 0;
+   assert(oSymTable != NULL);
+   assert(pfKeep != NULL);
+   assert(! oSymTable->iReadOnly);
+   ppsFrom = &oSymTable->psFirst;
+   ppsLink = ppsFrom;
+   while (*ppsLink != NULL) {
+      psCurr = *ppsLink;
+      if (REF_GET(&psCurr->uRefs) > 1) {
+         iShared = 1;
+      }
+      if ((*pfKeep)(psCurr->psKey, (void *)psCurr->pvItem,
+         (void *)pvExtra)) {
+         ppsLink = &psCurr->psNext;
+         continue;
+      }
+      if (iShared) {
+         ppsLink = SymTable_ownPath(oSymTable, ppsFrom, psCurr);
+         if (ppsLink == NULL) {
+            return 0;
+         }
+         psCurr = *ppsLink;
+         iShared = 0;
+      }
+      if (pfFree != NULL) {
+         (*pfFree)(psCurr->psKey, (void *)psCurr->pvItem,
+            (void *)pvExtra);
+      }
+      /* the link of psCurr to the next node moves into its place */
+      *ppsLink = psCurr->psNext;
+      SymTable_discard(oSymTable, psCurr);
+      oSymTable->length -= 1;
+      ppsFrom = ppsLink;
+   }
+   return 1;
+}
+
+/* Difference is the pvExtra SymTable_difference passes to
+   SymTable_retain, with the SymTable oOther whose keys are removed
+   and the pfFree and pvExtra of the caller */
+struct Difference
+{
+   SymTable_T oOther;
+   void (*pfFree)(const char *pcKey, void *pvValue, void *pvExtra);
+   const void *pvExtra;
+};
+
+/* SymTable_lacks takes in a binding pcKey and pvValue and a
+   Difference pvExtra, and returns 1 if oOther of the Difference does
+   not have pcKey, otherwise 0. */
+static int SymTable_lacks(const char *pcKey, void *pvValue,
+   void *pvExtra) {
+   struct Difference *psDifference = (struct Difference *)pvExtra;
+   (void)pvValue;
+   return SymTable_find(psDifference->oOther, pcKey, strlen(pcKey), 0,
+      NULL) == NULL;
+}
 
+/* SymTable_freeDifference takes in a binding pcKey and pvValue and a
+   Difference pvExtra, and calls pfFree of the Difference on the
+   binding with the pvExtra of the caller. */
+static void SymTable_freeDifference(const char *pcKey, void *pvValue,
+   void *pvExtra) {
+   struct Difference *psDifference = (struct Difference *)pvExtra;
+   (*psDifference->pfFree)(pcKey, pvValue,
+      (void *)psDifference->pvExtra);
+}
 
+int SymTable_difference(SymTable_T oSymTable, SymTable_T oOther,
+    void (*pfFree)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   struct Difference sDifference;
+   assert(oSymTable != NULL);
+   assert(oOther != NULL);
+   assert(oSymTable != oOther);
+   sDifference.oOther = oOther;
+   sDifference.pfFree = pfFree;
+   sDifference.pvExtra = pvExtra;
+   return SymTable_retain(oSymTable, SymTable_lacks,
+      pfFree == NULL ? NULL : SymTable_freeDifference, &sDifference);
+}
 
+/* SymTable_merge relinks every node it moves in front of the first
+   node of oDst, key and all, so nothing is copied unless a snapshot
+   shares it. As in SymTable_retain, shared nodes of oSrc are copied
+   from the last change on, so the walk of oSrc stays linear. */
+int SymTable_merge(SymTable_T oDst, SymTable_T oSrc, unsigned int uPolicy) {
+   struct Node **ppsFrom;
+   struct Node **ppsLink;
+   struct Node **ppsFound;
+   struct Node *psCurr;
+   struct Node *psFound;
+   const void *pvOld;
+   size_t uBefore;
+   int iShared = 0;
+   int iFoundShared;
+   assert(oDst != NULL);
+   assert(oSrc != NULL);
+   assert(oDst != oSrc);
+   assert(! oDst->iReadOnly && ! oSrc->iReadOnly);
+   assert(oDst->uValueSize == oSrc->uValueSize);
+   assert((oDst->uFlags & SYMTABLE_BORROW_KEYS) ==
+      (oSrc->uFlags & SYMTABLE_BORROW_KEYS));
+   assert(uPolicy == SYMTABLE_MERGE_KEEP ||
+      uPolicy == SYMTABLE_MERGE_REPLACE);
+   ppsFrom = &oSrc->psFirst;
+   ppsLink = ppsFrom;
+   while (*ppsLink != NULL) {
+      psCurr = *ppsLink;
+      if (REF_GET(&psCurr->uRefs) > 1) {
+         iShared = 1;
+      }
+      psFound = SymTable_find(oDst, psCurr->psKey, strlen(psCurr->psKey),
+         0, &iFoundShared);
+      if (psFound != NULL && uPolicy == SYMTABLE_MERGE_KEEP) {
+         ppsLink = &psCurr->psNext;
+         continue;
+      }
+      if (iShared) {
+         ppsLink = SymTable_ownPath(oSrc, ppsFrom, psCurr);
+         if (ppsLink == NULL) {
+            return 0;
+         }
+         psCurr = *ppsLink;
+         iShared = 0;
+      }
+      if (psFound != NULL) {
+         if (iFoundShared) {
+            ppsFound = SymTable_ownPath(oDst, &oDst->psFirst, psFound);
+            if (ppsFound == NULL) {
+               return 0;
+            }
+            psFound = *ppsFound;
+         }
+         if (oDst->uValueSize != 0) {
+            memcpy((void*)psFound->pvItem, psCurr->pvItem,
+               oDst->uValueSize);
+         }
+         else {
+            pvOld = psFound->pvItem;
+            psFound->pvItem = psCurr->pvItem;
+            psCurr->pvItem = pvOld;
+         }
+         ppsLink = &psCurr->psNext;
+         ppsFrom = ppsLink;
+         continue;
+      }
+      /* the link of psCurr to the next node moves into its place, and
+         psCurr takes the link from oDst to its first node */
+      *ppsLink = psCurr->psNext;
+      psCurr->psNext = oDst->psFirst;
+      oDst->psFirst = psCurr;
+      oSrc->length -= 1;
+      oDst->length += 1;
+      ppsFrom = ppsLink;
+   }
+   while (oDst->uCapacity != 0 && oDst->length > oDst->uCapacity) {
+      uBefore = oDst->length;
+      SymTable_evict(oDst);
+      if (oDst->length == uBefore) {
+         return 0;
+      }
+   }
+   return 1;
+}
+
+int SymTable_mapRange(SymTable_T oSymTable, const char *pcLo,
+    const char *pcHi,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   return SymTable_mapSorted(oSymTable, pcLo, pcHi, NULL, pfApply,
+      pvExtra);
+}
+
+int SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   assert(pcPrefix != NULL);
+   return SymTable_mapSorted(oSymTable, pcPrefix, NULL, pcPrefix,
+      pfApply, pvExtra);
+}
+
+struct SymTableStats SymTable_getStats(SymTable_T oSymTable) {
+   struct SymTableStats sStats;
+   assert(oSymTable != NULL);
+#ifdef SYMTABLE_STATS
+   sStats = oSymTable->sStats;
+#else
+   memset(&sStats, 0, sizeof(sStats));
+#endif
+   return sStats;
+}
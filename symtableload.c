@@ -0,0 +1,218 @@
+/*--------------------------------------------------------------------*/
+/* symtableload.c                                                   */
+/* Author: Kevin Chen                                               */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "symtable.h"
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* SymTable_loadStream maps a regular file into memory where POSIX
+   allows it, and reads it into a buffer everywhere else. */
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#if defined(_POSIX_MAPPED_FILES) && _POSIX_MAPPED_FILES > 0
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define SYMTABLE_MMAP
+#endif
+#endif
+
+/* Note: SymTable_loadStream only uses SymTable_putN and
+   SymTable_lookupN, so this file goes with any of the
+   implementations. Lines are cut out of the
+   mapped file or the buffer where they lie, and each key is copied
+   once, by SymTable_putN, straight into the storage of the SymTable. */
+
+/* LOAD_BUFFER is the size in bytes of the buffer a stream that cannot
+   be mapped is read into. The buffer doubles whenever one line does
+   not fit */
+enum {LOAD_BUFFER = 1 << 20};
+
+/*--------------------------------------------------------------------*/
+
+/* Load_line takes in a oSymTable, a line of uLength characters at
+   pcLine without its '\n', pfParse, pfFree and pvExtra as for
+   SymTable_loadStream, and binds the key of the line to the value
+   pfParse makes of the rest, unless the key is bound already. Returns
+   1 if successful, or 0 if the key has a '\0' in it, pfParse fails or
+   there is no memory. */
+static int Load_line(SymTable_T oSymTable, const char *pcLine,
+   size_t uLength,
+   int (*pfParse)(const char *pcValue, size_t uLength, void **ppvValue,
+      void *pvExtra),
+   void (*pfFree)(void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+   struct SymTableCursor sCursor = SYMTABLE_CURSOR_INIT;
+   const char *pcTab;
+   const char *pcValue;
+   size_t uKeyLength;
+   void *pvValue = NULL;
+   int iSuccessful;
+   if (uLength != 0 && pcLine[uLength - 1] == '\r') {
+      uLength--;
+   }
+   if (uLength == 0) {
+      return 1;
+   }
+   pcTab = (const char *) memchr(pcLine, '\t', uLength);
+   uKeyLength = pcTab == NULL ? uLength : (size_t)(pcTab - pcLine);
+   pcValue = pcTab == NULL ? pcLine + uLength : pcTab + 1;
+   if (memchr(pcLine, '\0', uKeyLength) != NULL) {
+      return 0;
+   }
+   if (pfParse != NULL && ! (*pfParse)(pcValue,
+      (size_t)(pcLine + uLength - pcValue), &pvValue, (void *)pvExtra)) {
+      return 0;
+   }
+   /* SymTable_putN alone decides a new key. Only when it fails does a
+      lookup tell a key bound already, whose first binding wins, from
+      running out of memory, and either way the value is dropped */
+   if (SymTable_putN(oSymTable, pcLine, uKeyLength, pvValue)) {
+      return 1;
+   }
+   iSuccessful = SymTable_lookupN(oSymTable, pcLine, uKeyLength,
+      &sCursor);
+   if (pfParse != NULL && pfFree != NULL) {
+      (*pfFree)(pvValue, (void *)pvExtra);
+   }
+   return iSuccessful;
+}
+
+/* Load_lines takes in a oSymTable, uLength characters at pcText,
+   pfParse, pfFree and pvExtra, and loads every line of pcText that
+   ends in a '\n', and also the last line if iLast is 1. Stores the
+   number of characters loaded in *puUsed. Returns 1 if successful,
+   otherwise 0, as for Load_line. */
+static int Load_lines(SymTable_T oSymTable, const char *pcText,
+   size_t uLength, int iLast,
+   int (*pfParse)(const char *pcValue, size_t uLength, void **ppvValue,
+      void *pvExtra),
+   void (*pfFree)(void *pvValue, void *pvExtra),
+   const void *pvExtra, size_t *puUsed) {
+   const char *pcLine = pcText;
+   const char *pcEnd = pcText + uLength;
+   const char *pcNewline;
+   while (pcLine < pcEnd) {
+      pcNewline = (const char *) memchr(pcLine, '\n',
+         (size_t)(pcEnd - pcLine));
+      if (pcNewline == NULL) {
+         if (! iLast) {
+            break;
+         }
+         pcNewline = pcEnd;
+      }
+      if (! Load_line(oSymTable, pcLine, (size_t)(pcNewline - pcLine),
+         pfParse, pfFree, pvExtra)) {
+         *puUsed = (size_t)(pcLine - pcText);
+         return 0;
+      }
+      pcLine = pcNewline == pcEnd ? pcEnd : pcNewline + 1;
+   }
+   *puUsed = (size_t)(pcLine - pcText);
+   return 1;
+}
+
+#ifdef SYMTABLE_MMAP
+/* Load_map takes in the arguments of SymTable_loadStream and, if
+   psFile is a regular file, maps the rest of it into memory, loads it
+   and stores whether that was successful in *piSuccessful. Returns 1
+   if it did so, or 0 if psFile cannot be mapped, in which case it has
+   read nothing. */
+static int Load_map(SymTable_T oSymTable, FILE *psFile,
+   int (*pfParse)(const char *pcValue, size_t uLength, void **ppvValue,
+      void *pvExtra),
+   void (*pfFree)(void *pvValue, void *pvExtra),
+   const void *pvExtra, int *piSuccessful) {
+   struct stat sStat;
+   long lOffset;
+   size_t uUsed;
+   char *pcMap;
+   int iFd;
+   iFd = fileno(psFile);
+   lOffset = ftell(psFile);
+   if (iFd < 0 || lOffset < 0 || fstat(iFd, &sStat) != 0 ||
+      ! S_ISREG(sStat.st_mode) || sStat.st_size < (off_t)lOffset) {
+      return 0;
+   }
+   if (sStat.st_size == (off_t)lOffset) {
+      *piSuccessful = 1;
+      return 1;
+   }
+   pcMap = (char *) mmap(NULL, (size_t)sStat.st_size, PROT_READ,
+      MAP_PRIVATE, iFd, 0);
+   if (pcMap == (char *) MAP_FAILED) {
+      return 0;
+   }
+   posix_madvise(pcMap, (size_t)sStat.st_size, POSIX_MADV_SEQUENTIAL);
+   *piSuccessful = Load_lines(oSymTable, pcMap + lOffset,
+      (size_t)(sStat.st_size - (off_t)lOffset), 1, pfParse, pfFree,
+      pvExtra, &uUsed);
+   munmap(pcMap, (size_t)sStat.st_size);
+   /* leave psFile after what was loaded, as reading would */
+   fseek(psFile, lOffset + (long)uUsed, SEEK_SET);
+   return 1;
+}
+#endif
+
+int SymTable_loadStream(SymTable_T oSymTable, FILE *psFile,
+   int (*pfParse)(const char *pcValue, size_t uLength, void **ppvValue,
+      void *pvExtra),
+   void (*pfFree)(void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+   char *pcBuffer;
+   char *pcNew;
+   size_t uSize = LOAD_BUFFER;
+   size_t uFilled = 0;
+   size_t uRead;
+   size_t uUsed;
+   int iSuccessful = 1;
+   int iLast;
+   assert(oSymTable != NULL);
+   assert(psFile != NULL);
+   /* the keys would be borrowed from pcBuffer, which is freed below */
+   assert(! (SymTable_getFlags(oSymTable) & SYMTABLE_BORROW_KEYS));
+   if (SymTable_getFlags(oSymTable) & SYMTABLE_BORROW_KEYS) {
+      return 0;
+   }
+#ifdef SYMTABLE_MMAP
+   if (Load_map(oSymTable, psFile, pfParse, pfFree, pvExtra,
+      &iSuccessful)) {
+      return iSuccessful;
+   }
+#endif
+   pcBuffer = (char *) malloc(uSize);
+   if (pcBuffer == NULL) {
+      return 0;
+   }
+   do {
+      if (uFilled == uSize) {
+         pcNew = (char *) realloc(pcBuffer, 2 * uSize);
+         if (pcNew == NULL) {
+            iSuccessful = 0;
+            break;
+         }
+         pcBuffer = pcNew;
+         uSize *= 2;
+      }
+      uRead = fread(pcBuffer + uFilled, 1, uSize - uFilled, psFile);
+      uFilled += uRead;
+      iLast = uRead == 0;
+      if (iLast && ferror(psFile)) {
+         iSuccessful = 0;
+         break;
+      }
+      iSuccessful = Load_lines(oSymTable, pcBuffer, uFilled, iLast,
+         pfParse, pfFree, pvExtra, &uUsed);
+      /* keep the line that did not end in the buffer for the next
+         read */
+      memmove(pcBuffer, pcBuffer + uUsed, uFilled - uUsed);
+      uFilled -= uUsed;
+   } while (iSuccessful && ! iLast);
+   free(pcBuffer);
+   return iSuccessful;
+}
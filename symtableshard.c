@@ -0,0 +1,436 @@
+/*--------------------------------------------------------------------*/
+/* symtableshard.c                                                  */
+/* Author: Kevin Chen                                               */
+/*--------------------------------------------------------------------*/
+
+#include "symtableshard.h"
+#include "symtablegen.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/* LENGTH_SET and LENGTH_GET write and read the length of a Shard. It
+   is only written under the lock of the Shard, but is read without
+   it, so both are atomic where the compiler allows it. */
+#if defined(__GNUC__)
+#define LENGTH_SET(puLength, uLength) \
+   __atomic_store_n((puLength), (uLength), __ATOMIC_RELAXED)
+#define LENGTH_GET(puLength) __atomic_load_n((puLength), __ATOMIC_RELAXED)
+#else
+#define LENGTH_SET(puLength, uLength) (*(puLength) = (uLength))
+#define LENGTH_GET(puLength) (*(puLength))
+#endif
+
+/* EPOCH_ADD, EPOCH_GET and EPOCH_SET add one to, read and write the
+   epoch of a ShardTable and the epoch each ShardThread last saw.
+   Each is written by one thread and read by others without a lock,
+   and what a thread did before it writes one must be seen by any
+   thread that reads it, so they are atomic and ordered where the
+   compiler allows it. */
+#if defined(__GNUC__)
+#define EPOCH_ADD(puEpoch) __atomic_add_fetch((puEpoch), 1, __ATOMIC_ACQ_REL)
+#define EPOCH_GET(puEpoch) __atomic_load_n((puEpoch), __ATOMIC_ACQUIRE)
+#define EPOCH_SET(puEpoch, uEpoch) \
+   __atomic_store_n((puEpoch), (uEpoch), __ATOMIC_RELEASE)
+#else
+#define EPOCH_ADD(puEpoch) (++*(puEpoch))
+#define EPOCH_GET(puEpoch) (*(puEpoch))
+#define EPOCH_SET(puEpoch, uEpoch) (*(puEpoch) = (uEpoch))
+#endif
+
+/* CACHE_LINE is the size in bytes of a cache line. Every Shard starts
+   on one and takes a whole number of them, so that no two Shards
+   share a line */
+enum {CACHE_LINE = 64};
+
+/* Shard is one SymTable of a ShardTable, its lock and its length */
+struct Shard
+{
+   /* sLock is held by whichever thread uses oSymTable */
+   pthread_mutex_t sLock;
+   /* oSymTable holds the bindings of the keys of the Shard */
+   SymTable_T oSymTable;
+   /* uLength is the length of oSymTable, kept here so that it can be
+      read without the lock */
+   size_t uLength;
+};
+
+/* SPARE_RETIRED is the most Retireds a ShardThread keeps to use
+   again */
+enum {SPARE_RETIRED = 256};
+
+/* Retired is a value retired from a ShardTable, to be freed by
+   pfFree once every joined thread has passed a quiescent state since
+   the ShardTable reached epoch uEpoch */
+struct Retired
+{
+   void *pvValue;
+   void (*pfFree)(void *pvValue);
+   size_t uEpoch;
+   struct Retired *psNext;
+};
+
+/* ShardThread is a thread joined to a ShardTable */
+struct ShardThread
+{
+   /* uSeen is the epoch of the ShardTable at the last quiescent state
+      of the thread. Only the thread writes it, but any thread may
+      read it */
+   size_t uSeen;
+   /* psRetired lists the values the thread retired, newest first, so
+      with their epochs decreasing */
+   struct Retired *psRetired;
+   /* psSpare lists the uSpare Retireds the thread freed, which its
+      next retired values take before malloc */
+   struct Retired *psSpare;
+   size_t uSpare;
+   /* psNext points to the next ShardThread of the ShardTable */
+   struct ShardThread *psNext;
+};
+
+/* ShardSlot pads a Shard to a whole number of cache lines */
+union ShardSlot
+{
+   struct Shard sShard;
+   char acPad[(sizeof(struct Shard) + CACHE_LINE - 1) / CACHE_LINE *
+      CACHE_LINE];
+};
+
+/* ShardTable is uShards Shards, uShards a power of 2 equal to
+   2 to the uBits. The Shard of a key is the top uBits bits of its
+   mixed hash code */
+struct ShardTable
+{
+   /* psSlots points to the first Shard, which starts on a cache
+      line, and pvBlock to the memory malloc'd for them */
+   union ShardSlot *psSlots;
+   void *pvBlock;
+   size_t uShards;
+   unsigned int uBits;
+   /* uEpoch goes up by one with every value retired */
+   size_t uEpoch;
+   /* sThreadsLock is held by whichever thread uses psThreads, the
+      joined ShardThreads, or psOrphans, the Retireds of the threads
+      that left */
+   pthread_mutex_t sThreadsLock;
+   struct ShardThread *psThreads;
+   struct Retired *psOrphans;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* ShardTable_shard takes in a oShardTable and a pcKey, and returns
+   the Shard of pcKey. The hash code is multiplied by the odd number
+   nearest 2 to the 64 over the golden ratio, which spreads every bit
+   of it to the top bits, so that the top bits do not follow the low
+   ones the shards' SymTables pick their buckets by, and short keys,
+   whose hash codes are small, still spread over every Shard. */
+static struct Shard *ShardTable_shard(ShardTable_T oShardTable,
+   const char *pcKey) {
+   size_t uHash;
+   assert(oShardTable != NULL);
+   assert(pcKey != NULL);
+   if (oShardTable->uBits == 0) {
+      return &oShardTable->psSlots[0].sShard;
+   }
+   uHash = SymTable_hashString(pcKey) *
+      (size_t)UINT64_C(0x9E3779B97F4A7C15);
+   return &oShardTable->psSlots[uHash >>
+      (sizeof(size_t) * CHAR_BIT - oShardTable->uBits)].sShard;
+}
+
+ShardTable_T ShardTable_new(size_t uShards, unsigned int uFlags) {
+   ShardTable_T oShardTable;
+   struct Shard *psShard;
+   size_t i;
+   oShardTable = (ShardTable_T) malloc(sizeof(struct ShardTable));
+   if (oShardTable == NULL) {
+      return NULL;
+   }
+   oShardTable->uBits = 0;
+   while (((size_t)1 << oShardTable->uBits) < uShards &&
+      oShardTable->uBits < sizeof(size_t) * CHAR_BIT - 1) {
+      oShardTable->uBits++;
+   }
+   oShardTable->uShards = (size_t)1 << oShardTable->uBits;
+   oShardTable->uEpoch = 0;
+   oShardTable->psThreads = NULL;
+   oShardTable->psOrphans = NULL;
+   if (pthread_mutex_init(&oShardTable->sThreadsLock, NULL) != 0) {
+      free(oShardTable);
+      return NULL;
+   }
+   oShardTable->pvBlock = malloc(oShardTable->uShards *
+      sizeof(union ShardSlot) + CACHE_LINE - 1);
+   if (oShardTable->pvBlock == NULL) {
+      pthread_mutex_destroy(&oShardTable->sThreadsLock);
+      free(oShardTable);
+      return NULL;
+   }
+   oShardTable->psSlots = (union ShardSlot *)
+      (((uintptr_t)oShardTable->pvBlock + CACHE_LINE - 1) &
+      ~(uintptr_t)(CACHE_LINE - 1));
+   for (i = 0; i < oShardTable->uShards; i++) {
+      psShard = &oShardTable->psSlots[i].sShard;
+      psShard->oSymTable = SymTable_newWithFlags(uFlags);
+      if (psShard->oSymTable == NULL ||
+         pthread_mutex_init(&psShard->sLock, NULL) != 0) {
+         if (psShard->oSymTable != NULL) {
+            SymTable_free(psShard->oSymTable);
+         }
+         oShardTable->uShards = i;
+         ShardTable_free(oShardTable);
+         return NULL;
+      }
+      psShard->uLength = 0;
+   }
+   return oShardTable;
+}
+
+/* Retired_free takes in a list of Retireds psRetired, and frees
+   their values and them. */
+static void Retired_free(struct Retired *psRetired) {
+   struct Retired *psNext;
+   for (; psRetired != NULL; psRetired = psNext) {
+      psNext = psRetired->psNext;
+      (*psRetired->pfFree)(psRetired->pvValue);
+      free(psRetired);
+   }
+}
+
+void ShardTable_free(ShardTable_T oShardTable) {
+   struct Shard *psShard;
+   size_t i;
+   assert(oShardTable != NULL);
+   assert(oShardTable->psThreads == NULL);
+   for (i = 0; i < oShardTable->uShards; i++) {
+      psShard = &oShardTable->psSlots[i].sShard;
+      SymTable_free(psShard->oSymTable);
+      pthread_mutex_destroy(&psShard->sLock);
+   }
+   Retired_free(oShardTable->psOrphans);
+   pthread_mutex_destroy(&oShardTable->sThreadsLock);
+   free(oShardTable->pvBlock);
+   free(oShardTable);
+}
+
+size_t ShardTable_getLength(ShardTable_T oShardTable) {
+   size_t uLength = 0;
+   size_t i;
+   assert(oShardTable != NULL);
+   for (i = 0; i < oShardTable->uShards; i++) {
+      uLength += LENGTH_GET(&oShardTable->psSlots[i].sShard.uLength);
+   }
+   return uLength;
+}
+
+size_t ShardTable_getShards(ShardTable_T oShardTable) {
+   assert(oShardTable != NULL);
+   return oShardTable->uShards;
+}
+
+int ShardTable_put(ShardTable_T oShardTable, const char *pcKey,
+   const void *pvValue) {
+   struct Shard *psShard = ShardTable_shard(oShardTable, pcKey);
+   int iSuccessful;
+   pthread_mutex_lock(&psShard->sLock);
+   iSuccessful = SymTable_put(psShard->oSymTable, pcKey, pvValue);
+   if (iSuccessful) {
+      LENGTH_SET(&psShard->uLength, psShard->uLength + 1);
+   }
+   pthread_mutex_unlock(&psShard->sLock);
+   return iSuccessful;
+}
+
+void *ShardTable_replace(ShardTable_T oShardTable, const char *pcKey,
+   const void *pvValue) {
+   struct Shard *psShard = ShardTable_shard(oShardTable, pcKey);
+   void *pvOldValue;
+   pthread_mutex_lock(&psShard->sLock);
+   pvOldValue = SymTable_replace(psShard->oSymTable, pcKey, pvValue);
+   pthread_mutex_unlock(&psShard->sLock);
+   return pvOldValue;
+}
+
+int ShardTable_contains(ShardTable_T oShardTable, const char *pcKey) {
+   struct Shard *psShard = ShardTable_shard(oShardTable, pcKey);
+   int iFound;
+   pthread_mutex_lock(&psShard->sLock);
+   iFound = SymTable_contains(psShard->oSymTable, pcKey);
+   pthread_mutex_unlock(&psShard->sLock);
+   return iFound;
+}
+
+void *ShardTable_get(ShardTable_T oShardTable, const char *pcKey) {
+   struct Shard *psShard = ShardTable_shard(oShardTable, pcKey);
+   void *pvValue;
+   pthread_mutex_lock(&psShard->sLock);
+   pvValue = SymTable_get(psShard->oSymTable, pcKey);
+   pthread_mutex_unlock(&psShard->sLock);
+   return pvValue;
+}
+
+void *ShardTable_remove(ShardTable_T oShardTable, const char *pcKey) {
+   struct Shard *psShard = ShardTable_shard(oShardTable, pcKey);
+   void *pvValue;
+   pthread_mutex_lock(&psShard->sLock);
+   pvValue = SymTable_remove(psShard->oSymTable, pcKey);
+   /* the value may be NULL even when a binding was removed, so the
+      length is asked of the SymTable */
+   LENGTH_SET(&psShard->uLength, SymTable_getLength(psShard->oSymTable));
+   pthread_mutex_unlock(&psShard->sLock);
+   return pvValue;
+}
+
+void ShardTable_map(ShardTable_T oShardTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+   struct Shard *psShard;
+   size_t i;
+   assert(oShardTable != NULL);
+   assert(pfApply != NULL);
+   for (i = 0; i < oShardTable->uShards; i++) {
+      psShard = &oShardTable->psSlots[i].sShard;
+      pthread_mutex_lock(&psShard->sLock);
+      SymTable_map(psShard->oSymTable, pfApply, pvExtra);
+      pthread_mutex_unlock(&psShard->sLock);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+ShardThread_T ShardTable_join(ShardTable_T oShardTable) {
+   ShardThread_T oShardThread;
+   assert(oShardTable != NULL);
+   oShardThread = (ShardThread_T) malloc(sizeof(struct ShardThread));
+   if (oShardThread == NULL) {
+      return NULL;
+   }
+   oShardThread->psRetired = NULL;
+   oShardThread->psSpare = NULL;
+   oShardThread->uSpare = 0;
+   pthread_mutex_lock(&oShardTable->sThreadsLock);
+   EPOCH_SET(&oShardThread->uSeen, EPOCH_GET(&oShardTable->uEpoch));
+   oShardThread->psNext = oShardTable->psThreads;
+   oShardTable->psThreads = oShardThread;
+   pthread_mutex_unlock(&oShardTable->sThreadsLock);
+   return oShardThread;
+}
+
+void ShardTable_leave(ShardTable_T oShardTable,
+   ShardThread_T oShardThread) {
+   struct ShardThread **ppsThread;
+   struct Retired *psLast;
+   struct Retired *psNext;
+   assert(oShardTable != NULL);
+   assert(oShardThread != NULL);
+   pthread_mutex_lock(&oShardTable->sThreadsLock);
+   for (ppsThread = &oShardTable->psThreads; *ppsThread != oShardThread;
+      ppsThread = &(*ppsThread)->psNext) {
+      assert(*ppsThread != NULL);
+   }
+   *ppsThread = oShardThread->psNext;
+   if (oShardThread->psRetired != NULL) {
+      for (psLast = oShardThread->psRetired; psLast->psNext != NULL;
+         psLast = psLast->psNext) {
+      }
+      psLast->psNext = oShardTable->psOrphans;
+      oShardTable->psOrphans = oShardThread->psRetired;
+   }
+   pthread_mutex_unlock(&oShardTable->sThreadsLock);
+   for (; oShardThread->psSpare != NULL;
+      oShardThread->psSpare = psNext) {
+      psNext = oShardThread->psSpare->psNext;
+      free(oShardThread->psSpare);
+   }
+   free(oShardThread);
+}
+
+void ShardTable_quiesce(ShardTable_T oShardTable,
+   ShardThread_T oShardThread) {
+   struct ShardThread *psThread;
+   struct Retired **ppsRetired;
+   struct Retired *psDone = NULL;
+   struct Retired *psRetired;
+   size_t uOldest;
+   assert(oShardTable != NULL);
+   assert(oShardThread != NULL);
+   uOldest = EPOCH_GET(&oShardTable->uEpoch);
+   EPOCH_SET(&oShardThread->uSeen, uOldest);
+   if (oShardThread->psRetired == NULL) {
+      return;
+   }
+
+   /* a value retired at an epoch no later than the oldest one any
+      joined thread last saw was removed before every thread's last
+      quiescent state */
+   pthread_mutex_lock(&oShardTable->sThreadsLock);
+   for (psThread = oShardTable->psThreads; psThread != NULL;
+      psThread = psThread->psNext) {
+      if (EPOCH_GET(&psThread->uSeen) < uOldest) {
+         uOldest = EPOCH_GET(&psThread->uSeen);
+      }
+   }
+   for (ppsRetired = &oShardTable->psOrphans; *ppsRetired != NULL;) {
+      psRetired = *ppsRetired;
+      if (psRetired->uEpoch <= uOldest) {
+         *ppsRetired = psRetired->psNext;
+         psRetired->psNext = psDone;
+         psDone = psRetired;
+      }
+      else {
+         ppsRetired = &psRetired->psNext;
+      }
+   }
+   pthread_mutex_unlock(&oShardTable->sThreadsLock);
+   Retired_free(psDone);
+
+   /* the values of the thread itself are newest first, so once one
+      can be freed all after it can too */
+   for (ppsRetired = &oShardThread->psRetired; *ppsRetired != NULL &&
+      (*ppsRetired)->uEpoch > uOldest;
+      ppsRetired = &(*ppsRetired)->psNext) {
+   }
+   psRetired = *ppsRetired;
+   *ppsRetired = NULL;
+   while (psRetired != NULL) {
+      psDone = psRetired;
+      psRetired = psRetired->psNext;
+      (*psDone->pfFree)(psDone->pvValue);
+      if (oShardThread->uSpare < SPARE_RETIRED) {
+         psDone->psNext = oShardThread->psSpare;
+         oShardThread->psSpare = psDone;
+         oShardThread->uSpare += 1;
+      }
+      else {
+         free(psDone);
+      }
+   }
+}
+
+int ShardTable_retire(ShardTable_T oShardTable, ShardThread_T oShardThread,
+   void *pvValue, void (*pfFree)(void *pvValue)) {
+   struct Retired *psRetired;
+   assert(oShardTable != NULL);
+   assert(oShardThread != NULL);
+   assert(pfFree != NULL);
+   psRetired = oShardThread->psSpare;
+   if (psRetired != NULL) {
+      oShardThread->psSpare = psRetired->psNext;
+      oShardThread->uSpare -= 1;
+   }
+   else {
+      psRetired = (struct Retired *) malloc(sizeof(struct Retired));
+      if (psRetired == NULL) {
+         return 0;
+      }
+   }
+   psRetired->pvValue = pvValue;
+   psRetired->pfFree = pfFree;
+   psRetired->uEpoch = EPOCH_ADD(&oShardTable->uEpoch);
+   psRetired->psNext = oShardThread->psRetired;
+   oShardThread->psRetired = psRetired;
+   return 1;
+}
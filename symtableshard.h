@@ -0,0 +1,119 @@
+/*--------------------------------------------------------------------*/
+/* symtableshard.h                                                  */
+/* Author: Kevin Chen                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef symtableshardH
+#define symtableshardH
+
+#include "symtable.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Note: A ShardTable spreads its bindings over a number of SymTables,
+   its shards, by the top bits of the hash of each key. Each shard has
+   a lock of its own, grows on its own and counts its own bindings on
+   a cache line of its own, so threads that put, get and remove keys
+   of different shards never wait for each other and never write the
+   same cache line. Unlike a SymTable, a ShardTable may be used by
+   many threads at once.
+
+   A value one thread removes may still be in use by another that got
+   it just before. Threads that share values through a ShardTable can
+   join it, and retire removed values instead of freeing them: a
+   retired value is freed once every joined thread has passed a
+   quiescent state, a call to ShardTable_quiesce at a point where it
+   holds no value it got from the ShardTable. The memory that keeps
+   track of this stays with the thread that retired the value, and
+   shards made with SYMTABLE_THREAD_CACHE keep the memory of removed
+   bindings with the thread that removed them in the same way. */
+
+/* ShardTable_T is a pointer to a ShardTable */
+typedef struct ShardTable *ShardTable_T;
+
+/* ShardTable_new takes in a number of shards uShards, which is
+   rounded up to a power of 2, and uFlags as for SymTable_newWithFlags,
+   and creates a new empty ShardTable_T whose shards are SymTables
+   made with uFlags. Returns the ShardTable_T, or NULL if there is no
+   memory. */
+ShardTable_T ShardTable_new(size_t uShards, unsigned int uFlags);
+
+/* ShardThread_T is a pointer to a ShardThread, what one thread keeps
+   while it is joined to a ShardTable */
+typedef struct ShardThread *ShardThread_T;
+
+/* ShardTable_free takes in a oShardTable and frees it and all of its
+   shards, and frees the values retired but not freed yet. No other
+   thread may be using it, and every thread that joined it must have
+   left. */
+void ShardTable_free(ShardTable_T oShardTable);
+
+/* ShardTable_getLength takes in a oShardTable and returns how many
+   bindings it has. It takes no lock, so while other threads change
+   the oShardTable it may miss their latest changes. */
+size_t ShardTable_getLength(ShardTable_T oShardTable);
+
+/* ShardTable_getShards takes in a oShardTable and returns how many
+   shards it has. */
+size_t ShardTable_getShards(ShardTable_T oShardTable);
+
+/* ShardTable_put, ShardTable_replace, ShardTable_contains,
+   ShardTable_get and ShardTable_remove work like SymTable_put,
+   SymTable_replace, SymTable_contains, SymTable_get and
+   SymTable_remove, holding the lock of the shard of pcKey. */
+int ShardTable_put(ShardTable_T oShardTable, const char *pcKey,
+   const void *pvValue);
+void *ShardTable_replace(ShardTable_T oShardTable, const char *pcKey,
+   const void *pvValue);
+int ShardTable_contains(ShardTable_T oShardTable, const char *pcKey);
+void *ShardTable_get(ShardTable_T oShardTable, const char *pcKey);
+void *ShardTable_remove(ShardTable_T oShardTable, const char *pcKey);
+
+/* ShardTable_map works like SymTable_map, one shard at a time, holding
+   the lock of the shard it is in. pfApply must not use the
+   oShardTable. */
+void ShardTable_map(ShardTable_T oShardTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra);
+
+/* ShardTable_join takes in a oShardTable and joins the calling thread
+   to it, so that values retired from now on wait for it to pass a
+   quiescent state. Joining is its first one. Returns the
+   ShardThread_T of the thread, which only it may use, or NULL if
+   there is no memory. */
+ShardThread_T ShardTable_join(ShardTable_T oShardTable);
+
+/* ShardTable_leave takes in a oShardTable and the oShardThread the
+   calling thread joined it with, and takes the thread out of it,
+   which is its last quiescent state. The values it retired that
+   cannot be freed yet are freed by a later ShardTable_quiesce of a
+   thread that has retired values of its own, or by ShardTable_free. */
+void ShardTable_leave(ShardTable_T oShardTable, ShardThread_T oShardThread);
+
+/* ShardTable_quiesce takes in a oShardTable and the oShardThread of
+   the calling thread, which must hold no value it got from the
+   oShardTable, and records that it passed a quiescent state. If the
+   thread has retired values, it then frees those, and those of
+   threads that left, that every joined thread has passed a quiescent
+   state since. */
+void ShardTable_quiesce(ShardTable_T oShardTable,
+   ShardThread_T oShardThread);
+
+/* ShardTable_retire takes in a oShardTable, the oShardThread of the
+   calling thread, a pvValue it removed from the oShardTable and
+   function pfFree, and leaves pvValue to be freed by pfFree once
+   every joined thread has passed a quiescent state, so that none can
+   still be using it. pfFree must not use the oShardTable. Returns 1
+   if successful, or 0 if there is no memory, in which case pvValue
+   stays the caller's. */
+int ShardTable_retire(ShardTable_T oShardTable, ShardThread_T oShardThread,
+   void *pvValue, void (*pfFree)(void *pvValue));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1542 @@
+/*--------------------------------------------------------------------*/
+/* symtabletree.c                                                     */
+/* Author: Kevin Chen                                                 */
+/*--------------------------------------------------------------------*/
+
+#include "symtable.h"
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+/* Note: This file keeps the bindings in a B-tree ordered by strcmp on
+   the keys, so SymTable_map, SymTable_mapRange and SymTable_mapPrefix
+   visit them in sorted order, and the range functions only visit the
+   BTreeNodes that can hold a matching key. A snapshot shares the
+   BTreeNodes of its SymTable, and whichever of them changes later
+   copies only the BTreeNodes on the path to the change. */
+
+#ifdef SYMTABLE_STATS
+/* When SYMTABLE_STATS is defined, STAT_ADD adds uCount to one of the
+   counters of a SymTable. Otherwise it expands to nothing, so the
+   normal build does no counting at all. */
+#define STAT_ADD(oSymTable, field, uCount) \
+   ((oSymTable)->sStats.field += (uCount))
+#else
+#define STAT_ADD(oSymTable, field, uCount) ((void)0)
+#endif
+
+/* REF_INC and REF_DEC add one to or take one from a reference count
+   and give the new count, and REF_GET reads one. They are atomic
+   where the compiler allows it, so that a snapshot may be used and
+   freed on another thread than the SymTable it was taken from. */
+#if defined(__GNUC__)
+#define REF_INC(puRefs) __atomic_add_fetch((puRefs), 1, __ATOMIC_RELAXED)
+#define REF_DEC(puRefs) __atomic_sub_fetch((puRefs), 1, __ATOMIC_ACQ_REL)
+#define REF_GET(puRefs) __atomic_load_n((puRefs), __ATOMIC_ACQUIRE)
+#else
+#define REF_INC(puRefs) (++*(puRefs))
+#define REF_DEC(puRefs) (--*(puRefs))
+#define REF_GET(puRefs) (*(puRefs))
+#endif
+
+/* MIN_DEGREE is the minimum degree of the B-tree. Every BTreeNode
+   other than the root holds between MIN_DEGREE - 1 and MAX_KEYS
+   bindings */
+enum {MIN_DEGREE = 8, MAX_KEYS = 2 * MIN_DEGREE - 1};
+
+/* Align is a union of the types that need the most alignment, so that
+   a value of any type may start at a multiple of its size */
+union Align
+{
+   long double ld;
+   long long ll;
+   void *pv;
+   void (*pf)(void);
+};
+
+/* The BTreeNode struct is one node of the B-tree. It contains up to
+   MAX_KEYS bindings in increasing order of key and, unless it is a
+   leaf, one more child than bindings */
+struct BTreeNode
+{
+   /* count is a size_t that stores how many bindings are in the
+      BTreeNode */
+   size_t count;
+   /* iLeaf is 1 if the BTreeNode has no children, otherwise 0 */
+   int iLeaf;
+   /* uRefs is how many SymTables and BTreeNodes link to the
+      BTreeNode. A BTreeNode with more than one link, or below one
+      that has, is shared and must be copied before it changes */
+   size_t uRefs;
+   /* apcKeys stores the keys of the bindings in increasing order */
+   char *apcKeys[MAX_KEYS];
+   /* apvItems stores the values of the bindings, so that apvItems[i]
+      is the value of apcKeys[i] */
+   const void *apvItems[MAX_KEYS];
+   /* apsChildren stores the children of the BTreeNode. Every key in
+      apsChildren[i] sorts after apcKeys[i - 1] and before
+      apcKeys[i] */
+   struct BTreeNode *apsChildren[MAX_KEYS + 1];
+};
+
+/* The SymTable struct contains the root of the B-tree psRoot and
+   contains it's length as a size_t */
+struct SymTable
+{
+   /* psRoot is a pointer that points to the root BTreeNode. It is
+      never NULL; an empty SymTable has an empty leaf as its root */
+   struct BTreeNode *psRoot;
+   /* length is a size_t that stores how many bindings are in
+      the table */
+   size_t length;
+   /* uFlags stores the SYMTABLE_ flags the SymTable was made with */
+   unsigned int uFlags;
+   /* iReadOnly is 1 if the SymTable is a snapshot, otherwise 0 */
+   int iReadOnly;
+   /* uValueSize is the size of the values a SymTable made by
+      SymTable_newSized keeps with its keys, or 0 if it keeps
+      pointers */
+   size_t uValueSize;
+   /* uCapacity is the most bindings a bounded SymTable may hold, or 0
+      if it has no capacity */
+   size_t uCapacity;
+   /* pfEvict is called with every evicted binding and pvExtra, unless
+      it is NULL */
+   void (*pfEvict)(const char *pcKey, void *pvValue, void *pvExtra);
+   const void *pvExtra;
+   /* uRandom is the state of the generator that picks the bindings a
+      bounded SymTable evicts */
+   size_t uRandom;
+#ifdef SYMTABLE_STATS
+   /* sStats stores the operation counters of the SymTable */
+   struct SymTableStats sStats;
+#endif
+};
+
+/* BTree_newNode takes in a flag iLeaf and returns a new empty
+   BTreeNode, or NULL if there is no memory. */
+static struct BTreeNode *BTree_newNode(int iLeaf) {
+   struct BTreeNode *psNode;
+   psNode = (struct BTreeNode *) malloc(sizeof(struct BTreeNode));
+   if (psNode == NULL) {
+      return NULL;
+   }
+   psNode->count = 0;
+   psNode->iLeaf = iLeaf;
+   psNode->uRefs = 1;
+   return psNode;
+}
+
+/* SymTable_freeKey takes in a oSymTable and a pcKey of one of its
+   BTreeNodes, and frees pcKey unless the oSymTable borrows its
+   keys. */
+static void SymTable_freeKey(SymTable_T oSymTable, char *pcKey) {
+   if (! (oSymTable->uFlags & SYMTABLE_BORROW_KEYS)) {
+      free(pcKey);
+   }
+}
+
+/* BTree_release takes in a oSymTable and a psNode, and drops one link
+   to psNode. If that was the last link, it frees psNode and its keys
+   and drops the links to its children. */
+static void BTree_release(SymTable_T oSymTable, struct BTreeNode *psNode) {
+   size_t i;
+   if (REF_DEC(&psNode->uRefs) != 0) {
+      return;
+   }
+   for (i = 0; i < psNode->count; i++) {
+      SymTable_freeKey(oSymTable, psNode->apcKeys[i]);
+   }
+   if (! psNode->iLeaf) {
+      for (i = 0; i <= psNode->count; i++) {
+         BTree_release(oSymTable, psNode->apsChildren[i]);
+      }
+   }
+   free(psNode);
+}
+
+/* SymTable_copyKey takes in a oSymTable, a pcKey of uLength
+   characters and a pointer ppvValue to its value, and returns a copy
+   of pcKey for a BTreeNode, or NULL if there is no memory. If the
+   oSymTable was made by SymTable_newSized, the value is copied in
+   after the key, and *ppvValue is set to point to the copy. If the
+   oSymTable borrows its keys, pcKey itself is returned. */
+static char *SymTable_copyKey(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength, const void **ppvValue) {
+   size_t uLen = uLength + 1;
+   size_t uOffset;
+   char *pcCopy;
+   if (oSymTable->uFlags & SYMTABLE_BORROW_KEYS) {
+      assert(pcKey[uLength] == '\0');
+      return (char*)pcKey;
+   }
+   if (oSymTable->uValueSize == 0) {
+      pcCopy = (char*)malloc(uLen);
+      if (pcCopy != NULL) {
+         memcpy(pcCopy, pcKey, uLength);
+         pcCopy[uLength] = '\0';
+      }
+      return pcCopy;
+   }
+   uOffset = (uLen + sizeof(union Align) - 1) / sizeof(union Align) *
+      sizeof(union Align);
+   pcCopy = (char*)malloc(uOffset + oSymTable->uValueSize);
+   if (pcCopy == NULL) {
+      return NULL;
+   }
+   memcpy(pcCopy, pcKey, uLength);
+   pcCopy[uLength] = '\0';
+   memcpy(pcCopy + uOffset, *ppvValue, oSymTable->uValueSize);
+   *ppvValue = pcCopy + uOffset;
+   return pcCopy;
+}
+
+/* BTree_own takes in a link ppsNode from a BTreeNode the SymTable
+   owns (or from the SymTable itself), and makes sure that the
+   BTreeNode it links to is not shared, copying it and its keys into
+   a BTreeNode of its own if it is. Its children become shared in
+   turn. Returns the BTreeNode, or NULL if there is no memory, in
+   which case nothing changes. */
+static struct BTreeNode *BTree_own(SymTable_T oSymTable,
+   struct BTreeNode **ppsNode) {
+   struct BTreeNode *psNode = *ppsNode;
+   struct BTreeNode *psCopy;
+   size_t i;
+   if (REF_GET(&psNode->uRefs) == 1) {
+      return psNode;
+   }
+   psCopy = (struct BTreeNode *) malloc(sizeof(struct BTreeNode));
+   if (psCopy == NULL) {
+      return NULL;
+   }
+   /* uRefs is left out, as a snapshot may be changing it */
+   psCopy->count = psNode->count;
+   psCopy->iLeaf = psNode->iLeaf;
+   psCopy->uRefs = 1;
+   memcpy(psCopy->apvItems, psNode->apvItems,
+      psNode->count * sizeof(psNode->apvItems[0]));
+   if (! psNode->iLeaf) {
+      memcpy(psCopy->apsChildren, psNode->apsChildren,
+         (psNode->count + 1) * sizeof(psNode->apsChildren[0]));
+   }
+   for (i = 0; i < psNode->count; i++) {
+      psCopy->apcKeys[i] = SymTable_copyKey(oSymTable,
+         psNode->apcKeys[i], strlen(psNode->apcKeys[i]),
+         &psCopy->apvItems[i]);
+      if (psCopy->apcKeys[i] == NULL) {
+         while (i > 0) {
+            SymTable_freeKey(oSymTable, psCopy->apcKeys[--i]);
+         }
+         free(psCopy);
+         return NULL;
+      }
+   }
+   STAT_ADD(oSymTable, uAllocations, 1 + psNode->count);
+   if (! psNode->iLeaf) {
+      for (i = 0; i <= psNode->count; i++) {
+         REF_INC(&psNode->apsChildren[i]->uRefs);
+      }
+   }
+   *ppsNode = psCopy;
+   BTree_release(oSymTable, psNode);
+   return psCopy;
+}
+
+/* SymTable_compareKey takes in a key pcStored and a pcKey of uLength
+   characters with no '\0' among them, and compares them as strcmp
+   would. */
+static int SymTable_compareKey(const char *pcStored, const char *pcKey,
+   size_t uLength) {
+   int iCompare = strncmp(pcStored, pcKey, uLength);
+   if (iCompare != 0) {
+      return iCompare;
+   }
+   return pcStored[uLength] != '\0';
+}
+
+/* BTree_lowerBound takes in a oSymTable, a psNode and a pcKey of
+   uLength characters, and returns the index of the first key of
+   psNode that is not less than pcKey, or psNode->count if there is
+   none. *piFound is set to 1 if that key equals pcKey, otherwise 0. */
+static size_t BTree_lowerBound(SymTable_T oSymTable,
+   const struct BTreeNode *psNode, const char *pcKey, size_t uLength,
+   int *piFound) {
+   size_t uLow = 0;
+   size_t uHigh = psNode->count;
+   size_t uMid;
+   int iCompare;
+   (void)oSymTable;
+   *piFound = 0;
+   STAT_ADD(oSymTable, uProbes, 1);
+   while (uLow < uHigh) {
+      uMid = uLow + (uHigh - uLow) / 2;
+      STAT_ADD(oSymTable, uCompares, 1);
+      iCompare = SymTable_compareKey(psNode->apcKeys[uMid], pcKey,
+         uLength);
+      if (iCompare == 0) {
+         *piFound = 1;
+         return uMid;
+      }
+      if (iCompare < 0) {
+         uLow = uMid + 1;
+      }
+      else {
+         uHigh = uMid;
+      }
+   }
+   return uLow;
+}
+
+/* SymTable_find takes in a oSymTable and a pcKey of uLength
+   characters, and returns the BTreeNode that holds pcKey, storing its
+   index in *puIndex. If pcKey is not in the oSymTable, returns
+   NULL. */
+static struct BTreeNode *SymTable_find(SymTable_T oSymTable,
+   const char *pcKey, size_t uLength, size_t *puIndex) {
+   struct BTreeNode *psNode;
+   int iFound;
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   psNode = oSymTable->psRoot;
+   for (;;) {
+      *puIndex = BTree_lowerBound(oSymTable, psNode, pcKey, uLength,
+         &iFound);
+      if (iFound) {
+         STAT_ADD(oSymTable, uHits, 1);
+         return psNode;
+      }
+      if (psNode->iLeaf) {
+         STAT_ADD(oSymTable, uMisses, 1);
+         return NULL;
+      }
+      psNode = psNode->apsChildren[*puIndex];
+   }
+}
+
+/* BTree_splitChild takes in a psParent that is not full and the index
+   i of a full child, and splits that child in two around its middle
+   binding, which moves up into psParent. Returns 1 if successful, or
+   0 if there is no memory, in which case nothing changes. */
+static int BTree_splitChild(struct BTreeNode *psParent, size_t i) {
+   struct BTreeNode *psLeft = psParent->apsChildren[i];
+   struct BTreeNode *psRight;
+   size_t j;
+   assert(psLeft->count == MAX_KEYS);
+   psRight = BTree_newNode(psLeft->iLeaf);
+   if (psRight == NULL) {
+      return 0;
+   }
+   /* the upper MIN_DEGREE - 1 bindings move to psRight */
+   psRight->count = MIN_DEGREE - 1;
+   for (j = 0; j < MIN_DEGREE - 1; j++) {
+      psRight->apcKeys[j] = psLeft->apcKeys[j + MIN_DEGREE];
+      psRight->apvItems[j] = psLeft->apvItems[j + MIN_DEGREE];
+   }
+   if (! psLeft->iLeaf) {
+      for (j = 0; j < MIN_DEGREE; j++) {
+         psRight->apsChildren[j] = psLeft->apsChildren[j + MIN_DEGREE];
+      }
+   }
+   psLeft->count = MIN_DEGREE - 1;
+   /* the middle binding moves up between psLeft and psRight */
+   for (j = psParent->count; j > i; j--) {
+      psParent->apcKeys[j] = psParent->apcKeys[j - 1];
+      psParent->apvItems[j] = psParent->apvItems[j - 1];
+      psParent->apsChildren[j + 1] = psParent->apsChildren[j];
+   }
+   psParent->apcKeys[i] = psLeft->apcKeys[MIN_DEGREE - 1];
+   psParent->apvItems[i] = psLeft->apvItems[MIN_DEGREE - 1];
+   psParent->apsChildren[i + 1] = psRight;
+   psParent->count += 1;
+   return 1;
+}
+
+/* BTree_merge takes in a psParent and an index i, and merges child
+   i + 1 and the binding i of psParent into child i. */
+static void BTree_merge(struct BTreeNode *psParent, size_t i) {
+   struct BTreeNode *psLeft = psParent->apsChildren[i];
+   struct BTreeNode *psRight = psParent->apsChildren[i + 1];
+   size_t j;
+   psLeft->apcKeys[psLeft->count] = psParent->apcKeys[i];
+   psLeft->apvItems[psLeft->count] = psParent->apvItems[i];
+   for (j = 0; j < psRight->count; j++) {
+      psLeft->apcKeys[psLeft->count + 1 + j] = psRight->apcKeys[j];
+      psLeft->apvItems[psLeft->count + 1 + j] = psRight->apvItems[j];
+   }
+   if (! psLeft->iLeaf) {
+      for (j = 0; j <= psRight->count; j++) {
+         psLeft->apsChildren[psLeft->count + 1 + j] =
+            psRight->apsChildren[j];
+      }
+   }
+   psLeft->count += psRight->count + 1;
+   for (j = i; j + 1 < psParent->count; j++) {
+      psParent->apcKeys[j] = psParent->apcKeys[j + 1];
+      psParent->apvItems[j] = psParent->apvItems[j + 1];
+      psParent->apsChildren[j + 1] = psParent->apsChildren[j + 2];
+   }
+   psParent->count -= 1;
+   free(psRight);
+}
+
+/* BTree_fill takes in a oSymTable, a psParent it owns and the index
+   *pi of a child that has only MIN_DEGREE - 1 bindings, and gives
+   that child one more binding by borrowing from a sibling or merging
+   with one. Afterwards *pi is the index of the child that covers the
+   keys child *pi covered, and that child and the sibling are owned.
+   Returns 1 if successful, or 0 if there is no memory to copy a
+   shared child. */
+static int BTree_fill(SymTable_T oSymTable, struct BTreeNode *psParent,
+   size_t *pi) {
+   struct BTreeNode *psChild;
+   struct BTreeNode *psSibling;
+   size_t i = *pi;
+   size_t j;
+   psChild = BTree_own(oSymTable, &psParent->apsChildren[i]);
+   if (psChild == NULL) {
+      return 0;
+   }
+   if (i > 0 && psParent->apsChildren[i - 1]->count >= MIN_DEGREE) {
+      /* borrow the last binding of the left sibling through
+         psParent */
+      psSibling = BTree_own(oSymTable, &psParent->apsChildren[i - 1]);
+      if (psSibling == NULL) {
+         return 0;
+      }
+      for (j = psChild->count; j > 0; j--) {
+         psChild->apcKeys[j] = psChild->apcKeys[j - 1];
+         psChild->apvItems[j] = psChild->apvItems[j - 1];
+      }
+      if (! psChild->iLeaf) {
+         for (j = psChild->count + 1; j > 0; j--) {
+            psChild->apsChildren[j] = psChild->apsChildren[j - 1];
+         }
+         psChild->apsChildren[0] = psSibling->apsChildren[psSibling->count];
+      }
+      psChild->apcKeys[0] = psParent->apcKeys[i - 1];
+      psChild->apvItems[0] = psParent->apvItems[i - 1];
+      psParent->apcKeys[i - 1] = psSibling->apcKeys[psSibling->count - 1];
+      psParent->apvItems[i - 1] = psSibling->apvItems[psSibling->count - 1];
+      psChild->count += 1;
+      psSibling->count -= 1;
+      return 1;
+   }
+   if (i < psParent->count &&
+      psParent->apsChildren[i + 1]->count >= MIN_DEGREE) {
+      /* borrow the first binding of the right sibling through
+         psParent */
+      psSibling = BTree_own(oSymTable, &psParent->apsChildren[i + 1]);
+      if (psSibling == NULL) {
+         return 0;
+      }
+      psChild->apcKeys[psChild->count] = psParent->apcKeys[i];
+      psChild->apvItems[psChild->count] = psParent->apvItems[i];
+      if (! psChild->iLeaf) {
+         psChild->apsChildren[psChild->count + 1] =
+            psSibling->apsChildren[0];
+      }
+      psParent->apcKeys[i] = psSibling->apcKeys[0];
+      psParent->apvItems[i] = psSibling->apvItems[0];
+      for (j = 0; j + 1 < psSibling->count; j++) {
+         psSibling->apcKeys[j] = psSibling->apcKeys[j + 1];
+         psSibling->apvItems[j] = psSibling->apvItems[j + 1];
+      }
+      if (! psSibling->iLeaf) {
+         for (j = 0; j < psSibling->count; j++) {
+            psSibling->apsChildren[j] = psSibling->apsChildren[j + 1];
+         }
+      }
+      psChild->count += 1;
+      psSibling->count -= 1;
+      return 1;
+   }
+   /* merging frees the right one of the pair, so both must be
+      owned */
+   if (i < psParent->count) {
+      if (BTree_own(oSymTable, &psParent->apsChildren[i + 1]) == NULL) {
+         return 0;
+      }
+      BTree_merge(psParent, i);
+      return 1;
+   }
+   if (BTree_own(oSymTable, &psParent->apsChildren[i - 1]) == NULL) {
+      return 0;
+   }
+   BTree_merge(psParent, i - 1);
+   *pi = i - 1;
+   return 1;
+}
+
+/* BTree_removeEdge takes in a oSymTable, a link ppsNode to a
+   BTreeNode with at least MIN_DEGREE bindings and a flag iLast, and
+   removes the last binding of its subtree if iLast is 1, or the first
+   binding if iLast is 0. The key and value of that binding are stored
+   in *ppcKey and *ppvItem. Returns 1 if successful, or 0 if there is
+   no memory to copy a shared BTreeNode. */
+static int BTree_removeEdge(SymTable_T oSymTable,
+   struct BTreeNode **ppsNode, int iLast, char **ppcKey,
+   const void **ppvItem) {
+   struct BTreeNode *psNode;
+   size_t i;
+   size_t j;
+   psNode = BTree_own(oSymTable, ppsNode);
+   if (psNode == NULL) {
+      return 0;
+   }
+   while (! psNode->iLeaf) {
+      i = iLast ? psNode->count : 0;
+      if (psNode->apsChildren[i]->count < MIN_DEGREE &&
+         ! BTree_fill(oSymTable, psNode, &i)) {
+         return 0;
+      }
+      psNode = BTree_own(oSymTable, &psNode->apsChildren[i]);
+      if (psNode == NULL) {
+         return 0;
+      }
+   }
+   i = iLast ? psNode->count - 1 : 0;
+   *ppcKey = psNode->apcKeys[i];
+   *ppvItem = psNode->apvItems[i];
+   for (j = i; j + 1 < psNode->count; j++) {
+      psNode->apcKeys[j] = psNode->apcKeys[j + 1];
+      psNode->apvItems[j] = psNode->apvItems[j + 1];
+   }
+   psNode->count -= 1;
+   return 1;
+}
+
+/* BTree_remove takes in a oSymTable, a link ppsNode to a BTreeNode
+   with at least MIN_DEGREE bindings (or the root) and a pcKey of
+   uLength characters, and removes the binding of pcKey from the
+   subtree of the BTreeNode. The key and value of the binding are
+   stored in *ppcKey and *ppvItem. Returns 1 if successful, or 0 if
+   pcKey is not in the subtree or there is no memory to copy a shared
+   BTreeNode. */
+static int BTree_remove(SymTable_T oSymTable, struct BTreeNode **ppsNode,
+   const char *pcKey, size_t uLength, char **ppcKey,
+   const void **ppvItem) {
+   struct BTreeNode *psNode;
+   size_t i;
+   size_t j;
+   int iFound;
+   psNode = BTree_own(oSymTable, ppsNode);
+   if (psNode == NULL) {
+      return 0;
+   }
+   for (;;) {
+      i = BTree_lowerBound(oSymTable, psNode, pcKey, uLength, &iFound);
+      if (iFound && psNode->iLeaf) {
+         *ppcKey = psNode->apcKeys[i];
+         *ppvItem = psNode->apvItems[i];
+         for (j = i; j + 1 < psNode->count; j++) {
+            psNode->apcKeys[j] = psNode->apcKeys[j + 1];
+            psNode->apvItems[j] = psNode->apvItems[j + 1];
+         }
+         psNode->count -= 1;
+         return 1;
+      }
+      if (iFound) {
+         /* replace the binding with its predecessor or successor,
+            taken from a child that can spare one */
+         *ppcKey = psNode->apcKeys[i];
+         *ppvItem = psNode->apvItems[i];
+         if (psNode->apsChildren[i]->count >= MIN_DEGREE) {
+            return BTree_removeEdge(oSymTable, &psNode->apsChildren[i],
+               1, &psNode->apcKeys[i], &psNode->apvItems[i]);
+         }
+         if (psNode->apsChildren[i + 1]->count >= MIN_DEGREE) {
+            return BTree_removeEdge(oSymTable,
+               &psNode->apsChildren[i + 1], 0, &psNode->apcKeys[i],
+               &psNode->apvItems[i]);
+         }
+         /* both children are minimal, so pcKey moves down into their
+            merge and is removed from there */
+         if (BTree_own(oSymTable, &psNode->apsChildren[i]) == NULL ||
+            BTree_own(oSymTable, &psNode->apsChildren[i + 1]) == NULL) {
+            return 0;
+         }
+         BTree_merge(psNode, i);
+         psNode = psNode->apsChildren[i];
+         continue;
+      }
+      if (psNode->iLeaf) {
+         return 0;
+      }
+      if (psNode->apsChildren[i]->count < MIN_DEGREE &&
+         ! BTree_fill(oSymTable, psNode, &i)) {
+         return 0;
+      }
+      psNode = BTree_own(oSymTable, &psNode->apsChildren[i]);
+      if (psNode == NULL) {
+         return 0;
+      }
+   }
+}
+
+/* BTree_map takes in a psNode, function pfApply and pvExtra, and
+   applies pfApply to every binding in the subtree of psNode in
+   increasing order of key. */
+static void BTree_map(struct BTreeNode *psNode,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   size_t i;
+   for (i = 0; i <= psNode->count; i++) {
+      if (! psNode->iLeaf) {
+         BTree_map(psNode->apsChildren[i], pfApply, pvExtra);
+      }
+      if (i < psNode->count) {
+         (*pfApply)(psNode->apcKeys[i], (void *)psNode->apvItems[i],
+            (void *)pvExtra);
+      }
+   }
+}
+
+/* BTree_mapRange takes in a oSymTable, a psNode, bounds pcLo and
+   pcHi, a prefix pcPrefix of length uPrefixLength, function pfApply
+   and pvExtra. It applies pfApply in increasing order of key to the
+   bindings in the subtree of psNode whose keys are at least pcLo and
+   less than pcHi and start with pcPrefix, where a NULL pcLo, pcHi or
+   pcPrefix is no limit. Subtrees that sort before pcLo are skipped.
+   Returns 1 once a key past the range has been seen, so that the
+   caller stops, otherwise 0. */
+static int BTree_mapRange(SymTable_T oSymTable, struct BTreeNode *psNode,
+    const char *pcLo, const char *pcHi, const char *pcPrefix,
+    size_t uPrefixLength,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   size_t i = 0;
+   int iFound;
+   if (pcLo != NULL) {
+      i = BTree_lowerBound(oSymTable, psNode, pcLo, strlen(pcLo),
+         &iFound);
+   }
+   for (; i <= psNode->count; i++) {
+      if (! psNode->iLeaf && BTree_mapRange(oSymTable,
+         psNode->apsChildren[i], pcLo, pcHi, pcPrefix, uPrefixLength,
+         pfApply, pvExtra)) {
+         return 1;
+      }
+      if (i == psNode->count) {
+         break;
+      }
+      if (pcHi != NULL && strcmp(psNode->apcKeys[i], pcHi) >= 0) {
+         return 1;
+      }
+      if (pcPrefix != NULL &&
+         strncmp(psNode->apcKeys[i], pcPrefix, uPrefixLength) != 0) {
+         return 1;
+      }
+      (*pfApply)(psNode->apcKeys[i], (void *)psNode->apvItems[i],
+         (void *)pvExtra);
+   }
+   return 0;
+}
+
+/* RETAIN_KEPT marks a binding that pfKeep kept, and RETAIN_COPIED
+   one whose key was copied out of a shared BTreeNode */
+enum {RETAIN_KEPT = 1, RETAIN_COPIED = 2};
+
+/* Retain is what SymTable_retain knows of the bindings of the B-tree
+   it rebuilds, in increasing order of key */
+struct Retain
+{
+   /* ppcKeys and ppvItems hold the uKept bindings kept so far */
+   char **ppcKeys;
+   const void **ppvItems;
+   size_t uKept;
+   /* pucMarks holds the RETAIN_ marks of the uSeen bindings judged so
+      far, 0 for one that pfKeep rejected */
+   unsigned char *pucMarks;
+   size_t uSeen;
+};
+
+/* BTree_judge takes in a oSymTable, a psNode, a flag iShared that is
+   1 if a BTreeNode above psNode is shared, a psRetain, pfKeep and
+   pvExtra. It calls pfKeep on every binding in the subtree of psNode
+   in increasing order of key, and marks it in psRetain, where the
+   kept ones are added. Kept keys in shared BTreeNodes are copied, as
+   a snapshot keeps the old ones. Returns 1 if successful, or 0 if
+   there is no memory for a copy. */
+static int BTree_judge(SymTable_T oSymTable, struct BTreeNode *psNode,
+   int iShared, struct Retain *psRetain,
+   int (*pfKeep)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+   const void *pvItem;
+   char *pcKey;
+   unsigned char ucMark;
+   size_t i;
+   iShared = iShared || REF_GET(&psNode->uRefs) > 1;
+   for (i = 0; i <= psNode->count; i++) {
+      if (! psNode->iLeaf && ! BTree_judge(oSymTable,
+         psNode->apsChildren[i], iShared, psRetain, pfKeep, pvExtra)) {
+         return 0;
+      }
+      if (i == psNode->count) {
+         break;
+      }
+      ucMark = 0;
+      if ((*pfKeep)(psNode->apcKeys[i], (void *)psNode->apvItems[i],
+         (void *)pvExtra)) {
+         ucMark = RETAIN_KEPT;
+         pcKey = psNode->apcKeys[i];
+         pvItem = psNode->apvItems[i];
+         if (iShared) {
+            pcKey = SymTable_copyKey(oSymTable, pcKey, strlen(pcKey),
+               &pvItem);
+            if (pcKey == NULL) {
+               return 0;
+            }
+            STAT_ADD(oSymTable, uAllocations, 1);
+            ucMark |= RETAIN_COPIED;
+         }
+         psRetain->ppcKeys[psRetain->uKept] = pcKey;
+         psRetain->ppvItems[psRetain->uKept] = pvItem;
+         psRetain->uKept++;
+      }
+      psRetain->pucMarks[psRetain->uSeen++] = ucMark;
+   }
+   return 1;
+}
+
+/* BTree_freeNodes takes in a psNode and frees it and every BTreeNode
+   below it, but none of their keys. */
+static void BTree_freeNodes(struct BTreeNode *psNode) {
+   size_t i;
+   if (! psNode->iLeaf) {
+      for (i = 0; i <= psNode->count; i++) {
+         BTree_freeNodes(psNode->apsChildren[i]);
+      }
+   }
+   free(psNode);
+}
+
+/* BTree_build takes in a oSymTable, uCount bindings in increasing
+   order of key at ppcKeys and ppvItems, and the most bindings
+   uChildCapacity the subtree of each child may hold, 0 for a leaf,
+   and returns a BTreeNode whose subtree holds the bindings. It uses
+   the fewest children that can hold them and shares the bindings
+   evenly among them, which leaves every BTreeNode below it at least
+   half full. Returns NULL if there is no memory, in which case no
+   BTreeNode is left. */
+static struct BTreeNode *BTree_build(SymTable_T oSymTable,
+   char **ppcKeys, const void **ppvItems, size_t uCount,
+   size_t uChildCapacity) {
+   struct BTreeNode *psNode;
+   size_t uChildren;
+   size_t uSize;
+   size_t i;
+   psNode = BTree_newNode(uChildCapacity == 0);
+   if (psNode == NULL) {
+      return NULL;
+   }
+   STAT_ADD(oSymTable, uAllocations, 1);
+   if (uChildCapacity == 0) {
+      assert(uCount <= MAX_KEYS);
+      memcpy(psNode->apcKeys, ppcKeys, uCount * sizeof(ppcKeys[0]));
+      memcpy(psNode->apvItems, ppvItems, uCount * sizeof(ppvItems[0]));
+      psNode->count = uCount;
+      return psNode;
+   }
+   uChildren = (uCount + uChildCapacity + 1) / (uChildCapacity + 1);
+   assert(uChildren >= 2 && uChildren <= MAX_KEYS + 1);
+   for (i = 0; i < uChildren; i++) {
+      /* every child and the binding after it take an equal share of
+         uCount + 1 */
+      uSize = (uCount + 1) / uChildren - 1 +
+         (i < (uCount + 1) % uChildren);
+      psNode->apsChildren[i] = BTree_build(oSymTable, ppcKeys, ppvItems,
+         uSize, (uChildCapacity + 1) / (MAX_KEYS + 1) - 1);
+      if (psNode->apsChildren[i] == NULL) {
+         while (i > 0) {
+            BTree_freeNodes(psNode->apsChildren[--i]);
+         }
+         free(psNode);
+         return NULL;
+      }
+      ppcKeys += uSize;
+      ppvItems += uSize;
+      if (i + 1 < uChildren) {
+         psNode->apcKeys[i] = *ppcKeys++;
+         psNode->apvItems[i] = *ppvItems++;
+      }
+   }
+   psNode->count = uChildren - 1;
+   return psNode;
+}
+
+/* BTree_discard takes in a oSymTable, a psNode of the B-tree that
+   SymTable_retain replaced, iShared as for BTree_judge, the psRetain
+   of the B-tree, pfFree and pvExtra. It calls pfFree on every binding
+   of the subtree of psNode that pfKeep rejected, and frees the keys
+   of those in BTreeNodes the oSymTable owns. The BTreeNodes it owns
+   are freed, and the link to the first shared one is dropped. */
+static void BTree_discard(SymTable_T oSymTable, struct BTreeNode *psNode,
+   int iShared, struct Retain *psRetain,
+   void (*pfFree)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+   int iHere;
+   size_t i;
+   iHere = iShared || REF_GET(&psNode->uRefs) > 1;
+   for (i = 0; i <= psNode->count; i++) {
+      if (! psNode->iLeaf) {
+         BTree_discard(oSymTable, psNode->apsChildren[i], iHere,
+            psRetain, pfFree, pvExtra);
+      }
+      if (i == psNode->count) {
+         break;
+      }
+      if (psRetain->pucMarks[psRetain->uSeen++] == 0) {
+         if (pfFree != NULL) {
+            (*pfFree)(psNode->apcKeys[i], (void *)psNode->apvItems[i],
+               (void *)pvExtra);
+         }
+         if (! iHere) {
+            SymTable_freeKey(oSymTable, psNode->apcKeys[i]);
+         }
+      }
+   }
+   if (iShared) {
+      return;
+   }
+   if (iHere) {
+      BTree_release(oSymTable, psNode);
+   }
+   else {
+      free(psNode);
+   }
+}
+
+/* SymTable_random takes in a oSymTable and returns the next number of
+   its linear congruential generator. */
+static size_t SymTable_random(SymTable_T oSymTable) {
+   oSymTable->uRandom = oSymTable->uRandom * 1103515245u + 12345u;
+   return oSymTable->uRandom >> 16;
+}
+
+/* SymTable_evict takes in a bounded oSymTable with more than one
+   binding and the key pcKeep of the binding just put, and evicts a
+   binding other than that one from a leaf reached by random
+   choices. If there is no memory to remove it, nothing is
+   evicted. */
+static void SymTable_evict(SymTable_T oSymTable, const char *pcKeep) {
+   struct BTreeNode *psNode = oSymTable->psRoot;
+   const void *pvItem;
+   char *pcKey;
+   size_t i;
+   while (! psNode->iLeaf) {
+      psNode = psNode->apsChildren[SymTable_random(oSymTable) %
+         (psNode->count + 1)];
+   }
+   /* a leaf holding pcKeep has another key too: the root holds at
+      least two keys here, and any other leaf MIN_DEGREE - 1 */
+   i = SymTable_random(oSymTable) % psNode->count;
+   if (strcmp(psNode->apcKeys[i], pcKeep) == 0) {
+      i = (i + 1) % psNode->count;
+   }
+   /* the key is copied, as removing it frees the BTreeNode's copy */
+   pcKey = malloc(strlen(psNode->apcKeys[i]) + 1);
+   if (pcKey == NULL) {
+      return;
+   }
+   strcpy(pcKey, psNode->apcKeys[i]);
+   pvItem = SymTable_remove(oSymTable, pcKey);
+   if (oSymTable->length <= oSymTable->uCapacity &&
+      oSymTable->pfEvict != NULL) {
+      (*oSymTable->pfEvict)(pcKey, (void *)pvItem,
+         (void *)oSymTable->pvExtra);
+   }
+   free(pcKey);
+}
+
+SymTable_T SymTable_new(void) {
+   return SymTable_newWithFlags(0);
+}
+
+/* A B-tree does not hash its keys and keeps them in sorted order, so
+   it ignores SYMTABLE_HARDENED, SYMTABLE_FILTER,
+   SYMTABLE_MOVE_TO_FRONT and SYMTABLE_TRANSPOSE. It grows a node at
+   a time and never resizes, so it ignores
+   SYMTABLE_BACKGROUND_RESIZE. Its removals rebalance the tree on the
+   way down, which costs more than the one free of the key, so it
+   ignores SYMTABLE_DEFER_FREE too. */
+SymTable_T SymTable_newWithFlags(unsigned int uFlags) {
+   SymTable_T oSymTable;
+   oSymTable = (SymTable_T) malloc(sizeof(struct SymTable));
+   if (oSymTable == NULL) {
+      return NULL;
+   }
+   oSymTable->psRoot = BTree_newNode(1);
+   if (oSymTable->psRoot == NULL) {
+      free(oSymTable);
+      return NULL;
+   }
+   oSymTable->length = 0;
+   oSymTable->uFlags = uFlags;
+   oSymTable->iReadOnly = 0;
+   oSymTable->uValueSize = 0;
+   oSymTable->uCapacity = 0;
+   oSymTable->pfEvict = NULL;
+   oSymTable->pvExtra = NULL;
+   oSymTable->uRandom = 1;
+#ifdef SYMTABLE_STATS
+   memset(&oSymTable->sStats, 0, sizeof(oSymTable->sStats));
+   oSymTable->sStats.uAllocations = 2;
+#endif
+   return oSymTable;
+}
+
+/* A B-tree has no bucket array, so it ignores SYMTABLE_HUGE_PAGES
+   and iNode. */
+SymTable_T SymTable_newOnNode(unsigned int uFlags, int iNode) {
+   (void)iNode;
+   return SymTable_newWithFlags(uFlags);
+}
+
+SymTable_T SymTable_newSized(size_t uValueSize) {
+   SymTable_T oSymTable;
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL) {
+      return NULL;
+   }
+   oSymTable->uValueSize = uValueSize;
+   return oSymTable;
+}
+
+/* A B-tree keeps no record of which bindings were used lately, so a
+   bounded one evicts bindings at random, which needs none. */
+SymTable_T SymTable_newBounded(size_t uCapacity, unsigned int uFlags,
+   void (*pfEvict)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+   SymTable_T oSymTable;
+   assert(uCapacity >= 1);
+   oSymTable = SymTable_newWithFlags(uFlags);
+   if (oSymTable == NULL) {
+      return NULL;
+   }
+   oSymTable->uCapacity = uCapacity;
+   oSymTable->pfEvict = pfEvict;
+   oSymTable->pvExtra = pvExtra;
+   return oSymTable;
+}
+
+/* A B-tree gains little from being built from unsorted arrays in one
+   pass, so this puts the bindings one at a time. */
+SymTable_T SymTable_fromArrays(const char *const *ppcKeys,
+   const void *const *ppvValues, size_t uCount) {
+   SymTable_T oSymTable;
+   size_t i;
+   assert(uCount == 0 || ppcKeys != NULL);
+   assert(uCount == 0 || ppvValues != NULL);
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL) {
+      return NULL;
+   }
+   for (i = 0; i < uCount; i++) {
+      if (! SymTable_put(oSymTable, ppcKeys[i], ppvValues[i]) &&
+         ! SymTable_contains(oSymTable, ppcKeys[i])) {
+         SymTable_free(oSymTable);
+         return NULL;
+      }
+   }
+   return oSymTable;
+}
+
+/* A B-tree has no hash to split its keys among threads by, so this
+   builds it on the calling thread, as SymTable_fromArrays does. */
+SymTable_T SymTable_buildParallel(const char *const *ppcKeys,
+   const void *const *ppvValues, size_t uCount, size_t uThreads) {
+   (void)uThreads;
+   return SymTable_fromArrays(ppcKeys, ppvValues, uCount);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+   return oSymTable->length;
+}
+
+unsigned int SymTable_getFlags(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+   return oSymTable->uFlags;
+}
+
+/* SymTable_putKey takes in a oSymTable, a pcKey of uLength characters
+   and a pvValue, and puts the binding as SymTable_put does. It splits
+   every full BTreeNode on its way down, so that the leaf it reaches
+   always has room for the new binding. */
+static int SymTable_putKey(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength, const void* pvValue) {
+   struct BTreeNode *psNode;
+   struct BTreeNode *psNewRoot;
+   char* copyKey;
+   size_t i;
+   size_t j;
+   int iFound;
+   if (BTree_own(oSymTable, &oSymTable->psRoot) == NULL) {
+      return 0;
+   }
+   if (oSymTable->psRoot->count == MAX_KEYS) {
+      psNewRoot = BTree_newNode(0);
+      if (psNewRoot == NULL) {
+         return 0;
+      }
+      psNewRoot->apsChildren[0] = oSymTable->psRoot;
+      if (! BTree_splitChild(psNewRoot, 0)) {
+         free(psNewRoot);
+         return 0;
+      }
+      STAT_ADD(oSymTable, uAllocations, 2);
+      oSymTable->psRoot = psNewRoot;
+   }
+   psNode = oSymTable->psRoot;
+   for (;;) {
+      i = BTree_lowerBound(oSymTable, psNode, pcKey, uLength, &iFound);
+      if (iFound) {
+         STAT_ADD(oSymTable, uHits, 1);
+         return 0;
+      }
+      if (psNode->iLeaf) {
+         break;
+      }
+      if (BTree_own(oSymTable, &psNode->apsChildren[i]) == NULL) {
+         return 0;
+      }
+      if (psNode->apsChildren[i]->count == MAX_KEYS) {
+         if (! BTree_splitChild(psNode, i)) {
+            return 0;
+         }
+         STAT_ADD(oSymTable, uAllocations, 1);
+         /* the binding that moved up may be pcKey itself, or may
+            send pcKey to the new right half */
+         continue;
+      }
+      psNode = psNode->apsChildren[i];
+   }
+   STAT_ADD(oSymTable, uMisses, 1);
+   copyKey = SymTable_copyKey(oSymTable, pcKey, uLength, &pvValue);
+   if (copyKey == NULL) {
+      return 0;
+   }
+   STAT_ADD(oSymTable, uAllocations, 1);
+   for (j = psNode->count; j > i; j--) {
+      psNode->apcKeys[j] = psNode->apcKeys[j - 1];
+      psNode->apvItems[j] = psNode->apvItems[j - 1];
+   }
+   psNode->apcKeys[i] = copyKey;
+   psNode->apvItems[i] = pvValue;
+   psNode->count += 1;
+   oSymTable->length += 1;
+   if (oSymTable->uCapacity != 0 &&
+      oSymTable->length > oSymTable->uCapacity) {
+      SymTable_evict(oSymTable, copyKey);
+   }
+   return 1;
+}
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+   const void* pvValue) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(! oSymTable->iReadOnly);
+   return SymTable_putKey(oSymTable, pcKey, strlen(pcKey), pvValue);
+}
+
+int SymTable_putN(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength, const void *pvValue) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL || uLength == 0);
+   assert(uLength == 0 || memchr(pcKey, '\0', uLength) == NULL);
+   assert(! oSymTable->iReadOnly);
+   return SymTable_putKey(oSymTable, pcKey == NULL ? "" : pcKey, uLength,
+      pvValue);
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+   size_t i;
+   assert(pcKey != NULL);
+   return SymTable_find(oSymTable, pcKey, strlen(pcKey), &i) != NULL;
+}
+
+void* SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+   struct BTreeNode *psNode;
+   size_t i;
+   assert(pcKey != NULL);
+   psNode = SymTable_find(oSymTable, pcKey, strlen(pcKey), &i);
+   if (psNode == NULL) {
+      return NULL;
+   }
+   return (void*) psNode->apvItems[i];
+}
+
+/* A cursor at a binding has uIndex 1 and the key of the binding as
+   pvPlace, and one past the last binding has uIndex 2. The B-tree
+   keeps no parent links, so each step looks for the least key after
+   pvPlace from the root down, in logarithmic time. */
+int SymTable_lookupN(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength, struct SymTableCursor *psCursor) {
+   struct BTreeNode *psNode;
+   size_t i;
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL || uLength == 0);
+   assert(uLength == 0 || memchr(pcKey, '\0', uLength) == NULL);
+   assert(psCursor != NULL);
+   psNode = SymTable_find(oSymTable, pcKey == NULL ? "" : pcKey, uLength,
+      &i);
+   if (psNode == NULL) {
+      return 0;
+   }
+   psCursor->uIndex = 1;
+   psCursor->pvPlace = psNode->apcKeys[i];
+   psCursor->pcKey = psNode->apcKeys[i];
+   psCursor->pvValue = (void*) psNode->apvItems[i];
+   return 1;
+}
+
+int SymTable_next(SymTable_T oSymTable, struct SymTableCursor *psCursor) {
+   const struct BTreeNode *psNode;
+   const struct BTreeNode *psNext = NULL;
+   const char *pcLast;
+   size_t i;
+   size_t uNext = 0;
+   int iFound;
+   assert(oSymTable != NULL);
+   assert(psCursor != NULL);
+   if (psCursor->uIndex == 2) {
+      return 0;
+   }
+   psNode = oSymTable->psRoot;
+   if (psCursor->uIndex == 0) {
+      while (! psNode->iLeaf) {
+         psNode = psNode->apsChildren[0];
+      }
+      if (psNode->count > 0) {
+         psNext = psNode;
+      }
+   }
+   else {
+      /* the least key after pcLast is the last key greater than it
+         passed on the way down to where pcLast is */
+      pcLast = (const char *)psCursor->pvPlace;
+      for (;;) {
+         i = BTree_lowerBound(oSymTable, psNode, pcLast, strlen(pcLast),
+            &iFound);
+         if (iFound) {
+            i += 1;
+         }
+         if (i < psNode->count) {
+            psNext = psNode;
+            uNext = i;
+         }
+         if (psNode->iLeaf) {
+            break;
+         }
+         psNode = psNode->apsChildren[i];
+      }
+   }
+   if (psNext == NULL) {
+      psCursor->uIndex = 2;
+      psCursor->pvPlace = NULL;
+      return 0;
+   }
+   psCursor->uIndex = 1;
+   psCursor->pvPlace = psNext->apcKeys[uNext];
+   psCursor->pcKey = psNext->apcKeys[uNext];
+   psCursor->pvValue = (void*) psNext->apvItems[uNext];
+   return 1;
+}
+
+/* SymTable_replaceKey takes in a oSymTable, a pcKey of uLength
+   characters and a pvValue, and replaces the value of pcKey as
+   SymTable_replace does, storing what SymTable_replace would return
+   in *ppvOld. It copies any shared BTreeNode on the way down, so that
+   a snapshot keeps the old value. Returns 1 if successful, or 0 if
+   pcKey is not in the oSymTable or there is no memory. */
+static int SymTable_replaceKey(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength, const void *pvValue, const void **ppvOld) {
+   struct BTreeNode **ppsNode;
+   struct BTreeNode *psNode;
+   size_t i;
+   int iFound;
+   ppsNode = &oSymTable->psRoot;
+   for (;;) {
+      psNode = BTree_own(oSymTable, ppsNode);
+      if (psNode == NULL) {
+         return 0;
+      }
+      i = BTree_lowerBound(oSymTable, psNode, pcKey, uLength, &iFound);
+      if (iFound) {
+         break;
+      }
+      if (psNode->iLeaf) {
+         STAT_ADD(oSymTable, uMisses, 1);
+         return 0;
+      }
+      ppsNode = &psNode->apsChildren[i];
+   }
+   STAT_ADD(oSymTable, uHits, 1);
+   if (oSymTable->uValueSize != 0) {
+      memcpy((void*)psNode->apvItems[i], pvValue, oSymTable->uValueSize);
+      *ppvOld = psNode->apvItems[i];
+      return 1;
+   }
+   *ppvOld = psNode->apvItems[i];
+   psNode->apvItems[i] = pvValue;
+   return 1;
+}
+
+void* SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue) {
+   const void *outItem;
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(! oSymTable->iReadOnly);
+   if (! SymTable_replaceKey(oSymTable, pcKey, strlen(pcKey), pvValue,
+      &outItem)) {
+      return NULL;
+   }
+   return (void*) outItem;
+}
+
+/* SymTable_removeKey takes in a oSymTable and a pcKey of uLength
+   characters, and removes the binding of pcKey as SymTable_remove
+   does. It makes sure every BTreeNode it descends into can spare a
+   binding, so that the removal never has to walk back up. */
+static void *SymTable_removeKey(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength) {
+   struct BTreeNode *psOldRoot;
+   char *pcOldKey;
+   const void *outItem;
+   int iFound;
+   iFound = BTree_remove(oSymTable, &oSymTable->psRoot, pcKey, uLength,
+      &pcOldKey, &outItem);
+   /* a root left without bindings hands over to its only child */
+   if (oSymTable->psRoot->count == 0 && ! oSymTable->psRoot->iLeaf) {
+      psOldRoot = oSymTable->psRoot;
+      oSymTable->psRoot = psOldRoot->apsChildren[0];
+      free(psOldRoot);
+   }
+   if (! iFound) {
+      STAT_ADD(oSymTable, uMisses, 1);
+      return NULL;
+   }
+   STAT_ADD(oSymTable, uHits, 1);
+   SymTable_freeKey(oSymTable, pcOldKey);
+   oSymTable->length -= 1;
+   if (oSymTable->uValueSize != 0) {
+      return NULL;
+   }
+   return (void *) outItem;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(! oSymTable->iReadOnly);
+   return SymTable_removeKey(oSymTable, pcKey, strlen(pcKey));
+}
+
+void *SymTable_removeN(SymTable_T oSymTable, const char *pcKey,
+   size_t uLength) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL || uLength == 0);
+   assert(uLength == 0 || memchr(pcKey, '\0', uLength) == NULL);
+   assert(! oSymTable->iReadOnly);
+   return SymTable_removeKey(oSymTable, pcKey == NULL ? "" : pcKey,
+      uLength);
+}
+
+/* The B-tree frees at once, so nothing is ever left to reclaim. */
+size_t SymTable_reclaim(SymTable_T oSymTable, size_t uBudget) {
+   assert(oSymTable != NULL);
+   (void)uBudget;
+   return 0;
+}
+
+void SymTable_free(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+   BTree_release(oSymTable, oSymTable->psRoot);
+   free(oSymTable);
+}
+
+SymTable_T SymTable_snapshot(SymTable_T oSymTable) {
+   SymTable_T oSnapshot;
+   assert(oSymTable != NULL);
+   oSnapshot = (SymTable_T) malloc(sizeof(struct SymTable));
+   if (oSnapshot == NULL) {
+      return NULL;
+   }
+   REF_INC(&oSymTable->psRoot->uRefs);
+   oSnapshot->psRoot = oSymTable->psRoot;
+   oSnapshot->length = oSymTable->length;
+   /* a snapshot frees only the keys it owns */
+   oSnapshot->uFlags = oSymTable->uFlags & SYMTABLE_BORROW_KEYS;
+   oSnapshot->iReadOnly = 1;
+   oSnapshot->uValueSize = oSymTable->uValueSize;
+   oSnapshot->uCapacity = 0;
+   oSnapshot->pfEvict = NULL;
+   oSnapshot->pvExtra = NULL;
+   oSnapshot->uRandom = 1;
+#ifdef SYMTABLE_STATS
+   memset(&oSnapshot->sStats, 0, sizeof(oSnapshot->sStats));
+   oSnapshot->sStats.uAllocations = 1;
+#endif
+   return oSnapshot;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+   BTree_map(oSymTable->psRoot, pfApply, pvExtra);
+}
+
+/* Taking bindings out of a B-tree in place would rebalance it at
+   every removal, so SymTable_retain collects the kept bindings in
+   order and builds a new B-tree of them from the bottom up, in time
+   linear in the length, before it lets go of the old one. It needs
+   memory for the new B-tree even when no snapshot is taken. */
+int SymTable_retain(SymTable_T oSymTable,
+    int (*pfKeep)(const char *pcKey, void *pvValue, void *pvExtra),
+    void (*pfFree)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   struct Retain sRetain;
+   struct BTreeNode *psRoot = NULL;
+   size_t uChildCapacity = 0;
+   size_t uCount;
+   size_t i;
+   size_t k;
+   int iJudged;
+   assert(oSymTable != NULL);
+   assert(pfKeep != NULL);
+   assert(! oSymTable->iReadOnly);
+   uCount = oSymTable->length + 1;
+   sRetain.ppcKeys = (char **) malloc(uCount * sizeof(char *));
+   sRetain.ppvItems = (const void **) malloc(uCount * sizeof(void *));
+   sRetain.pucMarks = (unsigned char *) malloc(uCount);
+   sRetain.uKept = 0;
+   sRetain.uSeen = 0;
+   iJudged = sRetain.ppcKeys != NULL && sRetain.ppvItems != NULL &&
+      sRetain.pucMarks != NULL && BTree_judge(oSymTable,
+      oSymTable->psRoot, 0, &sRetain, pfKeep, pvExtra);
+   if (iJudged && sRetain.uKept < oSymTable->length) {
+      while (sRetain.uKept > (uChildCapacity + 1) * (MAX_KEYS + 1) - 1) {
+         uChildCapacity = (uChildCapacity + 1) * (MAX_KEYS + 1) - 1;
+      }
+      psRoot = BTree_build(oSymTable, sRetain.ppcKeys, sRetain.ppvItems,
+         sRetain.uKept, uChildCapacity);
+   }
+   if (psRoot == NULL) {
+      /* the old B-tree stays, so only the copied keys go */
+      for (i = 0, k = 0; i < sRetain.uSeen; i++) {
+         if (sRetain.pucMarks[i] & RETAIN_COPIED) {
+            SymTable_freeKey(oSymTable, sRetain.ppcKeys[k]);
+         }
+         if (sRetain.pucMarks[i] & RETAIN_KEPT) {
+            k++;
+         }
+      }
+   }
+   else {
+      sRetain.uSeen = 0;
+      BTree_discard(oSymTable, oSymTable->psRoot, 0, &sRetain, pfFree,
+         pvExtra);
+      oSymTable->psRoot = psRoot;
+      oSymTable->length = sRetain.uKept;
+   }
+   free(sRetain.ppcKeys);
+   free(sRetain.ppvItems);
+   free(sRetain.pucMarks);
+   return iJudged && (psRoot != NULL ||
+      sRetain.uKept == oSymTable->length);
+}
+
+/* Difference is the pvExtra SymTable_difference passes to
+   SymTable_retain, with the SymTable oOther whose keys are removed
+   and the pfFree and pvExtra of the caller */
+struct Difference
+{
+   SymTable_T oOther;
+   void (*pfFree)(const char *pcKey, void *pvValue, void *pvExtra);
+   const void *pvExtra;
+};
+
+/* SymTable_lacks takes in a binding pcKey and pvValue and a
+   Difference pvExtra, and returns 1 if oOther of the Difference does
+   not have pcKey, otherwise 0. */
+static int SymTable_lacks(const char *pcKey, void *pvValue,
+   void *pvExtra) {
+   struct Difference *psDifference = (struct Difference *)pvExtra;
+   size_t i;
+   (void)pvValue;
+   return SymTable_find(psDifference->oOther, pcKey, strlen(pcKey), &i)
+      == NULL;
+}
+
+/* SymTable_freeDifference takes in a binding pcKey and pvValue and a
+   Difference pvExtra, and calls pfFree of the Difference on the
+   binding with the pvExtra of the caller. */
+static void SymTable_freeDifference(const char *pcKey, void *pvValue,
+   void *pvExtra) {
+   struct Difference *psDifference = (struct Difference *)pvExtra;
+   (*psDifference->pfFree)(pcKey, pvValue,
+      (void *)psDifference->pvExtra);
+}
+
+int SymTable_difference(SymTable_T oSymTable, SymTable_T oOther,
+    void (*pfFree)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   struct Difference sDifference;
+   assert(oSymTable != NULL);
+   assert(oOther != NULL);
+   assert(oSymTable != oOther);
+   sDifference.oOther = oOther;
+   sDifference.pfFree = pfFree;
+   sDifference.pvExtra = pvExtra;
+   return SymTable_retain(oSymTable, SymTable_lacks,
+      pfFree == NULL ? NULL : SymTable_freeDifference, &sDifference);
+}
+
+/* SymTable_collect takes in a binding pcKey and pvValue and a Retain
+   pvExtra, and adds the binding to the kept bindings of the
+   Retain. */
+static void SymTable_collect(const char *pcKey, void *pvValue,
+   void *pvExtra) {
+   struct Retain *psRetain = (struct Retain *)pvExtra;
+   psRetain->ppcKeys[psRetain->uKept] = (char *)pcKey;
+   psRetain->ppvItems[psRetain->uKept] = pvValue;
+   psRetain->uKept++;
+}
+
+/* SymTable_unmoved takes in a binding pcKey and pvValue and a Retain
+   pvExtra whose marks are those SymTable_merge gave the bindings in
+   increasing order of key, and returns the mark of the next one,
+   which is 0 if it moved. */
+static int SymTable_unmoved(const char *pcKey, void *pvValue,
+   void *pvExtra) {
+   struct Retain *psRetain = (struct Retain *)pvExtra;
+   (void)pcKey;
+   (void)pvValue;
+   return psRetain->pucMarks[psRetain->uSeen++];
+}
+
+/* SymTable_trade takes in a oDst, a oSrc, a pcKey of uLength
+   characters both have, and its value pvDst in oDst and pvSrc in
+   oSrc, and makes the two values trade places, or with
+   SymTable_newSized copies pvSrc over pvDst. Returns 1 if successful,
+   or 0 if there is no memory, in which case neither changes. */
+static int SymTable_trade(SymTable_T oDst, SymTable_T oSrc,
+   const char *pcKey, size_t uLength, const void *pvDst,
+   const void *pvSrc) {
+   const void *pvOld;
+   if (oDst->uValueSize != 0) {
+      return SymTable_replaceKey(oDst, pcKey, uLength, pvSrc, &pvOld);
+   }
+   if (! SymTable_replaceKey(oSrc, pcKey, uLength, pvDst, &pvOld)) {
+      return 0;
+   }
+   if (! SymTable_replaceKey(oDst, pcKey, uLength, pvSrc, &pvOld)) {
+      /* the path to pcKey in oSrc is owned now, so this cannot fail */
+      SymTable_replaceKey(oSrc, pcKey, uLength, pvSrc, &pvOld);
+      return 0;
+   }
+   return 1;
+}
+
+/* A B-tree rebalances at every removal, so SymTable_merge puts the
+   bindings it moves into oDst first, then takes them all out of oSrc
+   at once by rebuilding it as SymTable_retain does. Their keys are
+   copied, as the rebuild frees those of oSrc. */
+int SymTable_merge(SymTable_T oDst, SymTable_T oSrc, unsigned int uPolicy) {
+   struct Retain sMerge;
+   struct BTreeNode *psFound;
+   const char *pcKey;
+   size_t uCount;
+   size_t uLength;
+   size_t i;
+   size_t k;
+   int iSuccessful = 1;
+   assert(oDst != NULL);
+   assert(oSrc != NULL);
+   assert(oDst != oSrc);
+   assert(! oDst->iReadOnly && ! oSrc->iReadOnly);
+   assert(oDst->uValueSize == oSrc->uValueSize);
+   assert((oDst->uFlags & SYMTABLE_BORROW_KEYS) ==
+      (oSrc->uFlags & SYMTABLE_BORROW_KEYS));
+   assert(uPolicy == SYMTABLE_MERGE_KEEP ||
+      uPolicy == SYMTABLE_MERGE_REPLACE);
+   uCount = oSrc->length + 1;
+   sMerge.ppcKeys = (char **) malloc(uCount * sizeof(char *));
+   sMerge.ppvItems = (const void **) malloc(uCount * sizeof(void *));
+   sMerge.pucMarks = (unsigned char *) malloc(uCount);
+   sMerge.uKept = 0;
+   sMerge.uSeen = 0;
+   if (sMerge.ppcKeys == NULL || sMerge.ppvItems == NULL ||
+      sMerge.pucMarks == NULL) {
+      iSuccessful = 0;
+   }
+   else {
+      BTree_map(oSrc->psRoot, SymTable_collect, &sMerge);
+   }
+   for (k = 0; k < sMerge.uKept; k++) {
+      sMerge.pucMarks[k] = RETAIN_KEPT;
+      if (! iSuccessful) {
+         continue;
+      }
+      pcKey = sMerge.ppcKeys[k];
+      uLength = strlen(pcKey);
+      psFound = SymTable_find(oDst, pcKey, uLength, &i);
+      if (psFound == NULL) {
+         iSuccessful = SymTable_putKey(oDst, pcKey, uLength,
+            sMerge.ppvItems[k]);
+         if (iSuccessful) {
+            sMerge.pucMarks[k] = 0;
+         }
+      }
+      else if (uPolicy == SYMTABLE_MERGE_REPLACE) {
+         iSuccessful = SymTable_trade(oDst, oSrc, pcKey, uLength,
+            psFound->apvItems[i], sMerge.ppvItems[k]);
+      }
+   }
+   if (sMerge.uKept != 0 && ! SymTable_retain(oSrc, SymTable_unmoved,
+      NULL, &sMerge)) {
+      iSuccessful = 0;
+   }
+   free(sMerge.ppcKeys);
+   free(sMerge.ppvItems);
+   free(sMerge.pucMarks);
+   return iSuccessful;
+}
+
+int SymTable_mapRange(SymTable_T oSymTable, const char *pcLo,
+    const char *pcHi,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+   BTree_mapRange(oSymTable, oSymTable->psRoot, pcLo, pcHi, NULL, 0,
+      pfApply, pvExtra);
+   return 1;
+}
+
+int SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+   assert(oSymTable != NULL);
+   assert(pcPrefix != NULL);
+   assert(pfApply != NULL);
+   BTree_mapRange(oSymTable, oSymTable->psRoot, pcPrefix, NULL, pcPrefix,
+      strlen(pcPrefix), pfApply, pvExtra);
+   return 1;
+}
+
+struct SymTableStats SymTable_getStats(SymTable_T oSymTable) {
+   struct SymTableStats sStats;
+   assert(oSymTable != NULL);
+#ifdef SYMTABLE_STATS
+   sStats = oSymTable->sStats;
+#else
+   memset(&sStats, 0, sizeof(sStats));
+#endif
+   return sStats;
+}
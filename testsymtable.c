@@ -4,6 +4,7 @@
 /*--------------------------------------------------------------------*/
 
 #include "symtable.h"
+#include "symtablegen.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -776,6 +777,2315 @@ static void testCollisions(void)
 
 /*--------------------------------------------------------------------*/
 
+/* Return the bucket of pcKey in a hash table with uBucketCount
+   buckets, using the hash function provided in the assignment
+   specification. */
+
+static size_t specBucket(const char *pcKey, size_t uBucketCount)
+{
+   const size_t HASH_MULTIPLIER = 65599;
+   size_t u;
+   size_t uHash = 0;
+
+   assert(pcKey != NULL);
+
+   for (u = 0; pcKey[u] != '\0'; u++)
+      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+
+   return uHash % uBucketCount;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the ability of a SymTable object to handle a bucket that holds
+   more bindings than fit in one group of bucket metadata.  This test
+   makes the same assumptions as testCollisions. */
+
+static void testCrowdedBucket(void)
+{
+   enum {KEY_COUNT = 40, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char aacKeys[KEY_COUNT + 1][MAX_KEY_LENGTH];
+   int iSuccessful;
+   int iFound;
+   int i;
+   int k;
+   char *pcValue;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object with many keys in one bucket.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Find KEY_COUNT + 1 keys that hash to bucket 123. */
+   for (i = 0, k = 0; k < KEY_COUNT + 1; i++)
+   {
+      sprintf(aacKeys[k], "%d", i);
+      if (specBucket(aacKeys[k], 509) == 123)
+         k++;
+   }
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      iSuccessful = SymTable_put(oSymTable, aacKeys[k], aacKeys[k]);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      pcValue = (char*)SymTable_get(oSymTable, aacKeys[k]);
+      ASSURE(pcValue == aacKeys[k]);
+   }
+
+   /* The last key shares the bucket but was never put. */
+   iFound = SymTable_contains(oSymTable, aacKeys[KEY_COUNT]);
+   ASSURE(! iFound);
+   pcValue = (char*)SymTable_remove(oSymTable, aacKeys[KEY_COUNT]);
+   ASSURE(pcValue == NULL);
+
+   /* Remove every other key, starting from the most recent. */
+   for (k = KEY_COUNT - 1; k >= 0; k -= 2)
+   {
+      pcValue = (char*)SymTable_remove(oSymTable, aacKeys[k]);
+      ASSURE(pcValue == aacKeys[k]);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT / 2);
+
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      iFound = SymTable_contains(oSymTable, aacKeys[k]);
+      ASSURE(iFound == (k % 2 == 0));
+   }
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the ability of a SymTable object to withstand many keys that
+   all collide under the hash function provided in the assignment
+   specification, both for a table made by SymTable_new and for a
+   table made with SYMTABLE_HARDENED. */
+
+static void testFlooding(void)
+{
+   enum {KEY_COUNT = 200, MAX_KEY_LENGTH = 10};
+
+   SymTable_T aoSymTables[2];
+   struct SymTableStats sStats;
+   struct SymTableStats sStats2;
+   char aacKeys[KEY_COUNT][MAX_KEY_LENGTH];
+   int iSuccessful;
+   int i;
+   int k;
+   int t;
+   char *pcValue;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object flooded with colliding keys.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Find KEY_COUNT keys that hash to bucket 123. */
+   for (i = 0, k = 0; k < KEY_COUNT; i++)
+   {
+      sprintf(aacKeys[k], "%d", i);
+      if (specBucket(aacKeys[k], 509) == 123)
+         k++;
+   }
+
+   aoSymTables[0] = SymTable_new();
+   ASSURE(aoSymTables[0] != NULL);
+   aoSymTables[1] = SymTable_newWithFlags(SYMTABLE_HARDENED);
+   ASSURE(aoSymTables[1] != NULL);
+
+   for (t = 0; t < 2; t++)
+   {
+      for (k = 0; k < KEY_COUNT; k++)
+      {
+         iSuccessful = SymTable_put(aoSymTables[t], aacKeys[k],
+            aacKeys[k]);
+         ASSURE(iSuccessful);
+      }
+      ASSURE(SymTable_getLength(aoSymTables[t]) == KEY_COUNT);
+
+      sStats = SymTable_getStats(aoSymTables[t]);
+      for (k = 0; k < KEY_COUNT; k++)
+      {
+         pcValue = (char*)SymTable_get(aoSymTables[t], aacKeys[k]);
+         ASSURE(pcValue == aacKeys[k]);
+      }
+      sStats2 = SymTable_getStats(aoSymTables[t]);
+
+      /* A hash table must not scan the colliding keys one by one. */
+      if (sStats2.uHashes != 0)
+         ASSURE(sStats2.uProbes - sStats.uProbes < 4 * KEY_COUNT);
+
+      for (k = 0; k < KEY_COUNT; k += 2)
+      {
+         pcValue = (char*)SymTable_remove(aoSymTables[t], aacKeys[k]);
+         ASSURE(pcValue == aacKeys[k]);
+      }
+      for (k = 0; k < KEY_COUNT; k++)
+         ASSURE(SymTable_contains(aoSymTables[t], aacKeys[k]) ==
+            (k % 2 != 0));
+
+      SymTable_free(aoSymTables[t]);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the operation counters of a SymTable object.  The counters
+   are only kept when SYMTABLE_STATS is defined. */
+
+static void testStats(void)
+{
+   SymTable_T oSymTable;
+   struct SymTableStats sStats;
+   int iSuccessful;
+   int iFound;
+   char *pcValue;
+   char acRightField[] = "Right Field";
+   char acFirstBase[] = "First Base";
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the operation counters of a SymTable object.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   iSuccessful = SymTable_put(oSymTable, "Ruth", acRightField);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "Gehrig", acFirstBase);
+   ASSURE(iSuccessful);
+   pcValue = (char*)SymTable_get(oSymTable, "Ruth");
+   ASSURE(pcValue == acRightField);
+   pcValue = (char*)SymTable_get(oSymTable, "Mantle");
+   ASSURE(pcValue == NULL);
+   iFound = SymTable_contains(oSymTable, "Gehrig");
+   ASSURE(iFound);
+
+   sStats = SymTable_getStats(oSymTable);
+#ifdef SYMTABLE_STATS
+   /* Each put first looks its key up and misses. */
+   ASSURE(sStats.uHits == 2);
+   ASSURE(sStats.uMisses == 3);
+   ASSURE(sStats.uCompares >= sStats.uHits);
+   ASSURE(sStats.uProbes >= sStats.uCompares);
+   ASSURE((sStats.uHashes == 0) || (sStats.uHashes == 5));
+   ASSURE(sStats.uAllocations >= 4);
+#else
+   ASSURE(sStats.uHits == 0);
+   ASSURE(sStats.uMisses == 0);
+   ASSURE(sStats.uProbes == 0);
+   ASSURE(sStats.uAllocations == 0);
+#endif
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable objects made with SYMTABLE_MOVE_TO_FRONT and with
+   SYMTABLE_TRANSPOSE.  A key that is looked up over and over should
+   end up being found in one probe, and no binding should be lost
+   along the way. */
+
+static void testAdaptive(void)
+{
+   enum {KEY_COUNT = 100, MAX_KEY_LENGTH = 10};
+
+   static const unsigned int auFlags[] = {SYMTABLE_MOVE_TO_FRONT,
+      SYMTABLE_TRANSPOSE};
+   SymTable_T oSymTable;
+   struct SymTableStats sStats;
+   struct SymTableStats sStats2;
+   char aacKeys[KEY_COUNT][MAX_KEY_LENGTH];
+   char acPartner[MAX_KEY_LENGTH];
+   int iSuccessful;
+   int k;
+   int t;
+   char *pcValue;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable objects that reorder their bindings.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   for (k = 0; k < KEY_COUNT; k++)
+      sprintf(aacKeys[k], "%d", k);
+   /* Find a key that hashes to the bucket of the first one. */
+   for (k = KEY_COUNT; ; k++)
+   {
+      sprintf(acPartner, "%d", k);
+      if (specBucket(acPartner, 509) == specBucket(aacKeys[0], 509))
+         break;
+   }
+
+   for (t = 0; t < 2; t++)
+   {
+      oSymTable = SymTable_newWithFlags(auFlags[t]);
+      ASSURE(oSymTable != NULL);
+
+      for (k = 0; k < KEY_COUNT; k++)
+      {
+         iSuccessful = SymTable_put(oSymTable, aacKeys[k], aacKeys[k]);
+         ASSURE(iSuccessful);
+      }
+
+      /* Look up the key that was put first, and so is the furthest
+         from the front. */
+      for (k = 0; k < KEY_COUNT; k++)
+      {
+         pcValue = (char*)SymTable_get(oSymTable, aacKeys[0]);
+         ASSURE(pcValue == aacKeys[0]);
+      }
+      sStats = SymTable_getStats(oSymTable);
+      ASSURE(SymTable_contains(oSymTable, aacKeys[0]));
+      sStats2 = SymTable_getStats(oSymTable);
+      ASSURE(sStats2.uProbes - sStats.uProbes <= 1);
+
+      pcValue = (char*)SymTable_replace(oSymTable, aacKeys[KEY_COUNT / 2],
+         aacKeys[0]);
+      ASSURE(pcValue == aacKeys[KEY_COUNT / 2]);
+      pcValue = (char*)SymTable_get(oSymTable, aacKeys[KEY_COUNT / 2]);
+      ASSURE(pcValue == aacKeys[0]);
+      pcValue = (char*)SymTable_replace(oSymTable, aacKeys[KEY_COUNT / 2],
+         aacKeys[KEY_COUNT / 2]);
+      ASSURE(pcValue == aacKeys[0]);
+
+      for (k = 0; k < KEY_COUNT; k++)
+      {
+         pcValue = (char*)SymTable_get(oSymTable, aacKeys[k]);
+         ASSURE(pcValue == aacKeys[k]);
+      }
+      for (k = KEY_COUNT - 1; k >= 0; k -= 3)
+      {
+         pcValue = (char*)SymTable_remove(oSymTable, aacKeys[k]);
+         ASSURE(pcValue == aacKeys[k]);
+      }
+      for (k = 0; k < KEY_COUNT; k++)
+         ASSURE(SymTable_contains(oSymTable, aacKeys[k]) ==
+            ((KEY_COUNT - 1 - k) % 3 != 0));
+
+      SymTable_free(oSymTable);
+
+      /* Of two keys that share a bucket, the one put second must come
+         to be found in one probe too, ahead of the one put first. */
+      oSymTable = SymTable_newWithFlags(auFlags[t]);
+      ASSURE(oSymTable != NULL);
+      ASSURE(SymTable_put(oSymTable, aacKeys[0], aacKeys[0]));
+      ASSURE(SymTable_put(oSymTable, acPartner, acPartner));
+      for (k = 0; k < KEY_COUNT; k++)
+         ASSURE(SymTable_get(oSymTable, acPartner) == acPartner);
+      sStats = SymTable_getStats(oSymTable);
+      ASSURE(SymTable_contains(oSymTable, acPartner));
+      sStats2 = SymTable_getStats(oSymTable);
+      ASSURE(sStats2.uProbes - sStats.uProbes <= 1);
+      ASSURE(SymTable_get(oSymTable, aacKeys[0]) == aacKeys[0]);
+      ASSURE(SymTable_getLength(oSymTable) == 2);
+      SymTable_free(oSymTable);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_fromArrays, including a duplicate key and removal of
+   bindings that it made. */
+
+static void testFromArrays(void)
+{
+   enum {KEY_COUNT = 3000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   const char *apcKeys[] = {"Ruth", "Gehrig", "Mantle", "Ruth", "Jeter"};
+   const void *apvValues[5];
+   const char **ppcKeys;
+   const void **ppvValues;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   char acRightField[] = "Right Field";
+   char acFirstBase[] = "First Base";
+   char acCenterField[] = "Center Field";
+   char acShortstop[] = "Shortstop";
+   char *pcValue;
+   int iSuccessful;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object built from arrays.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   apvValues[0] = acRightField;
+   apvValues[1] = acFirstBase;
+   apvValues[2] = acCenterField;
+   apvValues[3] = acShortstop;
+   apvValues[4] = acShortstop;
+
+   oSymTable = SymTable_fromArrays(apcKeys, apvValues, 5);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getLength(oSymTable) == 4);
+   pcValue = (char*)SymTable_get(oSymTable, "Ruth");
+   ASSURE(pcValue == acRightField);
+   pcValue = (char*)SymTable_get(oSymTable, "Jeter");
+   ASSURE(pcValue == acShortstop);
+   pcValue = (char*)SymTable_remove(oSymTable, "Gehrig");
+   ASSURE(pcValue == acFirstBase);
+   iSuccessful = SymTable_put(oSymTable, "Gehrig", acFirstBase);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == 4);
+   SymTable_free(oSymTable);
+
+   oSymTable = SymTable_fromArrays(NULL, NULL, 0);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   SymTable_free(oSymTable);
+
+   /* A table large enough to need more than the first bucket count,
+      which then keeps growing through SymTable_put. */
+   paacKeys = malloc(sizeof(*paacKeys) * (2 * KEY_COUNT));
+   ppcKeys = malloc(sizeof(*ppcKeys) * KEY_COUNT);
+   ppvValues = malloc(sizeof(*ppvValues) * KEY_COUNT);
+   ASSURE(paacKeys != NULL && ppcKeys != NULL && ppvValues != NULL);
+   for (k = 0; k < 2 * KEY_COUNT; k++)
+      sprintf(paacKeys[k], "%d", k);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      ppcKeys[k] = paacKeys[k];
+      ppvValues[k] = paacKeys[k];
+   }
+
+   oSymTable = SymTable_fromArrays(ppcKeys, ppvValues, KEY_COUNT);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+   for (k = KEY_COUNT; k < 2 * KEY_COUNT; k++)
+   {
+      iSuccessful = SymTable_put(oSymTable, paacKeys[k], paacKeys[k]);
+      ASSURE(iSuccessful);
+   }
+   for (k = 0; k < 2 * KEY_COUNT; k++)
+   {
+      pcValue = (char*)SymTable_get(oSymTable, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+   }
+   for (k = 0; k < 2 * KEY_COUNT; k += 2)
+   {
+      pcValue = (char*)SymTable_remove(oSymTable, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+   SymTable_free(oSymTable);
+
+   free(paacKeys);
+   free(ppcKeys);
+   free(ppvValues);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The RangeVisit struct records what checkRangeVisit has seen: the
+   key it saw last and how many bindings it was applied to. */
+
+struct RangeVisit
+{
+   const char *pcLast;
+   int iCount;
+};
+
+/* Check that pcKey is bound to itself and sorts after every key seen
+   before it, then record it in the RangeVisit pvExtra. */
+
+static void checkRangeVisit(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   struct RangeVisit *psVisit = (struct RangeVisit*)pvExtra;
+
+   ASSURE(strcmp(pcKey, (char*)pvValue) == 0);
+   ASSURE(psVisit->pcLast == NULL || strcmp(psVisit->pcLast, pcKey) < 0);
+   psVisit->pcLast = pcKey;
+   psVisit->iCount++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_mapRange() and SymTable_mapPrefix() functions,
+   which must visit only the matching bindings, in sorted order. */
+
+static void testMapRange(void)
+{
+   enum {KEY_COUNT = 3000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   struct RangeVisit sVisit;
+   char *pcValue;
+   int iSuccessful;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the SymTable_mapRange() and SymTable_mapPrefix() "
+      "functions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   paacKeys = malloc(sizeof(*paacKeys) * KEY_COUNT);
+   ASSURE(paacKeys != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+      sprintf(paacKeys[k], "%04d", k);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   sVisit.pcLast = NULL;
+   sVisit.iCount = 0;
+   iSuccessful = SymTable_mapRange(oSymTable, NULL, NULL, checkRangeVisit,
+      &sVisit);
+   ASSURE(iSuccessful);
+   ASSURE(sVisit.iCount == 0);
+
+   /* Put the keys in a scrambled order. */
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      iSuccessful = SymTable_put(oSymTable, paacKeys[(k * 7) % KEY_COUNT],
+         paacKeys[(k * 7) % KEY_COUNT]);
+      ASSURE(iSuccessful);
+   }
+
+   sVisit.pcLast = NULL;
+   sVisit.iCount = 0;
+   iSuccessful = SymTable_mapRange(oSymTable, NULL, NULL, checkRangeVisit,
+      &sVisit);
+   ASSURE(iSuccessful);
+   ASSURE(sVisit.iCount == KEY_COUNT);
+
+   sVisit.pcLast = NULL;
+   sVisit.iCount = 0;
+   iSuccessful = SymTable_mapRange(oSymTable, "0100", "0200",
+      checkRangeVisit, &sVisit);
+   ASSURE(iSuccessful);
+   ASSURE(sVisit.iCount == 100);
+   ASSURE(strcmp(sVisit.pcLast, "0199") == 0);
+
+   /* Bounds that are not keys themselves. */
+   sVisit.pcLast = NULL;
+   sVisit.iCount = 0;
+   iSuccessful = SymTable_mapRange(oSymTable, "09", "1", checkRangeVisit,
+      &sVisit);
+   ASSURE(iSuccessful);
+   ASSURE(sVisit.iCount == 100);
+
+   sVisit.pcLast = NULL;
+   sVisit.iCount = 0;
+   iSuccessful = SymTable_mapRange(oSymTable, "2", NULL, checkRangeVisit,
+      &sVisit);
+   ASSURE(iSuccessful);
+   ASSURE(sVisit.iCount == 1000);
+
+   sVisit.pcLast = NULL;
+   sVisit.iCount = 0;
+   iSuccessful = SymTable_mapRange(oSymTable, "0500", "0500",
+      checkRangeVisit, &sVisit);
+   ASSURE(iSuccessful);
+   ASSURE(sVisit.iCount == 0);
+
+   sVisit.pcLast = NULL;
+   sVisit.iCount = 0;
+   iSuccessful = SymTable_mapPrefix(oSymTable, "012", checkRangeVisit,
+      &sVisit);
+   ASSURE(iSuccessful);
+   ASSURE(sVisit.iCount == 10);
+   ASSURE(strcmp(sVisit.pcLast, "0129") == 0);
+
+   sVisit.pcLast = NULL;
+   sVisit.iCount = 0;
+   iSuccessful = SymTable_mapPrefix(oSymTable, "", checkRangeVisit,
+      &sVisit);
+   ASSURE(iSuccessful);
+   ASSURE(sVisit.iCount == KEY_COUNT);
+
+   sVisit.pcLast = NULL;
+   sVisit.iCount = 0;
+   iSuccessful = SymTable_mapPrefix(oSymTable, "3", checkRangeVisit,
+      &sVisit);
+   ASSURE(iSuccessful);
+   ASSURE(sVisit.iCount == 0);
+
+   /* Remove every other key and check that the rest remain in
+      order. */
+   for (k = 0; k < KEY_COUNT; k += 2)
+   {
+      pcValue = (char*)SymTable_remove(oSymTable, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT / 2);
+
+   sVisit.pcLast = NULL;
+   sVisit.iCount = 0;
+   iSuccessful = SymTable_mapPrefix(oSymTable, "01", checkRangeVisit,
+      &sVisit);
+   ASSURE(iSuccessful);
+   ASSURE(sVisit.iCount == 50);
+
+   for (k = 1; k < KEY_COUNT; k += 2)
+   {
+      pcValue = (char*)SymTable_remove(oSymTable, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+
+   sVisit.pcLast = NULL;
+   sVisit.iCount = 0;
+   iSuccessful = SymTable_mapRange(oSymTable, NULL, NULL, checkRangeVisit,
+      &sVisit);
+   ASSURE(iSuccessful);
+   ASSURE(sVisit.iCount == 0);
+
+   SymTable_free(oSymTable);
+   free(paacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_snapshot(): a snapshot must keep the bindings its
+   SymTable had when it was taken, however the SymTable changes
+   afterwards, and must outlive it. */
+
+static void testSnapshot(void)
+{
+   enum {KEY_COUNT = 2000, MAX_KEY_LENGTH = 10};
+
+   static const unsigned int auFlags[] = {0, SYMTABLE_MOVE_TO_FRONT,
+      SYMTABLE_TRANSPOSE, SYMTABLE_THREAD_CACHE};
+   SymTable_T oSymTable;
+   SymTable_T oSnapshot;
+   SymTable_T oSnapshot2;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   const char **ppcKeys;
+   const void **ppvValues;
+   struct RangeVisit sVisit;
+   char acOther[] = "other";
+   char *pcValue;
+   int iSuccessful;
+   int k;
+   int t;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing snapshots of SymTable objects.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   paacKeys = malloc(sizeof(*paacKeys) * (2 * KEY_COUNT));
+   ppcKeys = malloc(sizeof(*ppcKeys) * KEY_COUNT);
+   ppvValues = malloc(sizeof(*ppvValues) * KEY_COUNT);
+   ASSURE(paacKeys != NULL && ppcKeys != NULL && ppvValues != NULL);
+   for (k = 0; k < 2 * KEY_COUNT; k++)
+      sprintf(paacKeys[k], "%d", k);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      ppcKeys[k] = paacKeys[k];
+      ppvValues[k] = paacKeys[k];
+   }
+
+   for (t = 0; t < 3; t++)
+   {
+      oSymTable = SymTable_newWithFlags(auFlags[t]);
+      ASSURE(oSymTable != NULL);
+      for (k = 0; k < KEY_COUNT; k++)
+      {
+         iSuccessful = SymTable_put(oSymTable, paacKeys[k], paacKeys[k]);
+         ASSURE(iSuccessful);
+      }
+
+      oSnapshot = SymTable_snapshot(oSymTable);
+      ASSURE(oSnapshot != NULL);
+      ASSURE(SymTable_getLength(oSnapshot) == KEY_COUNT);
+
+      /* Change every binding of the SymTable one way or another, and
+         add enough new ones that it has to grow. */
+      for (k = 0; k < KEY_COUNT; k += 2)
+      {
+         pcValue = (char*)SymTable_remove(oSymTable, paacKeys[k]);
+         ASSURE(pcValue == paacKeys[k]);
+      }
+      for (k = 1; k < KEY_COUNT; k += 2)
+      {
+         pcValue = (char*)SymTable_replace(oSymTable, paacKeys[k],
+            acOther);
+         ASSURE(pcValue == paacKeys[k]);
+         pcValue = (char*)SymTable_get(oSymTable, paacKeys[k]);
+         ASSURE(pcValue == acOther);
+      }
+      for (k = KEY_COUNT; k < 2 * KEY_COUNT; k++)
+      {
+         iSuccessful = SymTable_put(oSymTable, paacKeys[k], paacKeys[k]);
+         ASSURE(iSuccessful);
+      }
+      ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT + KEY_COUNT / 2);
+
+      oSnapshot2 = SymTable_snapshot(oSnapshot);
+      ASSURE(oSnapshot2 != NULL);
+      ASSURE(SymTable_getLength(oSnapshot) == KEY_COUNT);
+      for (k = 0; k < 2 * KEY_COUNT; k++)
+      {
+         pcValue = (char*)SymTable_get(oSnapshot, paacKeys[k]);
+         ASSURE(pcValue == (k < KEY_COUNT ? paacKeys[k] : NULL));
+         ASSURE(SymTable_contains(oSnapshot2, paacKeys[k]) ==
+            (k < KEY_COUNT));
+      }
+
+      /* The snapshots outlive the SymTable. */
+      SymTable_free(oSymTable);
+      sVisit.pcLast = NULL;
+      sVisit.iCount = 0;
+      iSuccessful = SymTable_mapRange(oSnapshot, NULL, NULL,
+         checkRangeVisit, &sVisit);
+      ASSURE(iSuccessful);
+      ASSURE(sVisit.iCount == KEY_COUNT);
+      SymTable_free(oSnapshot);
+      pcValue = (char*)SymTable_get(oSnapshot2, paacKeys[KEY_COUNT - 1]);
+      ASSURE(pcValue == paacKeys[KEY_COUNT - 1]);
+      SymTable_free(oSnapshot2);
+   }
+
+   /* A snapshot of a SymTable built from arrays, which is freed after
+      the SymTable. */
+   oSymTable = SymTable_fromArrays(ppcKeys, ppvValues, KEY_COUNT);
+   ASSURE(oSymTable != NULL);
+   oSnapshot = SymTable_snapshot(oSymTable);
+   ASSURE(oSnapshot != NULL);
+   for (k = 0; k < KEY_COUNT; k += 3)
+   {
+      pcValue = (char*)SymTable_remove(oSymTable, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+   }
+   SymTable_free(oSymTable);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      pcValue = (char*)SymTable_get(oSnapshot, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+   }
+   SymTable_free(oSnapshot);
+
+   /* A SymTable that outlives its snapshot keeps working. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   oSnapshot = SymTable_snapshot(oSymTable);
+   ASSURE(oSnapshot != NULL);
+   ASSURE(SymTable_getLength(oSnapshot) == 0);
+   SymTable_free(oSnapshot);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      iSuccessful = SymTable_put(oSymTable, paacKeys[k], paacKeys[k]);
+      ASSURE(iSuccessful);
+   }
+   oSnapshot = SymTable_snapshot(oSymTable);
+   ASSURE(oSnapshot != NULL);
+   SymTable_free(oSnapshot);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      pcValue = (char*)SymTable_remove(oSymTable, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   SymTable_free(oSymTable);
+
+   free(paacKeys);
+   free(ppcKeys);
+   free(ppvValues);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable objects made with SYMTABLE_DEFER_FREE, which leave
+   removed bindings to be freed later by SymTable_put and
+   SymTable_reclaim. */
+
+static void testDeferredFree(void)
+{
+   enum {KEY_COUNT = 3000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   SymTable_T oSnapshot = NULL;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   char *pcValue;
+   size_t uPending;
+   size_t uLeft;
+   int iSuccessful;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable objects that defer freeing.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   paacKeys = malloc(sizeof(*paacKeys) * KEY_COUNT);
+   ASSURE(paacKeys != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+      sprintf(paacKeys[k], "%d", k);
+
+   oSymTable = SymTable_newWithFlags(SYMTABLE_DEFER_FREE);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_reclaim(oSymTable, 10) == 0);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      iSuccessful = SymTable_put(oSymTable, paacKeys[k], paacKeys[k]);
+      ASSURE(iSuccessful);
+   }
+
+   /* Removed bindings are gone at once, even though their memory is
+      not freed yet, and a snapshot taken halfway keeps its own. */
+   for (k = 0; k < KEY_COUNT; k += 2)
+   {
+      if (k == KEY_COUNT / 2)
+      {
+         oSnapshot = SymTable_snapshot(oSymTable);
+         ASSURE(oSnapshot != NULL);
+      }
+      pcValue = (char*)SymTable_remove(oSymTable, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+      ASSURE(! SymTable_contains(oSymTable, paacKeys[k]));
+   }
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT / 2);
+   for (k = 1; k < KEY_COUNT; k += 2)
+   {
+      pcValue = (char*)SymTable_get(oSymTable, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+   }
+   ASSURE(SymTable_getLength(oSnapshot) == KEY_COUNT - KEY_COUNT / 4);
+   for (k = KEY_COUNT / 2; k < KEY_COUNT; k++)
+   {
+      pcValue = (char*)SymTable_get(oSnapshot, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+   }
+   SymTable_free(oSnapshot);
+
+   /* SymTable_reclaim frees no more than its budget. */
+   uPending = SymTable_reclaim(oSymTable, 0);
+   ASSURE(uPending <= KEY_COUNT / 2);
+   uLeft = SymTable_reclaim(oSymTable, 100);
+   ASSURE(uLeft == (uPending > 100 ? uPending - 100 : 0));
+
+   /* Puts free some of what is left, and removed keys can be put
+      again. */
+   for (k = 0; k < 400; k += 2)
+   {
+      iSuccessful = SymTable_put(oSymTable, paacKeys[k], paacKeys[k]);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_reclaim(oSymTable, 0) <= uLeft);
+   for (k = 0; k < 400; k++)
+   {
+      pcValue = (char*)SymTable_get(oSymTable, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+   }
+   ASSURE(SymTable_reclaim(oSymTable, (size_t)-1) == 0);
+
+   /* SymTable_free frees whatever is still waiting. */
+   for (k = 0; k < 400; k++)
+   {
+      pcValue = (char*)SymTable_remove(oSymTable, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT / 2 - 200);
+   SymTable_free(oSymTable);
+
+   free(paacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable objects made with SYMTABLE_FILTER.  The filter must
+   never hide a key that is there, through growing, removal and
+   snapshots, and a hashing SymTable should answer most lookups of
+   missing keys from it without probing. */
+
+static void testFilter(void)
+{
+   enum {KEY_COUNT = 5000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   SymTable_T oSnapshot;
+   struct SymTableStats sStats;
+   struct SymTableStats sStats2;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   char *pcValue;
+   int iSuccessful;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable objects with a filter.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   paacKeys = malloc(sizeof(*paacKeys) * (2 * KEY_COUNT));
+   ASSURE(paacKeys != NULL);
+   for (k = 0; k < 2 * KEY_COUNT; k++)
+      sprintf(paacKeys[k], "%d", k);
+
+   oSymTable = SymTable_newWithFlags(SYMTABLE_FILTER);
+   ASSURE(oSymTable != NULL);
+   ASSURE(! SymTable_contains(oSymTable, paacKeys[0]));
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      iSuccessful = SymTable_put(oSymTable, paacKeys[k], paacKeys[k]);
+      ASSURE(iSuccessful);
+   }
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      pcValue = (char*)SymTable_get(oSymTable, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+   }
+
+   /* Lookups of missing keys.  A hashing SymTable should probe for
+      only the few the filter lets through. */
+   sStats = SymTable_getStats(oSymTable);
+   for (k = KEY_COUNT; k < 2 * KEY_COUNT; k++)
+   {
+      ASSURE(! SymTable_contains(oSymTable, paacKeys[k]));
+      ASSURE(SymTable_get(oSymTable, paacKeys[k]) == NULL);
+      ASSURE(SymTable_replace(oSymTable, paacKeys[k], paacKeys[0]) == NULL);
+   }
+   sStats2 = SymTable_getStats(oSymTable);
+#ifdef SYMTABLE_STATS
+   ASSURE(sStats2.uMisses - sStats.uMisses == 3 * KEY_COUNT);
+   if (sStats2.uHashes != 0)
+      ASSURE(sStats2.uProbes - sStats.uProbes < 3 * KEY_COUNT / 10);
+#else
+   ASSURE(sStats2.uProbes == sStats.uProbes);
+#endif
+
+   /* Removed keys are gone, and the ones left are all still found,
+      including from a snapshot, which has no filter of its own. */
+   oSnapshot = SymTable_snapshot(oSymTable);
+   ASSURE(oSnapshot != NULL);
+   for (k = 0; k < KEY_COUNT; k += 2)
+   {
+      pcValue = (char*)SymTable_remove(oSymTable, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+      ASSURE(SymTable_remove(oSymTable, paacKeys[k]) == NULL);
+   }
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      ASSURE(SymTable_contains(oSymTable, paacKeys[k]) == (k % 2 == 1));
+      pcValue = (char*)SymTable_get(oSnapshot, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+   }
+   SymTable_free(oSnapshot);
+
+   /* Putting the removed keys back and more besides, so that the
+      SymTable grows, keeps every key findable. */
+   for (k = 0; k < 2 * KEY_COUNT; k++)
+   {
+      iSuccessful = SymTable_put(oSymTable, paacKeys[k], paacKeys[k]);
+      ASSURE(iSuccessful == (k >= KEY_COUNT || k % 2 == 0));
+   }
+   for (k = 0; k < 2 * KEY_COUNT; k++)
+   {
+      pcValue = (char*)SymTable_get(oSymTable, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == 2 * KEY_COUNT);
+   SymTable_free(oSymTable);
+
+   /* A hardened SymTable with a filter works the same way. */
+   oSymTable = SymTable_newWithFlags(SYMTABLE_FILTER | SYMTABLE_HARDENED);
+   ASSURE(oSymTable != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      iSuccessful = SymTable_put(oSymTable, paacKeys[k], paacKeys[k]);
+      ASSURE(iSuccessful);
+   }
+   for (k = 0; k < 2 * KEY_COUNT; k++)
+      ASSURE(SymTable_contains(oSymTable, paacKeys[k]) == (k < KEY_COUNT));
+   SymTable_free(oSymTable);
+
+   free(paacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check that the evicted pcKey is bound to itself, and count it in
+   the int that pvExtra points to. */
+
+static void countEviction(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   ASSURE(strcmp(pcKey, (char*)pvValue) == 0);
+   (*(int*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable objects made with SymTable_newBounded(), which must
+   never hold more than their capacity, must report every binding
+   they evict, and should keep a key that is used all the time. */
+
+static void testBounded(void)
+{
+   enum {KEY_COUNT = 2000, CAPACITY = 100, MAX_KEY_LENGTH = 10};
+   static const char *apcColliding[] = {"k708", "k994", "k1062",
+      "k1540", "k1759"};
+
+   SymTable_T oSymTable;
+   SymTable_T oSnapshot;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   char *pcValue;
+   int iEvictions = 0;
+   int iHotHits = 0;
+   int iFound = 0;
+   int iSuccessful;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable objects with a capacity.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   paacKeys = malloc(sizeof(*paacKeys) * KEY_COUNT);
+   ASSURE(paacKeys != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+      sprintf(paacKeys[k], "%d", k);
+
+   /* Use the SymTable as a cache of the keys, with key 0 looked up
+      before every put and put back whenever it was evicted. */
+   oSymTable = SymTable_newBounded(CAPACITY, 0, countEviction, &iEvictions);
+   ASSURE(oSymTable != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      pcValue = (char*)SymTable_get(oSymTable, paacKeys[0]);
+      if (pcValue != NULL)
+      {
+         ASSURE(pcValue == paacKeys[0]);
+         iHotHits++;
+      }
+      else if (k > 0)
+      {
+         iSuccessful = SymTable_put(oSymTable, paacKeys[0], paacKeys[0]);
+         ASSURE(iSuccessful);
+      }
+      iSuccessful = SymTable_put(oSymTable, paacKeys[k], paacKeys[k]);
+      ASSURE(iSuccessful == (k > 0 || pcValue == NULL));
+      ASSURE(SymTable_getLength(oSymTable) <= CAPACITY);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == CAPACITY);
+   ASSURE(iHotHits > (KEY_COUNT - 1) * 9 / 10);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      pcValue = (char*)SymTable_get(oSymTable, paacKeys[k]);
+      if (pcValue != NULL)
+      {
+         ASSURE(pcValue == paacKeys[k]);
+         iFound++;
+      }
+   }
+   ASSURE(iFound == CAPACITY);
+   ASSURE(iEvictions == KEY_COUNT + (KEY_COUNT - 1 - iHotHits) - CAPACITY);
+
+   /* A snapshot keeps its bindings while the SymTable evicts them. */
+   oSnapshot = SymTable_snapshot(oSymTable);
+   ASSURE(oSnapshot != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      if (SymTable_contains(oSnapshot, paacKeys[k]))
+         continue;
+      iSuccessful = SymTable_put(oSymTable, paacKeys[k], paacKeys[k]);
+      ASSURE(iSuccessful);
+      ASSURE(SymTable_getLength(oSymTable) == CAPACITY);
+   }
+   iFound = 0;
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      pcValue = (char*)SymTable_get(oSnapshot, paacKeys[k]);
+      if (pcValue != NULL)
+      {
+         ASSURE(pcValue == paacKeys[k]);
+         iFound++;
+      }
+   }
+   ASSURE(iFound == CAPACITY);
+   SymTable_free(oSnapshot);
+
+   /* Removing makes room without evicting. */
+   iEvictions = 0;
+   for (k = 0; k < KEY_COUNT; k++)
+      if (SymTable_remove(oSymTable, paacKeys[k]) != NULL)
+         ASSURE(SymTable_put(oSymTable, paacKeys[k], paacKeys[k]));
+   ASSURE(iEvictions == 0);
+   SymTable_free(oSymTable);
+
+   /* A key in constant use keeps only its own binding: the keys that
+      share its bucket, assuming the hash function from the assignment
+      specification, are evicted once they go unused. */
+   iEvictions = 0;
+   oSymTable = SymTable_newBounded(CAPACITY, 0, countEviction, &iEvictions);
+   ASSURE(oSymTable != NULL);
+   for (k = 0; k < 5; k++)
+      ASSURE(SymTable_put(oSymTable, apcColliding[k], apcColliding[k]));
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      if (SymTable_get(oSymTable, apcColliding[0]) == NULL)
+         ASSURE(SymTable_put(oSymTable, apcColliding[0],
+            apcColliding[0]));
+      ASSURE(SymTable_put(oSymTable, paacKeys[k], paacKeys[k]));
+      ASSURE(SymTable_getLength(oSymTable) <= CAPACITY);
+   }
+   ASSURE(SymTable_contains(oSymTable, apcColliding[0]));
+   for (k = 1; k < 5; k++)
+      ASSURE(! SymTable_contains(oSymTable, apcColliding[k]));
+   SymTable_free(oSymTable);
+
+   /* A SymTable of capacity 1 with no eviction function keeps only
+      the binding put last. */
+   oSymTable = SymTable_newBounded(1, SYMTABLE_FILTER, NULL, NULL);
+   ASSURE(oSymTable != NULL);
+   for (k = 0; k < 10; k++)
+   {
+      iSuccessful = SymTable_put(oSymTable, paacKeys[k], paacKeys[k]);
+      ASSURE(iSuccessful);
+      ASSURE(SymTable_getLength(oSymTable) == 1);
+      pcValue = (char*)SymTable_get(oSymTable, paacKeys[k]);
+      ASSURE(pcValue == paacKeys[k]);
+   }
+   SymTable_free(oSymTable);
+
+   free(paacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* A Point is a value too big for a pointer, to be kept in a SymTable
+   made with SymTable_newSized(). */
+
+struct Point
+{
+   double dX;
+   char cTag;
+   long lY;
+};
+
+/* Check that pvValue points to a Point whose lY is the number in
+   pcKey, and add its lY to the long that pvExtra points to. */
+
+static void sumPoint(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   struct Point *psPoint = (struct Point*)pvValue;
+   ASSURE(psPoint->lY == atol(pcKey));
+   ASSURE((size_t)psPoint % sizeof(double) == 0);
+   *(long*)pvExtra += psPoint->lY;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable objects made with SymTable_newSized(), which must
+   keep their own copy of every value. */
+
+static void testSized(void)
+{
+   enum {KEY_COUNT = 1000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   SymTable_T oSnapshot;
+   char acKey[MAX_KEY_LENGTH];
+   struct Point sPoint;
+   struct Point *psPoint;
+   int iValue;
+   int *piValue;
+   long lSum;
+   int iSuccessful;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable objects made with SymTable_newSized().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* An int is copied in, so changing the original later does not
+      change the binding. */
+   oSymTable = SymTable_newSized(sizeof(int));
+   ASSURE(oSymTable != NULL);
+   iValue = 42;
+   iSuccessful = SymTable_put(oSymTable, "answer", &iValue);
+   ASSURE(iSuccessful);
+   iValue = 0;
+   piValue = (int*)SymTable_get(oSymTable, "answer");
+   ASSURE(piValue != NULL && piValue != &iValue);
+   ASSURE(*piValue == 42);
+   iSuccessful = SymTable_put(oSymTable, "answer", &iValue);
+   ASSURE(! iSuccessful);
+   ASSURE(*(int*)SymTable_get(oSymTable, "answer") == 42);
+
+   /* Replacing copies over the value in place. */
+   iValue = 7;
+   ASSURE(SymTable_replace(oSymTable, "answer", &iValue) == piValue);
+   ASSURE(*piValue == 7);
+   ASSURE(SymTable_replace(oSymTable, "question", &iValue) == NULL);
+
+   /* Removing returns NULL, as the copy goes with the binding. */
+   ASSURE(SymTable_remove(oSymTable, "answer") == NULL);
+   ASSURE(! SymTable_contains(oSymTable, "answer"));
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   SymTable_free(oSymTable);
+
+   /* Bigger values keep their alignment, and survive the SymTable
+      growing. */
+   oSymTable = SymTable_newSized(sizeof(struct Point));
+   ASSURE(oSymTable != NULL);
+   lSum = 0;
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      sprintf(acKey, "%d", k);
+      sPoint.dX = k / 2.0;
+      sPoint.cTag = (char)('a' + k % 26);
+      sPoint.lY = k;
+      iSuccessful = SymTable_put(oSymTable, acKey, &sPoint);
+      ASSURE(iSuccessful);
+      lSum += k;
+   }
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      sprintf(acKey, "%d", k);
+      psPoint = (struct Point*)SymTable_get(oSymTable, acKey);
+      ASSURE(psPoint != NULL);
+      ASSURE(psPoint->dX == k / 2.0);
+      ASSURE(psPoint->cTag == (char)('a' + k % 26));
+      ASSURE(psPoint->lY == k);
+   }
+   SymTable_map(oSymTable, sumPoint, &lSum);
+   ASSURE(lSum == 2L * (KEY_COUNT - 1) * KEY_COUNT / 2);
+
+   /* A snapshot keeps the old values while the SymTable replaces and
+      removes them. */
+   oSnapshot = SymTable_snapshot(oSymTable);
+   ASSURE(oSnapshot != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      sprintf(acKey, "%d", k);
+      if (k % 2 == 0)
+      {
+         sPoint.dX = -1.0;
+         sPoint.cTag = 'z';
+         sPoint.lY = -k;
+         ASSURE(SymTable_replace(oSymTable, acKey, &sPoint) != NULL);
+         psPoint = (struct Point*)SymTable_get(oSymTable, acKey);
+         ASSURE(psPoint->lY == -k);
+      }
+      else
+         ASSURE(SymTable_remove(oSymTable, acKey) == NULL);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT / 2);
+   lSum = 0;
+   SymTable_map(oSnapshot, sumPoint, &lSum);
+   ASSURE(lSum == (long)(KEY_COUNT - 1) * KEY_COUNT / 2);
+   SymTable_free(oSnapshot);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* IntTable binds int keys to double values, and StringTable binds
+   string keys to int values, without void*. */
+
+SYMTABLE_DEFINE(IntTable, int, double, SYMTABLE_HASH_INT,
+   SYMTABLE_EQUAL_INT)
+SYMTABLE_DEFINE(StringTable, const char *, int, SymTable_hashString,
+   SymTable_equalString)
+
+/* Add the key and value to the doubles that pvExtra points to. */
+
+static void sumIntBinding(int iKey, double *pdValue, void *pvExtra)
+{
+   double *pdSums = (double*)pvExtra;
+   ASSURE(*pdValue == iKey * 0.5);
+   pdSums[0] += iKey;
+   pdSums[1] += *pdValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test tables made with SYMTABLE_DEFINE from symtablegen.h, which
+   must behave like a SymTable with typed keys and values. */
+
+static void testGenerated(void)
+{
+   enum {KEY_COUNT = 5000};
+
+   IntTable_T oIntTable;
+   StringTable_T oStringTable;
+   char acKey[] = "Ruth";
+   double dValue;
+   double adSums[2] = {0.0, 0.0};
+   double *pdValue;
+   int iValue;
+   int iSuccessful;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing tables made with SYMTABLE_DEFINE.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Integer keys, with enough of them to grow the table a few
+      times. */
+   oIntTable = IntTable_new();
+   ASSURE(oIntTable != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      iSuccessful = IntTable_put(oIntTable, k, k * 0.5);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(! IntTable_put(oIntTable, 7, 0.0));
+   ASSURE(IntTable_getLength(oIntTable) == KEY_COUNT);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      pdValue = IntTable_get(oIntTable, k);
+      ASSURE(pdValue != NULL && *pdValue == k * 0.5);
+   }
+   ASSURE(IntTable_get(oIntTable, -1) == NULL);
+   ASSURE(! IntTable_contains(oIntTable, KEY_COUNT));
+   IntTable_map(oIntTable, sumIntBinding, adSums);
+   ASSURE(adSums[0] == (KEY_COUNT - 1) * (double)KEY_COUNT / 2);
+   ASSURE(adSums[1] == adSums[0] * 0.5);
+
+   ASSURE(IntTable_replace(oIntTable, 3, 1.5, &dValue));
+   ASSURE(dValue == 1.5);
+   ASSURE(! IntTable_replace(oIntTable, -3, 1.0, NULL));
+   for (k = 0; k < KEY_COUNT; k += 2)
+   {
+      iSuccessful = IntTable_remove(oIntTable, k, &dValue);
+      ASSURE(iSuccessful && dValue == k * 0.5);
+   }
+   ASSURE(! IntTable_remove(oIntTable, 0, NULL));
+   ASSURE(IntTable_getLength(oIntTable) == KEY_COUNT / 2);
+   for (k = 0; k < KEY_COUNT; k++)
+      ASSURE(IntTable_contains(oIntTable, k) == (k % 2 == 1));
+   IntTable_free(oIntTable);
+
+   /* String keys are compared by value, not by address. */
+   oStringTable = StringTable_new();
+   ASSURE(oStringTable != NULL);
+   ASSURE(StringTable_put(oStringTable, "Ruth", 3));
+   ASSURE(StringTable_put(oStringTable, "Gehrig", 4));
+   ASSURE(! StringTable_put(oStringTable, acKey, 5));
+   ASSURE(*StringTable_get(oStringTable, acKey) == 3);
+   ASSURE(StringTable_remove(oStringTable, acKey, &iValue));
+   ASSURE(iValue == 3);
+   ASSURE(StringTable_getLength(oStringTable) == 1);
+   StringTable_free(oStringTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_putN(), SymTable_lookupN(), SymTable_removeN() and
+   SymTable_next(), which must agree with the other functions on keys
+   cut from longer strings, and must walk every binding once. */
+
+static void testCursor(void)
+{
+   enum {KEY_COUNT = 3000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   struct SymTableCursor sCursor = SYMTABLE_CURSOR_INIT;
+   struct SymTableCursor sStart = SYMTABLE_CURSOR_INIT;
+   const char *pcText = "Ruth Gehrig Ruthless";
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   char *pcSeen;
+   int iSuccessful;
+   int iCount;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable keys with a length, and cursors.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Keys cut from a longer string are the same as their copies. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_putN(oSymTable, pcText, 4, "Babe");
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putN(oSymTable, pcText + 5, 6, "Lou");
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putN(oSymTable, pcText + 12, 4, "Babe");
+   ASSURE(! iSuccessful);
+   iSuccessful = SymTable_putN(oSymTable, pcText, 0, "empty");
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == 3);
+   ASSURE(strcmp((char*)SymTable_get(oSymTable, "Ruth"), "Babe") == 0);
+   ASSURE(strcmp((char*)SymTable_get(oSymTable, "Gehrig"), "Lou") == 0);
+   ASSURE(strcmp((char*)SymTable_get(oSymTable, ""), "empty") == 0);
+   ASSURE(SymTable_lookupN(oSymTable, pcText + 12, 4, &sCursor));
+   ASSURE(strcmp(sCursor.pcKey, "Ruth") == 0);
+   ASSURE(strcmp((char*)sCursor.pvValue, "Babe") == 0);
+   ASSURE(! SymTable_lookupN(oSymTable, pcText + 12, 8, &sCursor));
+   ASSURE(! SymTable_lookupN(oSymTable, pcText, 3, &sCursor));
+   ASSURE(strcmp(sCursor.pcKey, "Ruth") == 0);
+   ASSURE(SymTable_removeN(oSymTable, pcText + 12, 8) == NULL);
+   ASSURE(strcmp((char*)SymTable_removeN(oSymTable, pcText + 12, 4),
+      "Babe") == 0);
+   ASSURE(! SymTable_contains(oSymTable, "Ruth"));
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+   SymTable_free(oSymTable);
+
+   paacKeys = malloc(sizeof(*paacKeys) * KEY_COUNT);
+   ASSURE(paacKeys != NULL);
+   pcSeen = calloc(KEY_COUNT, 1);
+   ASSURE(pcSeen != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+      sprintf(paacKeys[k], "%d", k);
+
+   /* An empty SymTable has nothing to walk. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   sCursor = sStart;
+   ASSURE(! SymTable_next(oSymTable, &sCursor));
+
+   /* A walk visits every binding once, and stays at the end. */
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      iSuccessful = SymTable_put(oSymTable, paacKeys[k], paacKeys[k]);
+      ASSURE(iSuccessful);
+   }
+   iCount = 0;
+   sCursor = sStart;
+   while (SymTable_next(oSymTable, &sCursor))
+   {
+      ASSURE(sCursor.pcKey != NULL);
+      ASSURE(strcmp(sCursor.pcKey, (char*)sCursor.pvValue) == 0);
+      k = atoi(sCursor.pcKey);
+      ASSURE(k >= 0 && k < KEY_COUNT);
+      ASSURE(! pcSeen[k]);
+      pcSeen[k] = 1;
+      iCount++;
+   }
+   ASSURE(iCount == KEY_COUNT);
+   ASSURE(! SymTable_next(oSymTable, &sCursor));
+
+   /* A walk from a key found with SymTable_lookupN visits what a
+      whole walk visits after it. */
+   sCursor = sStart;
+   for (k = 0; k < KEY_COUNT / 2; k++)
+      ASSURE(SymTable_next(oSymTable, &sCursor));
+   sStart = sCursor;
+   ASSURE(SymTable_lookupN(oSymTable, sCursor.pcKey,
+      strlen(sCursor.pcKey), &sCursor));
+   ASSURE(sCursor.pcKey == sStart.pcKey);
+   iCount = 0;
+   while (SymTable_next(oSymTable, &sStart))
+   {
+      ASSURE(SymTable_next(oSymTable, &sCursor));
+      ASSURE(sCursor.pcKey == sStart.pcKey);
+      iCount++;
+   }
+   ASSURE(iCount == KEY_COUNT - KEY_COUNT / 2);
+   ASSURE(! SymTable_next(oSymTable, &sCursor));
+   SymTable_free(oSymTable);
+
+   free(pcSeen);
+   free(paacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Store in *ppvValue a malloc'd copy of the uLength characters at
+   pcValue as a string, and return 1, or return 0 if there is no
+   memory or the value is "fail". */
+
+static int parseString(const char *pcValue, size_t uLength,
+   void **ppvValue, void *pvExtra)
+{
+   char *pcCopy;
+   if (uLength == 4 && strncmp(pcValue, "fail", 4) == 0)
+      return 0;
+   pcCopy = malloc(uLength + 1);
+   if (pcCopy == NULL)
+      return 0;
+   memcpy(pcCopy, pcValue, uLength);
+   pcCopy[uLength] = '\0';
+   *ppvValue = pcCopy;
+   (*(int*)pvExtra)++;
+   return 1;
+}
+
+/* Free the value pvValue that parseString made but that was not
+   bound, and uncount it in the int that pvExtra points to. */
+
+static void freeParsed(void *pvValue, void *pvExtra)
+{
+   free(pvValue);
+   (*(int*)pvExtra)--;
+}
+
+/* Free the value pvValue of a binding. */
+
+static void freeValue(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   (void)pcKey;
+   (void)pvExtra;
+   free(pvValue);
+}
+
+/* Test SymTable_loadStream on a file of tab separated lines,
+   including duplicate keys, lines without a tab, empty lines, "\r\n"
+   line ends, a last line without a '\n', a SymTable that borrows its
+   keys, and a load that fails. */
+
+static void testLoadStream(void)
+{
+   enum {KEY_COUNT = 5000};
+
+   SymTable_T oSymTable;
+   FILE *psFile;
+   char acKey[16];
+   char acValue[16];
+   int iParsed = 0;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object loaded from a stream.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   psFile = tmpfile();
+   ASSURE(psFile != NULL);
+   if (psFile == NULL)
+      return;
+   fputs("Ruth\tRight Field\n", psFile);
+   fputs("Gehrig\tFirst Base\r\n", psFile);
+   fputs("\n", psFile);
+   fputs("Ruth\tPitcher\n", psFile);
+   fputs("Mantle\n", psFile);
+   fputs("Jeter\tShort\tstop\n", psFile);
+   for (k = 0; k < KEY_COUNT; k++)
+      fprintf(psFile, "%d\tv%d\n", k, k);
+   fputs("Berra\tCatcher", psFile);
+   rewind(psFile);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_loadStream(oSymTable, psFile, parseString, freeParsed,
+      &iParsed));
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT + 5);
+   ASSURE(iParsed == KEY_COUNT + 5);
+   ASSURE(strcmp((char*)SymTable_get(oSymTable, "Ruth"),
+      "Right Field") == 0);
+   ASSURE(strcmp((char*)SymTable_get(oSymTable, "Gehrig"),
+      "First Base") == 0);
+   ASSURE(strcmp((char*)SymTable_get(oSymTable, "Mantle"), "") == 0);
+   ASSURE(strcmp((char*)SymTable_get(oSymTable, "Jeter"),
+      "Short\tstop") == 0);
+   ASSURE(strcmp((char*)SymTable_get(oSymTable, "Berra"), "Catcher")
+      == 0);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      sprintf(acKey, "%d", k);
+      sprintf(acValue, "v%d", k);
+      ASSURE(strcmp((char*)SymTable_get(oSymTable, acKey), acValue)
+         == 0);
+   }
+   ASSURE(fgetc(psFile) == EOF);
+   SymTable_map(oSymTable, freeValue, NULL);
+   SymTable_free(oSymTable);
+
+   /* Without a parser every key is bound to NULL, and a failing
+      parser stops the load after the line before it. */
+   rewind(psFile);
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_loadStream(oSymTable, psFile, NULL, NULL, NULL));
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT + 5);
+   ASSURE(SymTable_contains(oSymTable, "Mantle"));
+   ASSURE(SymTable_get(oSymTable, "Ruth") == NULL);
+   SymTable_free(oSymTable);
+
+   /* A SymTable that borrows its keys is refused, as they would be
+      left in memory the load frees; that is an assertion unless
+      NDEBUG is defined. */
+   rewind(psFile);
+   oSymTable = SymTable_newWithFlags(SYMTABLE_BORROW_KEYS);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getFlags(oSymTable) & SYMTABLE_BORROW_KEYS);
+#ifdef NDEBUG
+   ASSURE(! SymTable_loadStream(oSymTable, psFile, NULL, NULL, NULL));
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   ASSURE(ftell(psFile) == 0);
+#endif
+   SymTable_free(oSymTable);
+   fclose(psFile);
+
+   psFile = tmpfile();
+   ASSURE(psFile != NULL);
+   if (psFile == NULL)
+      return;
+   fputs("Ruth\tRight Field\nGehrig\tfail\nMantle\tCenter Field\n",
+      psFile);
+   rewind(psFile);
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   ASSURE(! SymTable_loadStream(oSymTable, psFile, parseString,
+      freeParsed, &iParsed));
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+   ASSURE(SymTable_contains(oSymTable, "Ruth"));
+   ASSURE(! SymTable_contains(oSymTable, "Mantle"));
+   SymTable_map(oSymTable, freeValue, NULL);
+   SymTable_free(oSymTable);
+   fclose(psFile);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check that the binding whose key is pcKey, bound to the key it was
+   put with as pvValue, kept that very key, and count it in the int
+   pvExtra points to. */
+
+static void checkBorrowed(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   ASSURE(pcKey == (const char*)pvValue);
+   (*(int*)pvExtra)++;
+}
+
+/* Test SYMTABLE_BORROW_KEYS, with removals, snapshots, deferred
+   freeing and a bounded SymTable, which must all leave the borrowed
+   keys where they are and never free them. */
+
+static void testBorrowedKeys(void)
+{
+   enum {KEY_COUNT = 3000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   SymTable_T oSnapshot;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   char acKeys[] = "Ruth\0Gehrig";
+   int iCount;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object that borrows its keys.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   paacKeys = malloc(sizeof(*paacKeys) * KEY_COUNT);
+   ASSURE(paacKeys != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+      sprintf(paacKeys[k], "%d", k);
+
+   oSymTable = SymTable_newWithFlags(SYMTABLE_BORROW_KEYS |
+      SYMTABLE_DEFER_FREE);
+   ASSURE(oSymTable != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+      ASSURE(SymTable_put(oSymTable, paacKeys[k], paacKeys[k]));
+   ASSURE(SymTable_putN(oSymTable, acKeys + 5, 6, acKeys + 5));
+   ASSURE(! SymTable_put(oSymTable, "0", acKeys));
+   iCount = 0;
+   SymTable_map(oSymTable, checkBorrowed, &iCount);
+   ASSURE(iCount == KEY_COUNT + 1);
+
+   /* Removing from the SymTable copies what the snapshot shares, but
+      not the keys. */
+   oSnapshot = SymTable_snapshot(oSymTable);
+   ASSURE(oSnapshot != NULL);
+   ASSURE(SymTable_getFlags(oSnapshot) == SYMTABLE_BORROW_KEYS);
+   for (k = 0; k < KEY_COUNT; k += 2)
+      ASSURE(SymTable_remove(oSymTable, paacKeys[k]) == paacKeys[k]);
+   ASSURE(SymTable_replace(oSymTable, paacKeys[1], paacKeys[1]) ==
+      paacKeys[1]);
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT / 2 + 1);
+   ASSURE(SymTable_getLength(oSnapshot) == KEY_COUNT + 1);
+   iCount = 0;
+   SymTable_map(oSnapshot, checkBorrowed, &iCount);
+   ASSURE(iCount == KEY_COUNT + 1);
+   SymTable_free(oSnapshot);
+   SymTable_reclaim(oSymTable, KEY_COUNT);
+   iCount = 0;
+   SymTable_map(oSymTable, checkBorrowed, &iCount);
+   ASSURE(iCount == KEY_COUNT / 2 + 1);
+   SymTable_free(oSymTable);
+
+   oSymTable = SymTable_newBounded(100, SYMTABLE_BORROW_KEYS, NULL,
+      NULL);
+   ASSURE(oSymTable != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+      ASSURE(SymTable_put(oSymTable, paacKeys[k], paacKeys[k]));
+   ASSURE(SymTable_getLength(oSymTable) == 100);
+   iCount = 0;
+   SymTable_map(oSymTable, checkBorrowed, &iCount);
+   ASSURE(iCount == 100);
+   SymTable_free(oSymTable);
+
+   free(paacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count the binding whose key is pcKey in the int pvExtra points
+   to, checking that its value pvValue is a copy of the key. */
+
+static void countBinding(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   ASSURE(strcmp(pcKey, (char*)pvValue) == 0);
+   (*(int*)pvExtra)++;
+}
+
+/* Return 1 if the number pcKey spells is not a multiple of the int
+   pvExtra points to, otherwise 0. */
+
+static int keepNonMultiple(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   ASSURE(strcmp(pcKey, (char*)pvValue) == 0);
+   return atoi(pcKey) % *(int*)pvExtra != 0;
+}
+
+/* Count a removed binding in the int that pvExtra points to, where
+   pvExtra is the address of the divisor given to keepNonMultiple. */
+
+static void countRemoved(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   ASSURE(strcmp(pcKey, (char*)pvValue) == 0);
+   ASSURE(atoi(pcKey) % ((int*)pvExtra)[0] == 0);
+   ((int*)pvExtra)[1]++;
+}
+
+/* Test the SymTable_retain() function, with and without a snapshot
+   that must keep every binding. */
+
+static void testRetain(void)
+{
+   enum {KEY_COUNT = 5000, MAX_KEY_LENGTH = 10};
+
+   static const unsigned int auFlags[] = {0, SYMTABLE_FILTER,
+      SYMTABLE_DEFER_FREE | SYMTABLE_MOVE_TO_FRONT};
+   SymTable_T oSymTable;
+   SymTable_T oSnapshot;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   int aiExtra[2];
+   int iCount;
+   size_t f;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the SymTable_retain() function.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   paacKeys = malloc(sizeof(*paacKeys) * KEY_COUNT);
+   ASSURE(paacKeys != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+      sprintf(paacKeys[k], "%d", k);
+
+   for (f = 0; f < sizeof(auFlags) / sizeof(auFlags[0]); f++)
+   {
+      oSymTable = SymTable_newWithFlags(auFlags[f]);
+      ASSURE(oSymTable != NULL);
+      for (k = 0; k < KEY_COUNT; k++)
+         ASSURE(SymTable_put(oSymTable, paacKeys[k], paacKeys[k]));
+
+      /* Remove the multiples of 3, with pfFree. */
+      aiExtra[0] = 3;
+      aiExtra[1] = 0;
+      ASSURE(SymTable_retain(oSymTable, keepNonMultiple, countRemoved,
+         aiExtra));
+      ASSURE(aiExtra[1] == (KEY_COUNT + 2) / 3);
+      ASSURE(SymTable_getLength(oSymTable) ==
+         (size_t)(KEY_COUNT - aiExtra[1]));
+      for (k = 0; k < KEY_COUNT; k++)
+         ASSURE(SymTable_get(oSymTable, paacKeys[k]) ==
+            (k % 3 != 0 ? paacKeys[k] : NULL));
+
+      /* Remove the multiples of 2 while a snapshot shares the
+         bindings, without pfFree. */
+      oSnapshot = SymTable_snapshot(oSymTable);
+      ASSURE(oSnapshot != NULL);
+      aiExtra[0] = 2;
+      ASSURE(SymTable_retain(oSymTable, keepNonMultiple, NULL,
+         aiExtra));
+      for (k = 0; k < KEY_COUNT; k++)
+      {
+         ASSURE(SymTable_contains(oSymTable, paacKeys[k]) ==
+            (k % 3 != 0 && k % 2 != 0));
+         ASSURE(SymTable_contains(oSnapshot, paacKeys[k]) ==
+            (k % 3 != 0));
+      }
+      iCount = 0;
+      SymTable_map(oSnapshot, countBinding, &iCount);
+      ASSURE(iCount == KEY_COUNT - (KEY_COUNT + 2) / 3);
+      SymTable_free(oSnapshot);
+
+      /* Keeping every binding changes nothing, and keeping none
+         empties the SymTable, which still takes new bindings. */
+      aiExtra[0] = KEY_COUNT + 1;
+      ASSURE(SymTable_retain(oSymTable, keepNonMultiple, NULL,
+         aiExtra));
+      iCount = 0;
+      SymTable_map(oSymTable, countBinding, &iCount);
+      ASSURE((size_t)iCount == SymTable_getLength(oSymTable));
+      aiExtra[0] = 1;
+      aiExtra[1] = 0;
+      ASSURE(SymTable_retain(oSymTable, keepNonMultiple, countRemoved,
+         aiExtra));
+      ASSURE(aiExtra[1] == iCount);
+      ASSURE(SymTable_getLength(oSymTable) == 0);
+      ASSURE(SymTable_put(oSymTable, paacKeys[6], paacKeys[6]));
+      ASSURE(SymTable_get(oSymTable, paacKeys[6]) == paacKeys[6]);
+      SymTable_reclaim(oSymTable, KEY_COUNT);
+      SymTable_free(oSymTable);
+   }
+
+   free(paacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_merge() and SymTable_difference() functions,
+   between SymTables that hash alike and ones that do not, with
+   snapshots that must keep their bindings, and from a SymTable made
+   by SymTable_fromArrays. The values of the two SymTables are
+   different copies of the keys, so that which one a binding has can
+   be told apart. */
+
+static void testMerge(void)
+{
+   enum {KEY_COUNT = 3000, MAX_KEY_LENGTH = 10};
+
+   static const unsigned int auFlags[][2] = {{0, 0},
+      {SYMTABLE_FILTER, SYMTABLE_HARDENED},
+      {SYMTABLE_DEFER_FREE | SYMTABLE_MOVE_TO_FRONT,
+         SYMTABLE_DEFER_FREE},
+      {SYMTABLE_THREAD_CACHE, 0}};
+   SymTable_T oDst;
+   SymTable_T oSrc;
+   SymTable_T oSnapshot;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   char (*paacOther)[MAX_KEY_LENGTH];
+   const char **ppcKeys;
+   const void **ppvValues;
+   const char *pcValue;
+   int aiExtra[2];
+   int iValue;
+   size_t f;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the SymTable_merge() and SymTable_difference() "
+      "functions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   paacKeys = malloc(sizeof(*paacKeys) * KEY_COUNT);
+   paacOther = malloc(sizeof(*paacOther) * KEY_COUNT);
+   ppcKeys = malloc(sizeof(*ppcKeys) * KEY_COUNT);
+   ppvValues = malloc(sizeof(*ppvValues) * KEY_COUNT);
+   ASSURE(paacKeys != NULL && paacOther != NULL && ppcKeys != NULL &&
+      ppvValues != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      sprintf(paacKeys[k], "%d", k);
+      strcpy(paacOther[k], paacKeys[k]);
+   }
+
+   for (f = 0; f < sizeof(auFlags) / sizeof(auFlags[0]); f++)
+   {
+      /* The even keys merge with the multiples of 3, which a snapshot
+         of oSrc keeps. */
+      oDst = SymTable_newWithFlags(auFlags[f][0]);
+      oSrc = SymTable_newWithFlags(auFlags[f][1]);
+      ASSURE(oDst != NULL && oSrc != NULL);
+      for (k = 0; k < KEY_COUNT; k++)
+      {
+         if (k % 2 == 0)
+            ASSURE(SymTable_put(oDst, paacKeys[k], paacKeys[k]));
+         if (k % 3 == 0)
+            ASSURE(SymTable_put(oSrc, paacKeys[k], paacOther[k]));
+      }
+      oSnapshot = SymTable_snapshot(oSrc);
+      ASSURE(oSnapshot != NULL);
+      ASSURE(SymTable_merge(oDst, oSrc, SYMTABLE_MERGE_KEEP));
+      ASSURE(SymTable_getLength(oDst) == (KEY_COUNT + 1) / 2 +
+         (KEY_COUNT + 2) / 3 - (KEY_COUNT + 5) / 6);
+      ASSURE(SymTable_getLength(oSrc) == (KEY_COUNT + 5) / 6);
+      ASSURE(SymTable_getLength(oSnapshot) == (KEY_COUNT + 2) / 3);
+      for (k = 0; k < KEY_COUNT; k++)
+      {
+         pcValue = SymTable_get(oDst, paacKeys[k]);
+         ASSURE(pcValue == (k % 2 == 0 ? paacKeys[k] :
+            k % 3 == 0 ? paacOther[k] : NULL));
+         pcValue = SymTable_get(oSrc, paacKeys[k]);
+         ASSURE(pcValue == (k % 6 == 0 ? paacOther[k] : NULL));
+         pcValue = SymTable_get(oSnapshot, paacKeys[k]);
+         ASSURE(pcValue == (k % 3 == 0 ? paacOther[k] : NULL));
+      }
+      SymTable_free(oSnapshot);
+      SymTable_free(oSrc);
+
+      /* Merging the multiples of 3 again with the other value of
+         each replaces every one of them, and oSrc gets back the
+         values that lost, while a snapshot of oDst keeps them. */
+      oSrc = SymTable_newWithFlags(auFlags[f][1]);
+      ASSURE(oSrc != NULL);
+      for (k = 0; k < KEY_COUNT; k += 3)
+         ASSURE(SymTable_put(oSrc, paacKeys[k],
+            k % 2 == 0 ? paacOther[k] : paacKeys[k]));
+      oSnapshot = SymTable_snapshot(oDst);
+      ASSURE(oSnapshot != NULL);
+      ASSURE(SymTable_merge(oDst, oSrc, SYMTABLE_MERGE_REPLACE));
+      ASSURE(SymTable_getLength(oDst) == SymTable_getLength(oSnapshot));
+      ASSURE(SymTable_getLength(oSrc) == (KEY_COUNT + 2) / 3);
+      for (k = 0; k < KEY_COUNT; k += 3)
+      {
+         ASSURE(SymTable_get(oDst, paacKeys[k]) ==
+            (k % 2 == 0 ? paacOther[k] : paacKeys[k]));
+         ASSURE(SymTable_get(oSrc, paacKeys[k]) ==
+            (k % 2 == 0 ? paacKeys[k] : paacOther[k]));
+         ASSURE(SymTable_get(oSnapshot, paacKeys[k]) ==
+            SymTable_get(oSrc, paacKeys[k]));
+      }
+      SymTable_free(oSnapshot);
+
+      /* The difference with oSrc leaves the even keys that are not
+         multiples of 3, and oSrc as it was. */
+      aiExtra[0] = 3;
+      aiExtra[1] = 0;
+      ASSURE(SymTable_difference(oDst, oSrc, countRemoved, aiExtra));
+      ASSURE(aiExtra[1] == (KEY_COUNT + 2) / 3);
+      ASSURE(SymTable_getLength(oSrc) == (KEY_COUNT + 2) / 3);
+      for (k = 0; k < KEY_COUNT; k++)
+      {
+         ASSURE(SymTable_get(oDst, paacKeys[k]) ==
+            (k % 2 == 0 && k % 3 != 0 ? paacKeys[k] : NULL));
+         ASSURE(SymTable_contains(oSrc, paacKeys[k]) == (k % 3 == 0));
+      }
+      ASSURE(SymTable_difference(oSrc, oDst, NULL, NULL));
+      ASSURE(SymTable_getLength(oSrc) == (KEY_COUNT + 2) / 3);
+      SymTable_free(oSrc);
+      SymTable_free(oDst);
+   }
+
+   /* Every binding of a SymTable made by SymTable_fromArrays moves
+      into an empty SymTable, which must outlive it. */
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      ppcKeys[k] = paacKeys[k];
+      ppvValues[k] = paacOther[k];
+   }
+   oSrc = SymTable_fromArrays(ppcKeys, ppvValues, KEY_COUNT);
+   oDst = SymTable_new();
+   ASSURE(oSrc != NULL && oDst != NULL);
+   ASSURE(SymTable_merge(oDst, oSrc, SYMTABLE_MERGE_KEEP));
+   ASSURE(SymTable_getLength(oSrc) == 0);
+   ASSURE(SymTable_merge(oDst, oSrc, SYMTABLE_MERGE_KEEP));
+   SymTable_free(oSrc);
+   ASSURE(SymTable_getLength(oDst) == KEY_COUNT);
+   for (k = 0; k < KEY_COUNT; k++)
+      ASSURE(SymTable_get(oDst, paacKeys[k]) == paacOther[k]);
+   SymTable_free(oDst);
+
+   /* SymTables made by SymTable_newSized copy the winning value. */
+   oDst = SymTable_newSized(sizeof(int));
+   oSrc = SymTable_newSized(sizeof(int));
+   ASSURE(oDst != NULL && oSrc != NULL);
+   iValue = 1;
+   ASSURE(SymTable_put(oDst, "a", &iValue));
+   iValue = 2;
+   ASSURE(SymTable_put(oSrc, "a", &iValue));
+   iValue = 3;
+   ASSURE(SymTable_put(oSrc, "b", &iValue));
+   ASSURE(SymTable_merge(oDst, oSrc, SYMTABLE_MERGE_REPLACE));
+   ASSURE(SymTable_getLength(oDst) == 2);
+   ASSURE(SymTable_getLength(oSrc) == 1);
+   ASSURE(*(int*)SymTable_get(oDst, "a") == 2);
+   ASSURE(*(int*)SymTable_get(oDst, "b") == 3);
+   SymTable_free(oSrc);
+   SymTable_free(oDst);
+
+   free(paacKeys);
+   free(paacOther);
+   free(ppcKeys);
+   free(ppvValues);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SYMTABLE_BACKGROUND_RESIZE: puts, replacements and removals
+   made while the SymTable grows must show in lookups at once, and in
+   a walk, a cursor and a snapshot afterwards, and a SymTable may be
+   freed while it grows. Implementations that ignore the flag must
+   pass as well. */
+
+static void testBackgroundResize(void)
+{
+   enum {KEY_COUNT = 3000, MAX_KEY_LENGTH = 10};
+
+   static const unsigned int auFlags[] = {0,
+      SYMTABLE_FILTER | SYMTABLE_HARDENED,
+      SYMTABLE_DEFER_FREE | SYMTABLE_MOVE_TO_FRONT,
+      SYMTABLE_THREAD_CACHE};
+   SymTable_T oSymTable;
+   SymTable_T oSnapshot;
+   struct SymTableCursor sCursor;
+   struct SymTableCursor sStart = SYMTABLE_CURSOR_INIT;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   char (*paacOther)[MAX_KEY_LENGTH];
+   const char *pcValue;
+   int iRemoved;
+   int iCount;
+   size_t f;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object that grows in the background.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   paacKeys = malloc(sizeof(*paacKeys) * KEY_COUNT);
+   paacOther = malloc(sizeof(*paacOther) * KEY_COUNT);
+   ASSURE(paacKeys != NULL && paacOther != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      sprintf(paacKeys[k], "%d", k);
+      strcpy(paacOther[k], paacKeys[k]);
+   }
+
+   for (f = 0; f < sizeof(auFlags) / sizeof(auFlags[0]); f++)
+   {
+      oSymTable = SymTable_newWithFlags(SYMTABLE_BACKGROUND_RESIZE |
+         auFlags[f]);
+      ASSURE(oSymTable != NULL);
+
+      /* Each multiple of 3 is removed, and each multiple of 5 bound
+         to its copy in paacOther, a few puts after it went in. */
+      iRemoved = 0;
+      for (k = 0; k < KEY_COUNT; k++)
+      {
+         ASSURE(SymTable_put(oSymTable, paacKeys[k], paacKeys[k]));
+         ASSURE(! SymTable_put(oSymTable, paacKeys[k], paacOther[k]));
+         ASSURE(SymTable_get(oSymTable, paacKeys[k]) == paacKeys[k]);
+         if (k % 3 == 1)
+         {
+            ASSURE(SymTable_remove(oSymTable, paacKeys[k - 1]) ==
+               paacKeys[k - 1]);
+            ASSURE(! SymTable_contains(oSymTable, paacKeys[k - 1]));
+            ASSURE(SymTable_remove(oSymTable, paacKeys[k - 1]) == NULL);
+            iRemoved++;
+         }
+         if (k % 5 == 4)
+         {
+            pcValue = SymTable_replace(oSymTable, paacKeys[k - 4],
+               paacOther[k - 4]);
+            if ((k - 4) % 3 == 0)
+               ASSURE(pcValue == NULL);
+            else
+            {
+               ASSURE(pcValue == paacKeys[k - 4]);
+               ASSURE(SymTable_get(oSymTable, paacKeys[k - 4]) ==
+                  paacOther[k - 4]);
+            }
+         }
+         ASSURE(SymTable_getLength(oSymTable) ==
+            (size_t)(k + 1 - iRemoved));
+         if (k % 500 == 499)
+         {
+            iCount = 0;
+            SymTable_map(oSymTable, countBinding, &iCount);
+            ASSURE(iCount == k + 1 - iRemoved);
+         }
+      }
+
+      for (k = 0; k < KEY_COUNT; k++)
+      {
+         pcValue = SymTable_get(oSymTable, paacKeys[k]);
+         if (k % 3 == 0)
+            ASSURE(pcValue == NULL);
+         else if (k % 5 == 0 && k + 4 < KEY_COUNT)
+            ASSURE(pcValue == paacOther[k]);
+         else
+            ASSURE(pcValue == paacKeys[k]);
+      }
+      iCount = 0;
+      SymTable_map(oSymTable, countBinding, &iCount);
+      ASSURE(iCount == KEY_COUNT - iRemoved);
+      iCount = 0;
+      sCursor = sStart;
+      while (SymTable_next(oSymTable, &sCursor))
+         iCount++;
+      ASSURE(iCount == KEY_COUNT - iRemoved);
+
+      /* Putting the removed keys back grows the SymTable again, and
+         the snapshot must not see it. */
+      oSnapshot = SymTable_snapshot(oSymTable);
+      ASSURE(oSnapshot != NULL);
+      for (k = 0; k < KEY_COUNT; k += 3)
+      {
+         ASSURE(SymTable_put(oSymTable, paacKeys[k], paacOther[k]));
+         ASSURE(SymTable_get(oSymTable, paacKeys[k]) == paacOther[k]);
+      }
+      ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+      iCount = 0;
+      SymTable_map(oSymTable, countBinding, &iCount);
+      ASSURE(iCount == KEY_COUNT);
+      ASSURE(SymTable_getLength(oSnapshot) ==
+         (size_t)(KEY_COUNT - iRemoved));
+      ASSURE(! SymTable_contains(oSnapshot, paacKeys[0]));
+      SymTable_free(oSnapshot);
+      for (k = 0; k < KEY_COUNT; k++)
+         ASSURE(SymTable_remove(oSymTable, paacKeys[k]) != NULL);
+      ASSURE(SymTable_getLength(oSymTable) == 0);
+      iCount = 0;
+      SymTable_map(oSymTable, countBinding, &iCount);
+      ASSURE(iCount == 0);
+      SymTable_free(oSymTable);
+
+      /* Free the SymTable right after it starts to grow. */
+      for (k = 500; k < KEY_COUNT; k += 500)
+      {
+         oSymTable = SymTable_newWithFlags(SYMTABLE_BACKGROUND_RESIZE |
+            auFlags[f]);
+         ASSURE(oSymTable != NULL);
+         for (iCount = 0; iCount <= k; iCount++)
+            ASSURE(SymTable_put(oSymTable, paacKeys[iCount],
+               paacKeys[iCount]));
+         SymTable_free(oSymTable);
+      }
+   }
+
+   free(paacKeys);
+   free(paacOther);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SYMTABLE_HUGE_PAGES and SymTable_newOnNode, with enough keys
+   for the bucket array to reach huge pages, a snapshot that shares
+   it and a node that does not exist. Implementations that ignore them
+   must pass as well. */
+
+static void testHugePages(void)
+{
+   enum {KEY_COUNT = 20000, MAX_KEY_LENGTH = 10, MODE_COUNT = 5};
+
+   SymTable_T oSymTable;
+   SymTable_T oSnapshot;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   int iCount;
+   int iMode;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable objects in huge pages or on a node.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   paacKeys = malloc(sizeof(*paacKeys) * KEY_COUNT);
+   ASSURE(paacKeys != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+      sprintf(paacKeys[k], "%d", k);
+
+   for (iMode = 0; iMode < MODE_COUNT; iMode++)
+   {
+      switch (iMode)
+      {
+         case 0:
+            oSymTable = SymTable_newWithFlags(SYMTABLE_HUGE_PAGES);
+            break;
+         case 1:
+            oSymTable = SymTable_newWithFlags(SYMTABLE_HUGE_PAGES |
+               SYMTABLE_BACKGROUND_RESIZE);
+            break;
+         case 2:
+            oSymTable = SymTable_newOnNode(0, 0);
+            break;
+         case 3:
+            oSymTable = SymTable_newOnNode(SYMTABLE_HUGE_PAGES |
+               SYMTABLE_FILTER, 0);
+            break;
+         default:
+            oSymTable = SymTable_newOnNode(SYMTABLE_HUGE_PAGES, 100000);
+            break;
+      }
+      ASSURE(oSymTable != NULL);
+      for (k = 0; k < KEY_COUNT; k++)
+         ASSURE(SymTable_put(oSymTable, paacKeys[k], paacKeys[k]));
+      for (k = 0; k < KEY_COUNT; k++)
+         ASSURE(SymTable_get(oSymTable, paacKeys[k]) == paacKeys[k]);
+
+      oSnapshot = SymTable_snapshot(oSymTable);
+      ASSURE(oSnapshot != NULL);
+      for (k = 0; k < KEY_COUNT; k += 2)
+         ASSURE(SymTable_remove(oSymTable, paacKeys[k]) == paacKeys[k]);
+      ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT / 2);
+      iCount = 0;
+      SymTable_map(oSnapshot, countBinding, &iCount);
+      ASSURE(iCount == KEY_COUNT);
+      SymTable_free(oSnapshot);
+      iCount = 0;
+      SymTable_map(oSymTable, countBinding, &iCount);
+      ASSURE(iCount == KEY_COUNT / 2);
+      SymTable_free(oSymTable);
+   }
+
+   free(paacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SYMTABLE_THREAD_CACHE: bindings removed from one SymTable and
+   put into another, with keys of every length up to past what a
+   cache keeps, deferred freeing and borrowed keys, must come out as
+   they went in. Implementations that ignore it must pass as well. */
+
+static void testThreadCache(void)
+{
+   enum {KEY_COUNT = 3000, MAX_KEY_LENGTH = 100, ROUND_COUNT = 4};
+
+   static const unsigned int auFlags[] = {SYMTABLE_THREAD_CACHE,
+      SYMTABLE_THREAD_CACHE | SYMTABLE_DEFER_FREE,
+      SYMTABLE_THREAD_CACHE | SYMTABLE_BORROW_KEYS};
+   SymTable_T aoSymTables[2];
+   SymTable_T oSnapshot;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   size_t f;
+   int iCount;
+   int iRound;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable objects that cache freed memory.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   paacKeys = malloc(sizeof(*paacKeys) * KEY_COUNT);
+   ASSURE(paacKeys != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      memset(paacKeys[k], 'a' + k % 26, (size_t)(k % (MAX_KEY_LENGTH - 8)));
+      sprintf(paacKeys[k] + k % (MAX_KEY_LENGTH - 8), "%d", k);
+   }
+
+   for (f = 0; f < sizeof(auFlags) / sizeof(auFlags[0]); f++)
+   {
+      aoSymTables[0] = SymTable_newWithFlags(auFlags[f]);
+      aoSymTables[1] = SymTable_newWithFlags(auFlags[f]);
+      ASSURE(aoSymTables[0] != NULL && aoSymTables[1] != NULL);
+      for (k = 0; k < KEY_COUNT; k++)
+         ASSURE(SymTable_put(aoSymTables[0], paacKeys[k], paacKeys[k]));
+
+      /* each round moves the bindings to the other SymTable, so that
+         the memory freed by one is taken by the other */
+      for (iRound = 0; iRound < ROUND_COUNT; iRound++)
+      {
+         oSnapshot = SymTable_snapshot(aoSymTables[iRound % 2]);
+         ASSURE(oSnapshot != NULL);
+         for (k = 0; k < KEY_COUNT; k++)
+         {
+            ASSURE(SymTable_remove(aoSymTables[iRound % 2], paacKeys[k])
+               == paacKeys[k]);
+            ASSURE(SymTable_put(aoSymTables[(iRound + 1) % 2],
+               paacKeys[k], paacKeys[k]));
+         }
+         if (iRound == 1)
+            ASSURE(SymTable_reclaim(aoSymTables[iRound % 2],
+               (size_t)-1) == 0);
+         ASSURE(SymTable_getLength(aoSymTables[iRound % 2]) == 0);
+         iCount = 0;
+         SymTable_map(oSnapshot, countBinding, &iCount);
+         ASSURE(iCount == KEY_COUNT);
+         SymTable_free(oSnapshot);
+         iCount = 0;
+         SymTable_map(aoSymTables[(iRound + 1) % 2], countBinding,
+            &iCount);
+         ASSURE(iCount == KEY_COUNT);
+      }
+      for (k = 0; k < KEY_COUNT; k++)
+         ASSURE(SymTable_get(aoSymTables[ROUND_COUNT % 2], paacKeys[k])
+            == paacKeys[k]);
+      SymTable_free(aoSymTables[0]);
+      SymTable_free(aoSymTables[1]);
+   }
+
+   free(paacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_buildParallel, which must build what
+   SymTable_fromArrays builds, whatever the number of threads,
+   including which of two duplicate keys wins. */
+
+static void testBuildParallel(void)
+{
+   enum {KEY_COUNT = 20000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   const char **ppcKeys;
+   const void **ppvValues;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   static const size_t auThreads[] = {0, 1, 3, 8, 100000};
+   size_t uThreads;
+   size_t u;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object built by several threads.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Every key appears twice, the second time bound to itself and
+      the first time to the key after it. */
+   paacKeys = malloc(sizeof(*paacKeys) * (KEY_COUNT + 1));
+   ppcKeys = malloc(sizeof(*ppcKeys) * (2 * KEY_COUNT));
+   ppvValues = malloc(sizeof(*ppvValues) * (2 * KEY_COUNT));
+   ASSURE(paacKeys != NULL && ppcKeys != NULL && ppvValues != NULL);
+   for (k = 0; k <= KEY_COUNT; k++)
+      sprintf(paacKeys[k], "%d", k);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      ppcKeys[k] = paacKeys[k];
+      ppvValues[k] = paacKeys[k + 1];
+      ppcKeys[2 * KEY_COUNT - 1 - k] = paacKeys[k];
+      ppvValues[2 * KEY_COUNT - 1 - k] = paacKeys[k];
+   }
+
+   for (u = 0; u < sizeof(auThreads) / sizeof(auThreads[0]); u++)
+   {
+      uThreads = auThreads[u];
+      oSymTable = SymTable_buildParallel(ppcKeys, ppvValues,
+         2 * KEY_COUNT, uThreads);
+      ASSURE(oSymTable != NULL);
+      ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+      for (k = 0; k < KEY_COUNT; k++)
+         ASSURE(SymTable_get(oSymTable, paacKeys[k]) == paacKeys[k + 1]);
+      ASSURE(! SymTable_contains(oSymTable, paacKeys[KEY_COUNT]));
+      ASSURE(SymTable_remove(oSymTable, paacKeys[0]) == paacKeys[1]);
+      ASSURE(SymTable_put(oSymTable, paacKeys[KEY_COUNT], paacKeys[0]));
+      ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+      SymTable_free(oSymTable);
+   }
+
+   /* Fewer keys than threads. */
+   oSymTable = SymTable_buildParallel(ppcKeys, ppvValues, 2, 8);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+   SymTable_free(oSymTable);
+   oSymTable = SymTable_buildParallel(NULL, NULL, 0, 8);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   SymTable_free(oSymTable);
+
+   free(paacKeys);
+   free(ppcKeys);
+   free(ppvValues);
+}
+
+/*--------------------------------------------------------------------*/
+
 /* Test the ability of a SymTable object to be large, that is, to
    contain iBindingCount bindings. Write the time consumed to stdout. */
 
@@ -960,6 +3270,27 @@ int main(int argc, char *argv[])
    testLongKey();
    testTableOfTables();
    testCollisions();
+   testCrowdedBucket();
+   testStats();
+   testFlooding();
+   testAdaptive();
+   testFromArrays();
+   testMapRange();
+   testSnapshot();
+   testDeferredFree();
+   testFilter();
+   testBounded();
+   testSized();
+   testGenerated();
+   testCursor();
+   testBuildParallel();
+   testLoadStream();
+   testBorrowedKeys();
+   testRetain();
+   testMerge();
+   testBackgroundResize();
+   testHugePages();
+   testThreadCache();
    testLargeTable(iBindingCount);
 
    printf("------------------------------------------------------\n");
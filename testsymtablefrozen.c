@@ -0,0 +1,257 @@
+/*--------------------------------------------------------------------*/
+/* testsymtablefrozen.c                                             */
+/* Author: Kevin Chen                                               */
+/*--------------------------------------------------------------------*/
+
+#include "symtablefrozen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Visit is what checkVisit is given: the keys it should see, in
+   order, and how many it has seen. */
+
+struct Visit
+{
+   const char **ppcKeys;
+   size_t uCount;
+   size_t uSeen;
+};
+
+/* Check that the binding whose key is pcKey is the next one the
+   Visit pvExtra points to expects, and that its value pvValue is the
+   key itself. */
+
+static void checkVisit(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   struct Visit *psVisit = (struct Visit*)pvExtra;
+   ASSURE(psVisit->uSeen < psVisit->uCount);
+   if (psVisit->uSeen < psVisit->uCount)
+      ASSURE(strcmp(pcKey, psVisit->ppcKeys[psVisit->uSeen]) == 0);
+   ASSURE(strcmp(pcKey, (char*)pvValue) == 0);
+   psVisit->uSeen++;
+}
+
+/* Compare the strings ppvFirst and ppvSecond point to, for qsort. */
+
+static int compareKeys(const void *ppvFirst, const void *ppvSecond)
+{
+   return strcmp(*(const char**)ppvFirst, *(const char**)ppvSecond);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a FrozenTable of a few keys that are prefixes of one another,
+   including the empty key, and keys that are not there before,
+   between and after them. */
+
+static void testPrefixes(void)
+{
+   static const char *apcKeys[] = {"", "a", "ab", "abc", "abd", "b",
+      "ba", "bab", "bb", "\377", "\377\377"};
+   static const char *apcMissing[] = {"aa", "abb", "abcd", "abe", "ac",
+      "b\001", "bac", "c", "\377\001", "\377\377\377"};
+   enum {KEY_COUNT = sizeof(apcKeys) / sizeof(apcKeys[0]),
+      MISSING_COUNT = sizeof(apcMissing) / sizeof(apcMissing[0])};
+
+   SymTable_T oSymTable;
+   FrozenTable_T oFrozenTable;
+   struct Visit sVisit;
+   size_t k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a FrozenTable of keys that are prefixes.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   oFrozenTable = FrozenTable_fromSymTable(oSymTable);
+   ASSURE(oFrozenTable != NULL);
+   ASSURE(FrozenTable_getLength(oFrozenTable) == 0);
+   ASSURE(! FrozenTable_contains(oFrozenTable, ""));
+   ASSURE(FrozenTable_get(oFrozenTable, "a") == NULL);
+   sVisit.ppcKeys = apcKeys;
+   sVisit.uCount = 0;
+   sVisit.uSeen = 0;
+   ASSURE(FrozenTable_map(oFrozenTable, checkVisit, &sVisit));
+   ASSURE(FrozenTable_mapPrefix(oFrozenTable, "a", checkVisit, &sVisit));
+   ASSURE(sVisit.uSeen == 0);
+   FrozenTable_free(oFrozenTable);
+
+   /* put the keys in backwards, so that order comes from the table */
+   for (k = KEY_COUNT; k > 0; k--)
+      ASSURE(SymTable_put(oSymTable, apcKeys[k - 1],
+         apcKeys[k - 1]));
+   oFrozenTable = FrozenTable_fromSymTable(oSymTable);
+   ASSURE(oFrozenTable != NULL);
+   SymTable_free(oSymTable);
+
+   ASSURE(FrozenTable_getLength(oFrozenTable) == KEY_COUNT);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      ASSURE(FrozenTable_contains(oFrozenTable, apcKeys[k]));
+      ASSURE(FrozenTable_get(oFrozenTable, apcKeys[k]) == apcKeys[k]);
+   }
+   for (k = 0; k < MISSING_COUNT; k++)
+   {
+      ASSURE(! FrozenTable_contains(oFrozenTable, apcMissing[k]));
+      ASSURE(FrozenTable_get(oFrozenTable, apcMissing[k]) == NULL);
+   }
+
+   sVisit.uCount = KEY_COUNT;
+   sVisit.uSeen = 0;
+   ASSURE(FrozenTable_map(oFrozenTable, checkVisit, &sVisit));
+   ASSURE(sVisit.uSeen == KEY_COUNT);
+
+   sVisit.ppcKeys = &apcKeys[1];
+   sVisit.uCount = 4;
+   sVisit.uSeen = 0;
+   ASSURE(FrozenTable_mapPrefix(oFrozenTable, "a", checkVisit, &sVisit));
+   ASSURE(sVisit.uSeen == 4);
+
+   sVisit.ppcKeys = &apcKeys[6];
+   sVisit.uCount = 2;
+   sVisit.uSeen = 0;
+   ASSURE(FrozenTable_mapPrefix(oFrozenTable, "ba", checkVisit,
+      &sVisit));
+   ASSURE(sVisit.uSeen == 2);
+
+   sVisit.ppcKeys = apcKeys;
+   sVisit.uCount = KEY_COUNT;
+   sVisit.uSeen = 0;
+   ASSURE(FrozenTable_mapPrefix(oFrozenTable, "", checkVisit, &sVisit));
+   ASSURE(sVisit.uSeen == KEY_COUNT);
+
+   sVisit.uCount = 0;
+   sVisit.uSeen = 0;
+   ASSURE(FrozenTable_mapPrefix(oFrozenTable, "abcd", checkVisit,
+      &sVisit));
+   ASSURE(FrozenTable_mapPrefix(oFrozenTable, "c", checkVisit, &sVisit));
+   ASSURE(sVisit.uSeen == 0);
+
+   FrozenTable_free(oFrozenTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a FrozenTable of iKeyCount namespaced keys, which spans many
+   blocks, against the SymTable it was made from. */
+
+static void testMany(int iKeyCount)
+{
+   enum {MAX_KEY_LENGTH = 64};
+
+   SymTable_T oSymTable;
+   FrozenTable_T oFrozenTable;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   const char **ppcSorted;
+   char acOther[MAX_KEY_LENGTH + 1];
+   struct Visit sVisit;
+   size_t uRawBytes = 0;
+   size_t uFirst;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a FrozenTable of many keys.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   paacKeys = malloc(sizeof(*paacKeys) * (size_t)iKeyCount);
+   ppcSorted = malloc(sizeof(*ppcSorted) * (size_t)iKeyCount);
+   ASSURE(paacKeys != NULL && ppcSorted != NULL);
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (k = 0; k < iKeyCount; k++)
+   {
+      sprintf(paacKeys[k], "app::module%d::Class%d::method%d", k % 7,
+         k % 97, k);
+      uRawBytes += strlen(paacKeys[k]) + 1;
+      ppcSorted[k] = paacKeys[k];
+      ASSURE(SymTable_put(oSymTable, paacKeys[k], paacKeys[k]));
+   }
+   qsort(ppcSorted, (size_t)iKeyCount, sizeof(*ppcSorted), compareKeys);
+
+   oFrozenTable = FrozenTable_fromSymTable(oSymTable);
+   ASSURE(oFrozenTable != NULL);
+   ASSURE(FrozenTable_getLength(oFrozenTable) == (size_t)iKeyCount);
+   /* a few keys have little to share */
+   if (iKeyCount >= 1000)
+      ASSURE(FrozenTable_getKeyBytes(oFrozenTable) < uRawBytes / 2);
+
+   for (k = 0; k < iKeyCount; k++)
+   {
+      ASSURE(FrozenTable_get(oFrozenTable, paacKeys[k]) ==
+         SymTable_get(oSymTable, paacKeys[k]));
+      /* a key one character longer or shorter is there only if it is
+         in the SymTable */
+      strcpy(acOther, paacKeys[k]);
+      strcat(acOther, "0");
+      ASSURE(FrozenTable_contains(oFrozenTable, acOther) ==
+         SymTable_contains(oSymTable, acOther));
+      acOther[strlen(acOther) - 2] = '\0';
+      ASSURE(FrozenTable_contains(oFrozenTable, acOther) ==
+         SymTable_contains(oSymTable, acOther));
+   }
+
+   sVisit.ppcKeys = ppcSorted;
+   sVisit.uCount = (size_t)iKeyCount;
+   sVisit.uSeen = 0;
+   ASSURE(FrozenTable_map(oFrozenTable, checkVisit, &sVisit));
+   ASSURE(sVisit.uSeen == (size_t)iKeyCount);
+
+   for (uFirst = 0; uFirst < (size_t)iKeyCount &&
+      strncmp(ppcSorted[uFirst], "app::module3::", 14) != 0; uFirst++)
+      ;
+   sVisit.ppcKeys = &ppcSorted[uFirst];
+   sVisit.uSeen = 0;
+   ASSURE(FrozenTable_mapPrefix(oFrozenTable, "app::module3::",
+      checkVisit, &sVisit));
+   ASSURE(sVisit.uSeen == (size_t)(iKeyCount + 3) / 7);
+
+   SymTable_free(oSymTable);
+   FrozenTable_free(oFrozenTable);
+   free(ppcSorted);
+   free(paacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a FrozenTable of argv[1] keys, or 10000. */
+
+int main(int argc, char *argv[])
+{
+   int iKeyCount = 10000;
+   if (argc > 1)
+      iKeyCount = atoi(argv[1]);
+   if (iKeyCount < 1)
+   {
+      fprintf(stderr, "Usage: %s [keycount]\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+   testPrefixes();
+   testMany(iKeyCount);
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
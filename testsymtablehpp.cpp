@@ -0,0 +1,154 @@
+/*--------------------------------------------------------------------*/
+/* testsymtablehpp.cpp                                              */
+/* Author: Kevin Chen                                               */
+/*--------------------------------------------------------------------*/
+
+#include "symtable.hpp"
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(bool iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      std::printf("Test at line %d failed.\n", iLineNum);
+      std::fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test lookups with std::string_view keys, which must find keys cut
+   from longer strings, and try_emplace and erase. */
+
+static void testLookups()
+{
+   symtable::SymTable oTable;
+   std::string sText = "Ruth Gehrig Ruthless";
+   std::string_view sView = sText;
+   char acRuth[] = "Babe";
+   char acGehrig[] = "Lou";
+   std::pair<symtable::SymTable::iterator, bool> sResult;
+
+   std::printf("------------------------------------------------------\n");
+   std::printf("Testing symtable::SymTable lookups.\n");
+   std::printf("No output should appear here:\n");
+   std::fflush(stdout);
+
+   ASSURE(oTable.empty());
+   sResult = oTable.try_emplace(sView.substr(0, 4), acRuth);
+   ASSURE(sResult.second);
+   ASSURE(sResult.first->first == "Ruth");
+   ASSURE(sResult.first->second == acRuth);
+   sResult = oTable.try_emplace(sView.substr(5, 6), acGehrig);
+   ASSURE(sResult.second);
+   sResult = oTable.try_emplace(sView.substr(12, 4), acGehrig);
+   ASSURE(! sResult.second);
+   ASSURE((*sResult.first).second == acRuth);
+   ASSURE(oTable.size() == 2);
+
+   ASSURE(oTable.contains("Gehrig"));
+   ASSURE(! oTable.contains(sView.substr(12, 8)));
+   ASSURE(oTable.find(std::string("Ruth")) != oTable.end());
+   ASSURE(oTable.find(std::string_view("Ruth\0x", 6)) == oTable.end());
+   ASSURE(SymTable_get(oTable.handle(), "Gehrig") == acGehrig);
+
+   try
+   {
+      oTable.try_emplace(std::string_view("a\0b", 3), acRuth);
+      ASSURE(false);
+   }
+   catch (const std::invalid_argument &)
+   {
+   }
+
+   ASSURE(oTable.erase(sView.substr(12, 4)) == 1);
+   ASSURE(oTable.erase("Ruth") == 0);
+   ASSURE(oTable.size() == 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test iterators, which must visit every binding once, and moves,
+   which must hand the SymTable_T over without freeing it. */
+
+static void testIteratorsAndMoves()
+{
+   enum {KEY_COUNT = 2000};
+
+   symtable::SymTable oTable(SYMTABLE_FILTER);
+   symtable::SymTable oOther;
+   std::set<std::string> oSeen;
+   std::string asKeys[KEY_COUNT];
+   SymTable_T oHandle;
+   int k;
+
+   std::printf("------------------------------------------------------\n");
+   std::printf("Testing symtable::SymTable iterators and moves.\n");
+   std::printf("No output should appear here:\n");
+   std::fflush(stdout);
+
+   ASSURE(oTable.begin() == oTable.end());
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      asKeys[k] = std::to_string(k);
+      ASSURE(oTable.try_emplace(asKeys[k], &asKeys[k]).second);
+   }
+   for (const auto &sBinding : oTable)
+   {
+      ASSURE(*static_cast<std::string *>(sBinding.second) ==
+         sBinding.first);
+      ASSURE(oSeen.insert(std::string(sBinding.first)).second);
+   }
+   ASSURE(oSeen.size() == KEY_COUNT);
+
+   /* Iterating from find goes on to the end. */
+   k = 0;
+   for (auto oIterator = oTable.find("1000"); oIterator != oTable.end();
+      oIterator++)
+      k++;
+   ASSURE(k >= 1 && k <= KEY_COUNT);
+
+   oHandle = oTable.handle();
+   oOther = std::move(oTable);
+   ASSURE(oTable.handle() == nullptr);
+   ASSURE(oOther.handle() == oHandle);
+   ASSURE(oOther.size() == KEY_COUNT);
+   symtable::SymTable oThird(std::move(oOther));
+   ASSURE(oThird.handle() == oHandle);
+   swap(oThird, oOther);
+   ASSURE(oOther.handle() == oHandle);
+
+   oHandle = oOther.release();
+   ASSURE(oOther.handle() == nullptr);
+   symtable::SymTable oAdopted(oHandle);
+   ASSURE(oAdopted.contains("1999"));
+
+   /* A snapshot can be owned too. */
+   symtable::SymTable oSnapshot(SymTable_snapshot(oAdopted.handle()));
+   ASSURE(oAdopted.erase("1999") == 1);
+   ASSURE(oSnapshot.contains("1999"));
+}
+
+/*--------------------------------------------------------------------*/
+
+int main()
+{
+   testLookups();
+   testIteratorsAndMoves();
+   std::printf("------------------------------------------------------\n");
+   return 0;
+}
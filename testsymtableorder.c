@@ -0,0 +1,324 @@
+/*--------------------------------------------------------------------*/
+/* testsymtableorder.c                                              */
+/* Author: Kevin Chen                                               */
+/*--------------------------------------------------------------------*/
+
+#include "symtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Note: This program tests what symtabledict.c promises beyond
+   symtable.h: that SymTable_map and SymTable_next visit the bindings
+   in the order they were put. It is linked with symtabledict.c
+   only. */
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* An Order is the pvExtra of checkOrder: the keys a walk should
+   visit, in order, how many there are and how many were visited. */
+
+struct Order
+{
+   const char **ppcExpected;
+   int iExpected;
+   int iVisited;
+};
+
+/* Check that pcKey is the next key the Order pvExtra expects, and
+   that pvValue is the key itself. */
+
+static void checkOrder(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   struct Order *psOrder = (struct Order*)pvExtra;
+   ASSURE(strcmp(pcKey, (char*)pvValue) == 0);
+   ASSURE(psOrder->iVisited < psOrder->iExpected);
+   if (psOrder->iVisited < psOrder->iExpected)
+      ASSURE(strcmp(pcKey, psOrder->ppcExpected[psOrder->iVisited]) == 0);
+   psOrder->iVisited++;
+}
+
+/* Check that both SymTable_map and a walk with SymTable_next visit
+   the bindings of oSymTable in the order of the iExpected keys of
+   ppcExpected. */
+
+static void assureOrder(SymTable_T oSymTable, const char **ppcExpected,
+   int iExpected, int iLineNum)
+{
+   struct SymTableCursor sCursor = SYMTABLE_CURSOR_INIT;
+   struct Order sOrder;
+   int iVisited = 0;
+
+   sOrder.ppcExpected = ppcExpected;
+   sOrder.iExpected = iExpected;
+   sOrder.iVisited = 0;
+   SymTable_map(oSymTable, checkOrder, &sOrder);
+   assure(sOrder.iVisited == iExpected, iLineNum);
+
+   while (SymTable_next(oSymTable, &sCursor))
+   {
+      assure(iVisited < iExpected &&
+         strcmp(sCursor.pcKey, ppcExpected[iVisited]) == 0, iLineNum);
+      iVisited++;
+   }
+   assure(iVisited == iExpected, iLineNum);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that the bindings are visited in the order they were put,
+   through growing, removal and putting removed keys back, and that a
+   snapshot keeps the order it was taken with. */
+
+static void testPutOrder(void)
+{
+   enum {KEY_COUNT = 5000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   SymTable_T oSnapshot;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   const char **ppcExpected;
+   const char **ppcSnapshot;
+   int iExpected = 0;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the order of bindings put into a SymTable.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   paacKeys = malloc(sizeof(*paacKeys) * KEY_COUNT);
+   ppcExpected = malloc(sizeof(*ppcExpected) * KEY_COUNT);
+   ppcSnapshot = malloc(sizeof(*ppcSnapshot) * KEY_COUNT);
+   ASSURE(paacKeys != NULL && ppcExpected != NULL && ppcSnapshot != NULL);
+
+   /* Put the keys from the last down, so that the order is neither
+      that of the keys nor that of their hash codes. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (k = KEY_COUNT - 1; k >= 0; k--)
+   {
+      sprintf(paacKeys[k], "%d", k);
+      ASSURE(SymTable_put(oSymTable, paacKeys[k], paacKeys[k]));
+      ppcExpected[iExpected++] = paacKeys[k];
+   }
+   assureOrder(oSymTable, ppcExpected, iExpected, __LINE__);
+
+   /* Removing a binding keeps the order of the others, and putting
+      its key back puts it last. */
+   for (k = 0; k < KEY_COUNT; k += 3)
+      ASSURE(SymTable_remove(oSymTable, paacKeys[k]) == paacKeys[k]);
+   iExpected = 0;
+   for (k = KEY_COUNT - 1; k >= 0; k--)
+      if (k % 3 != 0)
+         ppcExpected[iExpected++] = paacKeys[k];
+   assureOrder(oSymTable, ppcExpected, iExpected, __LINE__);
+
+   oSnapshot = SymTable_snapshot(oSymTable);
+   ASSURE(oSnapshot != NULL);
+   memcpy(ppcSnapshot, ppcExpected, sizeof(*ppcExpected) * iExpected);
+
+   for (k = 0; k < KEY_COUNT; k += 6)
+   {
+      ASSURE(SymTable_put(oSymTable, paacKeys[k], paacKeys[k]));
+      ppcExpected[iExpected++] = paacKeys[k];
+   }
+   assureOrder(oSymTable, ppcExpected, iExpected, __LINE__);
+   assureOrder(oSnapshot, ppcSnapshot, KEY_COUNT - (KEY_COUNT + 2) / 3,
+      __LINE__);
+
+   /* Replacing a value, or putting a key that is there, moves
+      nothing. */
+   ASSURE(SymTable_replace(oSymTable, paacKeys[1], paacKeys[1]) ==
+      paacKeys[1]);
+   ASSURE(! SymTable_put(oSymTable, paacKeys[2], paacKeys[2]));
+   assureOrder(oSymTable, ppcExpected, iExpected, __LINE__);
+
+   SymTable_free(oSnapshot);
+   SymTable_free(oSymTable);
+   free(ppcSnapshot);
+   free(ppcExpected);
+   free(paacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 if pcKey is a number that is not a multiple of 4,
+   otherwise 0. */
+
+static int keepNonMultiple(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   (void)pvValue;
+   (void)pvExtra;
+   return atoi(pcKey) % 4 != 0;
+}
+
+/* Test that SymTable_fromArrays keeps the order of the arrays, that
+   SymTable_retain keeps the order of what it keeps, and that
+   SymTable_merge adds the bindings it moves in the order of the
+   SymTable they come from. */
+
+static void testBulkOrder(void)
+{
+   enum {KEY_COUNT = 3000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   SymTable_T oOther;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   const char **ppcKeys;
+   const void **ppvValues;
+   const char **ppcExpected;
+   int iExpected = 0;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the order of bindings made in bulk.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   paacKeys = malloc(sizeof(*paacKeys) * KEY_COUNT);
+   ppcKeys = malloc(sizeof(*ppcKeys) * (KEY_COUNT + 1));
+   ppvValues = malloc(sizeof(*ppvValues) * (KEY_COUNT + 1));
+   ppcExpected = malloc(sizeof(*ppcExpected) * KEY_COUNT);
+   ASSURE(paacKeys != NULL && ppcKeys != NULL && ppvValues != NULL &&
+      ppcExpected != NULL);
+
+   /* The keys go in from the middle out, with the first one again at
+      the end. */
+   for (k = 0; k < KEY_COUNT; k++)
+      sprintf(paacKeys[k], "%d", k);
+   for (k = 0; k < KEY_COUNT; k++)
+      ppcKeys[k] = paacKeys[(KEY_COUNT / 2 + (k % 2 ? k / 2 + 1 :
+         KEY_COUNT - k / 2)) % KEY_COUNT];
+   ppcKeys[KEY_COUNT] = ppcKeys[0];
+   for (k = 0; k <= KEY_COUNT; k++)
+      ppvValues[k] = ppcKeys[k];
+
+   oSymTable = SymTable_fromArrays(ppcKeys, ppvValues, KEY_COUNT + 1);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+   assureOrder(oSymTable, ppcKeys, KEY_COUNT, __LINE__);
+
+   ASSURE(SymTable_retain(oSymTable, keepNonMultiple, NULL, NULL));
+   for (k = 0; k < KEY_COUNT; k++)
+      if (atoi(ppcKeys[k]) % 4 != 0)
+         ppcExpected[iExpected++] = ppcKeys[k];
+   assureOrder(oSymTable, ppcExpected, iExpected, __LINE__);
+
+   /* Merging in every key in decreasing order adds the multiples of
+      4 at the end in that order. */
+   oOther = SymTable_new();
+   ASSURE(oOther != NULL);
+   for (k = KEY_COUNT - 1; k >= 0; k--)
+   {
+      ASSURE(SymTable_put(oOther, paacKeys[k], paacKeys[k]));
+      if (k % 4 == 0)
+         ppcExpected[iExpected++] = paacKeys[k];
+   }
+   ASSURE(SymTable_merge(oSymTable, oOther, SYMTABLE_MERGE_KEEP));
+   ASSURE(SymTable_getLength(oOther) == KEY_COUNT - (KEY_COUNT + 3) / 4);
+   assureOrder(oSymTable, ppcExpected, iExpected, __LINE__);
+
+   SymTable_free(oOther);
+   SymTable_free(oSymTable);
+   free(ppcExpected);
+   free(ppvValues);
+   free(ppcKeys);
+   free(paacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count an evicted binding in the int pvExtra points to. */
+
+static void countEviction(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   (void)pcKey;
+   (void)pvValue;
+   (*(int*)pvExtra)++;
+}
+
+/* Test that a bounded SymTable keeps its bindings from the least to
+   the most recently used, and evicts the least recently used. */
+
+static void testBoundedOrder(void)
+{
+   enum {CAPACITY = 50, ROUNDS = 20, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char aacKeys[CAPACITY + 1][MAX_KEY_LENGTH];
+   const char *apcExpected[CAPACITY];
+   int iEvictions = 0;
+   int r;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the order of bindings in a bounded SymTable.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   for (k = 0; k <= CAPACITY; k++)
+      sprintf(aacKeys[k], "%d", k);
+
+   oSymTable = SymTable_newBounded(CAPACITY, 0, countEviction,
+      &iEvictions);
+   ASSURE(oSymTable != NULL);
+   for (k = 0; k < CAPACITY; k++)
+      ASSURE(SymTable_put(oSymTable, aacKeys[k], aacKeys[k]));
+
+   /* Each round finds the keys from the last down, which turns the
+      order around every time, and enough rounds squeeze out the
+      holes left behind many times over. */
+   for (r = 0; r < ROUNDS; r++)
+      for (k = 0; k < CAPACITY; k++)
+      {
+         ASSURE(SymTable_contains(oSymTable,
+            r % 2 == 0 ? aacKeys[CAPACITY - 1 - k] : aacKeys[k]));
+      }
+   for (k = 0; k < CAPACITY; k++)
+      apcExpected[k] = aacKeys[k];
+   assureOrder(oSymTable, apcExpected, CAPACITY, __LINE__);
+
+   /* The first key is the least recently used, so a new key evicts
+      it and goes last. */
+   ASSURE(SymTable_put(oSymTable, aacKeys[CAPACITY], aacKeys[CAPACITY]));
+   ASSURE(iEvictions == 1);
+   ASSURE(! SymTable_contains(oSymTable, aacKeys[0]));
+   for (k = 0; k < CAPACITY; k++)
+      apcExpected[k] = aacKeys[k + 1];
+   assureOrder(oSymTable, apcExpected, CAPACITY, __LINE__);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+   (void)argc;
+   testPutOrder();
+   testBulkOrder();
+   testBoundedOrder();
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
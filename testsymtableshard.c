@@ -0,0 +1,496 @@
+/*--------------------------------------------------------------------*/
+/* testsymtableshard.c                                              */
+/* Author: Kevin Chen                                               */
+/*--------------------------------------------------------------------*/
+
+#include "symtableshard.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count the binding whose key is pcKey in the size_t pvExtra points
+   to, checking that its value pvValue is the key itself. */
+
+static void countBinding(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   ASSURE(strcmp(pcKey, (char*)pvValue) == 0);
+   (*(size_t*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the ShardTable functions from one thread. */
+
+static void testBasics(void)
+{
+   enum {KEY_COUNT = 5000, MAX_KEY_LENGTH = 10};
+
+   ShardTable_T oShardTable;
+   char (*paacKeys)[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   size_t uCount;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the basic ShardTable functions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oShardTable = ShardTable_new(5, 0);
+   ASSURE(oShardTable != NULL);
+   ASSURE(ShardTable_getShards(oShardTable) == 8);
+   ASSURE(ShardTable_getLength(oShardTable) == 0);
+
+   paacKeys = malloc(sizeof(*paacKeys) * KEY_COUNT);
+   ASSURE(paacKeys != NULL);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      sprintf(paacKeys[k], "%d", k);
+      ASSURE(ShardTable_put(oShardTable, paacKeys[k], paacKeys[k]));
+   }
+   ASSURE(! ShardTable_put(oShardTable, paacKeys[0], acValue));
+   ASSURE(ShardTable_getLength(oShardTable) == KEY_COUNT);
+   for (k = 0; k < KEY_COUNT; k++)
+   {
+      ASSURE(ShardTable_contains(oShardTable, paacKeys[k]));
+      ASSURE(ShardTable_get(oShardTable, paacKeys[k]) == paacKeys[k]);
+   }
+   ASSURE(! ShardTable_contains(oShardTable, "-1"));
+   ASSURE(ShardTable_get(oShardTable, "-1") == NULL);
+
+   uCount = 0;
+   ShardTable_map(oShardTable, countBinding, &uCount);
+   ASSURE(uCount == KEY_COUNT);
+
+   ASSURE(ShardTable_replace(oShardTable, paacKeys[1], acValue) ==
+      paacKeys[1]);
+   ASSURE(ShardTable_get(oShardTable, paacKeys[1]) == acValue);
+   ASSURE(ShardTable_replace(oShardTable, "-1", acValue) == NULL);
+   ASSURE(ShardTable_remove(oShardTable, paacKeys[1]) == acValue);
+   ASSURE(ShardTable_remove(oShardTable, paacKeys[1]) == NULL);
+   ASSURE(ShardTable_getLength(oShardTable) == KEY_COUNT - 1);
+
+   /* A NULL value still counts as a binding, and its removal too. */
+   ASSURE(ShardTable_put(oShardTable, "null", NULL));
+   ASSURE(ShardTable_getLength(oShardTable) == KEY_COUNT);
+   ASSURE(ShardTable_remove(oShardTable, "null") == NULL);
+   ASSURE(ShardTable_getLength(oShardTable) == KEY_COUNT - 1);
+   ShardTable_free(oShardTable);
+
+   /* Short keys, whose hash codes are small, and shards made with
+      flags. */
+   oShardTable = ShardTable_new(16, SYMTABLE_HARDENED);
+   ASSURE(oShardTable != NULL);
+   for (k = 0; k < 256; k++)
+   {
+      sprintf(paacKeys[k], "%c%c", 'A' + k % 26, 'a' + k / 26);
+      ASSURE(ShardTable_put(oShardTable, paacKeys[k], paacKeys[k]));
+   }
+   ASSURE(ShardTable_getLength(oShardTable) == 256);
+   for (k = 0; k < 256; k++)
+      ASSURE(ShardTable_get(oShardTable, paacKeys[k]) == paacKeys[k]);
+   ShardTable_free(oShardTable);
+
+   oShardTable = ShardTable_new(0, 0);
+   ASSURE(oShardTable != NULL);
+   ASSURE(ShardTable_getShards(oShardTable) == 1);
+   ASSURE(ShardTable_put(oShardTable, "", acValue));
+   ASSURE(ShardTable_get(oShardTable, "") == acValue);
+   ShardTable_free(oShardTable);
+
+   free(paacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+enum {THREAD_COUNT = 8, THREAD_KEYS = 20000, THREAD_KEY_LENGTH = 12};
+
+/* Worker is what one thread of testThreads does: it puts its keys,
+   reads them back, and removes every other one, while reading the
+   length of the whole ShardTable along the way. */
+struct Worker
+{
+   ShardTable_T oShardTable;
+   char (*paacKeys)[THREAD_KEY_LENGTH];
+   int iFailures;
+   pthread_t sThread;
+};
+
+static void *runWorker(void *pvWorker)
+{
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   int k;
+   for (k = 0; k < THREAD_KEYS; k++)
+   {
+      if (! ShardTable_put(psWorker->oShardTable, psWorker->paacKeys[k],
+         psWorker->paacKeys[k]))
+         psWorker->iFailures++;
+      if (k % 1000 == 0 &&
+         ShardTable_getLength(psWorker->oShardTable) <
+         (size_t)k + 1)
+         psWorker->iFailures++;
+   }
+   for (k = 0; k < THREAD_KEYS; k++)
+      if (ShardTable_get(psWorker->oShardTable, psWorker->paacKeys[k]) !=
+         psWorker->paacKeys[k])
+         psWorker->iFailures++;
+   for (k = 0; k < THREAD_KEYS; k += 2)
+      if (ShardTable_remove(psWorker->oShardTable,
+         psWorker->paacKeys[k]) != psWorker->paacKeys[k])
+         psWorker->iFailures++;
+   return NULL;
+}
+
+/* Test a ShardTable used by THREAD_COUNT threads at once, each with
+   keys of its own. */
+
+static void testThreads(void)
+{
+   ShardTable_T oShardTable;
+   struct Worker asWorkers[THREAD_COUNT];
+   char (*paacKeys)[THREAD_KEY_LENGTH];
+   size_t uCount;
+   int t;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a ShardTable used by several threads.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oShardTable = ShardTable_new(64, 0);
+   ASSURE(oShardTable != NULL);
+   paacKeys = malloc(sizeof(*paacKeys) * THREAD_COUNT * THREAD_KEYS);
+   ASSURE(paacKeys != NULL);
+   for (k = 0; k < THREAD_COUNT * THREAD_KEYS; k++)
+      sprintf(paacKeys[k], "%d", k);
+
+   for (t = 0; t < THREAD_COUNT; t++)
+   {
+      asWorkers[t].oShardTable = oShardTable;
+      asWorkers[t].paacKeys = &paacKeys[t * THREAD_KEYS];
+      asWorkers[t].iFailures = 0;
+      ASSURE(pthread_create(&asWorkers[t].sThread, NULL, runWorker,
+         &asWorkers[t]) == 0);
+   }
+   for (t = 0; t < THREAD_COUNT; t++)
+   {
+      pthread_join(asWorkers[t].sThread, NULL);
+      ASSURE(asWorkers[t].iFailures == 0);
+   }
+
+   ASSURE(ShardTable_getLength(oShardTable) ==
+      THREAD_COUNT * THREAD_KEYS / 2);
+   for (k = 0; k < THREAD_COUNT * THREAD_KEYS; k++)
+      ASSURE(ShardTable_contains(oShardTable, paacKeys[k]) == (k % 2));
+   uCount = 0;
+   ShardTable_map(oShardTable, countBinding, &uCount);
+   ASSURE(uCount == THREAD_COUNT * THREAD_KEYS / 2);
+
+   ShardTable_free(oShardTable);
+   free(paacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* ITEM_LIVE marks an Item that is in use, and ITEM_FREED one that
+   freeItem is about to free */
+enum {ITEM_LIVE = 0x11FE, ITEM_FREED = 0xDEAD};
+
+/* Item is a value that testRetire and testRetireThreads put into a
+   ShardTable and retire */
+struct Item
+{
+   int iState;
+   char acKey[THREAD_KEY_LENGTH];
+};
+
+/* Return a new live Item with key pcKey, or NULL if there is no
+   memory. */
+
+static struct Item *newItem(const char *pcKey)
+{
+   struct Item *psItem = malloc(sizeof(struct Item));
+   if (psItem == NULL)
+      return NULL;
+   psItem->iState = ITEM_LIVE;
+   strcpy(psItem->acKey, pcKey);
+   return psItem;
+}
+
+/* Mark the Item pvItem freed and free it. */
+
+static void freeItem(void *pvItem)
+{
+   ((struct Item*)pvItem)->iState = ITEM_FREED;
+   free(pvItem);
+}
+
+/* iFreed counts the calls of countFree, which only testRetire makes
+   from one thread */
+
+static int iFreed = 0;
+
+/* Count a call, and free the Item pvItem. */
+
+static void countFree(void *pvItem)
+{
+   iFreed++;
+   freeItem(pvItem);
+}
+
+/* Free the Item pvValue bound to pcKey, and count it in the size_t
+   pvExtra points to. */
+
+static void freeBinding(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   ASSURE(strcmp(pcKey, ((struct Item*)pvValue)->acKey) == 0);
+   freeItem(pvValue);
+   (*(size_t*)pvExtra)++;
+}
+
+/* Test retiring values from one thread joined twice, once as a
+   thread that lags behind. */
+
+static void testRetire(void)
+{
+   ShardTable_T oShardTable;
+   ShardThread_T oWriter;
+   ShardThread_T oReader;
+   struct Item *psItem;
+   char acKey[THREAD_KEY_LENGTH];
+   size_t uCount;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing values retired from a ShardTable.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oShardTable = ShardTable_new(4, SYMTABLE_THREAD_CACHE);
+   ASSURE(oShardTable != NULL);
+   oWriter = ShardTable_join(oShardTable);
+   ASSURE(oWriter != NULL);
+   for (k = 0; k < 100; k++)
+   {
+      sprintf(acKey, "%d", k);
+      psItem = newItem(acKey);
+      ASSURE(psItem != NULL);
+      ASSURE(ShardTable_put(oShardTable, acKey, psItem));
+   }
+
+   /* With no other thread joined, a quiescent state frees what was
+      retired before it. */
+   psItem = ShardTable_remove(oShardTable, "0");
+   ASSURE(psItem != NULL);
+   ASSURE(ShardTable_retire(oShardTable, oWriter, psItem, countFree));
+   ASSURE(iFreed == 0);
+   ShardTable_quiesce(oShardTable, oWriter);
+   ASSURE(iFreed == 1);
+
+   /* A reader that joined waits out what is retired after, until it
+      passes a quiescent state of its own. */
+   oReader = ShardTable_join(oShardTable);
+   ASSURE(oReader != NULL);
+   for (k = 1; k < 11; k++)
+   {
+      sprintf(acKey, "%d", k);
+      psItem = ShardTable_remove(oShardTable, acKey);
+      ASSURE(psItem != NULL && psItem->iState == ITEM_LIVE);
+      ASSURE(ShardTable_retire(oShardTable, oWriter, psItem, countFree));
+   }
+   ShardTable_quiesce(oShardTable, oWriter);
+   ShardTable_quiesce(oShardTable, oWriter);
+   ASSURE(iFreed == 1);
+   ShardTable_quiesce(oShardTable, oReader);
+   ASSURE(iFreed == 1);
+   ShardTable_quiesce(oShardTable, oWriter);
+   ASSURE(iFreed == 11);
+
+   /* What a thread that leaves has retired is freed by another once
+      it may be, or by ShardTable_free. */
+   for (k = 11; k < 21; k++)
+   {
+      sprintf(acKey, "%d", k);
+      psItem = ShardTable_remove(oShardTable, acKey);
+      ASSURE(ShardTable_retire(oShardTable, oReader, psItem, countFree));
+   }
+   ShardTable_leave(oShardTable, oReader);
+   ASSURE(iFreed == 11);
+   psItem = ShardTable_remove(oShardTable, "21");
+   ASSURE(ShardTable_retire(oShardTable, oWriter, psItem, countFree));
+   ShardTable_quiesce(oShardTable, oWriter);
+   ASSURE(iFreed == 22);
+   oReader = ShardTable_join(oShardTable);
+   ASSURE(oReader != NULL);
+   psItem = ShardTable_remove(oShardTable, "22");
+   ASSURE(ShardTable_retire(oShardTable, oWriter, psItem, countFree));
+   ShardTable_leave(oShardTable, oWriter);
+   ShardTable_leave(oShardTable, oReader);
+   ASSURE(iFreed == 22);
+
+   uCount = 0;
+   ShardTable_map(oShardTable, freeBinding, &uCount);
+   ASSURE(uCount == 77);
+   ShardTable_free(oShardTable);
+   ASSURE(iFreed == 23);
+}
+
+/*--------------------------------------------------------------------*/
+
+enum {RETIRE_KEYS = 512, RETIRE_STEPS = 100000, QUIESCE_STEPS = 64};
+
+/* Retirer is what one thread of testRetireThreads does: it puts,
+   gets and removes keys that all threads share, checks every value
+   it gets while other threads may remove it, retires the values it
+   removes and passes a quiescent state every QUIESCE_STEPS steps. */
+struct Retirer
+{
+   ShardTable_T oShardTable;
+   char (*paacKeys)[THREAD_KEY_LENGTH];
+   unsigned int uSeed;
+   long lPuts;
+   long lRemoves;
+   int iFailures;
+   pthread_t sThread;
+};
+
+static void *runRetirer(void *pvRetirer)
+{
+   struct Retirer *psRetirer = (struct Retirer*)pvRetirer;
+   ShardThread_T oShardThread;
+   struct Item *psItem;
+   const char *pcKey;
+   int iStep;
+
+   oShardThread = ShardTable_join(psRetirer->oShardTable);
+   if (oShardThread == NULL)
+   {
+      psRetirer->iFailures++;
+      return NULL;
+   }
+   for (iStep = 0; iStep < RETIRE_STEPS; iStep++)
+   {
+      psRetirer->uSeed = psRetirer->uSeed * 1103515245u + 12345u;
+      pcKey = psRetirer->paacKeys[(psRetirer->uSeed >> 8) % RETIRE_KEYS];
+      switch ((psRetirer->uSeed >> 4) % 4)
+      {
+         case 0:
+            psItem = newItem(pcKey);
+            if (psItem == NULL)
+               psRetirer->iFailures++;
+            else if (ShardTable_put(psRetirer->oShardTable, pcKey, psItem))
+               psRetirer->lPuts++;
+            else
+               freeItem(psItem);
+            break;
+         case 1:
+            psItem = ShardTable_remove(psRetirer->oShardTable, pcKey);
+            if (psItem != NULL)
+            {
+               psRetirer->lRemoves++;
+               if (! ShardTable_retire(psRetirer->oShardTable,
+                  oShardThread, psItem, freeItem))
+                  psRetirer->iFailures++;
+            }
+            break;
+         default:
+            psItem = ShardTable_get(psRetirer->oShardTable, pcKey);
+            if (psItem != NULL && (psItem->iState != ITEM_LIVE ||
+               strcmp(psItem->acKey, pcKey) != 0))
+               psRetirer->iFailures++;
+            break;
+      }
+      if (iStep % QUIESCE_STEPS == 0)
+         ShardTable_quiesce(psRetirer->oShardTable, oShardThread);
+   }
+   ShardTable_leave(psRetirer->oShardTable, oShardThread);
+   return NULL;
+}
+
+/* Test THREAD_COUNT threads that put, get, remove and retire the same
+   few keys at once, in shards that cache freed memory, as a stress
+   test for ThreadSanitizer. */
+
+static void testRetireThreads(void)
+{
+   ShardTable_T oShardTable;
+   struct Retirer asRetirers[THREAD_COUNT];
+   char (*paacKeys)[THREAD_KEY_LENGTH];
+   long lLength = 0;
+   size_t uCount;
+   int t;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing values retired by several threads.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oShardTable = ShardTable_new(8, SYMTABLE_THREAD_CACHE);
+   ASSURE(oShardTable != NULL);
+   paacKeys = malloc(sizeof(*paacKeys) * RETIRE_KEYS);
+   ASSURE(paacKeys != NULL);
+   for (k = 0; k < RETIRE_KEYS; k++)
+      sprintf(paacKeys[k], "%d", k);
+
+   for (t = 0; t < THREAD_COUNT; t++)
+   {
+      asRetirers[t].oShardTable = oShardTable;
+      asRetirers[t].paacKeys = paacKeys;
+      asRetirers[t].uSeed = (unsigned int)t + 1;
+      asRetirers[t].lPuts = 0;
+      asRetirers[t].lRemoves = 0;
+      asRetirers[t].iFailures = 0;
+      ASSURE(pthread_create(&asRetirers[t].sThread, NULL, runRetirer,
+         &asRetirers[t]) == 0);
+   }
+   for (t = 0; t < THREAD_COUNT; t++)
+   {
+      pthread_join(asRetirers[t].sThread, NULL);
+      ASSURE(asRetirers[t].iFailures == 0);
+      lLength += asRetirers[t].lPuts - asRetirers[t].lRemoves;
+   }
+
+   ASSURE(ShardTable_getLength(oShardTable) == (size_t)lLength);
+   uCount = 0;
+   ShardTable_map(oShardTable, freeBinding, &uCount);
+   ASSURE(uCount == (size_t)lLength);
+   ShardTable_free(oShardTable);
+   free(paacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+   (void)argc;
+   testBasics();
+   testThreads();
+   testRetire();
+   testRetireThreads();
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}